@@ -91,6 +91,8 @@ public:
 #include "arduino/ArduinoAnalogDevice.h"
 #elif defined(BUILD_FOR_PICO_CMAKE)
 #include "pico/picoAnalogDevice.h"
+#elif defined(BUILD_FOR_HOST)
+#include "host/HostAnalogDevice.h"
 #endif
 
 /**
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include "AtomicSettingsEeprom.h"
+#include <IoLogging.h>
+#include <string.h>
+
+// CRC32 (the reflected 0xEDB88320 polynomial) a nibble at a time, a 16 entry table is a good trade between flash
+// use and speed for the few hundred bytes checked at boot.
+static const uint32_t crc32Nibbles[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, uint16_t len) {
+    for(uint16_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4U) ^ crc32Nibbles[crc & 0x0fU];
+        crc = (crc >> 4U) ^ crc32Nibbles[crc & 0x0fU];
+    }
+    return crc;
+}
+
+static void storeLittleEndian32(uint8_t* dest, uint32_t val) {
+    dest[0] = uint8_t(val);
+    dest[1] = uint8_t(val >> 8U);
+    dest[2] = uint8_t(val >> 16U);
+    dest[3] = uint8_t(val >> 24U);
+}
+
+static uint32_t loadLittleEndian32(const uint8_t* src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8U) | ((uint32_t)src[2] << 16U) | ((uint32_t)src[3] << 24U);
+}
+
+AtomicSettingsEeprom::AtomicSettingsEeprom(EepromAbstraction* backing, EepromPosition start, uint16_t settingsSize)
+        : backing(backing), start(start), settingsSize(settingsSize) {
+    settings = new uint8_t[settingsSize];
+    memset(settings, 0, settingsSize);
+}
+
+AtomicSettingsEeprom::~AtomicSettingsEeprom() {
+    delete[] settings;
+}
+
+bool AtomicSettingsEeprom::begin() {
+    // clear down anything left over, so that any error seen is from reading the copies.
+    backing->hasErrorOccurred();
+
+    uint32_t seq[2], crc[2];
+    readHeader(0, seq[0], crc[0]);
+    readHeader(1, seq[1], crc[1]);
+
+    // the sequence wraps, so the newer copy is the one with a positive difference
+    uint8_t newest = int32_t(seq[1] - seq[0]) > 0 ? 1 : 0;
+    for(uint8_t attempt = 0; attempt < 2; attempt++) {
+        uint8_t copy = (attempt == 0) ? newest : (1 - newest);
+        if(loadCopy(copy, seq[copy], crc[copy])) {
+            activeCopy = copy;
+            sequence = seq[copy];
+            dirty = false;
+            serlogF3(SER_IOA_INFO, "Settings loaded copy, seq ", copy, sequence);
+            return true;
+        }
+    }
+
+    serlogF(SER_IOA_INFO, "Settings no valid copy");
+    memset(settings, 0, settingsSize);
+    activeCopy = 1;
+    sequence = 0;
+    dirty = false;
+    return false;
+}
+
+void AtomicSettingsEeprom::readHeader(uint8_t copy, uint32_t& seq, uint32_t& crc) {
+    uint8_t header[ATOMIC_SETTINGS_HEADER_SIZE];
+    backing->readIntoMemArray(header, copyBase(copy), sizeof header);
+    seq = loadLittleEndian32(header);
+    crc = loadLittleEndian32(&header[4]);
+}
+
+bool AtomicSettingsEeprom::loadCopy(uint8_t copy, uint32_t seq, uint32_t crc) {
+    bool readOk = backing->readIntoMemArrayWide(settings, copyBase(copy) + ATOMIC_SETTINGS_HEADER_SIZE, settingsSize);
+    return readOk && !backing->hasErrorOccurred() && settingsCrc(seq) == crc;
+}
+
+uint32_t AtomicSettingsEeprom::settingsCrc(uint32_t seq) {
+    uint8_t seqBytes[4];
+    storeLittleEndian32(seqBytes, seq);
+    uint32_t crc = crc32Update(0xffffffffUL, seqBytes, sizeof seqBytes);
+    return crc32Update(crc, settings, settingsSize) ^ 0xffffffffUL;
+}
+
+bool AtomicSettingsEeprom::commit() {
+    if(!dirty) return true;
+
+    uint8_t copy = 1 - activeCopy;
+    uint32_t newSequence = sequence + 1;
+
+    bool ok = backing->writeArrayToRomWide(copyBase(copy) + ATOMIC_SETTINGS_HEADER_SIZE, settings, settingsSize);
+
+    // the settings must be in the backing store before the header that validates them, a backing store that caches
+    // writes could otherwise write the header first.
+    ok = backing->flush() && ok;
+
+    uint8_t header[ATOMIC_SETTINGS_HEADER_SIZE];
+    storeLittleEndian32(header, newSequence);
+    storeLittleEndian32(&header[4], settingsCrc(newSequence));
+    backing->writeArrayToRom(copyBase(copy), header, sizeof header);
+    ok = backing->flush() && ok;
+
+    if(!ok || backing->hasErrorOccurred()) {
+        serlogF2(SER_ERROR, "Settings commit failed, copy ", copy);
+        errorOccurred = true;
+        return false;
+    }
+
+    activeCopy = copy;
+    sequence = newSequence;
+    dirty = false;
+    return true;
+}
+
+bool AtomicSettingsEeprom::inBounds(EepromWidePosition position, size_t len) {
+    if(len > settingsSize || position > (settingsSize - len)) {
+        errorOccurred = true;
+        return false;
+    }
+    return true;
+}
+
+void AtomicSettingsEeprom::writeChanges(EepromPosition position, const uint8_t* data, size_t len) {
+    if(!inBounds(position, len)) return;
+    if(memcmp(&settings[position], data, len) != 0) {
+        memcpy(&settings[position], data, len);
+        dirty = true;
+    }
+}
+
+bool AtomicSettingsEeprom::hasErrorOccurred() {
+    bool err = errorOccurred;
+    errorOccurred = false;
+    return err;
+}
+
+uint8_t AtomicSettingsEeprom::read8(EepromPosition position) {
+    if(!inBounds(position, 1)) return 0;
+    return settings[position];
+}
+
+void AtomicSettingsEeprom::write8(EepromPosition position, uint8_t val) {
+    writeChanges(position, &val, 1);
+}
+
+uint16_t AtomicSettingsEeprom::read16(EepromPosition position) {
+    if(!inBounds(position, 2)) return 0;
+    return settings[position] | (settings[position + 1] << 8U);
+}
+
+void AtomicSettingsEeprom::write16(EepromPosition position, uint16_t val) {
+    uint8_t data[2] = { uint8_t(val), uint8_t(val >> 8U) };
+    writeChanges(position, data, sizeof data);
+}
+
+uint32_t AtomicSettingsEeprom::read32(EepromPosition position) {
+    if(!inBounds(position, 4)) return 0;
+    return loadLittleEndian32(&settings[position]);
+}
+
+void AtomicSettingsEeprom::write32(EepromPosition position, uint32_t val) {
+    uint8_t data[4];
+    storeLittleEndian32(data, val);
+    writeChanges(position, data, sizeof data);
+}
+
+void AtomicSettingsEeprom::readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) {
+    if(!inBounds(romSrc, len)) return;
+    memcpy(memDest, &settings[romSrc], len);
+}
+
+void AtomicSettingsEeprom::writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) {
+    writeChanges(romDest, memSrc, len);
+}
+
+bool AtomicSettingsEeprom::readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) {
+    if(!inBounds(romSrc, len)) return false;
+    memcpy(memDest, &settings[romSrc], len);
+    return true;
+}
+
+bool AtomicSettingsEeprom::writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) {
+    if(!inBounds(romDest, len)) return false;
+    writeChanges((EepromPosition)romDest, memSrc, len);
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_ATOMICSETTINGSEEPROM_H
+#define IOA_ATOMICSETTINGSEEPROM_H
+
+/**
+ * @file AtomicSettingsEeprom.h
+ * @brief An EepromAbstraction that keeps two copies of a block of settings in any other EepromAbstraction, so that a
+ * save is all or nothing, even if the power fails part way through it.
+ */
+
+#include "EepromAbstraction.h"
+
+/** the size of the header before each copy, a four byte sequence number then a four byte CRC32 */
+#define ATOMIC_SETTINGS_HEADER_SIZE 8
+
+/**
+ * Wraps any other EepromAbstraction, such as I2cAt24Eeprom, and holds a block of settings as two copies, A and B,
+ * each with a sequence number and a CRC32 over the sequence and the settings. Writes are made to a copy in RAM, and
+ * nothing is written to the backing store until commit() is called, which writes the whole block into the copy that
+ * is not active, then its header, and only then is it the active copy. Should the power fail during a commit, the
+ * copy being written fails its check at the next boot and the previous settings are used.
+ *
+ * Call begin() once at boot, it reads the two headers and then loads the newest valid copy with one bulk array read,
+ * rather than reading each setting from the backing store. After that all reads come from RAM. Multi byte values are
+ * stored little endian. The region used in the backing store is twice the header plus the settings size.
+ */
+class AtomicSettingsEeprom : public EepromAbstraction {
+private:
+    EepromAbstraction* backing;
+    uint8_t* settings;
+    EepromPosition start;
+    uint16_t settingsSize;
+    uint32_t sequence = 0;
+    uint8_t activeCopy = 1;
+    bool dirty = false;
+    bool errorOccurred = false;
+public:
+    /**
+     * Create the settings store over a region of another EEPROM.
+     * @param backing the EEPROM that holds both copies
+     * @param start the start of the region in the backing EEPROM
+     * @param settingsSize the size of the settings block, the region used is 2 * (ATOMIC_SETTINGS_HEADER_SIZE + size)
+     */
+    AtomicSettingsEeprom(EepromAbstraction* backing, EepromPosition start, uint16_t settingsSize);
+    ~AtomicSettingsEeprom() override;
+    AtomicSettingsEeprom(const AtomicSettingsEeprom&) = delete;
+    AtomicSettingsEeprom& operator=(const AtomicSettingsEeprom&) = delete;
+
+    /**
+     * Loads the newest valid copy of the settings from the backing EEPROM. If neither copy is valid, such as on first
+     * use, the settings are all zero until written and committed.
+     * @return true if a valid copy was loaded, otherwise false.
+     */
+    bool begin();
+
+    /**
+     * Writes any changes made since the last commit into the inactive copy, then makes it the active one. If nothing
+     * has changed, nothing is written.
+     * @return true if the settings were committed without error.
+     */
+    bool commit();
+
+    /** @return true if there are changes that have not been committed yet */
+    bool isDirty() const { return dirty; }
+
+    /** @return the sequence number of the active copy, it goes up by one on each commit */
+    uint32_t getSequence() const { return sequence; }
+
+    /** @return the copy that is active, 0 for A or 1 for B */
+    uint8_t getActiveCopy() const { return activeCopy; }
+
+    /** @return the size of the settings block */
+    uint16_t getSettingsSize() const { return settingsSize; }
+
+    bool hasErrorOccurred() override;
+
+    uint8_t read8(EepromPosition position) override;
+    void write8(EepromPosition position, uint8_t val) override;
+
+    uint16_t read16(EepromPosition position) override;
+    void write16(EepromPosition position, uint16_t val) override;
+
+    uint32_t read32(EepromPosition position) override;
+    void write32(EepromPosition position, uint32_t val) override;
+
+    void readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) override;
+    void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) override;
+
+    bool readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) override;
+    bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) override;
+
+    /** commits any changes, see commit() */
+    bool flush() override { return commit(); }
+private:
+    EepromPosition copyBase(uint8_t copy) const { return start + (copy * (ATOMIC_SETTINGS_HEADER_SIZE + settingsSize)); }
+    bool inBounds(EepromWidePosition position, size_t len);
+    void readHeader(uint8_t copy, uint32_t& seq, uint32_t& crc);
+    bool loadCopy(uint8_t copy, uint32_t seq, uint32_t crc);
+    uint32_t settingsCrc(uint32_t seq);
+    void writeChanges(EepromPosition position, const uint8_t* data, size_t len);
+};
+
+#endif //IOA_ATOMICSETTINGSEEPROM_H
@@ -11,16 +11,41 @@
  * @brief Provides the core IoAbstraction interface and Arduino implementation of that interface.
  */
 #include "PlatformDetermination.h"
+#include "IoDeviceStats.h"
 #include <TaskManagerIO.h>
 
 #define IO_PIN_NOT_DEFINED 0xFF
 
+/**
+ * A set of up to 32 pins used by the bulk readPins and writePins calls. Bit 0 of the mask represents the first pin
+ * that was passed to the call, bit 1 the pin after that, and so on.
+ */
+typedef uint32_t IoPinMask;
+
+/** the number of pins that can be represented in a single IoPinMask */
+#define IO_PIN_MASK_BITS 32
+
+/**
+ * Get a mask with all the bits from firstBit up to (but not including) lastBit set, where lastBit can be at most
+ * IO_PIN_MASK_BITS.
+ * @param firstBit the first bit to set
+ * @param lastBit one past the last bit to set
+ * @return the mask with the range of bits set
+ */
+inline IoPinMask ioPinMaskForRange(uint8_t firstBit, uint8_t lastBit) {
+    if(firstBit >= lastBit) return 0;
+    IoPinMask upper = (lastBit >= IO_PIN_MASK_BITS) ? 0xFFFFFFFFUL : ((IoPinMask(1) << lastBit) - 1);
+    return upper & ~((IoPinMask(1) << firstBit) - 1);
+}
+
 #if defined(IOA_USE_MBED)
 # include "mbed/MbedDigitalIO.h"
 #elif defined(ESP32) && defined(IOA_USE_ESP32_EXTRAS)
 # include "esp32/ESP32DigitalIO.h"
 #elif defined(BUILD_FOR_PICO_CMAKE)
 # include "pico/PicoDigitalIO.h"
+#elif defined(BUILD_FOR_HOST)
+# include "host/HostDigitalIO.h"
 #else
 # include <Arduino.h>
 #endif //IOA_USE_MBED
@@ -42,6 +67,9 @@ private:
 
     GpioWrapper *allocatePinIfNeedBe(uint8_t pinToAlloc);
 #endif //IOA_USE_MBED
+#ifndef IOA_DISABLE_DEVICE_STATS
+    IoDeviceStats* deviceStats = nullptr;
+#endif
 public:
 	virtual ~BasicIoAbstraction() = default;
 
@@ -67,7 +95,7 @@ public:
      * @param p the pin to read
      * @return HIGH or LOW
      */
-    uint8_t digitalReadS(pinid_t p) { runLoop(); return readValue(p); }
+    uint8_t digitalReadS(pinid_t p) { sync(); return readValue(p); }
 
     /**
      * Writes a new digital value for a given pin on the device. For I2C and other off-chip devices this does sync()
@@ -107,9 +135,41 @@ public:
      * This method is not needed on Arduino pins, but for most serial implementations it causes the device and abstraction to be synced.
 	 * Returns true if the write call worked, normally true, false indicates error
      * @return true if successful, otherwise false.
-     * @see runLoop this just calls runLoop, it is a renaming to make the intention clearer.
+     * @see runLoop this calls runLoop, counting and timing the call when stats are attached to the device.
      */
-    bool sync() { return runLoop(); }
+    bool sync() {
+#ifndef IOA_DISABLE_DEVICE_STATS
+        // the scope is opened even without stats, so that this device's traffic is not counted against a tracked
+        // device that yields while its own scope is active.
+        IoDeviceStatsScope scope(deviceStats, true);
+        return scope.syncResult(runLoop());
+#else
+        return runLoop();
+#endif
+    }
+
+    /**
+     * Attach statistics to this device, from then on each sync and any I2C traffic the device generates are counted
+     * into the stats provided. Pass nullptr to stop tracking. Has no effect when IOA_DISABLE_DEVICE_STATS is defined.
+     * @param stats the stats to count into, it must remain valid while attached.
+     * @see IoDeviceStats
+     */
+    void setDeviceStats(IoDeviceStats* stats) {
+#ifndef IOA_DISABLE_DEVICE_STATS
+        deviceStats = stats;
+#endif
+    }
+
+    /**
+     * @return the stats attached to this device, or nullptr if there are none.
+     */
+    IoDeviceStats* getDeviceStats() {
+#ifndef IOA_DISABLE_DEVICE_STATS
+        return deviceStats;
+#else
+        return nullptr;
+#endif
+    }
 
     /**
 	 * sets the pin direction for a pin controlled by this abstraction - as per `pinMode`
@@ -161,6 +221,74 @@ public:
 	 * @return the 8 bit value read from the port.
 	 */
 	virtual uint8_t readPort(pinid_t pin);
+
+	/**
+	 * Reads many pins in a single call, each bit in the mask represents a pin starting at firstPin, so bit 0 is
+	 * firstPin, bit 1 is firstPin + 1 and so on for up to 32 pins. For serial devices, you need to sync first. Devices
+	 * that cache their state override this to return the pins directly from the cache, by default it calls readValue
+	 * for each pin in the mask.
+	 * @param firstPin the pin that is represented by bit 0 of the mask
+	 * @param mask the pins that should be read
+	 * @return the state of the pins as a mask, where only the bits set in mask are meaningful
+	 */
+	virtual IoPinMask readPins(pinid_t firstPin, IoPinMask mask) {
+	    IoPinMask result = 0;
+	    for(uint8_t i = 0; mask != 0; ++i, mask >>= 1) {
+	        if((mask & 1U) && readValue(firstPin + i)) result |= (IoPinMask(1) << i);
+	    }
+	    return result;
+	}
+
+	/**
+	 * Writes many pins in a single call, each bit in the mask represents a pin starting at firstPin, so bit 0 is
+	 * firstPin, bit 1 is firstPin + 1 and so on for up to 32 pins. Only the pins in the mask are changed. For serial
+	 * devices you need to sync afterwards. By default it calls writeValue for each pin in the mask.
+	 * @param firstPin the pin that is represented by bit 0 of the mask
+	 * @param mask the pins that should be written
+	 * @param values the new value for each pin in the mask
+	 */
+	virtual void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) {
+	    for(uint8_t i = 0; mask != 0; ++i, mask >>= 1, values >>= 1) {
+	        if(mask & 1U) writeValue(firstPin + i, values & 1U);
+	    }
+	}
+
+	/**
+	 * Gets the pins that may have changed since they were last cleared with clearChangedPins, each bit in the mask
+	 * represents a pin starting at firstPin as with readPins. Changes are collected over every sync until cleared, so
+	 * a sync made by other code, such as to update outputs, does not hide them. Code that handles inputs, such as
+	 * switches and rotary encoders, can use this to skip pins that have not changed, clearing the pins it handles
+	 * straight after reading them. Devices that cannot tell return the whole mask, which is the default, as any of the
+	 * pins might have changed.
+	 * @param firstPin the pin that is represented by bit 0 of the mask
+	 * @param mask the pins that are of interest
+	 * @return the pins within the mask that may have changed since they were last cleared
+	 */
+	virtual IoPinMask changedPins(pinid_t /*firstPin*/, IoPinMask mask) { return mask; }
+
+	/**
+	 * Clears the changed state of the given pins, so that changedPins only reports them again once a later sync sees
+	 * them change. Only clear the pins that you handle, as other code may be waiting to see changes on the rest. By
+	 * default this does nothing, as devices that cannot tell which pins changed report them all.
+	 * @param firstPin the pin that is represented by bit 0 of the mask
+	 * @param mask the pins to clear
+	 */
+	virtual void clearChangedPins(pinid_t /*firstPin*/, IoPinMask /*mask*/) { }
+
+	/**
+	 * Starts a batch of pin configuration. Until commitConfig is called, the device may hold back configuration such
+	 * as pinDirection and attachInterrupt, and then write it in as few transactions as possible. Use this around
+	 * setting up many pins on an I2C device, such as when adding several switches. Calls can be nested, only the
+	 * outermost commitConfig writes to the device. Devices that have nothing to gain, such as board pins, apply
+	 * the configuration straight away, and by default this does nothing.
+	 */
+	virtual void beginConfig() { }
+
+	/**
+	 * Ends a batch of configuration started with beginConfig, writing any configuration that was held back.
+	 * @return true if successful, otherwise false.
+	 */
+	virtual bool commitConfig() { return true; }
 };
 
 /** 
@@ -230,7 +358,7 @@ inline void ioDeviceDigitalWrite(IoAbstractionRef ioDev, pinid_t pin, uint8_t va
  * Moving forward we recommend using the abstractions directly as per documentation.
  * @param ioDev the IoAbstraction to be synchronised.
  */ 
-inline bool ioDeviceSync(IoAbstractionRef ioDev) { return ioDev->runLoop(); }
+inline bool ioDeviceSync(IoAbstractionRef ioDev) { return ioDev->sync(); }
 
 /**
  * Attach an interrupt to any IoAbstraction, regardless of the device location this will perform the required tasks to register
@@ -252,7 +380,7 @@ inline void ioDeviceAttachInterrupt(IoAbstractionRef ioDev, pinid_t pin, RawIntH
  * @param ioDev the previously created IoAbstraction
  * @param the pin on the device to read 
  */
-inline uint8_t ioDeviceDigitalReadS(IoAbstractionRef ioDev, pinid_t pin) { ioDev->runLoop(); return ioDev->readValue(pin); }
+inline uint8_t ioDeviceDigitalReadS(IoAbstractionRef ioDev, pinid_t pin) { ioDev->sync(); return ioDev->readValue(pin); }
 
 /**
  * Works in the same way as digitalWrite, but this works for any `IoAbstractionRef`, unlike the non 'S' version this automatically
@@ -263,7 +391,7 @@ inline uint8_t ioDeviceDigitalReadS(IoAbstractionRef ioDev, pinid_t pin) { ioDev
  * @param pin the pin to be updated
  * @param val the new value for the pin, HIGH/LOW
  */
-inline bool ioDeviceDigitalWriteS(IoAbstractionRef ioDev, pinid_t pin, uint8_t val) { ioDev->writeValue(pin, (val)); return ioDev->runLoop(); }
+inline bool ioDeviceDigitalWriteS(IoAbstractionRef ioDev, pinid_t pin, uint8_t val) { ioDev->writeValue(pin, (val)); return ioDev->sync(); }
 
 /**
  * Write a whole 8 bit byte onto the port that the pin belongs to. For example if pin 42 where on PORTH then this would write to PORTH.
@@ -277,7 +405,7 @@ inline bool ioDeviceDigitalWriteS(IoAbstractionRef ioDev, pinid_t pin, uint8_t v
  * @param pinOnPort any pin belonging to the port
  * @param val the new value for the port
  */
-inline bool ioDeviceDigitalWritePortS(IoAbstractionRef ioDev, pinid_t pinOnPort, uint8_t portVal) { ioDev->writePort(pinOnPort, portVal); return ioDev->runLoop(); }
+inline bool ioDeviceDigitalWritePortS(IoAbstractionRef ioDev, pinid_t pinOnPort, uint8_t portVal) { ioDev->writePort(pinOnPort, portVal); return ioDev->sync(); }
 
 /**
  * Reads a whole 8 bit value back from the port with automatic sync before the operation. Specify the pin on the port that you wish to read.
@@ -291,7 +419,7 @@ inline bool ioDeviceDigitalWritePortS(IoAbstractionRef ioDev, pinid_t pinOnPort,
  * @param pin any pin belonging to the port to be read
  * @return the value of the port.
  */
-inline uint8_t ioDeviceDigitalReadPortS(IoAbstractionRef ioDev, pinid_t pinOnPort) { ioDev->runLoop(); return ioDev->readPort(pinOnPort);  }
+inline uint8_t ioDeviceDigitalReadPortS(IoAbstractionRef ioDev, pinid_t pinOnPort) { ioDev->sync(); return ioDev->readPort(pinOnPort);  }
 
 /**
  * Write a whole 8 bit byte onto the port that the pin belongs to. For example if pin 42 where on PORTH then this would write to PORTH.
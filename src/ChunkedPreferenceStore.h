@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_CHUNKEDPREFERENCESTORE_H
+#define IOA_CHUNKEDPREFERENCESTORE_H
+
+/**
+ * @file ChunkedPreferenceStore.h
+ * @brief Holds a RAM copy of a storage area that is saved as fixed size chunks, each under its own key in a key value
+ * store such as the ESP32 Preferences (NVS) API, so that a commit only writes the chunks that changed.
+ */
+
+#include "PlatformDetermination.h"
+#include <IoLogging.h>
+#include <string.h>
+
+/** the default size of each chunk, each is stored under its own key so smaller chunks mean less written per change */
+#ifndef IOA_PREFS_CHUNK_SIZE
+#define IOA_PREFS_CHUNK_SIZE 64
+#endif
+
+/** NVS keys are limited to 15 characters, the prefix is shortened so that there is room for the chunk number */
+#define IOA_PREFS_MAX_PREFIX 10
+#define IOA_PREFS_MAX_KEY 16
+
+/**
+ * Keeps a RAM copy of a storage area split into chunks, each stored under the key prefix followed by the chunk number,
+ * for example "ioa0", "ioa1" and so on. Writes are made to RAM and mark the chunks they change as dirty, commit() then
+ * writes only those chunks. Chunks are loaded lazily, the first time any byte in them is read or written, so a reload
+ * costs nothing until the data is needed. A chunk that is not in the store, or has the wrong length, reads as zero.
+ *
+ * It is a template over the key value store so that it can be used with the ESP32 Preferences class on device, and
+ * with a fake store when testing on host. The store must provide these functions with the same meaning as Preferences:
+ * isKey(key), getBytesLength(key), getBytes(key, buffer, maxLen), putBytes(key, data, len) and remove(key).
+ *
+ * The key prefix on its own is the key that older versions stored the whole area under in one blob. While that key
+ * holds a blob of the right size, it is loaded, and each chunk that is not yet stored is taken from it and marked
+ * dirty, so it is moved over to chunks at the next commit. The blob is only removed once every chunk is stored, so a
+ * commit that does not complete is carried on at the next boot.
+ *
+ * @tparam PrefsType the key value store, such as Preferences
+ */
+template<class PrefsType> class ChunkedPreferenceStore {
+private:
+    PrefsType& prefs;
+    uint8_t* store;
+    uint8_t* loadedChunks;
+    uint8_t* dirtyChunks;
+    size_t storeSize;
+    uint32_t chunksWritten = 0;
+    uint16_t chunkSize;
+    uint16_t chunkCount;
+    char keyPrefix[IOA_PREFS_MAX_PREFIX + 1];
+    bool storeOk = true;
+    bool legacyBlobPending = false;
+public:
+    /**
+     * Create the chunked store, the key value store must be opened before begin is called
+     * @param prefs the key value store to save chunks in
+     * @param prefix the key prefix, each chunk key is this followed by the chunk number, up to 10 characters are used
+     * @param size the size of the storage area
+     * @param chunkSize the size of each chunk, the last chunk may be shorter
+     */
+    ChunkedPreferenceStore(PrefsType& prefs, const char* prefix, size_t size, uint16_t chunkSize = IOA_PREFS_CHUNK_SIZE)
+            : prefs(prefs), storeSize(size), chunkSize(chunkSize) {
+        chunkCount = (size + chunkSize - 1) / chunkSize;
+        store = new uint8_t[size];
+        loadedChunks = new uint8_t[bitmapSize()];
+        dirtyChunks = new uint8_t[bitmapSize()];
+        memset(store, 0, size);
+        memset(loadedChunks, 0, bitmapSize());
+        memset(dirtyChunks, 0, bitmapSize());
+        strncpy(keyPrefix, prefix, IOA_PREFS_MAX_PREFIX);
+        keyPrefix[IOA_PREFS_MAX_PREFIX] = 0;
+    }
+
+    ~ChunkedPreferenceStore() {
+        delete[] store;
+        delete[] loadedChunks;
+        delete[] dirtyChunks;
+    }
+
+    ChunkedPreferenceStore(const ChunkedPreferenceStore&) = delete;
+    ChunkedPreferenceStore& operator=(const ChunkedPreferenceStore&) = delete;
+
+    /**
+     * Prepare the store for use once the key value store is open. Nothing is loaded unless there is an older single
+     * blob to move over to chunks, everything else is loaded on first use.
+     */
+    void begin() {
+        reload();
+    }
+
+    /**
+     * Copy from the storage area into memory, loading any chunks that are not yet in RAM.
+     * @return false if the range is outside of the storage area
+     */
+    bool read(size_t position, uint8_t* dest, size_t len) {
+        if(!inBounds(position, len)) return false;
+        ensureLoaded(position, len);
+        memcpy(dest, &store[position], len);
+        return true;
+    }
+
+    /**
+     * Copy from memory into the storage area, only the chunks where the data actually changes are marked dirty.
+     * @return false if the range is outside of the storage area
+     */
+    bool write(size_t position, const uint8_t* src, size_t len) {
+        if(!inBounds(position, len)) return false;
+        ensureLoaded(position, len);
+        for(size_t i = 0; i < len; i++) {
+            if(store[position + i] != src[i]) {
+                store[position + i] = src[i];
+                setBit(dirtyChunks, (position + i) / chunkSize);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Write each dirty chunk to the key value store, chunks that have not changed are not written.
+     * @return true if all the dirty chunks were written
+     */
+    bool commit() {
+        bool allWritten = true;
+        char key[IOA_PREFS_MAX_KEY];
+        for(uint16_t chunk = 0; chunk < chunkCount; chunk++) {
+            if(!isBitSet(dirtyChunks, chunk)) continue;
+            chunkKey(key, chunk);
+            size_t len = chunkLength(chunk);
+            if(prefs.putBytes(key, &store[chunk * chunkSize], len) == len) {
+                clearBit(dirtyChunks, chunk);
+                chunksWritten++;
+            } else {
+                serlogF2(SER_ERROR, "Prefs chunk write failed ", chunk);
+                allWritten = false;
+            }
+        }
+
+        // the old single blob is only removed once every chunk has been stored
+        if(allWritten && legacyBlobPending) {
+            prefs.remove(keyPrefix);
+            legacyBlobPending = false;
+        }
+
+        // an error is kept only while there are changes that could not be written
+        storeOk = allWritten;
+        return allWritten;
+    }
+
+    /**
+     * Throw away the RAM copy, including any changes that are not committed, so that each chunk is loaded again from
+     * the key value store when it is next used, or from the older single blob while it still exists. It also clears
+     * any error.
+     */
+    void reload() {
+        memset(loadedChunks, 0, bitmapSize());
+        memset(dirtyChunks, 0, bitmapSize());
+        storeOk = true;
+        loadLegacyBlob();
+    }
+
+    /** @return true if any chunk has changes that are not yet committed, or the older single blob is not yet removed */
+    bool isDirty() const {
+        if(legacyBlobPending) return true;
+        for(uint16_t i = 0; i < bitmapSize(); i++) {
+            if(dirtyChunks[i]) return true;
+        }
+        return false;
+    }
+
+    /** @return true if the given chunk has changes that are not yet committed */
+    bool isChunkDirty(uint16_t chunk) const { return chunk < chunkCount && isBitSet(dirtyChunks, chunk); }
+
+    /** @return true if the given chunk has been loaded into RAM */
+    bool isChunkLoaded(uint16_t chunk) const { return chunk < chunkCount && isBitSet(loadedChunks, chunk); }
+
+    /** @return false if loading or committing a chunk failed since begin, reload, or the last commit that wrote all */
+    bool isOk() const { return storeOk; }
+
+    /** @return the number of chunks that the storage area is split into */
+    uint16_t getChunkCount() const { return chunkCount; }
+
+    /** @return the size of each chunk */
+    uint16_t getChunkSize() const { return chunkSize; }
+
+    /** @return the size of the storage area */
+    size_t getStoreSize() const { return storeSize; }
+
+    /** @return the total number of chunks written by commits, useful to see how much flash is being written */
+    uint32_t getChunksWritten() const { return chunksWritten; }
+
+    /**
+     * Create the key for a chunk, the prefix followed by the chunk number in decimal
+     * @param key a buffer of at least IOA_PREFS_MAX_KEY characters
+     * @param chunk the chunk number
+     */
+    void chunkKey(char* key, uint16_t chunk) const {
+        size_t prefixLen = strlen(keyPrefix);
+        memcpy(key, keyPrefix, prefixLen);
+        char digits[6];
+        int count = 0;
+        do {
+            digits[count++] = char('0' + (chunk % 10));
+            chunk /= 10;
+        } while(chunk != 0);
+        for(int i = 0; i < count; i++) key[prefixLen + i] = digits[count - i - 1];
+        key[prefixLen + count] = 0;
+    }
+
+private:
+    uint16_t bitmapSize() const { return (chunkCount + 7) / 8; }
+    static bool isBitSet(const uint8_t* bits, uint16_t chunk) { return (bits[chunk / 8] & (1U << (chunk % 8))) != 0; }
+    static void setBit(uint8_t* bits, uint16_t chunk) { bits[chunk / 8] |= (1U << (chunk % 8)); }
+    static void clearBit(uint8_t* bits, uint16_t chunk) { bits[chunk / 8] &= ~(1U << (chunk % 8)); }
+
+    size_t chunkLength(uint16_t chunk) const {
+        size_t start = size_t(chunk) * chunkSize;
+        return (storeSize - start) < chunkSize ? (storeSize - start) : chunkSize;
+    }
+
+    bool inBounds(size_t position, size_t len) const {
+        return len <= storeSize && position <= (storeSize - len);
+    }
+
+    void ensureLoaded(size_t position, size_t len) {
+        if(len == 0) return;
+        uint16_t last = (position + len - 1) / chunkSize;
+        for(uint16_t chunk = position / chunkSize; chunk <= last; chunk++) {
+            if(!isBitSet(loadedChunks, chunk)) loadChunk(chunk);
+        }
+    }
+
+    bool isChunkStored(const char* key, uint16_t chunk) {
+        return prefs.isKey(key) && prefs.getBytesLength(key) == chunkLength(chunk);
+    }
+
+    void loadLegacyBlob() {
+        legacyBlobPending = prefs.isKey(keyPrefix) && prefs.getBytesLength(keyPrefix) == storeSize;
+        if(!legacyBlobPending) return;
+
+        serlogF2(SER_IOA_INFO, "Prefs moving blob to chunks ", keyPrefix);
+        if(prefs.getBytes(keyPrefix, store, storeSize) != storeSize) {
+            // the blob is kept so that moving it over can be tried again at the next boot
+            serlogF2(SER_ERROR, "Prefs blob load failed ", keyPrefix);
+            legacyBlobPending = false;
+            storeOk = false;
+            return;
+        }
+
+        // chunks stored by an earlier commit that did not complete are newer than the blob, so they are loaded on
+        // first use as usual, the rest are taken from the blob and are dirty until they are stored.
+        char key[IOA_PREFS_MAX_KEY];
+        for(uint16_t chunk = 0; chunk < chunkCount; chunk++) {
+            chunkKey(key, chunk);
+            if(isChunkStored(key, chunk)) continue;
+            setBit(loadedChunks, chunk);
+            setBit(dirtyChunks, chunk);
+        }
+    }
+
+    void loadChunk(uint16_t chunk) {
+        char key[IOA_PREFS_MAX_KEY];
+        chunkKey(key, chunk);
+        size_t len = chunkLength(chunk);
+        uint8_t* dest = &store[chunk * chunkSize];
+        setBit(loadedChunks, chunk);
+
+        if(!isChunkStored(key, chunk)) {
+            memset(dest, 0, len);
+            return;
+        }
+        if(prefs.getBytes(key, dest, len) != len) {
+            serlogF2(SER_ERROR, "Prefs chunk load failed ", chunk);
+            memset(dest, 0, len);
+            storeOk = false;
+        }
+    }
+};
+
+#endif //IOA_CHUNKEDPREFERENCESTORE_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include "DeferredCommitPolicy.h"
+#include <IoLogging.h>
+#include "BasicIoAbstraction.h"
+
+void DeferredCommitPolicy::changed() {
+    stats.changesNotified++;
+    unsigned long now = millis();
+    lastChangeAt = now;
+    if(pending) return;
+
+    pending = true;
+    firstChangeAt = now;
+    if(!registered) {
+        registered = true;
+        taskManager.registerEvent(this);
+    }
+    // wake the event so that it works out when the commit is due, rather than waiting for the idle check.
+    markTriggeredAndNotify();
+}
+
+uint32_t DeferredCommitPolicy::millisUntilCommit(unsigned long now, DeferredCommitDeadline& deadline) const {
+    deadline = DEFERRED_COMMIT_QUIET;
+    if(!pending) return 0;
+
+    // the times wrap, so they are always compared by their difference
+    unsigned long due = lastChangeAt + quietMillis;
+    unsigned long latencyDue = firstChangeAt + maxLatencyMillis;
+    if(int32_t(latencyDue - due) < 0) {
+        due = latencyDue;
+        deadline = DEFERRED_COMMIT_LATENCY;
+    }
+    if(committedYet && minIntervalMillis != 0) {
+        unsigned long rateDue = lastCommitAt + minIntervalMillis;
+        if(int32_t(rateDue - due) > 0) {
+            due = rateDue;
+            deadline = DEFERRED_COMMIT_RATE_LIMITED;
+        }
+    }
+    int32_t remaining = int32_t(due - now);
+    return remaining > 0 ? uint32_t(remaining) : 0;
+}
+
+uint32_t DeferredCommitPolicy::timeOfNextCheck() {
+    if(!pending) return DEFERRED_COMMIT_IDLE_MICROS;
+
+    uint32_t remaining = millisUntilCommit(millis());
+    if(remaining == 0) {
+        setTriggered(true);
+        return DEFERRED_COMMIT_IDLE_MICROS;
+    }
+    return (remaining >= DEFERRED_COMMIT_IDLE_MICROS / 1000UL) ? DEFERRED_COMMIT_IDLE_MICROS : remaining * 1000UL;
+}
+
+void DeferredCommitPolicy::exec() {
+    unsigned long now = millis();
+    DeferredCommitDeadline deadline;
+    if(pending && millisUntilCommit(now, deadline) == 0) {
+        switch(deadline) {
+            case DEFERRED_COMMIT_LATENCY: stats.latencyCommits++; break;
+            case DEFERRED_COMMIT_RATE_LIMITED: stats.rateLimitedCommits++; break;
+            default: stats.quietCommits++; break;
+        }
+        doCommit(now);
+    }
+}
+
+bool DeferredCommitPolicy::commitNow() {
+    if(!pending) return true;
+    return doCommit(millis());
+}
+
+bool DeferredCommitPolicy::doCommit(unsigned long now) {
+    unsigned long started = micros();
+    bool ok = store->flush();
+    auto taken = uint32_t(micros() - started);
+
+    stats.commits++;
+    stats.lastCommitMicros = taken;
+    stats.totalCommitMicros += taken;
+    if(taken > stats.maxCommitMicros) stats.maxCommitMicros = taken;
+    lastCommitAt = now;
+    committedYet = true;
+
+    if(!ok) {
+        // try again later, treating it as a new change so it waits at least the quiet period.
+        serlogF(SER_ERROR, "Deferred commit failed");
+        stats.failedCommits++;
+        firstChangeAt = lastChangeAt = now;
+        return false;
+    }
+    pending = false;
+    return true;
+}
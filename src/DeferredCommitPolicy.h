@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_DEFERREDCOMMITPOLICY_H
+#define IOA_DEFERREDCOMMITPOLICY_H
+
+/**
+ * @file DeferredCommitPolicy.h
+ * @brief A task manager event that decides when to commit an EepromAbstraction that holds its writes in RAM, such as
+ * EspPreferencesEeprom, HalStm32EepromAbstraction or AtomicSettingsEeprom, so that the application does not have to.
+ */
+
+#include "EepromAbstraction.h"
+#include <TaskManagerIO.h>
+
+/** How often the policy checks for work when nothing has changed, telling it about a change wakes it immediately */
+#define DEFERRED_COMMIT_IDLE_MICROS 250000UL
+
+/**
+ * Which of the timings decided when the next commit is due, see DeferredCommitPolicy::millisUntilCommit.
+ */
+enum DeferredCommitDeadline : uint8_t {
+    /** due once nothing has changed for the quiet period */
+    DEFERRED_COMMIT_QUIET,
+    /** due because the oldest uncommitted change reaches the maximum latency first */
+    DEFERRED_COMMIT_LATENCY,
+    /** held back until the minimum interval since the last commit has passed */
+    DEFERRED_COMMIT_RATE_LIMITED
+};
+
+/**
+ * Holds the counters for a commit policy, they can be used to tune the timings for a product. All counters wrap
+ * around at their maximum value.
+ */
+struct DeferredCommitStats {
+    /** the number of times the policy was told about a change */
+    uint32_t changesNotified;
+    /** the number of commits that were carried out */
+    uint32_t commits;
+    /** the number of commits that reported failure, each is tried again as if the store had just changed */
+    uint32_t failedCommits;
+    /** the number of commits made because nothing had changed for the quiet period */
+    uint32_t quietCommits;
+    /** the number of commits made because the maximum latency was reached while changes were still being made */
+    uint32_t latencyCommits;
+    /** the number of commits that were held back until the minimum interval since the previous commit had passed */
+    uint32_t rateLimitedCommits;
+    /** the total time spent committing in microseconds */
+    uint32_t totalCommitMicros;
+    /** the longest single commit in microseconds */
+    uint32_t maxCommitMicros;
+    /** the time that the most recent commit took in microseconds */
+    uint32_t lastCommitMicros;
+
+    DeferredCommitStats() { reset(); }
+
+    /** clear all the counters back to zero */
+    void reset() {
+        changesNotified = commits = failedCommits = quietCommits = latencyCommits = rateLimitedCommits = 0;
+        totalCommitMicros = maxCommitMicros = lastCommitMicros = 0;
+    }
+};
+
+/**
+ * Commits an EepromAbstraction by calling its flush() method at a sensible time after it has been changed, it is an
+ * event registered with task manager the first time that a change is notified. Call changed() after writing to the
+ * store, then changes are coalesced into one commit once nothing has changed for the quiet period. When changes keep
+ * coming, such as while an encoder is turned, a commit is made anyway once the first uncommitted change is older than
+ * the maximum latency. In both cases commits are never closer together than the minimum interval, which takes priority
+ * over the maximum latency to limit flash wear. A commit that fails is tried again later, as if the store had just
+ * changed.
+ *
+ * Before the power is removed, call commitNow() to commit anything still outstanding straight away. As events cannot
+ * be removed from task manager, the policy should be a global or otherwise live as long as the program.
+ */
+class DeferredCommitPolicy : public BaseEvent {
+private:
+    EepromAbstraction* store;
+    DeferredCommitStats stats;
+    uint32_t quietMillis;
+    uint32_t maxLatencyMillis;
+    uint32_t minIntervalMillis;
+    unsigned long firstChangeAt = 0;
+    unsigned long lastChangeAt = 0;
+    unsigned long lastCommitAt = 0;
+    bool pending = false;
+    bool committedYet = false;
+    bool registered = false;
+public:
+    /**
+     * Create a commit policy for a store, the timings can be changed later using setTimings.
+     * @param store the store to commit by calling its flush method
+     * @param quietMillis commit once there have been no changes for this long
+     * @param maxLatencyMillis commit once the oldest uncommitted change is this old, even if changes are still coming
+     * @param minIntervalMillis never commit more often than this, 0 for no limit
+     */
+    DeferredCommitPolicy(EepromAbstraction* store, uint32_t quietMillis, uint32_t maxLatencyMillis, uint32_t minIntervalMillis = 0)
+            : store(store), quietMillis(quietMillis), maxLatencyMillis(maxLatencyMillis), minIntervalMillis(minIntervalMillis) {}
+
+    /**
+     * Change the timings, see the constructor for what each one means.
+     */
+    void setTimings(uint32_t quiet, uint32_t maxLatency, uint32_t minInterval) {
+        quietMillis = quiet;
+        maxLatencyMillis = maxLatency;
+        minIntervalMillis = minInterval;
+    }
+
+    /**
+     * Tell the policy that the store has changed, call it after each write, or group of writes, to the store.
+     */
+    void changed();
+
+    /**
+     * Commit any changes straight away, ignoring the timings, for example before the power is removed.
+     * @return true if there was nothing to commit or the commit succeeded
+     */
+    bool commitNow();
+
+    /** @return true if there are changes that have not yet been committed */
+    bool isPending() const { return pending; }
+
+    /**
+     * @param now the current time in milliseconds
+     * @return the number of milliseconds until the next commit is due, 0 if it is due now or nothing is pending
+     */
+    uint32_t millisUntilCommit(unsigned long now) const {
+        DeferredCommitDeadline deadline;
+        return millisUntilCommit(now, deadline);
+    }
+
+    /**
+     * @param now the current time in milliseconds
+     * @param deadline set to the timing that decided when the commit is due
+     * @return the number of milliseconds until the next commit is due, 0 if it is due now or nothing is pending
+     */
+    uint32_t millisUntilCommit(unsigned long now, DeferredCommitDeadline& deadline) const;
+
+    /** @return the counters for this policy */
+    const DeferredCommitStats& getStats() const { return stats; }
+
+    /** clear the counters back to zero */
+    void resetStats() { stats.reset(); }
+
+    uint32_t timeOfNextCheck() override;
+    void exec() override;
+private:
+    bool doCommit(unsigned long now);
+};
+
+#endif //IOA_DEFERREDCOMMITPOLICY_H
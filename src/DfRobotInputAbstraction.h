@@ -35,7 +35,7 @@ struct DfRobotAnalogRanges {
 #define ALLOWABLE_RANGE 0.01F
 #endif // ALLOWABLE_RANGE
 
-#if defined(IOA_USE_MBED) || defined(BUILD_FOR_PICO_CMAKE)
+#if defined(IOA_USE_MBED) || defined(BUILD_FOR_PICO_CMAKE) || defined(BUILD_FOR_HOST)
 #define pgmAsFloat(x) ((float)(*x))
 #define A0 26
 #else
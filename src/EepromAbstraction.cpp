@@ -4,6 +4,33 @@
  */
 #include "EepromAbstraction.h"
 
+// the narrow functions can only reach the first 64K, and take at most 255 bytes at a time.
+#define NARROW_EEPROM_LIMIT 0x10000UL
+
+bool EepromAbstraction::readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) {
+	if(len > NARROW_EEPROM_LIMIT || romSrc > (NARROW_EEPROM_LIMIT - len)) return false;
+	while(len > 0) {
+		auto currentGo = (uint8_t)(len > 0xffU ? 0xffU : len);
+		readIntoMemArray(memDest, (EepromPosition)romSrc, currentGo);
+		memDest += currentGo;
+		romSrc += currentGo;
+		len -= currentGo;
+	}
+	return true;
+}
+
+bool EepromAbstraction::writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) {
+	if(len > NARROW_EEPROM_LIMIT || romDest > (NARROW_EEPROM_LIMIT - len)) return false;
+	while(len > 0) {
+		auto currentGo = (uint8_t)(len > 0xffU ? 0xffU : len);
+		writeArrayToRom((EepromPosition)romDest, memSrc, currentGo);
+		memSrc += currentGo;
+		romDest += currentGo;
+		len -= currentGo;
+	}
+	return true;
+}
+
 #ifdef __AVR__
 
 #include <avr/eeprom.h>
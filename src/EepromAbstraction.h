@@ -13,10 +13,11 @@
 #define _IOABSTRACTION_EEPROMABSTRACTION_H_
 
 #include "PlatformDetermination.h"
+#include "IoDeviceStats.h"
 
 #ifdef IOA_USE_MBED
 #include <mbed.h>
-#elif !defined(BUILD_FOR_PICO_CMAKE)
+#elif !defined(BUILD_FOR_PICO_CMAKE) && !defined(BUILD_FOR_HOST)
 #include <Arduino.h>
 #endif
 
@@ -25,15 +26,46 @@
  */
 typedef uint16_t EepromPosition;
 
+/**
+ * Defines an address or position within larger storage, used by the wide array functions that can reach beyond 64K
+ */
+typedef uint32_t EepromWidePosition;
+
 /**
  * Provides an abstraction on eeprom storage, to allow either on chip or external I2c based eeprom storage, or even
  * No storage whatsoever. This helps no end with 32 bit boards that don't have eeprom!
  * Most EEPROM implementions here only write if there are changes.
  */
 class EepromAbstraction {
+protected:
+#ifndef IOA_DISABLE_DEVICE_STATS
+	IoDeviceStats* deviceStats = nullptr;
+#endif
 public:
 	virtual ~EepromAbstraction() {}
 
+	/**
+	 * Attach statistics to this EEPROM, from then on any I2C traffic it generates is counted into the stats provided.
+	 * Pass nullptr to stop tracking. Has no effect when IOA_DISABLE_DEVICE_STATS is defined.
+	 * @param stats the stats to count into, it must remain valid while attached.
+	 */
+	void setDeviceStats(IoDeviceStats* stats) {
+#ifndef IOA_DISABLE_DEVICE_STATS
+		deviceStats = stats;
+#endif
+	}
+
+	/**
+	 * @return the stats attached to this EEPROM, or nullptr if there are none.
+	 */
+	IoDeviceStats* getDeviceStats() {
+#ifndef IOA_DISABLE_DEVICE_STATS
+		return deviceStats;
+#else
+		return nullptr;
+#endif
+	}
+
 	/**
 	 * Best efforts error flag that will clear once read.
 	 */
@@ -94,6 +126,34 @@ public:
 	 */
 	virtual void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) = 0;
 
+	/**
+	 * Read an array of bytes from EEPROM into memory, taking a 32 bit position and a length that is not limited to
+	 * 255 bytes, so that storage over 64K can be reached, and large blocks read in one call. Implementations that
+	 * can address more than 64K override this, by default it calls readIntoMemArray as many times as needed.
+	 * @param memDest the memory where the EEPROM data should be copied to
+	 * @param romSrc the source position in EEPROM storage
+	 * @param len the length of the array
+	 * @return false if the range is outside of what this EEPROM can address, nothing is read in that case.
+	 */
+	virtual bool readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len);
+
+	/**
+	 * Writes an array of bytes from memory to EEPROM storage, taking a 32 bit position and a length that is not
+	 * limited to 255 bytes, see readIntoMemArrayWide. By default it calls writeArrayToRom as many times as needed.
+	 * @param romDest the start position in eeprom storage that the array should be copied to
+	 * @param memSrc the memory where the rom should be copied from
+	 * @param len the length of the array
+	 * @return false if the range is outside of what this EEPROM can address, nothing is written in that case.
+	 */
+	virtual bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len);
+
+	/**
+	 * For implementations that hold back writes, such as those with a write cache, this writes out everything that
+	 * is held back. Otherwise writes are immediate, and there is nothing to do.
+	 * @return true if successful, otherwise false
+	 */
+	virtual bool flush() { return true; }
+
 	/**
 	 * Helper function that calls into `writeArrayToRom` but wraps it to take `char*` instead.
 	 * @see writeArrayToRom
@@ -6,16 +6,11 @@
 #include "PlatformDetermination.h"
 #include <IoLogging.h>
 #include "EepromAbstractionWire.h"
-
-#ifdef WIRE_BUFFER_SIZE
-# define MAX_BUFFER_SIZE_TO_USE WIRE_BUFFER_SIZE
-#else
-# define MAX_BUFFER_SIZE_TO_USE 32
-#endif
+#include <string.h>
 
 #define READY_TRIES_COUNT 100
 
-uint8_t at24PageFromRomSize(At24EepromType size) {
+uint16_t at24PageFromRomSize(At24EepromType size) {
     switch (size) {
         case PAGESIZE_AT24C01:
         case PAGESIZE_AT24C02: return 8;
@@ -25,6 +20,8 @@ uint8_t at24PageFromRomSize(At24EepromType size) {
         case PAGESIZE_AT24C32:
         case PAGESIZE_AT24C64: return 32;
         case PAGESIZE_AT24C512: return 128;
+        case PAGESIZE_AT24CM01:
+        case PAGESIZE_AT24CM02: return 256;
         case PAGESIZE_AT24C128:
         case PAGESIZE_AT24C256:
         default: return 64;
@@ -32,7 +29,7 @@ uint8_t at24PageFromRomSize(At24EepromType size) {
     }
 }
 
-size_t at24ActualSizeFromRomSize(At24EepromType size) {
+EepromWidePosition at24ActualSizeFromRomSize(At24EepromType size) {
     switch (size) {
         case PAGESIZE_AT24C01: return 127;
         case PAGESIZE_AT24C02: return 255;
@@ -44,6 +41,8 @@ size_t at24ActualSizeFromRomSize(At24EepromType size) {
         case PAGESIZE_AT24C128: return 16383;
         case PAGESIZE_AT24C256: return 32767;
         case PAGESIZE_AT24C512: return 65535;
+        case PAGESIZE_AT24CM01: return 131071;
+        case PAGESIZE_AT24CM02: return 262143;
         default: return 64;
 
     }
@@ -63,15 +62,43 @@ bool I2cAt24Eeprom::hasErrorOccurred() {
     return ret;
 }
 
-uint8_t I2cAt24Eeprom::findMaximumInPage(uint16_t destEeprom, uint8_t len) const {
-	// We can read/write in bulk, but do no exceed the page size or we will read / write
-	// the wrong bytes
-	uint16_t offs = destEeprom % pageSize;
-    uint16_t currentGo = internal_min((uint16_t)pageSize, uint16_t(offs + len)) - offs;
+bool I2cAt24Eeprom::setPreferredClock(uint32_t frequency) {
+    // one byte address parts use the low bits of the I2C address for each 256 byte block, and parts over 64K use
+    // them for each 64K block.
+    uint8_t blockShift = (pageSize > 16) ? 16U : 8U;
+    EepromWidePosition blocks = (eepromSize >> blockShift) + 1UL;
+    auto addressCount = (uint8_t)internal_min(blocks, EepromWidePosition(8));
+    return ioaWireSetDeviceSpeed(wireImpl, eepromAddr, frequency, addressCount);
+}
+
+size_t I2cAt24Eeprom::findMaximumInPage(EepromWidePosition destEeprom, size_t len) const {
+	// We can write in bulk, but do no exceed the page size or we will write the wrong bytes
+	size_t currentGo = internal_min(size_t(pageSize - (destEeprom % pageSize)), len);
 
-	// dont exceed the buffer length of the  wire library
-    auto absoluteMax = MAX_BUFFER_SIZE_TO_USE - 2;
-	return internal_min(currentGo, (uint16_t) absoluteMax);
+	// dont exceed what the wire library can send in one go, the memory address is sent first
+    size_t addrLen = (pageSize > 16) ? 2 : 1;
+    size_t absoluteMax = ioaWireMaxTransferSize(wireImpl) - addrLen;
+	return internal_min(currentGo, absoluteMax);
+}
+
+size_t I2cAt24Eeprom::findMaximumRead(EepromWidePosition romSrc, size_t len) const {
+    // reads carry on across pages, so they are only limited by what the wire library can receive in one go. Parts
+    // over 64K take the block in the I2C address, so a read is also kept within its 64K block.
+    if(pageSize > 16) len = at24LimitLength(EepromWidePosition(0x10000UL - (romSrc & 0xffffUL)), len);
+    return internal_min(len, ioaWireMaxTransferSize(wireImpl));
+}
+
+bool I2cAt24Eeprom::inRange(EepromWidePosition position, size_t len) {
+    if(!at24RangeFits(eepromSize, position, len)) {
+        errorOccurred = true;
+        return false;
+    }
+    return true;
+}
+
+uint8_t I2cAt24Eeprom::i2cAddressFor(EepromWidePosition memAddr) const {
+    // the bits above the memory address bytes are sent in the low bits of the I2C address
+    return eepromAddr | uint8_t((memAddr >> ((pageSize > 16) ? 16U : 8U)) & 0x07U);
 }
 
 uint8_t I2cAt24Eeprom::read8(EepromPosition position) {
@@ -116,9 +143,15 @@ void I2cAt24Eeprom::write32(EepromPosition position, uint32_t val) {
 }
 
 uint8_t I2cAt24Eeprom::readByte(EepromPosition position) {
+    IoDeviceStatsScope statsScope(getDeviceStats(), false);
+    if(pageCache != nullptr) {
+        uint8_t cached = 0;
+        cachedRead(&cached, position, 1, true);
+        return cached;
+    }
     writeAddressWire(position);
     uint8_t data = 0;
-    errorOccurred = errorOccurred || !ioaWireRead(wireImpl, eepromAddr, &data, 1);
+    errorOccurred = errorOccurred || !ioaWireRead(wireImpl, i2cAddressFor(position), &data, 1);
 
     // for debugging purposes
     serlogF4(SER_IOA_DEBUG, "readby ", data, errorOccurred, position);
@@ -127,60 +160,354 @@ uint8_t I2cAt24Eeprom::readByte(EepromPosition position) {
 }
 
 void I2cAt24Eeprom::writeByte(EepromPosition position, uint8_t val) {
+    if(pageCache != nullptr) {
+        cachedWrite(position, &val, 1);
+        return;
+    }
     uint8_t data[1];
     data[0] = (char)val;
     writeAddressWire(position, data, 1);
 }
 
-void I2cAt24Eeprom::writeAddressWire(EepromPosition memAddr, const uint8_t *data, int len) {
-    if(len > 32 || (memAddr + len) > eepromSize)
-    {
-        // either we've tried to write more that is possible, or we've exceeded the eeprom bounds
-        // we won't proceed and return an error.
-        errorOccurred = true;
+void I2cAt24Eeprom::writeAddressWire(EepromWidePosition memAddr, const uint8_t *data, size_t len) {
+    IoDeviceStatsScope statsScope(getDeviceStats(), false);
+    if(!inRange(memAddr, len)) {
+        // we've exceeded the eeprom bounds, we won't proceed, inRange has recorded the error.
         return;
     }
-    uint8_t ch[34];
-    auto addrLen = 2;
-    auto actualAddr = eepromAddr;
+    uint8_t addrBytes[2];
+    auto actualAddr = i2cAddressFor(memAddr);
+    IoaWireBuffer parts[2];
     if(pageSize > 16) {
-        ch[0] = memAddr >> 8U;
-        ch[1] = memAddr & 0xffU;
+        addrBytes[0] = (memAddr >> 8U) & 0xffU;
+        addrBytes[1] = memAddr & 0xffU;
+        parts[0] = { addrBytes, 2 };
     } else {
-        ch[0] = memAddr & 0xffU;
-        addrLen = 1;
-        actualAddr |= (memAddr >> 8U);
-    }
-    if(data != nullptr && len > 0) {
-        memcpy(ch + addrLen, data, len);
+        addrBytes[0] = memAddr & 0xffU;
+        parts[0] = { addrBytes, 1 };
     }
+    // the data is sent straight from the callers buffer after the address, without copying it.
+    parts[1] = { data, (data != nullptr) ? len : 0 };
 
     // for debugging purposes.
-    serlogF4(SER_IOA_DEBUG, "Wire write - ", actualAddr, addrLen, pageSize);
-    serlogHexDump(SER_IOA_DEBUG, "Data was - ", ch, len + addrLen);
+    serlogF4(SER_IOA_DEBUG, "Wire write - ", actualAddr, parts[0].len, pageSize);
+    if(parts[1].len != 0) serlogHexDump(SER_IOA_DEBUG, "Data was - ", data, len);
 
-    errorOccurred = errorOccurred || !ioaWireWriteWithRetry(wireImpl, actualAddr, ch, len + addrLen, READY_TRIES_COUNT);
+    if(asyncWrites != nullptr) {
+        if(parts[1].len != 0) {
+            errorOccurred = errorOccurred || !asyncWrites->submitWrite(wireImpl, actualAddr, parts, 2, getDeviceStats());
+            return;
+        }
+        // setting the address for a read, which must not overtake the writes that are queued.
+        asyncWrites->waitForAll();
+    }
+
+    errorOccurred = errorOccurred || !ioaWireWriteV(wireImpl, actualAddr, parts, 2, READY_TRIES_COUNT);
 }
 
 void I2cAt24Eeprom::readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) {
-    int romOffset = 0;
+    readIntoMemArrayWide(memDest, romSrc, len);
+}
+
+void I2cAt24Eeprom::writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) {
+    writeArrayToRomWide(romDest, memSrc, len);
+}
+
+bool I2cAt24Eeprom::readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) {
+    IoDeviceStatsScope statsScope(getDeviceStats(), false);
+    if(!inRange(romSrc, len)) return false;
+    if(pageCache != nullptr) {
+        cachedRead(memDest, romSrc, len, false);
+    } else {
+        readDirect(memDest, romSrc, len);
+    }
+    return true;
+}
+
+bool I2cAt24Eeprom::writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) {
+    if(!inRange(romDest, len)) return false;
+    if(pageCache != nullptr) {
+        cachedWrite(romDest, memSrc, len);
+    } else {
+        writeDirect(romDest, memSrc, len);
+    }
+    return true;
+}
+
+void I2cAt24Eeprom::readDirect(uint8_t* memDest, EepromWidePosition romSrc, size_t len) {
+    size_t romOffset = 0;
     while(len > 0 && !errorOccurred) {
-        int currentGo = findMaximumInPage(romSrc + romOffset, len);
+        size_t currentGo = findMaximumRead(romSrc + romOffset, len);
+        if(currentGo == 0) {
+            // a step of nothing would never finish, so give up with an error rather than spinning.
+            errorOccurred = true;
+            return;
+        }
 
         writeAddressWire(romSrc + romOffset);
-        errorOccurred = errorOccurred || !ioaWireRead(wireImpl, eepromAddr, &memDest[romOffset], currentGo);
+        auto i2cAddr = i2cAddressFor(romSrc + romOffset);
+        errorOccurred = errorOccurred || !ioaWireRead(wireImpl, i2cAddr, &memDest[romOffset], currentGo);
         romOffset += currentGo;
         len -= currentGo;
     }
 }
 
-void I2cAt24Eeprom::writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t origLen) {
-    int romOffset = 0;
-    int leftToGo = origLen;
-    while(leftToGo > 0 && !errorOccurred) {
-        int currentGo = findMaximumInPage(romDest + romOffset, leftToGo);
+void I2cAt24Eeprom::writeDirect(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) {
+    size_t romOffset = 0;
+    while(len > 0 && !errorOccurred) {
+        size_t currentGo = findMaximumInPage(romDest + romOffset, len);
+        if(currentGo == 0) {
+            errorOccurred = true;
+            return;
+        }
         writeAddressWire(romDest + romOffset, &memSrc[romOffset], currentGo);
-        leftToGo -= currentGo;
+        len -= currentGo;
         romOffset += currentGo;
     }
 }
+
+//
+// Write back page cache
+//
+
+At24PageCache::At24PageCache(I2cAt24Eeprom* rom, uint8_t numPages, uint16_t pageSize, uint16_t flushAfterMillis)
+        : rom(rom), numPages(numPages), flushAfterMillis(flushAfterMillis) {
+    storage = new uint8_t[numPages * pageSize];
+    pages = new CachedPage[numPages];
+    for(uint8_t i = 0; i < numPages; i++) {
+        pages[i] = { &storage[i * pageSize], 0, 0, 0, 0, false };
+    }
+}
+
+At24PageCache::~At24PageCache() {
+    if(flushTask != TASKMGR_INVALIDID) taskManager.cancelTask(flushTask);
+    delete[] pages;
+    delete[] storage;
+}
+
+At24PageCache::CachedPage* At24PageCache::findPage(EepromWidePosition pageStart) {
+    for(uint8_t i = 0; i < numPages; i++) {
+        if(pages[i].loaded && pages[i].start == pageStart) return &pages[i];
+    }
+    return nullptr;
+}
+
+At24PageCache::CachedPage* At24PageCache::leastRecentlyUsed() {
+    CachedPage* oldest = &pages[0];
+    for(uint8_t i = 0; i < numPages; i++) {
+        if(!pages[i].loaded) return &pages[i];
+        // the counter wraps, so compare how long ago each page was used rather than the raw values
+        if(uint16_t(useCounter - pages[i].lastUsed) > uint16_t(useCounter - oldest->lastUsed)) oldest = &pages[i];
+    }
+    return oldest;
+}
+
+void At24PageCache::pageChanged() {
+    if(flushAfterMillis != 0 && flushTask == TASKMGR_INVALIDID) {
+        flushTask = taskManager.scheduleOnce(flushAfterMillis, this, TIME_MILLIS);
+    }
+}
+
+void At24PageCache::exec() {
+    flushTask = TASKMGR_INVALIDID;
+    // the pages that failed are still changed, so try again after the same time rather than waiting for another write.
+    if(!rom->flush()) pageChanged();
+}
+
+I2cAt24Eeprom::~I2cAt24Eeprom() {
+    setPageCache(0);
+    setAsyncWrites(false);
+}
+
+void I2cAt24Eeprom::setAsyncWrites(bool async, At24WriteCompleteFn completeFn) {
+    if(asyncWrites != nullptr) {
+        asyncWrites->waitForAll();
+        delete asyncWrites;
+        asyncWrites = nullptr;
+    }
+    if(async) {
+        // room for the largest page write plus the two address bytes
+        auto bufferSize = (uint16_t)internal_min((size_t)pageSize + 2U, ioaWireMaxTransferSize(wireImpl));
+        asyncWrites = new At24AsyncWriteState(this, bufferSize, completeFn);
+    }
+}
+
+void I2cAt24Eeprom::setPageCache(uint8_t numPages, uint16_t flushAfterMillis) {
+    if(pageCache != nullptr) {
+        flush();
+        delete pageCache;
+        pageCache = nullptr;
+    }
+    if(numPages != 0) {
+        pageCache = new At24PageCache(this, numPages, pageSize, flushAfterMillis);
+    }
+}
+
+bool I2cAt24Eeprom::flush() {
+    if(pageCache == nullptr) return true;
+    bool allOk = true;
+    for(uint8_t i = 0; i < pageCache->getNumPages(); i++) {
+        allOk = flushPage(pageCache->getPage(i)) && allOk;
+    }
+    return allOk;
+}
+
+bool I2cAt24Eeprom::isCacheDirty() const {
+    if(pageCache == nullptr) return false;
+    for(uint8_t i = 0; i < pageCache->getNumPages(); i++) {
+        if(pageCache->getPage(i)->isDirty()) return true;
+    }
+    return false;
+}
+
+bool I2cAt24Eeprom::flushPage(At24PageCache::CachedPage* page) {
+    if(!page->isDirty()) return true;
+
+    // the error flag is held until it is read, so clear it while writing to find out if this write worked.
+    bool earlierError = errorOccurred;
+    errorOccurred = false;
+
+    // the range is marked clean before writing, so that changes made while waiting for queued writes are kept.
+    uint16_t from = page->dirtyFrom;
+    uint16_t to = page->dirtyTo;
+    page->dirtyFrom = page->dirtyTo = 0;
+    writeDirect(page->start + from, &page->data[from], to - from);
+
+    // queued writes only report failure once they have been sent, so wait for them before deciding.
+    waitForWrites();
+    bool writeOk = !errorOccurred;
+    errorOccurred = earlierError || !writeOk;
+
+    // on failure the changes are kept, so that a later flush can try again.
+    if(!writeOk) {
+        if(!page->isDirty() || from < page->dirtyFrom) page->dirtyFrom = from;
+        if(to > page->dirtyTo) page->dirtyTo = to;
+    }
+    return writeOk;
+}
+
+At24PageCache::CachedPage* I2cAt24Eeprom::cachedPageFor(EepromWidePosition pageStart, bool allocate) {
+    auto page = pageCache->findPage(pageStart);
+    if(page == nullptr && allocate) {
+        page = pageCache->leastRecentlyUsed();
+        if(!flushPage(page)) return nullptr;
+
+        bool earlierError = errorOccurred;
+        errorOccurred = false;
+        readDirect(page->data, pageStart, pageSize);
+        page->loaded = !errorOccurred;
+        page->start = pageStart;
+        errorOccurred = earlierError || !page->loaded;
+        if(!page->loaded) return nullptr;
+    }
+    if(page != nullptr) pageCache->touch(page);
+    return page;
+}
+
+void I2cAt24Eeprom::cachedRead(uint8_t* memDest, EepromWidePosition romSrc, size_t len, bool allocate) {
+    // runs of pages that are not in the cache are read directly in one go
+    EepromWidePosition missStart = romSrc;
+    size_t missLen = 0;
+    while(len > 0) {
+        uint16_t offset = romSrc % pageSize;
+        size_t currentGo = internal_min(len, size_t(pageSize - offset));
+        auto page = cachedPageFor(romSrc - offset, allocate);
+        if(page != nullptr) {
+            if(missLen != 0) readDirect(memDest - missLen, missStart, missLen);
+            missLen = 0;
+            memcpy(memDest, &page->data[offset], currentGo);
+        } else {
+            if(missLen == 0) missStart = romSrc;
+            missLen += currentGo;
+        }
+        memDest += currentGo;
+        romSrc += currentGo;
+        len -= currentGo;
+    }
+    if(missLen != 0) readDirect(memDest - missLen, missStart, missLen);
+}
+
+void I2cAt24Eeprom::cachedWrite(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) {
+    if(!inRange(romDest, len)) return;
+    while(len > 0) {
+        uint16_t offset = romDest % pageSize;
+        size_t currentGo = internal_min(len, size_t(pageSize - offset));
+        auto page = cachedPageFor(romDest - offset, true);
+        if(page == nullptr) {
+            // the page could not be loaded, so fall back to writing straight through
+            writeDirect(romDest, memSrc, currentGo);
+        } else {
+            bool changed = false;
+            for(uint16_t i = offset; i < (offset + currentGo); i++) {
+                uint8_t val = memSrc[i - offset];
+                if(page->data[i] == val) continue;
+                page->data[i] = val;
+                if(!page->isDirty()) {
+                    page->dirtyFrom = i;
+                    page->dirtyTo = i + 1;
+                } else {
+                    page->dirtyFrom = internal_min(page->dirtyFrom, i);
+                    page->dirtyTo = internal_max(page->dirtyTo, uint16_t(i + 1));
+                }
+                changed = true;
+            }
+            if(changed) pageCache->pageChanged();
+        }
+        memSrc += currentGo;
+        romDest += currentGo;
+        len -= currentGo;
+    }
+}
+
+//
+// Async writes through the transaction queue
+//
+
+At24AsyncWriteState::At24AsyncWriteState(I2cAt24Eeprom* rom, uint16_t bufferSize, At24WriteCompleteFn completeFn)
+        : rom(rom), bufferSize(bufferSize), completeFn(completeFn) {
+    buffers = new uint8_t[AT24_ASYNC_WRITE_SLOTS * bufferSize];
+    for(auto& txn : transactions) txn.setListener(this);
+}
+
+At24AsyncWriteState::~At24AsyncWriteState() {
+    for(auto& txn : transactions) i2cTransactionQueue.cancel(&txn);
+    delete[] buffers;
+}
+
+bool At24AsyncWriteState::submitWrite(WireType wire, uint8_t i2cAddr, const IoaWireBuffer* parts, size_t count, IoDeviceStats* stats) {
+    // when every slot is waiting, let the queue run until one is free, each write finishes or fails on its own.
+    while(inFlight >= AT24_ASYNC_WRITE_SLOTS) {
+        taskManager.yieldForMicros(I2C_QUEUE_POLL_MICROS);
+    }
+
+    for(int i = 0; i < AT24_ASYNC_WRITE_SLOTS; i++) {
+        if(transactions[i].isQueued()) continue;
+        auto buffer = &buffers[i * bufferSize];
+        size_t len;
+        if(!ioaWireGather(buffer, bufferSize, parts, count, len)) return false;
+        transactions[i].prepareWrite(wire, i2cAddr, buffer, (uint16_t)len, AT24_ASYNC_READY_POLLS);
+        transactions[i].setStats(stats);
+        inFlight++;
+        i2cTransactionQueue.submit(&transactions[i]);
+        return true;
+    }
+    return false;
+}
+
+void At24AsyncWriteState::waitForAll() {
+    while(inFlight != 0) {
+        taskManager.yieldForMicros(I2C_QUEUE_POLL_MICROS);
+    }
+}
+
+void At24AsyncWriteState::i2cTransactionComplete(I2cTransaction&, bool successful) {
+    if(!successful) {
+        batchOk = false;
+        rom->errorOccurred = true;
+    }
+    if(--inFlight == 0) {
+        lastResult = batchOk;
+        batchOk = true;
+        if(completeFn != nullptr) completeFn(rom, lastResult);
+    }
+}
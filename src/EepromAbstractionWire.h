@@ -13,6 +13,7 @@
 
 #include "PlatformDeterminationWire.h"
 #include "EepromAbstraction.h"
+#include "I2cTransactionQueue.h"
 #include "TaskManager.h"
 
 /**
@@ -29,22 +30,159 @@ enum At24EepromType {
     PAGESIZE_AT24C64,
     PAGESIZE_AT24C128,
     PAGESIZE_AT24C256,
-    PAGESIZE_AT24C512
+    PAGESIZE_AT24C512,
+    PAGESIZE_AT24CM01,
+    PAGESIZE_AT24CM02
 };
 
 /**
- * Given an eeprom type enum value this returns the actual size of the rom in bytes
+ * Given an eeprom type enum value this returns the last address on the rom, one less than its size in bytes. It is
+ * an EepromWidePosition because the larger parts do not fit in a 16 bit size_t.
  * @param size the eeprom type
- * @return the size of the rom
+ * @return the last address on the rom
  */
-size_t at24ActualSizeFromRomSize(At24EepromType size);
+EepromWidePosition at24ActualSizeFromRomSize(At24EepromType size);
 
 /**
  * Given the eeprom type enum value this returns the page size to use for the device.
  * @param size the eeprom type
  * @return the page size
  */
-uint8_t at24PageFromRomSize(At24EepromType size);
+uint16_t at24PageFromRomSize(At24EepromType size);
+
+/**
+ * Limits a length to a count held as an EepromWidePosition, the count is only narrowed once it is the smaller of the
+ * two, so that counts of 64K or more do not wrap to 0 where size_t is 16 bits, such as on AVR.
+ * @param count the count to limit to, for example the bytes left in a 64K block
+ * @param len the length to limit
+ * @return the smaller of the two as the length type
+ */
+template<typename LengthType> LengthType at24LimitLength(EepromWidePosition count, LengthType len) {
+    return (count < len) ? LengthType(count) : len;
+}
+
+/**
+ * Checks that len bytes from position are all on the device, the sums are done as EepromWidePosition so that they
+ * are correct for any length type, including a 16 bit size_t.
+ * @param lastAddress the last address on the device, one less than its size
+ * @param position the first address to access
+ * @param len the number of bytes to access
+ * @return true if every byte is on the device
+ */
+template<typename LengthType> bool at24RangeFits(EepromWidePosition lastAddress, EepromWidePosition position, LengthType len) {
+    EepromWidePosition romSize = lastAddress + 1UL;
+    if(len > romSize) return false;
+    return position <= (romSize - EepromWidePosition(len));
+}
+
+/** the number of pages held when the page cache is turned on without saying how many */
+#define AT24_DEFAULT_CACHE_PAGES 2
+
+/** the default time after a cached page is first changed until it is written out, in milliseconds */
+#define AT24_DEFAULT_FLUSH_MILLIS 250
+
+class I2cAt24Eeprom;
+
+/**
+ * Holds the pages of an AT24 EEPROM that are cached in RAM, along with the range of each page that has changed since
+ * it was last written. It is also the task that flushes the cache when a timed flush is due. This is created by
+ * I2cAt24Eeprom::setPageCache, you would not normally use it directly.
+ */
+class At24PageCache : public Executable {
+public:
+    struct CachedPage {
+        uint8_t* data;
+        EepromWidePosition start;
+        uint16_t lastUsed;
+        uint16_t dirtyFrom;
+        uint16_t dirtyTo;
+        bool loaded;
+
+        bool isDirty() const { return dirtyTo > dirtyFrom; }
+    };
+private:
+    I2cAt24Eeprom* rom;
+    CachedPage* pages;
+    uint8_t* storage;
+    uint8_t numPages;
+    uint16_t flushAfterMillis;
+    uint16_t useCounter = 0;
+    taskid_t flushTask = TASKMGR_INVALIDID;
+public:
+    At24PageCache(I2cAt24Eeprom* rom, uint8_t numPages, uint16_t pageSize, uint16_t flushAfterMillis);
+    ~At24PageCache() override;
+    At24PageCache(const At24PageCache&) = delete;
+    At24PageCache& operator=(const At24PageCache&) = delete;
+
+    /** @return the cached page starting at pageStart, or nullptr if it is not in the cache */
+    CachedPage* findPage(EepromWidePosition pageStart);
+
+    /** @return the page that has been used least recently, which is the one to reuse next */
+    CachedPage* leastRecentlyUsed();
+
+    /** mark a page as the one most recently used */
+    void touch(CachedPage* page) { page->lastUsed = ++useCounter; }
+
+    /** called when a page is changed, to schedule the timed flush if one is needed */
+    void pageChanged();
+
+    uint8_t getNumPages() const { return numPages; }
+    CachedPage* getPage(uint8_t idx) { return &pages[idx]; }
+
+    void exec() override;
+};
+
+/** the number of page writes that can be waiting in the queue at once when writing asynchronously */
+#define AT24_ASYNC_WRITE_SLOTS 4
+
+/** how many times the queue polls the EEPROM for the end of the previous write cycle before failing a write */
+#define AT24_ASYNC_READY_POLLS 200
+
+/**
+ * The function called when all the asynchronous writes that were queued have completed.
+ * @param eeprom the EEPROM that completed the writes
+ * @param successful true if all the writes succeeded, otherwise false
+ */
+typedef void(*At24WriteCompleteFn)(I2cAt24Eeprom* eeprom, bool successful);
+
+/**
+ * Holds the page writes that are waiting in the I2C transaction queue for an AT24 EEPROM in async write mode. Each
+ * write has its own buffer holding the memory address and a copy of the data, so the caller's data does not need to
+ * stay valid. This is created by I2cAt24Eeprom::setAsyncWrites, you would not normally use it directly.
+ */
+class At24AsyncWriteState : public I2cTransactionListener {
+private:
+    I2cAt24Eeprom* rom;
+    I2cTransaction transactions[AT24_ASYNC_WRITE_SLOTS];
+    uint8_t* buffers;
+    uint16_t bufferSize;
+    uint8_t inFlight = 0;
+    bool batchOk = true;
+    bool lastResult = true;
+    At24WriteCompleteFn completeFn;
+public:
+    At24AsyncWriteState(I2cAt24Eeprom* rom, uint16_t bufferSize, At24WriteCompleteFn completeFn);
+    ~At24AsyncWriteState() override;
+    At24AsyncWriteState(const At24AsyncWriteState&) = delete;
+    At24AsyncWriteState& operator=(const At24AsyncWriteState&) = delete;
+
+    /**
+     * Queue a write, when all the slots are in use this yields to task manager until one is free.
+     * @return true if it was queued, false if no slot became free.
+     */
+    bool submitWrite(WireType wire, uint8_t i2cAddr, const IoaWireBuffer* parts, size_t count, IoDeviceStats* stats);
+
+    /** yields to task manager until all queued writes have completed */
+    void waitForAll();
+
+    /** @return true while there are writes that have not completed */
+    bool isBusy() const { return inFlight != 0; }
+
+    /** @return the result of the last batch of writes to complete */
+    bool getLastResult() const { return lastResult; }
+
+    void i2cTransactionComplete(I2cTransaction& transaction, bool successful) override;
+};
 
 /**
  * An implementation of eeprom that works with the very well known At24CXXX chips over i2c. Before
@@ -61,18 +199,24 @@ uint8_t at24PageFromRomSize(At24EepromType size);
  */
 
 class I2cAt24Eeprom : public EepromAbstraction {
+    friend class At24AsyncWriteState;
 	WireType wireImpl;
 	uint8_t  eepromAddr;
 	bool     errorOccurred;
-	uint8_t  pageSize;
-    size_t   eepromSize;
+	uint16_t pageSize;
+    EepromWidePosition eepromSize; // the last address on the device, one less than its size
+    At24PageCache* pageCache = nullptr;
+    At24AsyncWriteState* asyncWrites = nullptr;
 public:
 	/**
 	 * Create an I2C EEPROM object giving it's address and the page size of the device.
-	 * Page sizes are defined in this header file.
+	 * Page sizes are defined in this header file. The AT24CM01 and AT24CM02 are larger than 64K, they take the top
+	 * address bits in the I2C address, and the area above 64K is reached through the wide array functions.
 	 */
     I2cAt24Eeprom(uint8_t address, At24EepromType ty, WireType wireImpl = defaultWireTypePtr);
-	~I2cAt24Eeprom() override = default;
+	~I2cAt24Eeprom() override;
+	I2cAt24Eeprom(const I2cAt24Eeprom&) = delete;
+	I2cAt24Eeprom& operator=(const I2cAt24Eeprom&) = delete;
 
 	/** 
 	 * This indicates if an I2C error has ocrrued at any point since the last call to error.
@@ -80,6 +224,60 @@ public:
 	 */
 	bool hasErrorOccurred() override;
 
+	/**
+	 * Sets the I2C clock this EEPROM should be driven at, when it shares the bus with devices that need a different
+	 * clock. Smaller parts that respond on an address per 256 byte block have the preference set on all of them.
+	 * @param frequency the clock in Hz, or 0 to use the bus default
+	 * @return true if stored, false if there is no space left for clock profiles
+	 */
+	bool setPreferredClock(uint32_t frequency);
+
+	/**
+	 * Turns on a write back cache that holds whole pages in RAM. Writes change the cached page, and only the bytes
+	 * that changed are later written out with one page write per page, rather than a write cycle for every byte.
+	 * Reads of cached pages are served from RAM. Changes are written out by flush, when a page has to be reused, and
+	 * if flushAfterMillis is not zero, that long after a page is first changed, trying again after the same time if
+	 * that write fails. Each page takes page size bytes of RAM. Until changes are flushed they are lost if the board
+	 * resets.
+	 * @param numPages the number of pages to cache, or 0 to flush and turn off the cache
+	 * @param flushAfterMillis the time after a change that it is written out, or 0 to only write on flush
+	 */
+	void setPageCache(uint8_t numPages = AT24_DEFAULT_CACHE_PAGES, uint16_t flushAfterMillis = AT24_DEFAULT_FLUSH_MILLIS);
+
+	/**
+	 * Writes out any changes held in the page cache, each changed page is written in one go. When writes are async
+	 * this waits for them to complete, and a page stays changed until its write has succeeded.
+	 * @return true if everything was written, otherwise false
+	 */
+	bool flush() override;
+
+	/** @return true if the page cache holds changes that have not been written yet */
+	bool isCacheDirty() const;
+
+	/**
+	 * Turns on or off async writes. In async mode each page write is handed to i2cTransactionQueue and the call
+	 * returns straight away. The queue waits for the previous write cycle to end by polling the chip between other
+	 * tasks, rather than blocking for up to 5ms after every write. Reads still block until the queued writes have
+	 * completed, so the data read is always up to date. For writes of single values, which read the existing value
+	 * first, combine this with setPageCache so the reads come from RAM. Errors are reported through
+	 * hasErrorOccurred, and to the callback, once the writes complete.
+	 * @param async true to write asynchronously, false to go back to blocking writes, which waits for any queued.
+	 * @param completeFn optionally called each time all the queued writes have completed, or nullptr.
+	 */
+	void setAsyncWrites(bool async, At24WriteCompleteFn completeFn = nullptr);
+
+	/** @return true if async writes are turned on */
+	bool isAsyncWrites() const { return asyncWrites != nullptr; }
+
+	/** @return true if there are async writes that have not yet completed */
+	bool isWritePending() const { return asyncWrites != nullptr && asyncWrites->isBusy(); }
+
+	/** @return true if the last batch of async writes to complete all succeeded */
+	bool lastAsyncWriteResult() const { return asyncWrites == nullptr || asyncWrites->getLastResult(); }
+
+	/** yields to task manager until all async writes have completed, returns straight away when there are none */
+	void waitForWrites() { if(asyncWrites != nullptr) asyncWrites->waitForAll(); }
+
 	uint8_t read8(EepromPosition position) override;
 	void write8(EepromPosition position, uint8_t val) override;
 
@@ -91,11 +289,34 @@ public:
 
 	void readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) override;
 	void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) override;
+
+	/**
+	 * Reads any length from anywhere in the EEPROM, including above 64K on the AT24CM01 and AT24CM02, in as few
+	 * transfers as the wire library allows.
+	 * @return false if the range is outside of the EEPROM, in which case the error flag is also set.
+	 */
+	bool readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) override;
+
+	/**
+	 * Writes any length to anywhere in the EEPROM, including above 64K on the AT24CM01 and AT24CM02, split into one
+	 * write per page.
+	 * @return false if the range is outside of the EEPROM, in which case the error flag is also set.
+	 */
+	bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) override;
 private:
-	uint8_t findMaximumInPage(uint16_t romDest, uint8_t len) const;
+	size_t findMaximumInPage(EepromWidePosition romDest, size_t len) const;
+	size_t findMaximumRead(EepromWidePosition romSrc, size_t len) const;
+	bool inRange(EepromWidePosition position, size_t len);
 	void writeByte(EepromPosition position, uint8_t val);
 	uint8_t readByte(EepromPosition position);
-    void writeAddressWire(uint16_t memAddr, const uint8_t* data = nullptr, int len = 0);
+    void writeAddressWire(EepromWidePosition memAddr, const uint8_t* data = nullptr, size_t len = 0);
+    uint8_t i2cAddressFor(EepromWidePosition memAddr) const;
+    void readDirect(uint8_t* memDest, EepromWidePosition romSrc, size_t len);
+    void writeDirect(EepromWidePosition romDest, const uint8_t* memSrc, size_t len);
+    At24PageCache::CachedPage* cachedPageFor(EepromWidePosition pageStart, bool allocate);
+    bool flushPage(At24PageCache::CachedPage* page);
+    void cachedRead(uint8_t* memDest, EepromWidePosition romSrc, size_t len, bool allocate);
+    void cachedWrite(EepromWidePosition romDest, const uint8_t* memSrc, size_t len);
 };
 
 #endif /* IOABSTRACTION_EEPROMABSTRACTIONWIRE_H_ */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include <IoLogging.h>
+#include "I2cTransactionQueue.h"
+
+I2cTransactionQueue i2cTransactionQueue;
+
+bool I2cTransactionQueue::submit(I2cTransaction* transaction) {
+    if(transaction->isQueued()) return false;
+
+    transaction->next = nullptr;
+    transaction->status = I2C_TXN_QUEUED;
+    if(tail == nullptr) {
+        head = tail = transaction;
+    } else {
+        tail->next = transaction;
+        tail = transaction;
+    }
+
+    if(!registered) {
+        registered = true;
+        taskManager.registerEvent(this);
+    }
+    markTriggeredAndNotify();
+    return true;
+}
+
+void I2cTransactionQueue::cancel(I2cTransaction* transaction) {
+    I2cTransaction* previous = nullptr;
+    for(auto current = head; current != nullptr; current = current->next) {
+        if(current == transaction) {
+            if(previous == nullptr) head = current->next; else previous->next = current->next;
+            if(tail == current) tail = previous;
+            current->next = nullptr;
+            current->status = I2C_TXN_IDLE;
+            return;
+        }
+        previous = current;
+    }
+}
+
+uint32_t I2cTransactionQueue::timeOfNextCheck() {
+    if(head != nullptr) {
+        setTriggered(true);
+        return I2C_QUEUE_POLL_MICROS;
+    }
+    return I2C_QUEUE_IDLE_MICROS;
+}
+
+void I2cTransactionQueue::exec() {
+    auto transaction = head;
+    if(transaction == nullptr) return;
+
+    IoDeviceStatsScope statsScope(transaction->stats, false);
+
+    // when the write needs the device to be ready, we poll it once per run, letting other tasks run in between.
+    if(transaction->retriesLeft != 0 && transaction->type != I2C_TXN_READ) {
+        if(!ioaWireReady(transaction->wire, transaction->address)) {
+            ioaStatsWireRetry();
+            if(--transaction->retriesLeft == 0) {
+                serlogF2(SER_IOA_WARNING, "I2C queue device not ready ", transaction->address);
+                complete(transaction, false);
+            }
+            return;
+        }
+        transaction->retriesLeft = 0;
+    }
+
+    bool ok = true;
+    if(transaction->type != I2C_TXN_READ) {
+        bool sendStop = transaction->type == I2C_TXN_WRITE;
+        ok = ioaWireWriteWithRetry(transaction->wire, transaction->address, transaction->writeData, transaction->writeLen, 0, sendStop);
+    }
+    if(ok && transaction->type != I2C_TXN_WRITE) {
+        ok = ioaWireRead(transaction->wire, transaction->address, transaction->readData, transaction->readLen);
+    }
+    complete(transaction, ok);
+}
+
+void I2cTransactionQueue::complete(I2cTransaction* transaction, bool successful) {
+    // take it off the queue before telling the listener, so that it can be submitted again straight away.
+    head = transaction->next;
+    if(head == nullptr) tail = nullptr;
+    transaction->next = nullptr;
+    transaction->status = successful ? I2C_TXN_SUCCEEDED : I2C_TXN_FAILED;
+
+    if(transaction->listener != nullptr) {
+        transaction->listener->i2cTransactionComplete(*transaction, successful);
+    }
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_I2CTRANSACTIONQUEUE_H
+#define IOA_I2CTRANSACTIONQUEUE_H
+
+/**
+ * @file I2cTransactionQueue.h
+ * @brief A queue of I2C transactions that are carried out by a task manager event, one transaction at a time, so that
+ * devices can submit work and carry on, rather than blocking the whole scheduler until the bus work is done.
+ *
+ * Devices submit I2cTransaction objects that they own, there is no allocation by the queue. Each transaction is either
+ * a write, a read, or a write then read (with a repeated start, for register reads). When a transaction is complete
+ * the listener on the transaction is called from task manager. Where a write asks for retries, the queue waits for
+ * the device to be ready by polling it between other tasks, instead of spinning as ioaWireWriteWithRetry does.
+ *
+ * Note that on most boards the wire libraries are themselves blocking, so each individual transaction still blocks
+ * for the time it takes to transfer its bytes, but no more, and other tasks run between transactions.
+ */
+
+#include "PlatformDeterminationWire.h"
+#include "IoDeviceStats.h"
+#include <TaskManagerIO.h>
+
+/** The interval at which the queue polls a device that is not yet ready, in microseconds */
+#define I2C_QUEUE_POLL_MICROS 100
+
+/** How often the queue checks for work when idle, submitting work wakes it immediately anyway */
+#define I2C_QUEUE_IDLE_MICROS 250000UL
+
+/** The type of work that a transaction carries out */
+enum I2cTransactionType : uint8_t {
+    /** write the data to the device */
+    I2C_TXN_WRITE,
+    /** read the requested number of bytes from the device */
+    I2C_TXN_READ,
+    /** write the data without a stop, then read with a repeated start, normally for reading registers */
+    I2C_TXN_WRITE_THEN_READ
+};
+
+/** The state of a transaction */
+enum I2cTransactionStatus : uint8_t {
+    /** the transaction has not been submitted yet */
+    I2C_TXN_IDLE,
+    /** the transaction is waiting in the queue or being carried out */
+    I2C_TXN_QUEUED,
+    /** the transaction completed successfully */
+    I2C_TXN_SUCCEEDED,
+    /** the transaction failed, either on the bus or the device did not become ready */
+    I2C_TXN_FAILED
+};
+
+class I2cTransaction;
+
+/**
+ * Implement this interface to be told when a transaction completes, it is called on the task manager thread.
+ */
+class I2cTransactionListener {
+public:
+    virtual ~I2cTransactionListener() = default;
+    /**
+     * Called when a transaction has completed, the transaction can be prepared and submitted again from here.
+     * @param transaction the transaction that completed
+     * @param successful true if the transaction succeeded, otherwise false
+     */
+    virtual void i2cTransactionComplete(I2cTransaction& transaction, bool successful) = 0;
+};
+
+/**
+ * A single I2C transaction that can be submitted to an I2cTransactionQueue. The buffers are owned by the caller and
+ * must remain valid until the transaction completes. A transaction can only be in the queue once at any time.
+ */
+class I2cTransaction {
+private:
+    friend class I2cTransactionQueue;
+    I2cTransaction* next = nullptr;
+    I2cTransactionListener* listener = nullptr;
+    IoDeviceStats* stats = nullptr;
+    WireType wire = nullptr;
+    const uint8_t* writeData = nullptr;
+    uint8_t* readData = nullptr;
+    uint16_t writeLen = 0;
+    uint16_t readLen = 0;
+    uint8_t address = 0;
+    uint8_t retriesLeft = 0;
+    I2cTransactionType type = I2C_TXN_WRITE;
+    volatile I2cTransactionStatus status = I2C_TXN_IDLE;
+public:
+    I2cTransaction() = default;
+    I2cTransaction(const I2cTransaction&) = delete;
+    I2cTransaction& operator=(const I2cTransaction&) = delete;
+
+    /**
+     * Prepare a write, when retries is non zero the queue waits for the device to acknowledge its address first,
+     * polling up to retries times, this is needed for devices such as EEPROMs that are busy after a write.
+     * @param wireImpl the wire bus to use, nullptr for the default
+     * @param addr the I2C address
+     * @param data the data to write, must stay valid until complete
+     * @param len the length of the data
+     * @param retries the number of times to poll for the device being ready, 0 to send straight away.
+     */
+    void prepareWrite(WireType wireImpl, uint8_t addr, const uint8_t* data, uint16_t len, uint8_t retries = 0) {
+        prepare(I2C_TXN_WRITE, wireImpl, addr, data, len, nullptr, 0, retries);
+    }
+
+    /**
+     * Prepare a read of len bytes into the buffer provided.
+     * @param wireImpl the wire bus to use, nullptr for the default
+     * @param addr the I2C address
+     * @param buffer the buffer to read into, must stay valid until complete
+     * @param len the number of bytes to read
+     */
+    void prepareRead(WireType wireImpl, uint8_t addr, uint8_t* buffer, uint16_t len) {
+        prepare(I2C_TXN_READ, wireImpl, addr, nullptr, 0, buffer, len, 0);
+    }
+
+    /**
+     * Prepare a write followed by a read with a repeated start, normally to read registers from a device.
+     * @param wireImpl the wire bus to use, nullptr for the default
+     * @param addr the I2C address
+     * @param data the data to write, such as the register address, must stay valid until complete
+     * @param len the length of the data to write
+     * @param buffer the buffer to read into, must stay valid until complete
+     * @param readLength the number of bytes to read
+     */
+    void prepareWriteThenRead(WireType wireImpl, uint8_t addr, const uint8_t* data, uint16_t len, uint8_t* buffer, uint16_t readLength) {
+        prepare(I2C_TXN_WRITE_THEN_READ, wireImpl, addr, data, len, buffer, readLength, 0);
+    }
+
+    /** set the listener that is told when this transaction completes, or nullptr for none */
+    void setListener(I2cTransactionListener* txnListener) { listener = txnListener; }
+
+    /** set the device stats that this transaction counts against, or nullptr for none */
+    void setStats(IoDeviceStats* deviceStats) { stats = deviceStats; }
+
+    /** @return the status of this transaction */
+    I2cTransactionStatus getStatus() const { return status; }
+
+    /** @return true if the transaction is in the queue and not yet complete */
+    bool isQueued() const { return status == I2C_TXN_QUEUED; }
+
+    /** @return the type of this transaction */
+    I2cTransactionType getType() const { return type; }
+
+private:
+    void prepare(I2cTransactionType txnType, WireType wireImpl, uint8_t addr, const uint8_t* data, uint16_t len,
+                 uint8_t* buffer, uint16_t readLength, uint8_t retries) {
+        type = txnType;
+        wire = (wireImpl != nullptr) ? wireImpl : defaultWireTypePtr;
+        address = addr;
+        writeData = data;
+        writeLen = len;
+        readData = buffer;
+        readLen = readLength;
+        retriesLeft = retries;
+    }
+};
+
+/**
+ * The queue of transactions, it is an event registered with task manager the first time something is submitted.
+ * Each time the event runs, one transaction is carried out, so other tasks get to run in between. Submit and cancel
+ * should be called from the task manager thread.
+ */
+class I2cTransactionQueue : public BaseEvent {
+private:
+    I2cTransaction* head = nullptr;
+    I2cTransaction* tail = nullptr;
+    bool registered = false;
+public:
+    /**
+     * Add a transaction to the end of the queue, it must have been prepared first.
+     * @param transaction the transaction to add
+     * @return true if added, false if the transaction was already queued
+     */
+    bool submit(I2cTransaction* transaction);
+
+    /**
+     * Remove a transaction from the queue without carrying it out, the listener is not called. Use this before a
+     * transaction is destroyed while it may still be queued.
+     * @param transaction the transaction to remove
+     */
+    void cancel(I2cTransaction* transaction);
+
+    /** @return true if there is nothing waiting to be carried out */
+    bool isIdle() const { return head == nullptr; }
+
+    uint32_t timeOfNextCheck() override;
+    void exec() override;
+private:
+    void complete(I2cTransaction* transaction, bool successful);
+};
+
+/**
+ * The queue that the IoAbstraction devices submit their transactions to when in async mode.
+ */
+extern I2cTransactionQueue i2cTransactionQueue;
+
+/**
+ * Holds the state needed by a device that syncs asynchronously, a write transaction for the outputs and a read
+ * transaction for the inputs, along with their buffers. It is only allocated by devices that are put into async mode,
+ * so other devices do not pay for it. Reads that complete are picked up by the device on its next sync.
+ */
+class I2cAsyncSyncState : public I2cTransactionListener {
+public:
+    I2cTransaction writeTxn;
+    I2cTransaction readTxn;
+    uint8_t writeBuffer[3] = {};
+    uint8_t readCommand[1] = {};
+    uint8_t readBuffer[2] = {};
+    uint8_t readLength = 0;
+    bool lastSyncOk = true;
+    bool readAvailable = false;
+
+    I2cAsyncSyncState() {
+        writeTxn.setListener(this);
+        readTxn.setListener(this);
+    }
+
+    ~I2cAsyncSyncState() override {
+        i2cTransactionQueue.cancel(&writeTxn);
+        i2cTransactionQueue.cancel(&readTxn);
+    }
+
+    I2cAsyncSyncState(const I2cAsyncSyncState&) = delete;
+    I2cAsyncSyncState& operator=(const I2cAsyncSyncState&) = delete;
+
+    /** @return true if either transaction is still in the queue */
+    bool isBusy() const { return writeTxn.isQueued() || readTxn.isQueued(); }
+
+    /**
+     * Submit one of the transactions to the queue, counting its traffic against the device stats provided.
+     * @param transaction either writeTxn or readTxn, already prepared
+     * @param stats the device stats or nullptr
+     */
+    void submit(I2cTransaction& transaction, IoDeviceStats* stats) {
+        transaction.setStats(stats);
+        i2cTransactionQueue.submit(&transaction);
+    }
+
+    /**
+     * Gets the outcome of the transactions that completed since the last call, and resets it.
+     * @return true if all succeeded, otherwise false.
+     */
+    bool takeSyncResult() {
+        bool result = lastSyncOk;
+        lastSyncOk = true;
+        return result;
+    }
+
+    void i2cTransactionComplete(I2cTransaction& transaction, bool successful) override {
+        if(!successful) lastSyncOk = false;
+        if(&transaction == &readTxn && successful) readAvailable = true;
+    }
+};
+
+#endif //IOA_I2CTRANSACTIONQUEUE_H
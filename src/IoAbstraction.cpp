@@ -9,7 +9,7 @@
 
 #define LATCH_TIME 5
 
-#if defined(IOA_USE_MBED) || defined(BUILD_FOR_PICO_CMAKE)
+#if defined(IOA_USE_MBED) || defined(BUILD_FOR_PICO_CMAKE) || defined(BUILD_FOR_HOST)
 #if defined(IOA_USE_MBED)
 #include <mbed.h>
 #endif // only for mbed
@@ -48,6 +48,30 @@ void shiftOut(pinid_t dataPin, pinid_t clockPin, ShiftBitOrder bitOrder, uint8_t
 #endif
 
 
+IoPinMask pinsFromShiftBuffer(const uint8_t* buffer, uint8_t bufferLen, pinid_t firstPin, IoPinMask mask) {
+    IoPinMask result = 0;
+    pinid_t byteIdx = firstPin / 8;
+    for(int8_t shift = -int8_t(firstPin % 8); shift < IO_PIN_MASK_BITS && byteIdx < bufferLen; shift += 8, byteIdx++) {
+        IoPinMask byteVal = buffer[byteIdx];
+        result |= (shift < 0) ? (byteVal >> -shift) : (byteVal << shift);
+    }
+    return result & mask;
+}
+
+bool pinsToShiftBuffer(uint8_t* buffer, uint8_t bufferLen, pinid_t firstPin, IoPinMask mask, IoPinMask values) {
+    bool changed = false;
+    pinid_t byteIdx = firstPin / 8;
+    for(int8_t shift = -int8_t(firstPin % 8); shift < IO_PIN_MASK_BITS && byteIdx < bufferLen; shift += 8, byteIdx++) {
+        auto byteMask = uint8_t((shift < 0) ? (mask << -shift) : (mask >> shift));
+        if(byteMask == 0) continue;
+        auto byteVals = uint8_t((shift < 0) ? (values << -shift) : (values >> shift));
+        auto newVal = uint8_t((buffer[byteIdx] & ~byteMask) | (byteVals & byteMask));
+        changed = changed || newVal != buffer[byteIdx];
+        buffer[byteIdx] = newVal;
+    }
+    return changed;
+}
+
 ShiftRegisterIoAbstraction::ShiftRegisterIoAbstraction(const ShiftRegConfig& readConfig, const ShiftRegConfig& writeConfig) {
     this->readClockPin = readConfig.clock;
     this->readDataPin = readConfig.data;
@@ -57,8 +81,7 @@ ShiftRegisterIoAbstraction::ShiftRegisterIoAbstraction(const ShiftRegConfig& rea
     this->writeDataPin = writeConfig.data;
     this->writeLatchPin = writeConfig.latch;
     this->numOfDevicesWrite = writeConfig.numDevices;
-    this->lastRead = toWrite = 0;
-    needsInit = true;
+    allocateBuffers();
 }
 
 ShiftRegisterIoAbstraction::ShiftRegisterIoAbstraction(pinid_t readClockPin, pinid_t readDataPin, pinid_t readLatchPin, pinid_t writeClockPin, pinid_t writeDataPin,
@@ -71,7 +94,28 @@ ShiftRegisterIoAbstraction::ShiftRegisterIoAbstraction(pinid_t readClockPin, pin
 	this->writeDataPin = writeDataPin;
 	this->writeClockPin = writeClockPin;
 	this->numOfDevicesWrite = noWriteDevices;
-	this->lastRead = toWrite = 0;
+	allocateBuffers();
+}
+
+ShiftRegisterIoAbstraction::~ShiftRegisterIoAbstraction() {
+    delete[] readBuffer;
+    delete[] writeBuffer;
+}
+
+void ShiftRegisterIoAbstraction::allocateBuffers() {
+    // a direction that is not wired up has no devices, and inputs have to fit below the output cutover.
+    if(readDataPin == 0xff) numOfDevicesRead = 0;
+    if(writeDataPin == 0xff) numOfDevicesWrite = 0;
+    if(numOfDevicesRead > SHIFT_REGISTER_MAX_INPUT_DEVICES) numOfDevicesRead = SHIFT_REGISTER_MAX_INPUT_DEVICES;
+
+    readBuffer = numOfDevicesRead ? new uint8_t[numOfDevicesRead] : nullptr;
+    writeBuffer = numOfDevicesWrite ? new uint8_t[numOfDevicesWrite] : nullptr;
+    for(uint8_t i = 0; i < numOfDevicesRead; i++) readBuffer[i] = 0;
+    for(uint8_t i = 0; i < numOfDevicesWrite; i++) writeBuffer[i] = 0;
+
+    needsWrite = true;
+    inputsInUse = false;
+    syncOptions = 0;
     needsInit = true;
 }
 
@@ -95,85 +139,83 @@ void ShiftRegisterIoAbstraction::initDevice() {
     needsInit = false;
 }
 
-void ShiftRegisterIoAbstraction::pinDirection(__attribute((unused)) pinid_t pin, __attribute((unused)) uint8_t mode) {
-	// ignored, this implementation has hardwired inputs and outputs - inputs are 0-31, outputs are 32 onwards
+void ShiftRegisterIoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
+	// inputs and outputs are hardwired, inputs are 0-31, outputs are 32 onwards. We only note if any inputs are used.
+	if(pin < SHIFT_REGISTER_OUTPUT_CUTOVER && (mode == INPUT || mode == INPUT_PULLUP)) {
+		inputsInUse = true;
+	}
+}
+
+void ShiftRegisterIoAbstraction::outputsWritten(bool changed) {
+	if(changed || !bitRead(syncOptions, SHIFTREG_OUTPUT_ONLY_ON_CHANGE)) {
+		needsWrite = true;
+	}
 }
 
 void ShiftRegisterIoAbstraction::writeValue(pinid_t pin, uint8_t value) {
 	if (pin < SHIFT_REGISTER_OUTPUT_CUTOVER) return;
 	pin = pin - SHIFT_REGISTER_OUTPUT_CUTOVER;
 
-	bitWrite(toWrite, pin, value);
-	needsWrite = true;
+	outputsWritten(pinsToShiftBuffer(writeBuffer, numOfDevicesWrite, pin, 1, value ? 1 : 0));
 }
 
 void ShiftRegisterIoAbstraction::writePort(pinid_t pin, uint8_t portV) {
-	uint32_t portVal = portV;
 	if(pin < SHIFT_REGISTER_OUTPUT_CUTOVER) return;
 	pin = pin - SHIFT_REGISTER_OUTPUT_CUTOVER;
-	if(pin < 8) {
-		toWrite &= 0xffffff00;
-		toWrite |= portVal;
-	}
-	else if(pin < 16) {
-		toWrite &= 0xffff00ff;
-		toWrite |= (portVal << 8);
-	}
-	else if(pin < 24) {
-		toWrite &= 0xff00ffff;
-		toWrite |= (portVal << 16);
-	}
-	else {
-		toWrite &= 0x00ffffff;
-		toWrite |= (portVal << 24);
-	}
-	needsWrite = true;
+
+	outputsWritten(pinsToShiftBuffer(writeBuffer, numOfDevicesWrite, pin & ~0x07U, 0xff, portV));
 }
 
 uint8_t ShiftRegisterIoAbstraction::readPort(pinid_t pin) {
-    if(pin < 8) {
-		return lastRead & 0xff;
-	}
-	else if(pin < 16) {
-		return (lastRead >> 8) & 0xff;
-	}
-	else if(pin < 24) {
-		return (lastRead >> 16) & 0xff;
-	}
-	else {
-		return (lastRead >> 24) & 0xff;
-	}
+    if(pin >= SHIFT_REGISTER_OUTPUT_CUTOVER) return 0;
+    return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, pin & ~0x07U, 0xff);
 }
 
 uint8_t ShiftRegisterIoAbstraction::readValue(pinid_t pin) {
-    return ((lastRead & (1 << pin)) != 0) ? HIGH : LOW;
+    if(pin >= SHIFT_REGISTER_OUTPUT_CUTOVER) return LOW;
+    return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, pin, 1) ? HIGH : LOW;
+}
+
+IoPinMask ShiftRegisterIoAbstraction::readPins(pinid_t firstPin, IoPinMask mask) {
+    if(firstPin >= SHIFT_REGISTER_OUTPUT_CUTOVER) return 0;
+    return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, firstPin, mask);
+}
+
+void ShiftRegisterIoAbstraction::writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) {
+    // line the mask up with the output register, any pins below the cutover are inputs and are dropped.
+    if(firstPin < SHIFT_REGISTER_OUTPUT_CUTOVER) {
+        uint8_t inputPins = SHIFT_REGISTER_OUTPUT_CUTOVER - firstPin;
+        if(inputPins >= IO_PIN_MASK_BITS) return;
+        mask >>= inputPins;
+        values >>= inputPins;
+        firstPin = SHIFT_REGISTER_OUTPUT_CUTOVER;
+    }
+    if(mask == 0) return;
+
+    outputsWritten(pinsToShiftBuffer(writeBuffer, numOfDevicesWrite, firstPin - SHIFT_REGISTER_OUTPUT_CUTOVER, mask, values));
 }
 
 bool ShiftRegisterIoAbstraction::runLoop() {
     if(needsInit) initDevice();
 
 	uint8_t i;
-	if (readDataPin != 0xff) {
+	if (numOfDevicesRead != 0 && (inputsInUse || !bitRead(syncOptions, SHIFTREG_INPUT_ONLY_WHEN_USED))) {
 		internalDigitalDevice().digitalWriteS(readLatchPin, LOW);
         taskManager.yieldForMicros(LATCH_TIME);
         internalDigitalDevice().digitalWriteS(readLatchPin, HIGH);
 
-		lastRead = 0;
-		for(i = 0; i < numOfDevicesRead; ++i) {
-			lastRead = lastRead << 8;
-			lastRead |= (shiftIn(readDataPin, readClockPin, MSBFIRST) & 0xff);
+		// the first byte shifted in is from the device furthest away, which holds the highest pins.
+		for(i = numOfDevicesRead; i > 0; --i) {
+			readBuffer[i - 1] = shiftIn(readDataPin, readClockPin, MSBFIRST);
 		}
 	}
 	
-	if (writeDataPin != 0xff && needsWrite) {
+	if (numOfDevicesWrite != 0 && needsWrite) {
         internalDigitalDevice().digitalWriteS(writeLatchPin, LOW);
         taskManager.yieldForMicros(LATCH_TIME);
 		
-		uint32_t shiftLocal = toWrite;
 		for(i = 0; i < numOfDevicesWrite; ++i) {
-			uint8_t regVal = (shiftLocal & 0xff);
-			shiftOut(writeDataPin, writeClockPin, MSBFIRST, regVal);
-			shiftLocal = shiftLocal >> 8;
+			shiftOut(writeDataPin, writeClockPin, MSBFIRST, writeBuffer[i]);
 		}
 		needsWrite = false;
         internalDigitalDevice().digitalWriteS(writeLatchPin, HIGH);
@@ -207,8 +249,9 @@ ShiftRegisterIoAbstraction165In::ShiftRegisterIoAbstraction165In(ShiftRegConfig
     this->readClockPin = config.clock;
     this->readDataPin = config.data;
     this->numOfDevicesRead = config.numDevices;
+    this->readBuffer = new uint8_t[numOfDevicesRead];
+    for(uint8_t i = 0; i < numOfDevicesRead; i++) readBuffer[i] = 0;
     needsInit = true;
-    lastRead = 0;
 }
 
 ShiftRegisterIoAbstraction165In::ShiftRegisterIoAbstraction165In(pinid_t readClockPin, pinid_t readDataPin,
@@ -216,10 +259,10 @@ ShiftRegisterIoAbstraction165In::ShiftRegisterIoAbstraction165In(pinid_t readClo
     this->readClockPin = readClockPin;
     this->readDataPin = readDataPin;
     this->readLatchPin = readLatchPin;
-    this->lastRead = 0;
     this->numOfDevicesRead = numRead;
+    this->readBuffer = new uint8_t[numOfDevicesRead];
+    for(uint8_t i = 0; i < numOfDevicesRead; i++) readBuffer[i] = 0;
     this->needsInit = true;
-    this->lastRead = 0;
 }
 
 void ShiftRegisterIoAbstraction165In::initDevice() {
@@ -235,38 +278,31 @@ void ShiftRegisterIoAbstraction165In::initDevice() {
 uint8_t ShiftRegisterIoAbstraction165In::readPort(pinid_t pin) {
     if(needsInit) initDevice();
 
-    if(pin < 8) {
-        return lastRead & 0xff;
-    }
-    else if(pin < 16) {
-        return (lastRead >> 8) & 0xff;
-    }
-    else if(pin < 24) {
-        return (lastRead >> 16) & 0xff;
-    }
-    else {
-        return (lastRead >> 24) & 0xff;
-    }
+    return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, pin & ~0x07U, 0xff);
 }
 
 uint8_t ShiftRegisterIoAbstraction165In::readValue(pinid_t pin) {
     if(needsInit) initDevice();
 
-    return ((lastRead & (1 << pin)) != 0) ? HIGH : LOW;
+    return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, pin, 1) ? HIGH : LOW;
+}
+
+IoPinMask ShiftRegisterIoAbstraction165In::readPins(pinid_t firstPin, IoPinMask mask) {
+    if(needsInit) initDevice();
+
+    return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, firstPin, mask);
 }
 
 bool ShiftRegisterIoAbstraction165In::runLoop() {
     if(needsInit) initDevice();
 
-    uint8_t i;
     internalDigitalDevice().digitalWriteS(readLatchPin, LOW);
     taskManager.yieldForMicros(LATCH_TIME);
     internalDigitalDevice().digitalWriteS(readLatchPin, HIGH);
 
-    lastRead = 0;
-    for(i = 0; i < numOfDevicesRead; ++i) {
-        lastRead = lastRead << 8;
-        lastRead |= (shiftInFor165() & 0xff);
+    // the first byte shifted in is from the device furthest away, which holds the highest pins.
+    for(uint8_t i = numOfDevicesRead; i > 0; --i) {
+        readBuffer[i - 1] = shiftInFor165();
     }
 
     return true;
@@ -288,55 +324,120 @@ IoAbstractionRef inputFrom74HC165ShiftRegister(pinid_t readClkPin, pinid_t dataP
 }
 
 MultiIoAbstraction::MultiIoAbstraction(pinid_t arduinoPinsNeeded) {
+	delegateCapacity = MAX_ALLOWABLE_DELEGATES;
+	delegates = new IoAbstractionRef[delegateCapacity];
+	limits = new pinid_t[delegateCapacity];
+	delegateFlags = new uint8_t[delegateCapacity];
 	limits[0] = arduinoPinsNeeded;
 	delegates[0] = internalDigitalIo();
+	delegateFlags[0] = 0;
 	numDelegates = 1;
+	skippedSyncs = 0;
+	routingTable = nullptr;
+	rebuildRoutingTable();
 }
 
 MultiIoAbstraction::~MultiIoAbstraction() {
-	// delegates added are our responsibility to clean up
-	for(uint8_t i=0; i<numDelegates; ++i) {
+	// delegates added are our responsibility to clean up, the first one is always the device pins.
+	for(uint8_t i=1; i<numDelegates; ++i) {
 		delete delegates[i];
 	}
+	delete[] delegates;
+	delete[] limits;
+	delete[] delegateFlags;
+	delete[] routingTable;
 }
 
 void MultiIoAbstraction::addIoExpander(IoAbstractionRef expander, pinid_t numOfPinsNeeded) {
+	if(numDelegates == delegateCapacity) {
+		if(delegateCapacity == 0xff) {
+			serlogF(SER_ERROR, "Multi IO full");
+			return;
+		}
+		uint8_t newCapacity = (delegateCapacity > 0x7f) ? 0xff : delegateCapacity * 2;
+		auto newDelegates = new IoAbstractionRef[newCapacity];
+		auto newLimits = new pinid_t[newCapacity];
+		auto newFlags = new uint8_t[newCapacity];
+		for(uint8_t i=0; i<numDelegates; ++i) {
+			newDelegates[i] = delegates[i];
+			newLimits[i] = limits[i];
+			newFlags[i] = delegateFlags[i];
+		}
+		delete[] delegates;
+		delete[] limits;
+		delete[] delegateFlags;
+		delegates = newDelegates;
+		limits = newLimits;
+		delegateFlags = newFlags;
+		delegateCapacity = newCapacity;
+	}
+
 	limits[numDelegates]= limits[numDelegates - 1] + numOfPinsNeeded;
 	delegates[numDelegates] = expander;
 
+	// a new expander is synced at least once so that it gets initialised.
+	delegateFlags[numDelegates] = 0;
+	bitSet(delegateFlags[numDelegates], MULTI_IO_DIRTY_OUTPUT);
+
 	numDelegates++;
+	rebuildRoutingTable();
 }
 
-uint8_t MultiIoAbstraction::doExpanderOp(pinid_t pin, uint8_t aVal, ExpanderOpFn fn) {
-	uint8_t ret = -1;
-	for(uint8_t i=0; i<numDelegates; ++i) {
-		// when we are on the first expander, the "previous" last pin is 0.
-		uint8_t last = (i==0) ? 0 : limits[i-1];
-
-		// then we find the limit of the expander we are on
-		uint8_t currLimit = limits[i];
+void MultiIoAbstraction::rebuildRoutingTable() {
+	// each entry holds the delegate that owns the first pin of that group of pins, any other delegate starting
+	// within the group is found by stepping forward from there, so at most a few limit checks are ever needed.
+	size_t entries = ((size_t)limits[numDelegates - 1] >> MULTI_IO_ROUTING_SHIFT) + 1;
+	delete[] routingTable;
+	routingTable = new uint8_t[entries];
 
-		// and check if we have a match!
-		if(pin >= last && pin < currLimit) {
-			ret = fn(delegates[i], pin - last, aVal);
-			break;
-		}
+	uint8_t delegate = 0;
+	for(size_t i=0; i<entries; ++i) {
+		size_t firstPin = i << MULTI_IO_ROUTING_SHIFT;
+		while(delegate < (numDelegates - 1) && firstPin >= limits[delegate]) delegate++;
+		routingTable[i] = delegate;
 	}
-	return ret;
+}
+
+uint8_t MultiIoAbstraction::delegateForPin(pinid_t pin) const {
+	if(pin >= limits[numDelegates - 1]) return 0xff;
+
+	uint8_t idx = routingTable[pin >> MULTI_IO_ROUTING_SHIFT];
+	while(pin >= limits[idx]) idx++;
+	return idx;
+}
+
+void MultiIoAbstraction::alwaysSyncExpander(pinid_t pin) {
+	uint8_t idx = delegateForPin(pin);
+	if(idx != 0xff) bitSet(delegateFlags[idx], MULTI_IO_HAS_INPUTS);
+}
+
+uint8_t MultiIoAbstraction::doExpanderOp(pinid_t pin, uint8_t aVal, ExpanderOpFn fn, uint8_t flagsToSet) {
+	uint8_t idx = delegateForPin(pin);
+	if(idx == 0xff) return -1;
+	delegateFlags[idx] |= flagsToSet;
+
+	// when we are on the first expander, the "previous" last pin is 0.
+	pinid_t last = (idx == 0) ? 0 : limits[idx - 1];
+	return fn(delegates[idx], pin - last, aVal);
 }
 
 void MultiIoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
+	// some devices only write the direction out during sync, so a direction change always needs a sync.
+	uint8_t flags = 0;
+	bitSet(flags, MULTI_IO_DIRTY_OUTPUT);
+	if(mode == INPUT || mode == INPUT_PULLUP) bitSet(flags, MULTI_IO_HAS_INPUTS);
+
 	doExpanderOp(pin, mode, [](IoAbstractionRef a, uint8_t p, uint8_t v) {
 		a->pinDirection(p, v);
 		return (uint8_t)0;
-	});
+	}, flags);
 }
 
 void MultiIoAbstraction::writeValue(pinid_t pin, uint8_t value) {
 	doExpanderOp(pin, value, [](IoAbstractionRef a, uint8_t p, uint8_t v) {
 		a->writeValue(p, v);
 		return (uint8_t)0;
-	});
+	}, (1U << MULTI_IO_DIRTY_OUTPUT));
 }
 
 uint8_t MultiIoAbstraction::readValue(pinid_t pin) {
@@ -350,7 +451,7 @@ void MultiIoAbstraction::writePort(pinid_t pin, uint8_t val) {
 	doExpanderOp(pin, val, [](IoAbstractionRef a, uint8_t p, uint8_t v) {
 		a->writePort(p, v);
 		return (uint8_t)0;
-	});
+	}, (1U << MULTI_IO_DIRTY_OUTPUT));
 }
 
 uint8_t MultiIoAbstraction::readPort(pinid_t pin) {
@@ -359,26 +460,104 @@ uint8_t MultiIoAbstraction::readPort(pinid_t pin) {
 	});
 }
 
-void MultiIoAbstraction::attachInterrupt(pinid_t pin, RawIntHandler intHandler, uint8_t mode) {
-	for(uint8_t i=0; i<numDelegates; ++i) {
-		// when we are on the first expander, the "previous" last pin is 0.
-		uint8_t last = (i==0) ? 0 : limits[i-1];
+IoPinMask MultiIoAbstraction::readPins(pinid_t firstPin, IoPinMask mask) {
+	return doBulkOp(firstPin, mask, 0, BULK_READ);
+}
 
-		// then we find the limit of the expander we are on
-		uint8_t currLimit = limits[i];
+void MultiIoAbstraction::writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) {
+	doBulkOp(firstPin, mask, values, BULK_WRITE);
+}
 
-		// and check if we have a match!
-		if(pin >= last && pin < currLimit) {
-			delegates[i]->attachInterrupt(pin - last, intHandler, mode);
-			break;
+IoPinMask MultiIoAbstraction::changedPins(pinid_t firstPin, IoPinMask mask) {
+	return doBulkOp(firstPin, mask, 0, BULK_CHANGED);
+}
+
+void MultiIoAbstraction::clearChangedPins(pinid_t firstPin, IoPinMask mask) {
+	doBulkOp(firstPin, mask, 0, BULK_CLEAR_CHANGED);
+}
+
+IoPinMask MultiIoAbstraction::doBulkOp(pinid_t firstPin, IoPinMask mask, IoPinMask values, BulkOperation operation) {
+	IoPinMask result = 0;
+	uint32_t windowEnd = uint32_t(firstPin) + IO_PIN_MASK_BITS;
+	uint8_t firstDelegate = delegateForPin(firstPin);
+	if(firstDelegate == 0xff) return 0;
+	for(uint8_t i=firstDelegate; i<numDelegates && mask != 0; ++i) {
+		pinid_t last = (i==0) ? 0 : limits[i-1];
+		pinid_t currLimit = limits[i];
+		if(currLimit <= firstPin) continue;
+		if(last >= windowEnd) break;
+
+		// work out which bits of the mask belong to this expander, then shift them down to its own pin numbers.
+		uint8_t fromBit = (last > firstPin) ? uint8_t(last - firstPin) : 0;
+		uint8_t toBit = (currLimit >= windowEnd) ? IO_PIN_MASK_BITS : uint8_t(currLimit - firstPin);
+		IoPinMask delegateMask = (mask & ioPinMaskForRange(fromBit, toBit)) >> fromBit;
+		if(delegateMask == 0) continue;
+
+		pinid_t delegateFirstPin = firstPin + fromBit - last;
+		if(operation == BULK_WRITE) {
+			delegates[i]->writePins(delegateFirstPin, delegateMask, values >> fromBit);
+			bitSet(delegateFlags[i], MULTI_IO_DIRTY_OUTPUT);
+		}
+		else if(operation == BULK_CHANGED) {
+			// unless the last sync included this abstraction, what it reports is from an older sync and may be stale.
+			IoPinMask changed = delegateMask;
+			if(bitRead(delegateFlags[i], MULTI_IO_SYNCED_LAST)) changed = delegates[i]->changedPins(delegateFirstPin, delegateMask);
+			result |= (changed & delegateMask) << fromBit;
+		}
+		else if(operation == BULK_CLEAR_CHANGED) {
+			delegates[i]->clearChangedPins(delegateFirstPin, delegateMask);
+		}
+		else {
+			result |= (delegates[i]->readPins(delegateFirstPin, delegateMask) & delegateMask) << fromBit;
 		}
 	}
+	return result;
+}
+
+void MultiIoAbstraction::attachInterrupt(pinid_t pin, RawIntHandler intHandler, uint8_t mode) {
+	uint8_t idx = delegateForPin(pin);
+	if(idx == 0xff) return;
+
+	pinid_t last = (idx == 0) ? 0 : limits[idx - 1];
+	delegates[idx]->attachInterrupt(pin - last, intHandler, mode);
+
+	// an interrupt means we'll want to read the pin back, and some devices set up interrupts during sync.
+	bitSet(delegateFlags[idx], MULTI_IO_DIRTY_OUTPUT);
+	bitSet(delegateFlags[idx], MULTI_IO_HAS_INPUTS);
 }
 
 bool MultiIoAbstraction::runLoop() {
 	bool runStatus = true;
 	for(uint8_t i=0; i<numDelegates; ++i) {
-		runStatus = runStatus && delegates[i]->runLoop();
+		uint8_t flags = delegateFlags[i];
+		if(!bitRead(flags, MULTI_IO_DIRTY_OUTPUT) && !bitRead(flags, MULTI_IO_HAS_INPUTS)) {
+			// device pins never need a sync, so only count the expanders.
+			if(i != 0) skippedSyncs++;
+			bitClear(delegateFlags[i], MULTI_IO_SYNCED_LAST);
+			continue;
+		}
+
+		// every delegate is synced even after one has failed, so a faulty expander cannot hold up the others.
+		bool ok = delegates[i]->sync();
+		runStatus = runStatus && ok;
+
+		// only once the sync has worked can we be sure the outputs are written, otherwise try again next time.
+		if(ok) bitClear(delegateFlags[i], MULTI_IO_DIRTY_OUTPUT);
+		bitWrite(delegateFlags[i], MULTI_IO_SYNCED_LAST, ok);
 	}
 	return runStatus;
 }
+
+void MultiIoAbstraction::beginConfig() {
+	for(uint8_t i=0; i<numDelegates; ++i) {
+		delegates[i]->beginConfig();
+	}
+}
+
+bool MultiIoAbstraction::commitConfig() {
+	bool commitOk = true;
+	for(uint8_t i=0; i<numDelegates; ++i) {
+		if(!delegates[i]->commitConfig()) commitOk = false;
+	}
+	return commitOk;
+}
@@ -18,7 +18,43 @@
 
 #define SHIFT_REGISTER_OUTPUT_CUTOVER 32
 
-#if defined(IOA_USE_MBED) || defined(BUILD_FOR_PICO_CMAKE)
+/** inputs are pins 0 up to SHIFT_REGISTER_OUTPUT_CUTOVER on an input and output shift register, limiting the input chain */
+#define SHIFT_REGISTER_MAX_INPUT_DEVICES (SHIFT_REGISTER_OUTPUT_CUTOVER / 8)
+
+/**
+ * Shift register sync option: the output chain is only shifted out when a write actually changed the value of at
+ * least one output, instead of after any write.
+ */
+#define SHIFTREG_OUTPUT_ONLY_ON_CHANGE 0
+/**
+ * Shift register sync option: the input chain is only shifted in once at least one input pin has been set up with
+ * pinMode as INPUT or INPUT_PULLUP. SwitchInput does this for each switch that is added.
+ */
+#define SHIFTREG_INPUT_ONLY_WHEN_USED 1
+
+/**
+ * Gets up to 32 pins from a shift register byte buffer where byte 0 holds pins 0..7, pins beyond the end read as 0.
+ * Used by the shift register abstractions to hold any length of chain.
+ * @param buffer the shift register buffer
+ * @param bufferLen the number of bytes in the buffer, one per device
+ * @param firstPin the pin that is represented by bit 0 of the mask
+ * @param mask the pins to get
+ * @return the pins as a mask
+ */
+IoPinMask pinsFromShiftBuffer(const uint8_t* buffer, uint8_t bufferLen, pinid_t firstPin, IoPinMask mask);
+
+/**
+ * Puts up to 32 pins into a shift register byte buffer where byte 0 holds pins 0..7, pins beyond the end are dropped.
+ * @param buffer the shift register buffer
+ * @param bufferLen the number of bytes in the buffer, one per device
+ * @param firstPin the pin that is represented by bit 0 of the mask
+ * @param mask the pins to change
+ * @param values the new value for each pin in the mask
+ * @return true if any byte in the buffer changed
+ */
+bool pinsToShiftBuffer(uint8_t* buffer, uint8_t bufferLen, pinid_t firstPin, IoPinMask mask, IoPinMask values);
+
+#if defined(IOA_USE_MBED) || defined(BUILD_FOR_PICO_CMAKE) || defined(BUILD_FOR_HOST)
 #if defined(IOA_USE_MBED)
 #include <mbed.h>
 #endif
@@ -43,14 +79,20 @@ struct ShiftRegConfig {
  * up to 4 devices chained together, this is a breaking change from the 1.0.x versions.
  * 
  * An implementation of BasicIoFacilities that supports the ubiquitous shift
- * register, using 74HC165 for input (pins 0 to 23) and a 74HC595 for output (32 onwards).
- * It supports up to three registers in each direction at the moment.
+ * register, using 74HC165 for input (pins 0 to 31) and a 74HC595 for output (32 onwards).
+ * It supports up to four input registers, and any number of output registers that fit in the range of pinid_t, on
+ * 8 bit boards that is up to 28 output registers. The state of each chain is held in a byte per register.
+ *
+ * By default the outputs are shifted on the next sync after any write, and inputs are shifted in on every sync. For
+ * long chains, setSyncOptions can restrict this so that unchanged outputs and unused inputs are not shifted.
  */
 class ShiftRegisterIoAbstraction : public BasicIoAbstraction {
 private:
-	uint32_t toWrite;
-	uint32_t lastRead;
+	uint8_t* writeBuffer;
+	uint8_t* readBuffer;
 	bool needsWrite;
+	bool inputsInUse;
+	uint8_t syncOptions;
 
 	uint8_t numOfDevicesRead;
 	pinid_t readDataPin;
@@ -72,9 +114,19 @@ public:
 	ShiftRegisterIoAbstraction(pinid_t readClockPin, pinid_t readDataPin, pinid_t readLatchPin,
 	                           pinid_t writeClockPin, pinid_t writeDataPin, pinid_t writeLatchPin, uint8_t numRead, uint8_t numWrite);
     ShiftRegisterIoAbstraction(const ShiftRegConfig& readConfig, const ShiftRegConfig& writeConfig);
-	~ShiftRegisterIoAbstraction() override { }
+	~ShiftRegisterIoAbstraction() override;
+	// the buffers are owned by this object, so it cannot be copied.
+	ShiftRegisterIoAbstraction(const ShiftRegisterIoAbstraction&) = delete;
+	ShiftRegisterIoAbstraction& operator=(const ShiftRegisterIoAbstraction&) = delete;
     void initDevice();
 
+	/**
+	 * Choose how the chains are synced, by default everything is synced as in earlier versions. Combine the options
+	 * as bits, for example `(1 << SHIFTREG_OUTPUT_ONLY_ON_CHANGE) | (1 << SHIFTREG_INPUT_ONLY_WHEN_USED)`.
+	 * @param options the sync options as bits, see SHIFTREG_OUTPUT_ONLY_ON_CHANGE and SHIFTREG_INPUT_ONLY_WHEN_USED
+	 */
+	void setSyncOptions(uint8_t options) { syncOptions = options; }
+
 	void pinDirection(pinid_t pin, uint8_t mode) override;
 	void writeValue(pinid_t pin, uint8_t value) override;
 	uint8_t readValue(pinid_t pin) override;
@@ -85,19 +137,36 @@ public:
 	bool runLoop() override;
 	
 	/**
-	 * writes to the output shift register - currently always port 0
+	 * writes a whole output shift register at once, pin is any output pin on that register (32 onwards)
 	 */
 	void writePort(pinid_t port, uint8_t portVal) override;
 
 	/**
-	 * reads from the input shift register - currently always port 3
+	 * reads a whole input shift register at once, pin is any input pin on that register
 	 */
 	uint8_t readPort(pinid_t port) override;
+
+	/**
+	 * reads the requested input pins from the last state that was shifted in, in one operation.
+	 */
+	IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override;
+
+	/**
+	 * writes the requested output pins (32 onwards) in one operation, they are shifted out on the next sync.
+	 */
+	void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override;
+private:
+	void allocateBuffers();
+	void outputsWritten(bool changed);
 };
 
+/**
+ * An input only shift register implementation for 74HC165 devices, any number of devices can be chained up to the
+ * range of pinid_t, the pins start at 0 on the device nearest the board.
+ */
 class ShiftRegisterIoAbstraction165In : public BasicIoAbstraction {
 private:
-    uint32_t lastRead;
+    uint8_t* readBuffer;
     uint8_t numOfDevicesRead;
     pinid_t readDataPin;
     pinid_t readLatchPin;
@@ -113,7 +182,10 @@ public:
      */
     ShiftRegisterIoAbstraction165In(pinid_t readClockPin, pinid_t readDataPin, pinid_t readLatchPin, pinid_t numRead);
     ShiftRegisterIoAbstraction165In(ShiftRegConfig config);
-    ~ShiftRegisterIoAbstraction165In() override = default;
+    ~ShiftRegisterIoAbstraction165In() override { delete[] readBuffer; }
+    // the buffer is owned by this object, so it cannot be copied.
+    ShiftRegisterIoAbstraction165In(const ShiftRegisterIoAbstraction165In&) = delete;
+    ShiftRegisterIoAbstraction165In& operator=(const ShiftRegisterIoAbstraction165In&) = delete;
     void initDevice();
 
     /** Input only abstraction, does nothing because only input is supported */
@@ -122,6 +194,7 @@ public:
     uint8_t readValue(pinid_t pin) override;
     bool runLoop() override;
     uint8_t readPort(pinid_t port) override;
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override;
 
     //
     // Features not implemented on this abstaction
@@ -136,7 +209,7 @@ public:
 /**
  * performs both input and output functions using two or more shift registers, for both reading and writing.  As shift registers have a fixed direction
  * input and output are handled by different devices, and therefore fixed at the time of building the circuit. This function supports chaining of
- * up to 4 devices for both directions.
+ * up to 4 input devices, and as many output devices as fit in the range of pinid_t.
  *
  * This abstraction works as follows:
  *
@@ -192,21 +265,30 @@ IoAbstractionRef inputOnlyFromShiftRegister(uint8_t readClockPin, uint8_t dataPi
 IoAbstractionRef outputOnlyFromShiftRegister(uint8_t writeClockPin, uint8_t writeDataPin, uint8_t writeLatchPin, uint8_t numOfDevicesWrite = 1);
 
 /**
- * Performs input only functions using a 74x165 plugin, the input pins start at 0 up to a maximum of 31, each device
- * adds another 8 pins.
+ * Performs input only functions using a 74x165 plugin, the input pins start at 0 and each device adds another 8 pins,
+ * any number of devices can be chained up to the range of pinid_t.
  * @param readClkPin the clock pin of the shift register, used as OUTPUT
  * @param dataPin the data pin of the shift register, used as INPUT
  * @param latchPin the latch pin of the shift register, used as OUTPUT
- * @param numOfDevices the number of devices that are chained together in the usual fashion, range is 1..4
+ * @param numOfDevices the number of devices that are chained together in the usual fashion
  * @return a shift register abstraction as an IoAbstraction ref.
  */
 IoAbstractionRef inputFrom74HC165ShiftRegister(pinid_t readClkPin, pinid_t dataPin, pinid_t latchPin, pinid_t numOfDevices = 1);
 
-// this defines the number of IOExpanders can be put into a multi IO expander.
+// this defines the number of IOExpanders a multi IO expander has space for initially, it grows when more are added.
 #ifndef MAX_ALLOWABLE_DELEGATES
 #define MAX_ALLOWABLE_DELEGATES 8
 #endif // defined MAX_ALLOWABLE_DELEGATES
 
+// each multi IO routing table entry covers (1 << MULTI_IO_ROUTING_SHIFT) pins.
+#define MULTI_IO_ROUTING_SHIFT 3
+
+// flags kept for each abstraction within a multi IO, they decide if the abstraction needs to be synced.
+#define MULTI_IO_DIRTY_OUTPUT 0
+#define MULTI_IO_HAS_INPUTS 1
+// set when the abstraction was synced successfully by the last sync, otherwise which of its pins changed is unknown.
+#define MULTI_IO_SYNCED_LAST 2
+
 typedef uint8_t (*ExpanderOpFn)(IoAbstractionRef ref, uint8_t pin, uint8_t val);
 
 /** 
@@ -219,18 +301,53 @@ typedef uint8_t (*ExpanderOpFn)(IoAbstractionRef ref, uint8_t pin, uint8_t val);
  * and append the additional IO devices during setup. In order to pass such a varable to
  * the ioDevice functions, such as ioDeviceDigitalRead you must put an ampersand in front
  * of the variable to make it into a pointer.
+ *
+ * Pins are routed to their abstraction using a table with one entry for every 8 pins, built as expanders are
+ * added, so the cost of finding the abstraction for a pin does not grow with the number of expanders.
+ *
+ * During sync, only abstractions that have been written to since the last sync, or that have input pins, are
+ * synced; others are skipped. If you change an expander directly instead of through this class, or it needs syncing
+ * for reasons this class cannot see (such as touch sensing), call alwaysSyncExpander with any pin on it.
  */
 class MultiIoAbstraction : public BasicIoAbstraction {
 private:
-	IoAbstractionRef delegates[MAX_ALLOWABLE_DELEGATES];
-	pinid_t limits[MAX_ALLOWABLE_DELEGATES];
+	IoAbstractionRef* delegates;
+	pinid_t* limits;
+	uint8_t* routingTable;
+	uint8_t* delegateFlags;
 	uint8_t numDelegates;
+	uint8_t delegateCapacity;
+	uint32_t skippedSyncs;
 public:
 	explicit MultiIoAbstraction(pinid_t arduinoPinsNeeded = 100);
 	~MultiIoAbstraction() override;
+	MultiIoAbstraction(const MultiIoAbstraction&) = delete;
+	MultiIoAbstraction& operator=(const MultiIoAbstraction&) = delete;
 	void addIoExpander(IoAbstractionRef expander, pinid_t numOfPinsNeeded);
 	void addIoDevice(BasicIoAbstraction& expander, pinid_t pinsNeeded) { addIoExpander(&expander, pinsNeeded);}
 
+	/**
+	 * @return the number of abstractions in this multi IO, including the device pins.
+	 */
+	uint8_t getNumberOfDelegates() const { return numDelegates; }
+
+	/**
+	 * Makes sure the abstraction that owns the pin is synced on every call to sync, even if none of its pins have
+	 * been configured as input or written to through this class.
+	 * @param pin any pin on the expander, in this multi IO's numbering.
+	 */
+	void alwaysSyncExpander(pinid_t pin);
+
+	/**
+	 * @return the number of abstraction syncs that have been skipped because there was nothing to write or read.
+	 */
+	uint32_t getSkippedSyncCount() const { return skippedSyncs; }
+
+	/**
+	 * Reset the skipped sync count back to zero.
+	 */
+	void resetSkippedSyncCount() { skippedSyncs = 0; }
+
 	/** 
 	 * delegates the pin direction call to whichever abstraction owns the pin, and that
 	 * abstraction will then set the pin mode
@@ -268,6 +385,36 @@ public:
 	 */
 	uint8_t readPort(pinid_t port) override;
 
+	/**
+	 * splits the pins in the mask between the abstractions that own them, with one bulk read per abstraction
+	 * @param firstPin the pin represented by bit 0 of the mask
+	 * @param mask the pins to be read
+	 */
+	IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override;
+
+	/**
+	 * splits the pins in the mask between the abstractions that own them, with one bulk write per abstraction
+	 * @param firstPin the pin represented by bit 0 of the mask
+	 * @param mask the pins to be written
+	 * @param values the values to write to the pins
+	 */
+	void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override;
+
+	/**
+	 * splits the pins in the mask between the abstractions that own them, asking each which of its pins changed.
+	 * Abstractions that were skipped or failed during the last sync report all their pins, as they cannot be sure.
+	 * @param firstPin the pin represented by bit 0 of the mask
+	 * @param mask the pins of interest
+	 */
+	IoPinMask changedPins(pinid_t firstPin, IoPinMask mask) override;
+
+	/**
+	 * splits the pins in the mask between the abstractions that own them, clearing the changed state on each.
+	 * @param firstPin the pin represented by bit 0 of the mask
+	 * @param mask the pins to clear
+	 */
+	void clearChangedPins(pinid_t firstPin, IoPinMask mask) override;
+
 	/**
 	 * delegates attaching an interrupt to the abstraction that owns the pin, see each abstraction
 	 * for more information about how interrupts work with the given device.
@@ -278,11 +425,26 @@ public:
 	void attachInterrupt(pinid_t pin, RawIntHandler intHandler, uint8_t mode) override;
 
 	/**
-	 * will run through all delegate abstractions and sync them
+	 * will run through the delegate abstractions and sync those that have been written to or have inputs.
 	 */
 	bool runLoop() override;
+
+	/**
+	 * starts a configuration batch on every abstraction in this multi IO.
+	 */
+	void beginConfig() override;
+
+	/**
+	 * commits the configuration batch on every abstraction in this multi IO.
+	 * @return true if all the abstractions committed successfully
+	 */
+	bool commitConfig() override;
 private:
-	uint8_t doExpanderOp(pinid_t pin, uint8_t aVal, ExpanderOpFn fn);
+	enum BulkOperation : uint8_t { BULK_READ, BULK_WRITE, BULK_CHANGED, BULK_CLEAR_CHANGED };
+	uint8_t doExpanderOp(pinid_t pin, uint8_t aVal, ExpanderOpFn fn, uint8_t flagsToSet = 0);
+	uint8_t delegateForPin(pinid_t pin) const;
+	void rebuildRoutingTable();
+	IoPinMask doBulkOp(pinid_t firstPin, IoPinMask mask, IoPinMask values, BulkOperation operation);
 };
 
 /**
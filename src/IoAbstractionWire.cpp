@@ -5,6 +5,7 @@
 
 #include <IoAbstractionWire.h>
 #include "wireHelpers.h"
+#include "I2cTransactionQueue.h"
 
 PCF8574IoAbstraction::PCF8574IoAbstraction(uint8_t addr, uint8_t interruptPin, WireType wireImplementation, bool mode16Bit, bool invertedLogic) : lastRead{}, toWrite{} {
 	this->wireImpl = (wireImplementation != nullptr) ? wireImplementation : defaultWireTypePtr;
@@ -19,6 +20,7 @@ PCF8574IoAbstraction::PCF8574IoAbstraction(uint8_t addr, uint8_t interruptPin, W
 void PCF8574IoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
 	if (mode == INPUT || mode == INPUT_PULLUP) {
 		overrideReadFlag();
+		bitWrite(flags, FORCE_READ_FLAG, true);
 		writeValue(pin, HIGH);
 	}
 	else {
@@ -49,7 +51,68 @@ void PCF8574IoAbstraction::writePort(pinid_t pin, uint8_t value) {
     bitWrite(flags, NEEDS_WRITE_FLAG, true);
 }
 
+IoPinMask PCF8574IoAbstraction::readPins(pinid_t firstPin, IoPinMask mask) {
+    if(firstPin > 15) return 0;
+    IoPinMask state = lastRead[0] | ((IoPinMask)lastRead[1] << 8);
+    return (state >> firstPin) & mask;
+}
+
+void PCF8574IoAbstraction::writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) {
+    if(firstPin > 15) return;
+    uint16_t pinMask = (mask << firstPin) & 0xffff;
+    if(pinMask == 0) return;
+    uint16_t pinValues = (values << firstPin) & pinMask;
+
+    toWrite[0] = (toWrite[0] & ~(pinMask & 0xff)) | (pinValues & 0xff);
+    toWrite[1] = (toWrite[1] & ~(pinMask >> 8)) | (pinValues >> 8);
+    bitWrite(flags, NEEDS_WRITE_FLAG, true);
+}
+
+PCF8574IoAbstraction::~PCF8574IoAbstraction() {
+    delete asyncState;
+}
+
+bool PCF8574IoAbstraction::setAsyncSync(bool async) {
+    if(async == isAsyncSync()) return true;
+    if(async) {
+        asyncState = new I2cAsyncSyncState();
+    }
+    else {
+        if(asyncState->isBusy()) return false;
+        delete asyncState;
+        asyncState = nullptr;
+    }
+    return true;
+}
+
+bool PCF8574IoAbstraction::setInterruptGatedReads(bool gated, uint16_t safetyMillis) {
+    if(gated && interruptPin == 0xff) return false;
+
+    if(gated) internalDigitalDevice().pinMode(interruptPin, INPUT_PULLUP);
+    safetyReadMillis = safetyMillis;
+    bitWrite(flags, INTERRUPT_GATED_FLAG, gated);
+    // we cannot know what happened before the interrupt line was being watched, so read on the next sync.
+    bitWrite(flags, FORCE_READ_FLAG, true);
+    return true;
+}
+
+bool PCF8574IoAbstraction::isReadNeeded() {
+    if(!bitRead(flags, PINS_CONFIGURED_READ_FLAG)) return false;
+    if(!bitRead(flags, INTERRUPT_GATED_FLAG) || bitRead(flags, FORCE_READ_FLAG)) return true;
+
+    if(internalDigitalDevice().digitalRead(interruptPin) == LOW) return true;
+    return safetyReadMillis != 0 && (micros() - lastReadMicros) >= (safetyReadMillis * 1000UL);
+}
+
+void PCF8574IoAbstraction::inputsWereRead(bool readOk) {
+    // after a failed read the inputs are unknown, so keep reading until one succeeds.
+    bitWrite(flags, FORCE_READ_FLAG, !readOk);
+    lastReadMicros = micros();
+}
+
 bool PCF8574IoAbstraction::runLoop(){
+    if(asyncState != nullptr) return asyncRunLoop();
+
     bool writeOk = true;
     size_t bytesToTransfer = bitRead(flags, PCF8575_16BIT_FLAG) ? 2 : 1;
     bool invertedLogic = bitRead(flags, INVERTED_LOGIC);
@@ -62,10 +125,13 @@ bool PCF8574IoAbstraction::runLoop(){
         dataToWrite[1] = invertedLogic ? ~toWrite[1] : toWrite[1];
 
         writeOk = ioaWireWriteWithRetry(wireImpl, address, dataToWrite, bytesToTransfer);
+        // a write clears the interrupt line, so any input change before it would not be seen without a read.
+        bitWrite(flags, FORCE_READ_FLAG, true);
     }
 
-    if(bitRead(flags, PINS_CONFIGURED_READ_FLAG)) {
+    if(isReadNeeded()) {
         writeOk = writeOk && ioaWireRead(wireImpl, address, lastRead, bytesToTransfer);
+        inputsWereRead(writeOk);
 
         if (invertedLogic) {
             lastRead[0] = ~lastRead[0];
@@ -75,6 +141,38 @@ bool PCF8574IoAbstraction::runLoop(){
     return writeOk;
 }
 
+bool PCF8574IoAbstraction::asyncRunLoop() {
+    // the last sync is still on the bus, changes made since then stay pending until the next sync.
+    if(asyncState->isBusy()) return true;
+
+    uint8_t bytesToTransfer = bitRead(flags, PCF8575_16BIT_FLAG) ? 2 : 1;
+    bool invertedLogic = bitRead(flags, INVERTED_LOGIC);
+
+    if(asyncState->readAvailable) {
+        asyncState->readAvailable = false;
+        lastRead[0] = invertedLogic ? ~asyncState->readBuffer[0] : asyncState->readBuffer[0];
+        lastRead[1] = invertedLogic ? ~asyncState->readBuffer[1] : asyncState->readBuffer[1];
+    }
+    bool lastSyncOk = asyncState->takeSyncResult();
+    if(!lastSyncOk) bitWrite(flags, FORCE_READ_FLAG, true);
+
+    if (bitRead(flags, NEEDS_WRITE_FLAG)) {
+        bitWrite(flags, NEEDS_WRITE_FLAG, false);
+        asyncState->writeBuffer[0] = invertedLogic ? ~toWrite[0] : toWrite[0];
+        asyncState->writeBuffer[1] = invertedLogic ? ~toWrite[1] : toWrite[1];
+        asyncState->writeTxn.prepareWrite(wireImpl, address, asyncState->writeBuffer, bytesToTransfer);
+        asyncState->submit(asyncState->writeTxn, getDeviceStats());
+        bitWrite(flags, FORCE_READ_FLAG, true);
+    }
+
+    if(isReadNeeded()) {
+        // the read is queued behind any write, a failure is picked up on the next sync and forces another read.
+        asyncState->readTxn.prepareRead(wireImpl, address, asyncState->readBuffer, bytesToTransfer);
+        asyncState->submit(asyncState->readTxn, getDeviceStats());
+        inputsWereRead(true);
+    }
+    return lastSyncOk;
+}
 
 void PCF8574IoAbstraction::attachInterrupt(pinid_t /*pin*/, RawIntHandler intHandler, uint8_t /*mode*/) {
 	// if there's an interrupt pin set
@@ -118,8 +216,11 @@ BasicIoAbstraction* ioFrom8575(uint8_t addr, pinid_t interruptPin, WireType wire
 #define IOCON_MIRROR_BIT  6
 #define IOCON_BANK_BIT  7
 
+// the configuration registers that are cached, the device never changes these by itself.
+static const uint8_t mcp23017ShadowRegisters[] = { IODIR_ADDR, IPOL_ADDR, GPINTENA_ADDR, DEFVAL_ADDR, INTCON_ADDR, GPPU_ADDR };
+
 MCP23017IoAbstraction::MCP23017IoAbstraction(uint8_t address, Mcp23xInterruptMode intMode, pinid_t intPinA, pinid_t intPinB, WireType wireImpl) :
-        Standard16BitDevice() {
+        Standard16BitDevice(), registerShadow(mcp23017ShadowRegisters, sizeof mcp23017ShadowRegisters, true) {
     this->wireImpl = (wireImpl != nullptr) ? wireImpl : defaultWireTypePtr;
     this->address = address;
 	this->intPinA = intPinA;
@@ -128,7 +229,7 @@ MCP23017IoAbstraction::MCP23017IoAbstraction(uint8_t address, Mcp23xInterruptMod
 }
 
 MCP23017IoAbstraction::MCP23017IoAbstraction(uint8_t address, Mcp23xInterruptMode intMode, pinid_t intPinA, WireType wireImpl) :
-        Standard16BitDevice() {
+        Standard16BitDevice(), registerShadow(mcp23017ShadowRegisters, sizeof mcp23017ShadowRegisters, true) {
     this->wireImpl = (wireImpl != nullptr) ? wireImpl : defaultWireTypePtr;
     this->address = address;
     this->intPinA = intPinA;
@@ -137,7 +238,7 @@ MCP23017IoAbstraction::MCP23017IoAbstraction(uint8_t address, Mcp23xInterruptMod
 }
 
 MCP23017IoAbstraction::MCP23017IoAbstraction(uint8_t address, WireType wireImpl) :
-        Standard16BitDevice() {
+        Standard16BitDevice(), registerShadow(mcp23017ShadowRegisters, sizeof mcp23017ShadowRegisters, true) {
     this->wireImpl = (wireImpl != nullptr) ? wireImpl : defaultWireTypePtr;
     this->address = address;
     this->intPinA = this->intPinB = IO_PIN_NOT_DEFINED;
@@ -166,14 +267,32 @@ void MCP23017IoAbstraction::initDevice() {
 void MCP23017IoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
 	if(isInitNeeded()) initDevice();
 
-	toggleBitInRegister16(wireImpl, address, IODIR_ADDR, pin, (mode == INPUT || mode == INPUT_PULLUP));
-	toggleBitInRegister16(wireImpl, address, GPPU_ADDR, pin, mode == INPUT_PULLUP);
+	registerShadow.toggleBit(wireImpl, address, IODIR_ADDR, pin, (mode == INPUT || mode == INPUT_PULLUP));
+	registerShadow.toggleBit(wireImpl, address, GPPU_ADDR, pin, mode == INPUT_PULLUP);
 
     setReadPort((pin < 8) ? 0 : 1);
 }
 
+MCP23017IoAbstraction::~MCP23017IoAbstraction() {
+    delete asyncState;
+}
+
+bool MCP23017IoAbstraction::setAsyncSync(bool async) {
+    if(async == isAsyncSync()) return true;
+    if(async) {
+        asyncState = new I2cAsyncSyncState();
+    }
+    else {
+        if(asyncState->isBusy()) return false;
+        delete asyncState;
+        asyncState = nullptr;
+    }
+    return true;
+}
+
 bool MCP23017IoAbstraction::runLoop() {
 	if(isInitNeeded()) initDevice();
+	if(asyncState != nullptr) return asyncRunLoop();
 
 	bool writeOk = true;
 
@@ -188,6 +307,8 @@ bool MCP23017IoAbstraction::runLoop() {
 
 	clearChangeFlags();
 
+	if(interruptCapture) return readWithInterruptCapture() && writeOk;
+
 	flagA = isReadPortSet(0);
 	flagB = isReadPortSet(1);
 	if(flagA && flagB)
@@ -200,9 +321,105 @@ bool MCP23017IoAbstraction::runLoop() {
 	return writeOk;
 }
 
+void MCP23017IoAbstraction::setInterruptCapture(bool capture) {
+    interruptCapture = capture;
+    // we cannot know what changed before the first capture sync, so treat every pin as pending until then.
+    changedMask = 0xffff;
+    pendingMask = 0xffff;
+}
+
+bool MCP23017IoAbstraction::readWithInterruptCapture() {
+    uint16_t readMask = (isReadPortSet(0) ? 0x00ffU : 0) | (isReadPortSet(1) ? 0xff00U : 0);
+    if(readMask == 0) return true;
+
+    // INTF, INTCAP and GPIO are next to each other, so with sequential mode on one read gets all three, port A first.
+    uint8_t reg = INTF_ADDR;
+    uint8_t data[6];
+    if(!ioaWireWriteWithRetry(wireImpl, address, &reg, 1, 0, false)) return false;
+    if(!ioaWireRead(wireImpl, address, data, sizeof data)) return false;
+
+    uint16_t interruptFlags = data[0] | (data[1] << 8U);
+    uint16_t captured = data[2] | (data[3] << 8U);
+    uint16_t current = data[4] | (data[5] << 8U);
+
+    // pins that interrupted take the value from when they interrupted, so short pulses are not lost, and any that
+    // have changed again since are picked up next time around.
+    uint16_t newRead = ((current & ~interruptFlags) | (captured & interruptFlags)) & readMask;
+    uint16_t previousPending = pendingMask;
+    pendingMask = interruptFlags & (captured ^ current) & readMask;
+    // changes are added to those not yet cleared, so that a sync by other code does not hide them.
+    changedMask |= (newRead ^ lastRead) | interruptFlags | previousPending;
+    lastRead = newRead;
+
+    // the device will not interrupt again for a change that happened before the capture was read, so we do.
+    if(pendingMask != 0 && interruptHandler != nullptr) interruptHandler();
+    return true;
+}
+
+IoPinMask MCP23017IoAbstraction::changedPins(pinid_t firstPin, IoPinMask mask) {
+    if(!interruptCapture || asyncState != nullptr) return mask;
+    if(firstPin >= 16) return 0;
+    return (IoPinMask(changedMask) >> firstPin) & mask;
+}
+
+void MCP23017IoAbstraction::clearChangedPins(pinid_t firstPin, IoPinMask mask) {
+    if(firstPin >= 16) return;
+    changedMask &= ~uint16_t(mask << firstPin);
+}
+
+bool MCP23017IoAbstraction::asyncRunLoop() {
+    // the last sync is still on the bus, changes made since then stay pending until the next sync.
+    if(asyncState->isBusy()) return true;
+
+    if(asyncState->readAvailable) {
+        asyncState->readAvailable = false;
+        auto readBuffer = asyncState->readBuffer;
+        if(asyncState->readLength == 2)
+            lastRead = readBuffer[0] | (readBuffer[1] << 8U);
+        else if(asyncState->readCommand[0] == GPIO_ADDR)
+            lastRead = readBuffer[0];
+        else
+            lastRead = readBuffer[0] << 8U;
+    }
+    bool lastSyncOk = asyncState->takeSyncResult();
+
+    bool flagA = isWritePortSet(0);
+    bool flagB = isWritePortSet(1);
+    if(flagA || flagB) {
+        // the same register layout as wireWriteReg16 and wireWriteReg8, register first then port A before port B.
+        auto writeBuffer = asyncState->writeBuffer;
+        uint8_t len = 2;
+        if(flagA) {
+            writeBuffer[0] = OUTLAT_ADDR;
+            writeBuffer[1] = toWrite & 0xff;
+            writeBuffer[2] = toWrite >> 8;
+            if(flagB) len = 3;
+        }
+        else {
+            writeBuffer[0] = OUTLAT_ADDR + 1;
+            writeBuffer[1] = toWrite >> 8;
+        }
+        asyncState->writeTxn.prepareWrite(wireImpl, address, writeBuffer, len);
+        asyncState->submit(asyncState->writeTxn, getDeviceStats());
+    }
+    clearChangeFlags();
+
+    flagA = isReadPortSet(0);
+    flagB = isReadPortSet(1);
+    if(flagA || flagB) {
+        asyncState->readCommand[0] = flagA ? GPIO_ADDR : GPIO_ADDR + 1;
+        asyncState->readLength = (flagA && flagB) ? 2 : 1;
+        asyncState->readTxn.prepareWriteThenRead(wireImpl, address, asyncState->readCommand, 1,
+                                                 asyncState->readBuffer, asyncState->readLength);
+        asyncState->submit(asyncState->readTxn, getDeviceStats());
+    }
+    return lastSyncOk;
+}
+
 void MCP23017IoAbstraction::attachInterrupt(pinid_t pin, RawIntHandler intHandler, uint8_t mode) {
 	// only if there's an interrupt pin set
 	if(intPinA == 0xff) return;
+	interruptHandler = intHandler;
 
 	auto  inbuiltIo = internalDigitalDevice();
 	uint8_t pm = (intMode == ACTIVE_HIGH_OPEN || intMode == ACTIVE_LOW_OPEN) ? INPUT_PULLUP : INPUT;
@@ -218,13 +435,13 @@ void MCP23017IoAbstraction::attachInterrupt(pinid_t pin, RawIntHandler intHandle
         inbuiltIo.attachInterrupt(intPinB, intHandler, im);
     }
 
-	toggleBitInRegister16(wireImpl, address, GPINTENA_ADDR, pin, true);
-	toggleBitInRegister16(wireImpl, address, INTCON_ADDR, pin, mode != CHANGE);
-	toggleBitInRegister16(wireImpl, address, DEFVAL_ADDR, pin, mode == FALLING);
+	registerShadow.toggleBit(wireImpl, address, GPINTENA_ADDR, pin, true);
+	registerShadow.toggleBit(wireImpl, address, INTCON_ADDR, pin, mode != CHANGE);
+	registerShadow.toggleBit(wireImpl, address, DEFVAL_ADDR, pin, mode == FALLING);
 }
 
 void MCP23017IoAbstraction::setInvertInputPin(pinid_t pin, bool shouldInvert) {
-    toggleBitInRegister16(wireImpl, address, IPOL_ADDR, pin, shouldInvert);
+    registerShadow.toggleBit(wireImpl, address, IPOL_ADDR, pin, shouldInvert);
 }
 
 void MCP23017IoAbstraction::resetDevice(int resetPin) {
@@ -232,6 +449,16 @@ void MCP23017IoAbstraction::resetDevice(int resetPin) {
     internalDigitalDevice().digitalWriteS(resetPin, LOW);
     taskManager.yieldForMicros(100);
     internalDigitalDevice().digitalWriteS(resetPin, HIGH);
+
+    // the device is back to its defaults, so put back any configuration that has already been made.
+    if(registerShadow.hasCachedValues()) resyncRegisters();
+}
+
+bool MCP23017IoAbstraction::resyncRegisters() {
+    initDevice();
+    bool resyncOk = registerShadow.resync(wireImpl, address);
+    markPortsForWrite();
+    return resyncOk;
 }
 
 IoAbstractionRef ioFrom23017(pinid_t addr, WireType wireImpl) {
@@ -295,11 +522,32 @@ void Standard16BitDevice::writePort(pinid_t pin, uint8_t value) {
     }
 }
 
+IoPinMask Standard16BitDevice::readPins(pinid_t firstPin, IoPinMask mask) {
+    if(firstPin > 15) return 0;
+    return ((IoPinMask)lastRead >> firstPin) & mask;
+}
+
+void Standard16BitDevice::writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) {
+    if(firstPin > 15) return;
+    uint16_t pinMask = (mask << firstPin) & 0xffff;
+    if(pinMask == 0) return;
+    if(bitRead(flags, STD16_NEEDS_INIT)) initDevice();
+
+    toWrite = (toWrite & ~pinMask) | ((values << firstPin) & pinMask);
+    if(pinMask & 0x00ff) bitSet(flags, STD16_CHANGE_PORTA_BIT);
+    if(pinMask & 0xff00) bitSet(flags, STD16_CHANGE_PORTB_BIT);
+}
+
 void Standard16BitDevice::clearChangeFlags() {
     bitClear(flags, STD16_CHANGE_PORTA_BIT);
     bitClear(flags, STD16_CHANGE_PORTB_BIT);
 }
 
+void Standard16BitDevice::markPortsForWrite() {
+    bitSet(flags, STD16_CHANGE_PORTA_BIT);
+    bitSet(flags, STD16_CHANGE_PORTB_BIT);
+}
+
 bool Standard16BitDevice::isReadPortSet(int port) const {
     auto bitNum = (port == 0) ? STD16_READER_PORTA_BIT : STD16_READER_PORTB_BIT;
     return bitRead(flags, bitNum);
@@ -339,8 +587,10 @@ inline uint8_t getAw9523LedDimRegister(pinid_t pin) {
     else return AW9523_LED_DIM_START + pin;
 }
 
+static const uint8_t aw9523ShadowRegisters[] = { AW9523_PORT_DIRECTION_16, AW9523_INTERRUPT_CTRL_16, AW9523_LED_MODE_16 };
+
 AW9523IoAbstraction::AW9523IoAbstraction(uint8_t addr, pinid_t intPin, WireType wirePtr) : Standard16BitDevice(),
-        i2cAddress(addr), interruptPin(intPin) {
+        i2cAddress(addr), interruptPin(intPin), registerShadow(aw9523ShadowRegisters, sizeof aw9523ShadowRegisters, true) {
     wireImpl = (wirePtr != nullptr) ? wirePtr : defaultWireTypePtr;
 }
 
@@ -351,10 +601,10 @@ void AW9523IoAbstraction::initDevice() {
     softwareReset();
 
     // turn off all interrupts
-    wireWriteReg16(wireImpl, i2cAddress, AW9523_INTERRUPT_CTRL_16, 0xFFFF);
+    registerShadow.writeRegister(wireImpl, i2cAddress, AW9523_INTERRUPT_CTRL_16, 0xFFFF);
 
     // set everything to output, low
-    wireWriteReg16(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, 0x0);
+    registerShadow.writeRegister(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, 0x0);
 
     // full current, push/pull port 0.
     writeGlobalControl(true);
@@ -374,7 +624,7 @@ void AW9523IoAbstraction::attachInterrupt(pinid_t pin, RawIntHandler intHandler,
     internalDigitalDevice().attachInterrupt(interruptPin, intHandler, CHANGE);
 
     // now enable interrupt support for this pin
-    toggleBitInRegister16(wireImpl, i2cAddress, AW9523_INTERRUPT_CTRL_16, pin, false);
+    registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_INTERRUPT_CTRL_16, pin, false);
 }
 
 void AW9523IoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
@@ -382,14 +632,14 @@ void AW9523IoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
 
     if(mode == INPUT || mode == INPUT_PULLUP) {
         setReadPort(pin < 8 ? 0 : 1);
-        toggleBitInRegister16(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, pin, true);
-        toggleBitInRegister16(wireImpl, i2cAddress, AW9523_LED_MODE_16, pin, true);
+        registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, pin, true);
+        registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_LED_MODE_16, pin, true);
     } else if(mode == OUTPUT) {
-        toggleBitInRegister16(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, pin, false);
-        toggleBitInRegister16(wireImpl, i2cAddress, AW9523_LED_MODE_16, pin, true);
+        registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, pin, false);
+        registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_LED_MODE_16, pin, true);
     } else if(mode == AW9523_LED_OUTPUT) {
-        toggleBitInRegister16(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, pin, false);
-        toggleBitInRegister16(wireImpl, i2cAddress, AW9523_LED_MODE_16, pin, false);
+        registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_PORT_DIRECTION_16, pin, false);
+        registerShadow.toggleBit(wireImpl, i2cAddress, AW9523_LED_MODE_16, pin, false);
     } else {
         serlogF3(SER_ERROR, "AW9523 mode error ", pin, mode);
         return;
@@ -418,7 +668,7 @@ bool AW9523IoAbstraction::runLoop() {
     } else if(port0){
         lastRead = wireReadReg8(wireImpl, i2cAddress, AW9523_INPUT_READ_16);
     } else if(port1) {
-        lastRead = wireReadReg8(wireImpl, i2cAddress, AW9523_INPUT_READ_16) << 8U;
+        lastRead = wireReadReg8(wireImpl, i2cAddress, AW9523_INPUT_READ_16 + 1) << 8U;
     }
     return writeOk;
 }
@@ -433,6 +683,19 @@ void AW9523IoAbstraction::setPinLedCurrent(pinid_t pin, uint8_t pwr) {
 
 void AW9523IoAbstraction::softwareReset() {
     wireWriteReg8(wireImpl, i2cAddress, AW9523_SW_RESET_REG, 0);
+    registerShadow.invalidate();
+}
+
+void AW9523IoAbstraction::beginConfig() {
+    // the device reset during init would otherwise clear the batch, so get it out of the way first.
+    if(isInitNeeded()) initDevice();
+    registerShadow.beginBatch();
+}
+
+bool AW9523IoAbstraction::resyncRegisters() {
+    bool resyncOk = registerShadow.resync(wireImpl, i2cAddress);
+    markPortsForWrite();
+    return resyncOk;
 }
 
 uint8_t AW9523IoAbstraction::deviceId() {
@@ -453,8 +716,11 @@ void AW9523AnalogAbstraction::initPin(pinid_t pin, AnalogDirection direction) {
     }
 }
 
+static const uint8_t mpr121ShadowRegisters[] = { MPR121_GPIO_CONTROL_0, MPR121_GPIO_CONTROL_1, MPR121_GPIO_DIRECTION_0, MPR121_GPIO_ENABLE };
+
 MPR121IoAbstraction::MPR121IoAbstraction(uint8_t addr, pinid_t intPin, WireType wirePtr) : Standard16BitDevice(),
-                                                                                           i2cAddress(addr), interruptPin(intPin) {
+                                                                                           i2cAddress(addr), interruptPin(intPin),
+                                                                                           registerShadow(mpr121ShadowRegisters, sizeof mpr121ShadowRegisters, false) {
     wireImpl = (wirePtr != nullptr) ? wirePtr : defaultWireTypePtr;
 }
 
@@ -462,6 +728,11 @@ void MPR121IoAbstraction::softwareReset() {
     // perform a reset and stop the chip.
     wireWriteReg8(wireImpl, i2cAddress, MPR121_SOFT_RESET, MPR121_SOFT_RESET_VALUE);
     wireWriteReg8(wireImpl, i2cAddress, MPR121_ELECTRODE_CONFIG, 0);
+    registerShadow.invalidate();
+}
+
+bool MPR121IoAbstraction::resyncRegisters() {
+    return registerShadow.resync(wireImpl, i2cAddress);
 }
 
 void MPR121IoAbstraction::setPinLedCurrent(pinid_t pin, uint8_t pwr) {
@@ -475,11 +746,13 @@ void MPR121IoAbstraction::setPinLedCurrent(pinid_t pin, uint8_t pwr) {
 }
 
 void MPR121IoAbstraction::writeReg8(uint8_t reg, uint8_t data) {
-    wireWriteReg8(wireImpl, i2cAddress, reg, data);
+    registerShadow.writeRegister(wireImpl, i2cAddress, reg, data);
 }
 
 void MPR121IoAbstraction::writeReg16(uint8_t reg, uint16_t data) {
     wireWriteReg16(wireImpl, i2cAddress, reg, data);
+    // this may have overwritten a pair of cached registers, so read them again when next needed.
+    registerShadow.invalidate();
 }
 
 uint8_t MPR121IoAbstraction::readReg8(uint8_t reg) {
@@ -517,19 +790,19 @@ void MPR121IoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
     if(mode == LED_CURRENT_OUTPUT || mode == OUTPUT) {
         if(pin < 4) return;
         int gpioPinNo = pin - 4;
-        toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_ENABLE, gpioPinNo, true);
-        toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_DIRECTION_0, gpioPinNo, true);
-        toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_0, gpioPinNo, mode == LED_CURRENT_OUTPUT);
-        toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_1, gpioPinNo, mode == LED_CURRENT_OUTPUT);
+        registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_ENABLE, gpioPinNo, true);
+        registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_DIRECTION_0, gpioPinNo, true);
+        registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_0, gpioPinNo, mode == LED_CURRENT_OUTPUT);
+        registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_1, gpioPinNo, mode == LED_CURRENT_OUTPUT);
     } else if(mode == INPUT || mode == INPUT_PULLUP){
         // if the touch support has already been prepared for our pin, there is nothing to do here. It is assumed that
         // in this case you have already configured the touch parameters. 
         if(maximumTouchPin < pin  && pin > 4) {
             int gpioPinNo = pin - 4;
-            toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_ENABLE, gpioPinNo, true);
-            toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_DIRECTION_0, gpioPinNo, false);
-            toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_0, gpioPinNo, mode == INPUT_PULLUP);
-            toggleBitInRegister8(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_1, gpioPinNo, mode == INPUT_PULLUP);
+            registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_ENABLE, gpioPinNo, true);
+            registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_DIRECTION_0, gpioPinNo, false);
+            registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_0, gpioPinNo, mode == INPUT_PULLUP);
+            registerShadow.toggleBit(wireImpl, i2cAddress, MPR121_GPIO_CONTROL_1, gpioPinNo, mode == INPUT_PULLUP);
         }
     }
 }
@@ -21,6 +21,12 @@
 #include "PlatformDeterminationWire.h"
 #include "IoAbstraction.h"
 #include "AnalogDeviceAbstraction.h"
+#include "wireHelpers.h"
+
+class I2cAsyncSyncState;
+
+/** the default interval between safety reads when PCF8574 reads are gated by the interrupt line, in milliseconds */
+#define PCF8574_DEFAULT_SAFETY_READ_MILLIS 1000
 
 /**
  * An implementation of BasicIoAbstraction that supports the PCF8574/PCF8575 i2c IO chip. Providing all possible capabilities
@@ -30,7 +36,7 @@
  */
 class PCF8574IoAbstraction : public BasicIoAbstraction {
 public:
-    enum { NEEDS_WRITE_FLAG, PINS_CONFIGURED_READ_FLAG, PCF8575_16BIT_FLAG, INVERTED_LOGIC };
+    enum { NEEDS_WRITE_FLAG, PINS_CONFIGURED_READ_FLAG, PCF8575_16BIT_FLAG, INVERTED_LOGIC, INTERRUPT_GATED_FLAG, FORCE_READ_FLAG };
 private:
 	WireType wireImpl;
 	uint8_t address;
@@ -38,6 +44,9 @@ private:
 	uint8_t toWrite[2];
 	uint8_t flags;
 	uint8_t interruptPin;
+	uint16_t safetyReadMillis = PCF8574_DEFAULT_SAFETY_READ_MILLIS;
+	uint32_t lastReadMicros = 0;
+	I2cAsyncSyncState* asyncState = nullptr;
 public:
 	/** 
 	 * Construct a 8574 expander on i2c address and with interrupts connected to a given pin (0xff no interrupts) 
@@ -48,11 +57,49 @@ public:
 	 * @param invertedLogic invert bits sent and received from the expander.
 	 */
 	PCF8574IoAbstraction(uint8_t addr, uint8_t interruptPin, WireType wireInstance = nullptr, bool mode16bit = false, bool invertedLogic = false);
-	virtual ~PCF8574IoAbstraction() { }
+	~PCF8574IoAbstraction() override;
+
+	PCF8574IoAbstraction(const PCF8574IoAbstraction&) = delete;
+	PCF8574IoAbstraction& operator=(const PCF8574IoAbstraction&) = delete;
 
 	/** Forces the device to start reading back state during syncs even if no pins are configured as read */
 	void overrideReadFlag() { bitWrite(flags, PINS_CONFIGURED_READ_FLAG, true); }
 
+	/**
+	 * Turns on or off async sync. In async mode sync never blocks, instead it submits the writes and reads to
+	 * i2cTransactionQueue and returns straight away. The values read are picked up on the following sync, so inputs
+	 * lag by one sync, and the result of sync reflects the transactions that completed since the previous sync.
+	 * @param async true to sync asynchronously, false to go back to blocking syncs
+	 * @return true if the mode was changed, false if transactions are still queued and it cannot change yet.
+	 * @see I2cTransactionQueue
+	 */
+	bool setAsyncSync(bool async);
+
+	/** @return true if this device is in async sync mode */
+	bool isAsyncSync() const { return asyncState != nullptr; }
+
+	/**
+	 * Turns on or off interrupt gated reads, only possible when the interrupt pin is connected. The chip holds its
+	 * interrupt line low from the time any input changes until the next read or write, so while the line is high
+	 * the inputs are as they were last read and sync skips the read. As a safety net against a missed edge, the inputs
+	 * are read anyway when safetyReadMillis has passed since the last read.
+	 * @param gated true to only read when the interrupt line is active, false to read on every sync
+	 * @param safetyMillis the longest time between reads in milliseconds, or 0 to only read on interrupt
+	 * @return true if the mode was set, false if there is no interrupt pin
+	 */
+	bool setInterruptGatedReads(bool gated, uint16_t safetyMillis = PCF8574_DEFAULT_SAFETY_READ_MILLIS);
+
+	/** @return true if reads are gated by the interrupt line */
+	bool isInterruptGatedReads() const { return bitRead(flags, INTERRUPT_GATED_FLAG); }
+
+	/**
+	 * Sets the I2C clock this device should be driven at, when it shares the bus with devices that need a different
+	 * clock. The bus is switched only when moving between devices that want different clocks.
+	 * @param frequency the clock in Hz, or 0 to use the bus default
+	 * @return true if stored, false if there is no space left for clock profiles
+	 */
+	bool setPreferredClock(uint32_t frequency) { return ioaWireSetDeviceSpeed(wireImpl, address, frequency); }
+
 	/** 
 	 * sets the pin direction on the device, notice that on this device input is achieved by setting the port to high 
 	 * so it is always set as INPUT_PULLUP, even if INPUT is chosen 
@@ -79,6 +126,16 @@ public:
 	 */ 
 	uint8_t readPort(pinid_t pin) override;
 
+	/**
+	 * Reads many pins at once from the last cached state, that is updated each sync.
+	 */
+	IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override;
+
+	/**
+	 * Writes many pins at once, they are updated to the device on the next sync.
+	 */
+	void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override;
+
 	/** 
 	 * attaches an interrupt handler for this device. Notice for this device, all pin changes will be notified
 	 * on any pin of the port, it is not configurable at the device level, the type of interrupt will also
@@ -90,6 +147,10 @@ public:
 	 * updates settings on the board after changes 
 	 */
 	bool runLoop() override;
+private:
+	bool asyncRunLoop();
+	bool isReadNeeded();
+	void inputsWereRead(bool readOk);
 };
 
 class Standard16BitDevice : public BasicIoAbstraction {
@@ -106,7 +167,10 @@ public:
     uint8_t readValue(pinid_t pin) override;
     void writePort(pinid_t pin, uint8_t port) override;
     uint8_t readPort(pinid_t pin) override;
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override;
+    void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override;
     void clearChangeFlags();
+    void markPortsForWrite();
     void setReadPort(int port);
     bool isReadPortSet(int port) const;
     bool isWritePortSet(int port) const;
@@ -134,6 +198,12 @@ private:
 	pinid_t  intPinA;
 	pinid_t  intPinB;
 	uint8_t  intMode;
+	I2cAsyncSyncState* asyncState = nullptr;
+	WireRegisterShadow registerShadow;
+	RawIntHandler interruptHandler = nullptr;
+	uint16_t changedMask = 0xffff;
+	uint16_t pendingMask = 0;
+	bool interruptCapture = false;
 public:
 	/**
 	 * Most complete constructor, allows for either single or dual interrupt mode and all capabilities
@@ -155,7 +225,24 @@ public:
     MCP23017IoAbstraction(uint8_t address, Mcp23xInterruptMode intMode, pinid_t intPinA, WireType wireImpl = nullptr);
 
 
-	~MCP23017IoAbstraction() override = default;
+	~MCP23017IoAbstraction() override;
+
+	MCP23017IoAbstraction(const MCP23017IoAbstraction&) = delete;
+	MCP23017IoAbstraction& operator=(const MCP23017IoAbstraction&) = delete;
+
+	/**
+	 * Turns on or off async sync. In async mode sync never blocks, instead it submits the output latch write and the
+	 * GPIO read to i2cTransactionQueue and returns straight away. The values read are picked up on the following sync,
+	 * so inputs lag by one sync, and the result of sync reflects the transactions that completed since the previous
+	 * sync. Setting up pins and interrupts is still carried out straight away.
+	 * @param async true to sync asynchronously, false to go back to blocking syncs
+	 * @return true if the mode was changed, false if transactions are still queued and it cannot change yet.
+	 * @see I2cTransactionQueue
+	 */
+	bool setAsyncSync(bool async);
+
+	/** @return true if this device is in async sync mode */
+	bool isAsyncSync() const { return asyncState != nullptr; }
 
 	/**
 	 * Sets the pin direction similar to pinMode, pin direction on this device supports INPUT_PULLUP, INPUT and OUTPUT.
@@ -195,8 +282,69 @@ public:
      */
     void resetDevice(int resetPin);
 
+    /**
+     * The configuration registers (direction, pull up, polarity and interrupts) are cached in RAM after first use, so
+     * that setting up pins only writes what changed. If the device resets on its own, such as after a brown out, call
+     * this to write the cached configuration back to the device, the outputs are written again on the next sync.
+     * This is called for you by resetDevice if anything has already been configured.
+     * @return true if all the writes succeeded, otherwise false
+     */
+    bool resyncRegisters();
+
+    /**
+     * Holds back changes to the direction, pull up, polarity and interrupt registers until commitConfig, so that
+     * setting up many pins results in one 16 bit write per changed register.
+     */
+    void beginConfig() override { registerShadow.beginBatch(); }
+
+    /**
+     * Writes each register that changed since beginConfig as a single 16 bit write.
+     * @return true if successful, otherwise false
+     */
+    bool commitConfig() override { return registerShadow.commitBatch(wireImpl, address); }
+
+    /**
+     * Sets the I2C clock this device should be driven at, when it shares the bus with devices that need a different
+     * clock. The bus is switched only when moving between devices that want different clocks.
+     * @param frequency the clock in Hz, or 0 to use the bus default
+     * @return true if stored, false if there is no space left for clock profiles
+     */
+    bool setPreferredClock(uint32_t frequency) { return ioaWireSetDeviceSpeed(wireImpl, address, frequency); }
+
+    /**
+     * Turns on interrupt capture mode, where each sync reads the interrupt flags (INTF), the values captured when the
+     * interrupt fired (INTCAP) and the current GPIO values in one burst read. For pins that raised an interrupt, the
+     * captured value is used first, so a short pulse that has already gone by the time of the sync is still seen. If
+     * such a pin has changed again since the capture, the current value is picked up on the following sync, and the
+     * interrupt handler is called again so that sync happens. Use changedPins to find which pins changed since they
+     * were last cleared. Interrupt capture is not used when the device is in async sync mode.
+     * @param capture true to turn on interrupt capture, false to read GPIO only.
+     */
+    void setInterruptCapture(bool capture);
+
+    /** @return true if interrupt capture is turned on */
+    bool isInterruptCapture() const { return interruptCapture; }
+
+    /**
+     * In interrupt capture mode, returns the pins that raised an interrupt or otherwise changed in any sync since they
+     * were last cleared, otherwise it returns the mask as is, as any of the pins might have changed.
+     * @param firstPin the pin that is represented by bit 0 of the mask
+     * @param mask the pins that are of interest
+     * @return the pins in the mask that changed since they were last cleared
+     */
+    IoPinMask changedPins(pinid_t firstPin, IoPinMask mask) override;
+
+    /**
+     * Clears the changed state of the given pins, see changedPins.
+     * @param firstPin the pin that is represented by bit 0 of the mask
+     * @param mask the pins to clear
+     */
+    void clearChangedPins(pinid_t firstPin, IoPinMask mask) override;
+
 private:
 	void initDevice() override;
+	bool asyncRunLoop();
+	bool readWithInterruptCapture();
 };
 
 /**
@@ -210,6 +358,7 @@ private:
     WireType wireImpl;
     uint8_t i2cAddress;
     pinid_t interruptPin;
+    WireRegisterShadow registerShadow;
 public:
     enum AW9523CurrentControl: uint8_t { FULL_CURRENT = 0, CURRENT_THREE_QUARTER = 1, CURRENT_HALF = 2, CURRENT_QUARTER = 3 };
 
@@ -270,9 +419,38 @@ public:
     void writeGlobalControl(bool pushPullP0, AW9523CurrentControl maxCurrentMode = FULL_CURRENT);
 
     /**
-     * Perform a software reset of the device. Make sure you've called sync at least once before calling.
+     * Sets the I2C clock this device should be driven at, when it shares the bus with devices that need a different
+     * clock. The bus is switched only when moving between devices that want different clocks.
+     * @param frequency the clock in Hz, or 0 to use the bus default
+     * @return true if stored, false if there is no space left for clock profiles
+     */
+    bool setPreferredClock(uint32_t frequency) { return ioaWireSetDeviceSpeed(wireImpl, i2cAddress, frequency); }
+
+    /**
+     * Perform a software reset of the device. Make sure you've called sync at least once before calling. The cached
+     * configuration registers are cleared, as the device goes back to its defaults.
      */
     void softwareReset();
+
+    /**
+     * The direction, LED mode and interrupt registers are cached in RAM after first use, so that setting up pins only
+     * writes what changed. If the device resets on its own, such as after a brown out, call this to write the cached
+     * configuration back to the device, the outputs are written again on the next sync.
+     * @return true if all the writes succeeded, otherwise false
+     */
+    bool resyncRegisters();
+
+    /**
+     * Holds back changes to the direction, LED mode and interrupt registers until commitConfig, so that setting up
+     * many pins results in one 16 bit write per changed register.
+     */
+    void beginConfig() override;
+
+    /**
+     * Writes each register that changed since beginConfig as a single 16 bit write.
+     * @return true if successful, otherwise false
+     */
+    bool commitConfig() override { return registerShadow.commitBatch(wireImpl, i2cAddress); }
 private:
     void initDevice() override;
 };
@@ -376,6 +554,7 @@ private:
     uint8_t i2cAddress;
     pinid_t interruptPin;
     pinid_t maximumTouchPin = 0;
+    WireRegisterShadow registerShadow;
 public:
     /**
      * create an instance of the abstraction that communicates with the device and extends Arduino like functions
@@ -465,11 +644,40 @@ public:
     void setPinLedCurrent(pinid_t pin, uint8_t pwr);
 
     /**
-     * Perform a software reset of the device. Make sure you've called sync at least once before calling.
+     * Sets the I2C clock this device should be driven at, when it shares the bus with devices that need a different
+     * clock. The bus is switched only when moving between devices that want different clocks.
+     * @param frequency the clock in Hz, or 0 to use the bus default
+     * @return true if stored, false if there is no space left for clock profiles
+     */
+    bool setPreferredClock(uint32_t frequency) { return ioaWireSetDeviceSpeed(wireImpl, i2cAddress, frequency); }
+
+    /**
+     * Perform a software reset of the device. Make sure you've called sync at least once before calling. The cached
+     * GPIO configuration registers are cleared, as the device goes back to its defaults.
      */
     void softwareReset();
     void initDevice() override { /* ignored */ }
 
+    /**
+     * The GPIO enable, direction and control registers are cached in RAM after first use, so that setting up pins only
+     * writes what changed. If the device resets on its own, such as after a brown out, call this to write the cached
+     * GPIO configuration back to the device. The touch configuration is not cached and must be set up again.
+     * @return true if all the writes succeeded, otherwise false
+     */
+    bool resyncRegisters();
+
+    /**
+     * Holds back changes to the GPIO enable, direction and control registers until commitConfig, so that setting up
+     * many pins results in one write per changed register.
+     */
+    void beginConfig() override { registerShadow.beginBatch(); }
+
+    /**
+     * Writes each GPIO register that changed since beginConfig.
+     * @return true if successful, otherwise false
+     */
+    bool commitConfig() override { return registerShadow.commitBatch(wireImpl, i2cAddress); }
+
     void writeReg8(uint8_t reg, uint8_t data);
     void writeReg16(uint8_t reg, uint16_t data);
     uint8_t readReg8(uint8_t reg);
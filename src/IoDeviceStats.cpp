@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include <IoLogging.h>
+#include "BasicIoAbstraction.h"
+#include "IoDeviceStats.h"
+
+#ifndef IOA_DISABLE_DEVICE_STATS
+
+IoDeviceStats* ioaActiveWireStats = nullptr;
+
+IoDeviceStatsScope::IoDeviceStatsScope(IoDeviceStats* stats, bool isSync) : stats(stats), previous(ioaActiveWireStats),
+                                                                            startMicros(0), timed(isSync && stats) {
+    ioaActiveWireStats = stats;
+    if(timed) {
+        stats->runLoopCalls++;
+        startMicros = micros();
+    }
+}
+
+IoDeviceStatsScope::~IoDeviceStatsScope() {
+    if(timed) {
+        auto taken = uint32_t(micros() - startMicros);
+        stats->totalSyncMicros += taken;
+        if(taken > stats->maxSyncMicros) stats->maxSyncMicros = taken;
+    }
+    ioaActiveWireStats = previous;
+}
+
+#endif // IOA_DISABLE_DEVICE_STATS
+
+void ioaDumpDeviceStats(const char* name, const IoDeviceStats& stats) {
+    serlogF2(SER_IOA_INFO, "Device stats for ", name);
+    serlogF3(SER_IOA_INFO, "Syncs, failed", stats.runLoopCalls, stats.failedSyncs);
+    serlogF3(SER_IOA_INFO, "Sync avg, max us", stats.averageSyncMicros(), stats.maxSyncMicros);
+    serlogF4(SER_IOA_INFO, "I2C trans, read, written", stats.transactions, stats.bytesRead, stats.bytesWritten);
+    serlogF3(SER_IOA_INFO, "I2C retries, failures", stats.retries, stats.failures);
+}
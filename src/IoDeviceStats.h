@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_IODEVICESTATS_H
+#define IOA_IODEVICESTATS_H
+
+/**
+ * @file IoDeviceStats.h
+ * @brief Optional per device statistics, that help to find which device is using up the I2C bus or making sync slow.
+ *
+ * To track a device, create an IoDeviceStats instance and attach it with `setDeviceStats(&stats)` on either an
+ * IoAbstraction or an EepromAbstraction. From then on, each `sync()` is counted and timed, and the I2C transactions
+ * made during the sync (or during EEPROM reads and writes) through ioaWireRead and ioaWireWriteWithRetry are counted
+ * along with the bytes transferred, retries and failures. Devices without stats attached still open an empty scope
+ * on each sync, costing a pointer save and restore, so their traffic is never counted against another device that
+ * is waiting within its own scope. To remove the tracking completely at compile time define IOA_DISABLE_DEVICE_STATS.
+ */
+
+#include "PlatformDetermination.h"
+
+/**
+ * Holds the counters for a single device, all counters wrap around at their maximum value.
+ */
+struct IoDeviceStats {
+    /** the number of times the device was synced (runLoop called through sync) */
+    uint32_t runLoopCalls;
+    /** the number of syncs that reported failure */
+    uint32_t failedSyncs;
+    /** the number of I2C transactions attempted, both reads and writes */
+    uint32_t transactions;
+    /** the number of bytes read from the device over I2C */
+    uint32_t bytesRead;
+    /** the number of bytes written to the device over I2C */
+    uint32_t bytesWritten;
+    /** the number of times the bus was polled again waiting for the device to become ready */
+    uint32_t retries;
+    /** the number of I2C transactions that failed */
+    uint32_t failures;
+    /** the total time spent in sync in microseconds */
+    uint32_t totalSyncMicros;
+    /** the longest single sync in microseconds */
+    uint32_t maxSyncMicros;
+
+    IoDeviceStats() { reset(); }
+
+    /** clear all the counters back to zero */
+    void reset() {
+        runLoopCalls = failedSyncs = transactions = bytesRead = bytesWritten = 0;
+        retries = failures = totalSyncMicros = maxSyncMicros = 0;
+    }
+
+    /** @return the average sync time in microseconds, or 0 if there have not been any syncs */
+    uint32_t averageSyncMicros() const { return runLoopCalls ? (totalSyncMicros / runLoopCalls) : 0; }
+};
+
+/**
+ * Writes the statistics to IoLogging at INFO level, with the name given to identify the device.
+ * @param name the name to log the stats under
+ * @param stats the statistics to log
+ */
+void ioaDumpDeviceStats(const char* name, const IoDeviceStats& stats);
+
+#ifndef IOA_DISABLE_DEVICE_STATS
+
+/**
+ * The stats that I2C transactions are currently being counted against, or nullptr when no tracked device is active.
+ * Devices set this using IoDeviceStatsScope, you should not normally need to touch it.
+ */
+extern IoDeviceStats* ioaActiveWireStats;
+
+/**
+ * Makes a set of statistics active for the lifetime of the scope, so that any I2C transactions made within it are
+ * counted. When created for a sync, the sync is also counted and timed. Scopes can be nested, such as a multi IO
+ * syncing its expanders, and the previous stats are made active again when the scope ends.
+ */
+class IoDeviceStatsScope {
+private:
+    IoDeviceStats* stats;
+    IoDeviceStats* previous;
+    unsigned long startMicros;
+    bool timed;
+public:
+    /**
+     * Activate the given stats, if stats is nullptr then I2C traffic within the scope is not counted.
+     * @param stats the stats to activate
+     * @param isSync true if this scope is a sync that should be counted and timed
+     */
+    IoDeviceStatsScope(IoDeviceStats* stats, bool isSync);
+    ~IoDeviceStatsScope();
+
+    /**
+     * Records the outcome of the sync, returning the result passed in so it can wrap the call.
+     * @param syncOk the result of the sync
+     * @return syncOk unchanged
+     */
+    bool syncResult(bool syncOk) {
+        if(stats != nullptr && !syncOk) stats->failedSyncs++;
+        return syncOk;
+    }
+};
+
+/**
+ * Called by the wire implementations after each read transaction, counts against the active stats if there are any.
+ * @param len the number of bytes requested
+ * @param ok if the transaction succeeded
+ */
+inline void ioaStatsWireRead(size_t len, bool ok) {
+    if(ioaActiveWireStats == nullptr) return;
+    ioaActiveWireStats->transactions++;
+    if(ok) ioaActiveWireStats->bytesRead += len; else ioaActiveWireStats->failures++;
+}
+
+/**
+ * Called by the wire implementations after each write transaction, counts against the active stats if there are any.
+ * @param len the number of bytes to be written
+ * @param ok if the transaction succeeded
+ */
+inline void ioaStatsWireWrite(size_t len, bool ok) {
+    if(ioaActiveWireStats == nullptr) return;
+    ioaActiveWireStats->transactions++;
+    if(ok) ioaActiveWireStats->bytesWritten += len; else ioaActiveWireStats->failures++;
+}
+
+/**
+ * Called by the wire implementations each time they poll a device again waiting for it to become ready.
+ */
+inline void ioaStatsWireRetry() {
+    if(ioaActiveWireStats != nullptr) ioaActiveWireStats->retries++;
+}
+
+#else // IOA_DISABLE_DEVICE_STATS
+
+class IoDeviceStatsScope {
+public:
+    IoDeviceStatsScope(IoDeviceStats*, bool) {}
+    bool syncResult(bool syncOk) { return syncOk; }
+};
+
+inline void ioaStatsWireRead(size_t, bool) {}
+inline void ioaStatsWireWrite(size_t, bool) {}
+inline void ioaStatsWireRetry() {}
+
+#endif // IOA_DISABLE_DEVICE_STATS
+
+#endif //IOA_IODEVICESTATS_H
@@ -27,6 +27,8 @@ MatrixKeyboardManager::MatrixKeyboardManager() {
     keyMode = KEYMODE_NOT_PRESSED;
     interruptMode = false;
     counter = 0;
+    firstRowPin = firstColPin = 0;
+    rowPinMask = colPinMask = 0;
     INSTANCE = this;
 }
 
@@ -36,6 +38,12 @@ void MatrixKeyboardManager::initialise(IoAbstractionRef ref, KeyboardLayout* lay
     this->listener = listener_;
     this->interruptMode = interruptMode_;
 
+    // when the rows or columns are within 32 pins of each other we can read / write them all in one call.
+    rowPinMask = pinMaskForLayout(firstRowPin, true);
+    colPinMask = pinMaskForLayout(firstColPin, false);
+
+    // set up all the pins as one configuration batch, so I2C devices write each register only once.
+    ioRef->beginConfig();
     for(int i=0; i<layout->numColumns(); i++) {
         ioRef->pinMode(layout->getColPin(i), OUTPUT);
         ioRef->digitalWrite(layout->getColPin(i), LOW);
@@ -46,13 +54,44 @@ void MatrixKeyboardManager::initialise(IoAbstractionRef ref, KeyboardLayout* lay
             ioRef->attachInterrupt(layout->getRowPin(i), rawKeyboardInterrupt, CHANGE);
         }
     }
+    ioRef->commitConfig();
 
     ioRef->sync();
     currentKey = 0;
     taskManager.registerEvent(this);
 }
 
+IoPinMask MatrixKeyboardManager::pinMaskForLayout(pinid_t& firstPin, bool forRows) {
+    int count = forRows ? layout->numRows() : layout->numColumns();
+    if(count == 0) return 0;
+
+    int lowest = forRows ? layout->getRowPin(0) : layout->getColPin(0);
+    for(int i=1; i<count; i++) {
+        lowest = internal_min(lowest, forRows ? layout->getRowPin(i) : layout->getColPin(i));
+    }
+
+    IoPinMask mask = 0;
+    for(int i=0; i<count; i++) {
+        int offset = (forRows ? layout->getRowPin(i) : layout->getColPin(i)) - lowest;
+        if(offset >= IO_PIN_MASK_BITS) return 0; // too spread out, fall back to pin at a time
+        mask |= (IoPinMask(1) << offset);
+    }
+    firstPin = lowest;
+    return mask;
+}
+
+bool MatrixKeyboardManager::isRowHigh(IoPinMask rowStates, int row) {
+    if(rowPinMask == 0) return ioRef->digitalRead(layout->getRowPin(row));
+    return (rowStates >> (layout->getRowPin(row) - firstRowPin)) & 1U;
+}
+
 void MatrixKeyboardManager::setToOutput(int col) {
+    if(colPinMask != 0) {
+        IoPinMask activeCol = IoPinMask(1) << (layout->getColPin(col) - firstColPin);
+        ioRef->writePins(firstColPin, colPinMask, colPinMask & ~activeCol);
+        return;
+    }
+
     for(int i=0; i<layout->numColumns(); i++) {
         ioRef->digitalWrite(layout->getColPin(i), col != i);
     }
@@ -83,8 +122,9 @@ void MatrixKeyboardManager::exec() {
         taskManager.yieldForMicros(500); // let things settle while other tasks run.
         ioRef->sync(); // then we read the latest row states back
 
+        IoPinMask rowStates = (rowPinMask != 0) ? ioRef->readPins(firstRowPin, rowPinMask) : 0;
         for(int r=0; r<layout->numRows(); r++) {
-            if(!ioRef->digitalRead(layout->getRowPin(r))) {
+            if(!isRowHigh(rowStates, r)) {
                 pressThisTime = layout->keyFor(r, c);
                 serlogF4(SER_IOA_DEBUG, "Pressed: ", r, c, (int)pressThisTime);
             }
@@ -135,8 +175,12 @@ void MatrixKeyboardManager::enableAllOutputsForInterrupt() {
         // in interrupt mode we set all output pins low when nothing is pressed so that any change will be detected.
         // this effectively means that each column pin is low and will pull down the input line. We don't need to
         // know what is pressed, just that something was pressed.
-        for(int i=0; i < layout->numColumns(); i++) {
-            ioRef->digitalWrite(layout->getColPin(i), 0);
+        if(colPinMask != 0) {
+            ioRef->writePins(firstColPin, colPinMask, 0);
+        } else {
+            for(int i=0; i < layout->numColumns(); i++) {
+                ioRef->digitalWrite(layout->getColPin(i), 0);
+            }
         }
         ioRef->sync();
     }
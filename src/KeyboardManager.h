@@ -127,6 +127,10 @@ private:
     volatile KeyMode keyMode;
     uint8_t counter;
     bool interruptMode;
+    pinid_t firstRowPin;
+    pinid_t firstColPin;
+    IoPinMask rowPinMask;
+    IoPinMask colPinMask;
 public:
     MatrixKeyboardManager();
     void initialise(IoAbstractionRef ref, KeyboardLayout* layout, KeyboardListener* listener, bool interruptMode = false);
@@ -139,6 +143,8 @@ public:
 private:
     void setToOutput(int i);
     void enableAllOutputsForInterrupt();
+    bool isRowHigh(IoPinMask rowStates, int row);
+    IoPinMask pinMaskForLayout(pinid_t& firstPin, bool forRows);
 
     void doDebounce(char time);
 };
@@ -89,6 +89,27 @@ public:
 		memcpy(&data[romDest], memSrc, len);
 	}
 
+	bool readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) override {
+		if(!checkWideBounds(romSrc, len)) return false;
+		memcpy(memDest, &data[romSrc], len);
+		return true;
+	}
+
+	bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) override {
+		if(!checkWideBounds(romDest, len)) return false;
+		memcpy(&data[romDest], memSrc, len);
+		return true;
+	}
+
+	bool checkWideBounds(EepromWidePosition pos, size_t len) {
+		if(len > memSize || pos > (memSize - len)) {
+			serlogF3(SER_DEBUG, "wide checkbounds exceeded: ", pos, len);
+			errorFlag = true;
+			return false;
+		}
+		return true;
+	}
+
 	void serPrintContents(int start, int len) {
         if(len >= 63) {
             serlogF(SER_DEBUG, "Mock rom debug - len too big");
@@ -244,6 +244,15 @@ public:
     }
     uint8_t readPort(pinid_t pin) override { return delegate->readPort(pin);}
 
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override { return delegate->readPins(firstPin, mask); }
+
+    void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override {
+        for(uint8_t i = 0; i < IO_PIN_MASK_BITS && (firstPin + i) < 32; ++i) {
+            if(bitRead(mask, i)) bitWrite(writeVals, firstPin + i, bitRead(values, i));
+        }
+        delegate->writePins(firstPin, mask, values);
+    }
+
     bool runLoop() override { 
         serlogF(SER_DEBUG, "Port write ");
         uint32_t val = writeVals;
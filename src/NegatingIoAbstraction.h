@@ -40,7 +40,7 @@ public:
     }
   	
     bool runLoop() override {
-        return delegate->runLoop();
+        return delegate->sync();
     }
 
     void writePort(pinid_t pin, uint8_t portVal) override {
@@ -50,6 +50,30 @@ public:
     uint8_t readPort(pinid_t pin) override {
         return ~(delegate->readPort(pin));
     }
+
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override {
+        return ~(delegate->readPins(firstPin, mask)) & mask;
+    }
+
+    void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override {
+        delegate->writePins(firstPin, mask, ~values);
+    }
+
+    IoPinMask changedPins(pinid_t firstPin, IoPinMask mask) override {
+        return delegate->changedPins(firstPin, mask);
+    }
+
+    void clearChangedPins(pinid_t firstPin, IoPinMask mask) override {
+        delegate->clearChangedPins(firstPin, mask);
+    }
+
+    void beginConfig() override {
+        delegate->beginConfig();
+    }
+
+    bool commitConfig() override {
+        return delegate->commitConfig();
+    }
 };
 
 #endif // _NEGATING_IO_ABSTRACTION_
\ No newline at end of file
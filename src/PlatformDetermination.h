@@ -16,7 +16,7 @@
 #endif // has include "io_local_definitions"
 
 // when not on mbed, we need to load Arduino.h to get the right defines for some boards.
-#if !defined(__MBED__) && !defined(BUILD_FOR_PICO_CMAKE)
+#if !defined(__MBED__) && !defined(BUILD_FOR_PICO_CMAKE) && !defined(BUILD_FOR_HOST)
 #include <Arduino.h>
 #endif
 
@@ -63,6 +63,16 @@ typedef uint32_t pinid_t;
 #include <pico/stdlib.h>
 typedef uint8_t pinid_t;
 #define pgm_read_byte_near(x) (*(x))
+#elif defined(BUILD_FOR_HOST)
+// a simulated platform for running tests and benchmarks on a desktop machine, see the host directory.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+typedef uint8_t pinid_t;
+#define pgm_read_byte_near(x) (*(x))
+# define IOA_ANALOGIN_RES 12
+# define IOA_ANALOGOUT_RES 12
 #else
 // here we are in full arduino mode (AVR, MKR, ESP etc).
 # define IOA_USE_ARDUINO
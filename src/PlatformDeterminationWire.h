@@ -7,6 +7,7 @@
 #define IOA_PLATFORMDETERMINATIONWIRE_H
 
 #include "PlatformDetermination.h"
+#include "IoDeviceStats.h"
 #include <SimpleSpinLock.h>
 
 //
@@ -28,6 +29,11 @@ void ioaWireBegin();
 class PicoI2cWrapper;
 typedef PicoI2cWrapper* WireType;
 void ioaWireBegin(i2c_inst_t* toUse);
+#elif defined(BUILD_FOR_HOST)
+#define IOA_USE_HOST_I2C
+#include "host/HostWireBus.h"
+typedef HostI2cBus* WireType;
+void ioaWireBegin();
 #else
 # define IOA_USE_ARDUINO_WIRE
 #include <Wire.h>
@@ -60,6 +66,68 @@ bool ioaWireRead(WireType wire, int address, uint8_t* buffer, size_t len);
  */
 bool ioaWireWriteWithRetry(WireType pI2c, int address, const uint8_t* buffer, size_t len, int retriesAllowed = 0, bool sendStop = true);
 
+/**
+ * One part of a scatter gather write, the data and its length. The parts of a write are sent one after another in a
+ * single transaction, so for example a register or memory address can be sent ahead of data that is elsewhere in
+ * memory, without first copying them together.
+ */
+struct IoaWireBuffer {
+    const uint8_t* data;
+    size_t len;
+};
+
+/**
+ * On platforms that can only send from one buffer, the parts of a scatter gather write are gathered into a stack
+ * buffer of this size, so a write must not exceed it there.
+ */
+#ifndef IOA_WIRE_GATHER_BUFFER_SIZE
+#define IOA_WIRE_GATHER_BUFFER_SIZE 132
+#endif
+
+/**
+ * The largest transfer on a platform that gathers the parts of a write and then copies them into a driver buffer of
+ * driverBufferSize, both buffers must hold it so it is the smaller of the two.
+ */
+#define ioaWireGatheredTransferLimit(driverBufferSize) internal_min((driverBufferSize), IOA_WIRE_GATHER_BUFFER_SIZE)
+
+/**
+ * Writes several buffers to the I2C bus as one transaction, as if they were a single buffer. Where the platform
+ * allows it, each part is sent straight from where it is, avoiding a copy. Retries and the stop are handled the same
+ * way as ioaWireWriteWithRetry.
+ * @param wire the wire implementation
+ * @param address the address to write to
+ * @param buffers the parts to be written in order
+ * @param count the number of parts
+ * @param retriesAllowed the number of retries before failing
+ * @param sendStop if the stop event should be sent during transaction end.
+ * @return true if successful, otherwise false.
+ */
+bool ioaWireWriteV(WireType wire, int address, const IoaWireBuffer* buffers, size_t count, int retriesAllowed = 0, bool sendStop = true);
+
+/**
+ * Used by wire wrappers that can only send from one buffer, it copies the parts of a scatter gather write together.
+ * @param dest the buffer to copy into
+ * @param destSize the size of the destination buffer
+ * @param buffers the parts to be copied
+ * @param count the number of parts
+ * @param total set to the total length copied
+ * @return true if the parts fitted, otherwise false
+ */
+bool ioaWireGather(uint8_t* dest, size_t destSize, const IoaWireBuffer* buffers, size_t count, size_t& total);
+
+/** returned by ioaWireMaxTransferSize when the bus has no limit on the size of a transfer */
+#define IOA_WIRE_NO_TRANSFER_LIMIT 0xffffU
+
+/**
+ * Gets the largest number of bytes that can be sent in one write, or received in one read, on the given bus, so that
+ * callers can make each transfer as large as possible. On Arduino this is the size of the Wire library buffer, which
+ * is only 32 bytes on AVR boards, on mbed there is no limit, and where writes are gathered it is the gather buffer, or
+ * the driver buffer that they are copied into if that is smaller, see ioaWireGatheredTransferLimit.
+ * @param wire the wire implementation
+ * @return the maximum transfer size in bytes, or IOA_WIRE_NO_TRANSFER_LIMIT
+ */
+size_t ioaWireMaxTransferSize(WireType wire);
+
 /**
  * Sets the frequency of the selected I2C bus.
  * @param pI2c the I2C that the frequency is to be adjusted
@@ -74,6 +142,50 @@ void ioaWireSetSpeed(WireType pI2c, long frequency);
  */
 bool ioaWireReady(WireType wire, int address);
 
+/** the maximum number of devices that can have a preferred clock registered, across all buses */
+#ifndef IOA_WIRE_MAX_CLOCK_PROFILES
+#define IOA_WIRE_MAX_CLOCK_PROFILES 8
+#endif
+
+/** the maximum number of buses whose current clock is tracked for clock profiles */
+#ifndef IOA_WIRE_MAX_BUSES
+#define IOA_WIRE_MAX_BUSES 2
+#endif
+
+/**
+ * Registers the clock that a device prefers to run at, for buses that mix fast and slow devices. Before each
+ * transaction, the wire layer checks if the device being addressed needs a different clock from the one the bus is
+ * currently running at, and only then changes it, so consecutive transactions with the same device, or devices that
+ * prefer the same clock, do not pay for a change. Devices without a preference run at the speed last given to
+ * ioaWireSetSpeed for that bus, so ioaWireSetSpeed must have been called on the bus before any preference is
+ * registered, setting the clock directly on the bus does not record it. Each bus that ioaWireSetSpeed is called on
+ * takes an entry in a table of IOA_WIRE_MAX_BUSES, an entry is only given up for another bus once all the
+ * preferences on its bus are removed.
+ * @param wire the bus the device is on
+ * @param address the device address, or its first address if it responds on several
+ * @param frequency the preferred frequency, or 0 to remove the preference
+ * @param addressCount the number of consecutive addresses the device responds on, for example small AT24 parts
+ * @return true if the preference was stored, false if the table of profiles is full or the bus speed was never set
+ */
+bool ioaWireSetDeviceSpeed(WireType wire, uint8_t address, uint32_t frequency, uint8_t addressCount = 1);
+
+/**
+ * Used by the wire wrappers before each transaction, it works out if the clock needs to change before talking to
+ * the device at address, and if so records the new clock as current for that bus.
+ * @param wire the bus to be used
+ * @param address the device about to be addressed
+ * @return the frequency to change to, or 0 if the bus is already at the right speed
+ */
+uint32_t ioaWireSpeedChangeFor(WireType wire, int address);
+
+/**
+ * Used by the wire wrappers in ioaWireSetSpeed to record the speed as the default for devices on that bus that
+ * have no preference, and as the current speed.
+ * @param wire the bus that was changed
+ * @param frequency the new frequency
+ */
+void ioaWireDefaultSpeedChanged(WireType wire, uint32_t frequency);
+
 /**
  * The lock that must be used before accessing wire. All I2C calls use this lock, but you can wrap it around multiple
  * calls if they should happen together.
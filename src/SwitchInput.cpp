@@ -250,18 +250,41 @@ bool SwitchInput::runLoop() {
 
 	lastSyncStatus = ioDevice->sync();
 
-	for (bsize_t i = 0; i < keys.count(); ++i) {
-		// get the pins current state
-		auto key = keys.itemAtIndex(i);
-		uint8_t pinState = ioDevice->digitalRead(key->getPin());
-		if(isPullupLogic(key->isLogicInverted())) {
-			pinState = !pinState;
+	bsize_t i = 0;
+	while (i < keys.count()) {
+		// keys are sorted by pin, so we gather all keys within a 32 pin window and read them in one call.
+		pinid_t firstPin = keys.itemAtIndex(i)->getPin();
+		IoPinMask windowMask = 0;
+		bsize_t windowEnd = i;
+		while (windowEnd < keys.count()) {
+			pinid_t offset = keys.itemAtIndex(windowEnd)->getPin() - firstPin;
+			if(offset >= IO_PIN_MASK_BITS) break;
+			windowMask |= (IoPinMask(1) << offset);
+			windowEnd++;
 		}
-		// and pass to the key handler.
-		key->checkAndTrigger(pinState);
+		IoPinMask pinStates = ioDevice->readPins(firstPin, windowMask);
+		IoPinMask changedPins = ioDevice->changedPins(firstPin, windowMask);
+		// cleared before the keys are handled, so that a sync made by a key callback cannot clear a change unseen.
+		ioDevice->clearChangedPins(firstPin, windowMask);
+
+		for (; i < windowEnd; ++i) {
+			auto key = keys.itemAtIndex(i);
+			uint8_t pinBit = key->getPin() - firstPin;
+
+			// a key that is idle has nothing to do unless its pin changed, devices that can't tell report all pins changed.
+			if(((changedPins >> pinBit) & 1U) == 0 && !key->isDebouncing() && !key->isPressed()) continue;
+
+			// get the pins current state
+			uint8_t pinState = (pinStates >> pinBit) & 1U;
+			if(isPullupLogic(key->isLogicInverted())) {
+				pinState = !pinState;
+			}
+			// and pass to the key handler.
+			key->checkAndTrigger(pinState);
 
-		// we need to call into here again if we are debouncing or anything is pressed.
-		needAnotherGo |= (key->isDebouncing() || key->isPressed());
+			// we need to call into here again if we are debouncing or anything is pressed.
+			needAnotherGo |= (key->isDebouncing() || key->isPressed());
+		}
 	}
 
 	return needAnotherGo;
@@ -394,15 +417,21 @@ void checkRunLoopAndRepeat() {
 }
 
 void onSwitchesInterrupt(__attribute__((unused)) pinid_t pin) {
+	bool syncedForInterrupt = false;
 	if(switches.isInterruptDriven() && !switches.isInterruptDebouncing()) {
 		checkRunLoopAndRepeat();
+		syncedForInterrupt = true;
 	}
 
-  for(int i = 0; i < MAX_ROTARY_ENCODERS; ++i) {
+	// when switches has just synced, the encoders use that sync instead of each syncing again, so that they see
+	// the same values as switches, including any values the device captured when the interrupt was raised.
+	switches.setEncoderSyncShared(syncedForInterrupt);
+	for(int i = 0; i < MAX_ROTARY_ENCODERS; ++i) {
 		if(switches.encoder[i]) {
 			switches.encoder[i]->encoderChanged();
 		}
 	}
+	switches.setEncoderSyncShared(false);
 }
 
 void SwitchInput::resetAllSwitches() {
@@ -433,7 +462,23 @@ int AbstractHwRotaryEncoder::amountFromChange(unsigned long change) {
 
 }
 
+bool AbstractHwRotaryEncoder::pinsUnchangedInSharedSync() {
+    // only a sync that every encoder sees can be used, an encoder's own sync would hide changes from the others.
+    if(!switches.isEncoderSyncShared()) return false;
+
+    pinid_t firstPin = internal_min(pinA, pinB);
+    pinid_t offset = (pinA > pinB) ? (pinA - pinB) : (pinB - pinA);
+    if(offset >= IO_PIN_MASK_BITS) return false;
+    IoPinMask encoderPins = 1U | (IoPinMask(1) << offset);
+    auto device = switches.getIoAbstraction();
+    bool unchanged = device->changedPins(firstPin, encoderPins) == 0;
+    device->clearChangedPins(firstPin, encoderPins);
+    return unchanged;
+}
+
 void HardwareRotaryEncoder::encoderChanged() {
+    if(pinsUnchangedInSharedSync()) return;
+
     // Read the current states of pins A and B
     uint8_t a = switches.getIoAbstraction()->digitalRead(pinA);
     uint8_t b = switches.getIoAbstraction()->digitalRead(pinB);
@@ -633,8 +678,14 @@ int8_t HwStateRotaryEncoder::stateFor(uint8_t bits) {
 }
 
 void HwStateRotaryEncoder::encoderChanged() {
-    bool lastSyncStatus = switches.getIoAbstraction()->sync();
-    bitWrite(flags, LAST_SYNC_STATUS, lastSyncStatus);
+    if(switches.isEncoderSyncShared()) {
+        bitWrite(flags, LAST_SYNC_STATUS, switches.didLastSyncSucceed());
+        if(pinsUnchangedInSharedSync()) return;
+    }
+    else {
+        bool lastSyncStatus = switches.getIoAbstraction()->sync();
+        bitWrite(flags, LAST_SYNC_STATUS, lastSyncStatus);
+    }
 
     // get the current bit pattern on a and b
     uint8_t a = switches.getIoAbstraction()->digitalRead(pinA);
@@ -346,6 +346,7 @@ public:
 protected:
     void initialiseBase(pinid_t pinA, pinid_t pinB, HWAccelerationMode accelerationMode, EncoderType);
     int amountFromChange(unsigned long change);
+    bool pinsUnchangedInSharedSync();
     void handleChangeRaw(bool increase);
 };
 
@@ -501,6 +502,7 @@ protected:
 #define SW_FLAG_INTERRUPT_DRIVEN 1
 #define SW_FLAG_INTERRUPT_DEBOUNCE 2
 #define SW_FLAG_ENCODER_IS_POLLING 3
+#define SW_FLAG_ENCODER_SYNC_SHARED 4
 
 /**
  * An enumeration of values, one of which is used when calling switches.init to tell switches what to poll for, or
@@ -579,7 +581,9 @@ public:
 	void initialiseInterrupt(IoAbstractionRef ioDevice, bool usePullUpSwitching = false);
 	
 	/**
-	 * Add a switch to be managed by switches, it can optionally be a repeat key
+	 * Add a switch to be managed by switches, it can optionally be a repeat key. When adding many switches on an I2C
+	 * expander, call beginConfig() on the device before adding them and commitConfig() afterwards, so the pin set up
+	 * is written to the device in a few transactions instead of several for every switch.
 	 * @param pin the pin on which the switch is attached
 	 * @param callback the function to be called back upon change
 	 * @param invertLogic optional - inverts the logic between active high and active low for one switch
@@ -720,6 +724,15 @@ public:
 	 */
 	void setInterruptDebouncing(bool debounce) { bitWrite(swFlags, SW_FLAG_INTERRUPT_DEBOUNCE, debounce);}
 
+    /** @return true while encoders are handling an interrupt that switches has just synced the device for */
+	bool isEncoderSyncShared() {return bitRead(swFlags, SW_FLAG_ENCODER_SYNC_SHARED);}
+
+	/**
+	 * Sets if encoders can use the sync that switches has just made - only really for internal use.
+	 * @param shared true if the device was synced for the interrupt being handled.
+	 */
+	void setEncoderSyncShared(bool shared) { bitWrite(swFlags, SW_FLAG_ENCODER_SYNC_SHARED, shared);}
+
     /**
      * Gets the last sync status of the IoAbstraction being used by switches.
      * @return the last sync status as an bool, true for success, otherwise false.
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include "WearLevelledEeprom.h"
+#include <IoLogging.h>
+#include <TaskManagerIO.h>
+#include <string.h>
+
+#define WEAR_LEVEL_MAGIC_1 0x57
+#define WEAR_LEVEL_MAGIC_2 0x4C
+#define WEAR_LEVEL_MAX_RECORD (WEAR_LEVEL_MAX_RUN + WEAR_LEVEL_RECORD_OVERHEAD)
+
+// the replay window must hold a whole record, and each read into it is at most 255 bytes.
+static_assert(WEAR_LEVEL_READ_CHUNK >= WEAR_LEVEL_MAX_RECORD && WEAR_LEVEL_READ_CHUNK <= 255,
+              "WEAR_LEVEL_READ_CHUNK must be between WEAR_LEVEL_MAX_RECORD and 255");
+
+// CRC-16/CCITT, small and table free, as it only runs over a record at a time or a snapshot at boot.
+static uint16_t crc16Update(uint16_t crc, const uint8_t* data, uint16_t len) {
+    for(uint16_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8U;
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000U) ? (crc << 1U) ^ 0x1021U : (crc << 1U);
+        }
+    }
+    return crc;
+}
+
+// each check starts from the generation and where it is stored, so that a record or snapshot left over from an older
+// generation can never be taken as current, even where the bytes happen to be the same.
+static uint16_t crc16Seed(uint16_t gen, uint16_t offset) {
+    uint8_t seed[4] = { uint8_t(gen), uint8_t(gen >> 8U), uint8_t(offset), uint8_t(offset >> 8U) };
+    return crc16Update(0xffffU, seed, sizeof seed);
+}
+
+WearLevelledEeprom::WearLevelledEeprom(EepromAbstraction* backing, EepromPosition physicalStart, uint16_t physicalSize, uint16_t logicalSize)
+        : backing(backing), physicalStart(physicalStart), sectorSize(physicalSize / 2), logicalSize(logicalSize) {
+    image = new uint8_t[logicalSize];
+    memset(image, 0, logicalSize);
+    journalPosition = journalStart();
+}
+
+WearLevelledEeprom::~WearLevelledEeprom() {
+    delete[] image;
+}
+
+bool WearLevelledEeprom::begin() {
+    if((journalStart() + WEAR_LEVEL_MAX_RECORD) > sectorSize) {
+        serlogF2(SER_ERROR, "Wear level region too small ", sectorSize);
+        errorOccurred = true;
+        return false;
+    }
+    compactions = 0;
+
+    uint16_t gen[2];
+    bool valid[2];
+    for(uint8_t sector = 0; sector < 2; sector++) {
+        valid[sector] = readHeader(sector, gen[sector]);
+    }
+
+    // try the newest sector first, the generation wraps so compare the difference
+    uint8_t newest = (valid[1] && (!valid[0] || int16_t(gen[1] - gen[0]) > 0)) ? 1 : 0;
+    for(uint8_t attempt = 0; attempt < 2; attempt++) {
+        uint8_t sector = (attempt == 0) ? newest : (1 - newest);
+        if(valid[sector] && loadSnapshot(sector, gen[sector])) {
+            activeSector = sector;
+            generation = gen[sector];
+            replayJournal();
+            serlogF4(SER_IOA_INFO, "Wear level mounted sector, gen, used ", sector, generation, journalPosition);
+            return !backing->hasErrorOccurred();
+        }
+    }
+
+    serlogF(SER_IOA_INFO, "Wear level no valid data, formatting");
+    // as if before the first generation, so that the first snapshot is written to sector 0 as generation 1.
+    activeSector = 1;
+    generation = 0;
+    format();
+    return false;
+}
+
+void WearLevelledEeprom::format() {
+    memset(image, 0, logicalSize);
+    // a newer generation in the other sector replaces the current one, which stays valid until the header is written.
+    writeSnapshot(1 - activeSector, generation + 1);
+}
+
+bool WearLevelledEeprom::readHeader(uint8_t sector, uint16_t& gen) {
+    uint8_t header[WEAR_LEVEL_HEADER_SIZE];
+    backing->readIntoMemArray(header, sectorBase(sector), sizeof header);
+    gen = header[2] | (header[3] << 8U);
+    return header[0] == WEAR_LEVEL_MAGIC_1 && header[1] == WEAR_LEVEL_MAGIC_2;
+}
+
+bool WearLevelledEeprom::loadSnapshot(uint8_t sector, uint16_t gen) {
+    uint8_t check[2];
+    backing->readIntoMemArray(check, sectorBase(sector) + 4, sizeof check);
+
+    if(!backing->readIntoMemArrayWide(image, sectorBase(sector) + WEAR_LEVEL_HEADER_SIZE, logicalSize)) return false;
+
+    uint16_t crc = crc16Update(crc16Seed(gen, 0), image, logicalSize);
+    return crc == (check[0] | (check[1] << 8U));
+}
+
+void WearLevelledEeprom::replayJournal() {
+    uint8_t window[WEAR_LEVEL_READ_CHUNK];
+    uint16_t windowStart = journalStart();
+    uint16_t windowLen = 0;
+    uint16_t offset = journalStart();
+
+    while(true) {
+        // keep at least one whole record in the window, reading ahead in bulk rather than record by record.
+        uint16_t used = offset - windowStart;
+        uint16_t available = windowLen - used;
+        uint16_t windowEnd = windowStart + windowLen;
+        if(available < WEAR_LEVEL_MAX_RECORD && windowEnd < sectorSize) {
+            memmove(window, &window[used], available);
+            windowStart = offset;
+            auto toRead = (uint8_t)internal_min(uint16_t(sizeof(window) - available), uint16_t(sectorSize - windowEnd));
+            backing->readIntoMemArray(&window[available], sectorBase(activeSector) + windowEnd, toRead);
+            windowLen = available + toRead;
+            used = 0;
+            available = windowLen;
+        }
+
+        // the journal ends at the first record that is not complete and valid for this generation.
+        if(available <= WEAR_LEVEL_RECORD_OVERHEAD) break;
+        const uint8_t* record = &window[used];
+        uint8_t len = record[2];
+        if(len == 0 || len > WEAR_LEVEL_MAX_RUN || available < uint16_t(len + WEAR_LEVEL_RECORD_OVERHEAD)) break;
+        EepromPosition position = record[0] | (record[1] << 8U);
+        if(uint32_t(position + len) > logicalSize) break;
+        uint16_t crc = crc16Update(crc16Seed(generation, offset), record, len + 3);
+        if(crc != (record[len + 3] | (record[len + 4] << 8U))) break;
+
+        memcpy(&image[position], &record[3], len);
+        offset += len + WEAR_LEVEL_RECORD_OVERHEAD;
+    }
+    journalPosition = offset;
+}
+
+bool WearLevelledEeprom::appendRecord(EepromPosition position, const uint8_t* data, uint8_t len) {
+    uint16_t recordLen = len + WEAR_LEVEL_RECORD_OVERHEAD;
+    if((journalPosition + recordLen) > sectorSize) return false;
+
+    uint8_t record[WEAR_LEVEL_MAX_RECORD];
+    record[0] = uint8_t(position);
+    record[1] = uint8_t(position >> 8U);
+    record[2] = len;
+    memcpy(&record[3], data, len);
+    uint16_t crc = crc16Update(crc16Seed(generation, journalPosition), record, len + 3);
+    record[len + 3] = uint8_t(crc);
+    record[len + 4] = uint8_t(crc >> 8U);
+
+    backing->writeArrayToRom(sectorBase(activeSector) + journalPosition, record, recordLen);
+    journalPosition += recordLen;
+    return true;
+}
+
+void WearLevelledEeprom::writeSnapshot(uint8_t sector, uint16_t gen) {
+    // the snapshot goes in first and the header last, so the sector only becomes valid once it is complete.
+    backing->writeArrayToRomWide(sectorBase(sector) + WEAR_LEVEL_HEADER_SIZE, image, logicalSize);
+
+    uint16_t crc = crc16Update(crc16Seed(gen, 0), image, logicalSize);
+    uint8_t header[WEAR_LEVEL_HEADER_SIZE] = {
+            WEAR_LEVEL_MAGIC_1, WEAR_LEVEL_MAGIC_2, uint8_t(gen), uint8_t(gen >> 8U), uint8_t(crc), uint8_t(crc >> 8U)
+    };
+    backing->writeArrayToRom(sectorBase(sector), header, sizeof header);
+
+    activeSector = sector;
+    generation = gen;
+    journalPosition = journalStart();
+}
+
+bool WearLevelledEeprom::inBounds(EepromWidePosition position, size_t len) {
+    if(len > logicalSize || position > (logicalSize - len)) {
+        errorOccurred = true;
+        return false;
+    }
+    return true;
+}
+
+void WearLevelledEeprom::writeChanges(EepromPosition position, const uint8_t* data, size_t len) {
+    if(!inBounds(position, len)) return;
+
+    // only the span from the first to the last byte that changed is journalled
+    int first = -1, last = -1;
+    for(int i = 0; i < int(len); i++) {
+        if(image[position + i] != data[i]) {
+            if(first < 0) first = i;
+            last = i;
+        }
+    }
+    if(first < 0) return;
+    memcpy(&image[position + first], &data[first], last - first + 1);
+
+    for(int i = first; i <= last; i += WEAR_LEVEL_MAX_RUN) {
+        auto runLen = (uint8_t)internal_min(last - i + 1, WEAR_LEVEL_MAX_RUN);
+        if(!appendRecord(position + i, &data[i], runLen)) {
+            // the journal is full, the image already holds all of this change, so a new snapshot covers it.
+            compactions++;
+            writeSnapshot(1 - activeSector, generation + 1);
+            return;
+        }
+    }
+}
+
+bool WearLevelledEeprom::hasErrorOccurred() {
+    bool err = errorOccurred;
+    errorOccurred = false;
+    return backing->hasErrorOccurred() || err;
+}
+
+uint8_t WearLevelledEeprom::read8(EepromPosition position) {
+    if(!inBounds(position, 1)) return 0;
+    return image[position];
+}
+
+void WearLevelledEeprom::write8(EepromPosition position, uint8_t val) {
+    writeChanges(position, &val, 1);
+}
+
+uint16_t WearLevelledEeprom::read16(EepromPosition position) {
+    if(!inBounds(position, 2)) return 0;
+    return image[position] | (image[position + 1] << 8U);
+}
+
+void WearLevelledEeprom::write16(EepromPosition position, uint16_t val) {
+    uint8_t data[2] = { uint8_t(val), uint8_t(val >> 8U) };
+    writeChanges(position, data, sizeof data);
+}
+
+uint32_t WearLevelledEeprom::read32(EepromPosition position) {
+    if(!inBounds(position, 4)) return 0;
+    return (uint32_t)image[position] | ((uint32_t)image[position + 1] << 8U) |
+           ((uint32_t)image[position + 2] << 16U) | ((uint32_t)image[position + 3] << 24U);
+}
+
+void WearLevelledEeprom::write32(EepromPosition position, uint32_t val) {
+    uint8_t data[4] = { uint8_t(val), uint8_t(val >> 8U), uint8_t(val >> 16U), uint8_t(val >> 24U) };
+    writeChanges(position, data, sizeof data);
+}
+
+void WearLevelledEeprom::readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) {
+    if(!inBounds(romSrc, len)) return;
+    memcpy(memDest, &image[romSrc], len);
+}
+
+void WearLevelledEeprom::writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) {
+    writeChanges(romDest, memSrc, len);
+}
+
+bool WearLevelledEeprom::readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) {
+    if(!inBounds(romSrc, len)) return false;
+    memcpy(memDest, &image[romSrc], len);
+    return true;
+}
+
+bool WearLevelledEeprom::writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) {
+    if(!inBounds(romDest, len)) return false;
+    writeChanges((EepromPosition)romDest, memSrc, len);
+    return true;
+}
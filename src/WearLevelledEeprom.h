@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_WEARLEVELLEDEEPROM_H
+#define IOA_WEARLEVELLEDEEPROM_H
+
+/**
+ * @file WearLevelledEeprom.h
+ * @brief An EepromAbstraction that spreads writes over a larger region of any other EepromAbstraction, so that values
+ * that are saved frequently do not wear out the same cells.
+ */
+
+#include "EepromAbstraction.h"
+
+/** the most bytes that a single journal record can hold, longer changes are split over several records */
+#define WEAR_LEVEL_MAX_RUN 8
+
+/** the size of the header at the start of each sector, two magic bytes, the generation and the snapshot check */
+#define WEAR_LEVEL_HEADER_SIZE 6
+
+/** the bytes each journal record takes in addition to its data, the position, length and check */
+#define WEAR_LEVEL_RECORD_OVERHEAD 5
+
+/**
+ * the size of the buffer used to read the journal back at boot, larger is fewer reads but more stack. It must hold the
+ * largest record, WEAR_LEVEL_MAX_RUN plus WEAR_LEVEL_RECORD_OVERHEAD bytes, and be no more than 255.
+ */
+#ifndef WEAR_LEVEL_READ_CHUNK
+#define WEAR_LEVEL_READ_CHUNK 64
+#endif
+
+/**
+ * Wraps any other EepromAbstraction, such as I2cAt24Eeprom, AvrEeprom or ArduinoEEPROMAbstraction, and presents a
+ * smaller logical EEPROM that is stored as a journal within a larger physical region of it. This is for settings
+ * that are saved often, where writing the same few bytes in place would soon wear out those cells.
+ *
+ * The physical region is split into two sectors. Each sector starts with a header and a snapshot of the whole logical
+ * EEPROM, followed by a journal. Each write that changes something appends a small record, holding the position and
+ * the new bytes, to the journal of the active sector, so repeated saves are spread over the whole journal. When the
+ * journal is full, the current contents are written as a new snapshot into the other sector, with a higher
+ * generation, which then becomes active. Each record and snapshot carries a check, so a write that was interrupted
+ * by a power loss is ignored at the next boot, leaving the values as they were before it.
+ *
+ * The logical contents are held in RAM, so reads never touch the backing store. Call begin() once at boot, before
+ * any other call, it reads the newest valid snapshot and replays the journal with bulk reads. Multi byte values are
+ * stored little endian.
+ */
+class WearLevelledEeprom : public EepromAbstraction {
+private:
+    EepromAbstraction* backing;
+    uint8_t* image;
+    EepromPosition physicalStart;
+    uint16_t sectorSize;
+    uint16_t logicalSize;
+    uint16_t generation = 0;
+    uint16_t journalPosition = 0;
+    uint16_t compactions = 0;
+    uint8_t activeSector = 0;
+    bool errorOccurred = false;
+public:
+    /**
+     * Create a wear levelled EEPROM over part of another EEPROM. The physical region must be large enough for two
+     * sectors, each holding a header, the logical size and some room for the journal, the more room the journal has,
+     * the less often a whole snapshot is written, and the longer the EEPROM lasts.
+     * @param backing the EEPROM to store the data in
+     * @param physicalStart the start of the region within the backing EEPROM
+     * @param physicalSize the size of the region within the backing EEPROM
+     * @param logicalSize the size of the EEPROM that this presents
+     */
+    WearLevelledEeprom(EepromAbstraction* backing, EepromPosition physicalStart, uint16_t physicalSize, uint16_t logicalSize);
+    ~WearLevelledEeprom() override;
+    WearLevelledEeprom(const WearLevelledEeprom&) = delete;
+    WearLevelledEeprom& operator=(const WearLevelledEeprom&) = delete;
+
+    /**
+     * Loads the contents from the backing EEPROM, finding the newest valid snapshot and replaying its journal. If
+     * there is no valid data, such as on first use, the region is formatted with all values zero.
+     * @return true if existing data was loaded, false if the region was formatted or there was an error.
+     */
+    bool begin();
+
+    /**
+     * Clears the logical contents to zero and writes them as a new snapshot into the other sector, with a higher
+     * generation, so that the old contents are not loaded again at the next boot.
+     */
+    void format();
+
+    /** @return the size of the logical EEPROM */
+    uint16_t getLogicalSize() const { return logicalSize; }
+
+    /** @return the generation of the active sector, it goes up by one each time the journal fills */
+    uint16_t getGeneration() const { return generation; }
+
+    /** @return the number of times the journal has filled and a snapshot was written since begin */
+    uint16_t getCompactions() const { return compactions; }
+
+    /** @return the bytes left in the journal of the active sector */
+    uint16_t getJournalSpace() const { return sectorSize - journalPosition; }
+
+    bool hasErrorOccurred() override;
+
+    uint8_t read8(EepromPosition position) override;
+    void write8(EepromPosition position, uint8_t val) override;
+
+    uint16_t read16(EepromPosition position) override;
+    void write16(EepromPosition position, uint16_t val) override;
+
+    uint32_t read32(EepromPosition position) override;
+    void write32(EepromPosition position, uint32_t val) override;
+
+    void readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) override;
+    void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) override;
+
+    bool readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) override;
+    bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) override;
+
+    /** writes out anything held back by the backing EEPROM */
+    bool flush() override { return backing->flush(); }
+private:
+    EepromPosition sectorBase(uint8_t sector) const { return physicalStart + (sector * sectorSize); }
+    uint16_t journalStart() const { return WEAR_LEVEL_HEADER_SIZE + logicalSize; }
+    bool inBounds(EepromWidePosition position, size_t len);
+    bool readHeader(uint8_t sector, uint16_t& gen);
+    bool loadSnapshot(uint8_t sector, uint16_t gen);
+    void replayJournal();
+    bool appendRecord(EepromPosition position, const uint8_t* data, uint8_t len);
+    void writeSnapshot(uint8_t sector, uint16_t gen);
+    void writeChanges(EepromPosition position, const uint8_t* data, size_t len);
+};
+
+#endif //IOA_WEARLEVELLEDEEPROM_H
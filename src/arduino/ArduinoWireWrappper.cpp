@@ -16,31 +16,62 @@ SimpleSpinLock i2cLock;
 
 WireType defaultWireTypePtr = &Wire;
 
+// each core names its wire buffer size differently, if none are defined assume the 32 bytes of the original library
+#if defined(WIRE_BUFFER_SIZE)
+# define IOA_ARDUINO_WIRE_BUFFER WIRE_BUFFER_SIZE
+#elif defined(I2C_BUFFER_LENGTH)
+# define IOA_ARDUINO_WIRE_BUFFER I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+# define IOA_ARDUINO_WIRE_BUFFER BUFFER_LENGTH
+#else
+# define IOA_ARDUINO_WIRE_BUFFER 32
+#endif
+
+size_t ioaWireMaxTransferSize(WireType) {
+    return IOA_ARDUINO_WIRE_BUFFER;
+}
+
 void ioaWireBegin() {
     defaultWireTypePtr->begin();
 }
 
 void ioaWireSetSpeed(WireType wireType, long frequency) {
+    ioaWireDefaultSpeedChanged(wireType, frequency);
     wireType->setClock(frequency);
 }
 
+static inline void selectSpeedForDevice(WireType pI2c, int address) {
+    auto newSpeed = ioaWireSpeedChangeFor(pI2c, address);
+    if(newSpeed != 0) pI2c->setClock(newSpeed);
+}
+
+bool ioaWireReady(WireType pI2c, int address) {
+    selectSpeedForDevice(pI2c, address);
+    pI2c->beginTransmission(address);
+    return pI2c->endTransmission() == 0;
+}
+
 bool ioaWireRead(WireType pI2c, int addr, uint8_t* buffer, size_t len) {
+    selectSpeedForDevice(pI2c, addr);
+    bool readOk = false;
     if(pI2c->requestFrom(uint8_t(addr), len)) {
         uint8_t idx = 0;
         while(pI2c->available() && idx < len) {
             buffer[idx] = pI2c->read();
             idx++;
         }
-        return idx == len;
+        readOk = idx == len;
     }
-    return false;
+    ioaStatsWireRead(len, readOk);
+    return readOk;
 }
 
-bool ioaWireWriteWithRetry(WireType pI2c, int address, const uint8_t* buffer, size_t len, int retriesAllowed, bool sendStop) {
+static bool waitForDevice(WireType pI2c, int address, int retriesAllowed) {
     bool firstTime = true;
     bool i2cReady = retriesAllowed == 0;
     while(retriesAllowed && !i2cReady) {
         if(!firstTime) {
+            ioaStatsWireRetry();
             taskManager.yieldForMicros(50);
         }
         firstTime = false;
@@ -51,12 +82,52 @@ bool ioaWireWriteWithRetry(WireType pI2c, int address, const uint8_t* buffer, si
 
     if(!i2cReady) {
         serlogF(SER_ERROR, "I2C was not ready after retries, failing");
+    }
+    return i2cReady;
+}
+
+bool ioaWireWriteWithRetry(WireType pI2c, int address, const uint8_t* buffer, size_t len, int retriesAllowed, bool sendStop) {
+    selectSpeedForDevice(pI2c, address);
+    if(!waitForDevice(pI2c, address, retriesAllowed)) {
+        ioaStatsWireWrite(len, false);
         return false;
     }
 
     pI2c->beginTransmission(address);
     pI2c->write(buffer, len);
     auto writeOk = pI2c->endTransmission(sendStop) == 0;
+    ioaStatsWireWrite(len, writeOk);
+
+    return writeOk;
+}
+
+bool ioaWireWriteV(WireType pI2c, int address, const IoaWireBuffer* buffers, size_t count, int retriesAllowed, bool sendStop) {
+    size_t total = 0;
+    for(size_t i = 0; i < count; i++) total += buffers[i].len;
+
+    // the parts are written into the wire buffer, so check they fit before starting rather than sending a truncated write
+    if(total > ioaWireMaxTransferSize(pI2c)) {
+        serlogF(SER_ERROR, "I2C write too large for wire buffer");
+        ioaStatsWireWrite(total, false);
+        return false;
+    }
+
+    selectSpeedForDevice(pI2c, address);
+
+    if(!waitForDevice(pI2c, address, retriesAllowed)) {
+        ioaStatsWireWrite(total, false);
+        return false;
+    }
+
+    // once started the transmission is always ended, so the wire library is never left part way through a write
+    pI2c->beginTransmission(address);
+    size_t written = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(buffers[i].len != 0) written += pI2c->write(buffers[i].data, buffers[i].len);
+    }
+    auto endOk = pI2c->endTransmission(sendStop) == 0;
+    auto writeOk = endOk && written == total;
+    ioaStatsWireWrite(total, writeOk);
 
     return writeOk;
 }
@@ -21,6 +21,9 @@
 #define TWI_BUFFER_LENGTH 32
 #endif
 
+// writes are gathered and then copied into the TWI buffer, so the largest transfer must fit in both
+#define AVR_TWI_MAX_TRANSFER ioaWireGatheredTransferLimit(TWI_BUFFER_LENGTH)
+
 #define TWSR_STATUS_MASK  0xF8
 #define TWSR_VAL_START 0x08
 #define TWSR_VAL_REPEATED_START 0x10
@@ -321,28 +324,64 @@ void ioaWireBegin() {
     IoaTwi.initTwi();
 }
 
+static inline void selectSpeedForDevice(WireType wire, int address) {
+    auto newSpeed = ioaWireSpeedChangeFor(wire, address);
+    if(newSpeed != 0) IoaTwi.setFrequency(newSpeed);
+}
+
 bool ioaWireReady(WireType wire, int address) {
+    selectSpeedForDevice(wire, address);
     return IoaTwi.isReady(address);
 }
 
+size_t ioaWireMaxTransferSize(WireType) {
+    // every transfer goes through the TWI buffer, which is smaller than the gather buffer unless overridden
+    return AVR_TWI_MAX_TRANSFER;
+}
+
 void ioaWireSetSpeed(WireType wireType, long frequency) {
+    ioaWireDefaultSpeedChanged(wireType, frequency);
     IoaTwi.setFrequency(frequency);
 }
 
 bool ioaWireRead(WireType pI2c, int addr, uint8_t* buffer, size_t len) {
-    return IoaTwi.receiveData(addr, buffer, len);
+    selectSpeedForDevice(pI2c, addr);
+    bool readOk = IoaTwi.receiveData(addr, buffer, len);
+    ioaStatsWireRead(len, readOk);
+    return readOk;
 }
 
 bool ioaWireWriteWithRetry(WireType pI2c, int address, const uint8_t* buffer, size_t len, int retriesAllowed, bool sendStop) {
+    selectSpeedForDevice(pI2c, address);
     bool ready = retriesAllowed == 0;
     while(retriesAllowed != 0 && !ready) {
         ready = IoaTwi.isReady(retriesAllowed);
-        if(!ready) taskManager.yieldForMicros(50);
+        if(!ready) {
+            ioaStatsWireRetry();
+            taskManager.yieldForMicros(50);
+        }
         retriesAllowed--;
     }
-    if(!ready) return false;
+    if(!ready) {
+        ioaStatsWireWrite(len, false);
+        return false;
+    }
+
+    bool writeOk = IoaTwi.sendData(address, buffer, len, sendStop);
+    ioaStatsWireWrite(len, writeOk);
+    return writeOk;
+}
 
-    return IoaTwi.sendData(address, buffer, len, sendStop);
+bool ioaWireWriteV(WireType pI2c, int address, const IoaWireBuffer* buffers, size_t count, int retriesAllowed, bool sendStop) {
+    // the TWI manager sends from a single buffer, so the parts are gathered first.
+    uint8_t gathered[AVR_TWI_MAX_TRANSFER];
+    size_t len;
+    if(!ioaWireGather(gathered, sizeof gathered, buffers, count, len)) {
+        serlogF(SER_ERROR, "I2C write too large to gather");
+        ioaStatsWireWrite(len, false);
+        return false;
+    }
+    return ioaWireWriteWithRetry(pI2c, address, gathered, len, retriesAllowed, sendStop);
 }
 
 #endif
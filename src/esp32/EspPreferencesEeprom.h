@@ -14,6 +14,7 @@
 #define IOA_ESPPREFERENCESEEPROM_H
 
 #include <EepromAbstraction.h>
+#include <ChunkedPreferenceStore.h>
 #include <IoLogging.h>
 #include <Preferences.h>
 
@@ -24,16 +25,19 @@
 
 /**
  * An implementation of EepromAbstraction that backs onto the ESP32 preferences API. It holds an array of the
- * size requested in memory, which is loaded from the preferences at start up, and it can be committed back
+ * size requested in memory, which is loaded from the preferences as it is used, and it can be committed back
  * to storage using the extra `commit` method.
+ *
+ * The storage is split into chunks of IOA_PREFS_CHUNK_SIZE bytes, each under its own key, and a commit only writes
+ * the chunks that changed, so flash wear and commit time depend on how much changed rather than the size of the
+ * store. A store saved by an older version as a single blob is loaded and moved over to chunks on the next commit.
+ * See ChunkedPreferenceStore for how the chunks are managed.
  */
 class EspPreferencesEeprom : public EepromAbstraction {
 private:
     Preferences prefs;
-    uint8_t *menuStore;
-    size_t storeSize;
+    ChunkedPreferenceStore<Preferences> store;
     bool prefsOk = true;
-    bool changed = false;
     char romNamespaceStr[20];
 
 public:
@@ -41,10 +45,10 @@ public:
      * Construct the preferences based eeprom, ready to be initialised and used later.
      * @param romNameSpace the namespace to use, up to 20 characters in length
      * @param size the size of the storage area to create.
+     * @param chunkSize the size of each chunk stored under its own key, defaults to IOA_PREFS_CHUNK_SIZE
      */
-    EspPreferencesEeprom(const char* romNameSpace, size_t size) {
-        menuStore = new uint8_t[size];
-        storeSize = size;
+    EspPreferencesEeprom(const char* romNameSpace, size_t size, uint16_t chunkSize = IOA_PREFS_CHUNK_SIZE)
+            : store(prefs, IOA_STORE_KEY, size, chunkSize) {
         strncpy(romNamespaceStr, romNameSpace, sizeof(romNamespaceStr) - 1);
         romNamespaceStr[sizeof(romNamespaceStr) - 1] = 0;
     }
@@ -55,19 +59,13 @@ public:
      */
     bool init() {
         prefs.begin(romNamespaceStr, false);
-        // Make sure the store can be loaded and the sizes match. Otherwise, we don't load it.
-        if (!prefs.isKey(IOA_STORE_KEY) || prefs.getBytesLength(IOA_STORE_KEY) != storeSize) {
-            serlogF2(SER_IOA_INFO, "New prefs ", IOA_STORE_KEY);
-            memset(menuStore, 0, storeSize);
-        } else {
-            reload();
-        }
+        store.begin();
+        prefsOk = store.isOk();
         return prefsOk;
     }
 
     ~EspPreferencesEeprom() override {
         prefs.end();
-        delete[] menuStore;
         prefsOk = false;
     }
 
@@ -75,51 +73,54 @@ public:
      * Check if an error has occurred during any operation
      * @return true in the event an error was recorded, otherwise false
      */
-    bool hasErrorOccurred() override { return !prefsOk; }
+    bool hasErrorOccurred() override { return !prefsOk || !store.isOk(); }
 
     uint8_t read8(EepromPosition position) override {
-        if (position >= storeSize || !prefsOk) {
-            prefsOk = false;
-            return 0;
-        }
-        return menuStore[position];
+        uint8_t val = 0;
+        readValue(position, &val, 1);
+        return val;
     }
 
     void write8(EepromPosition position, uint8_t val) override {
-        if (position >= storeSize || !prefsOk) return;
-        menuStore[position] = val;
-        changed = true;
+        writeValue(position, &val, 1);
     }
 
     uint16_t read16(EepromPosition position) override {
-        return read8(position) | (read8(position + 1) << 8);
+        uint8_t data[2] = {};
+        readValue(position, data, sizeof data);
+        return data[0] | (data[1] << 8);
     }
 
     void write16(EepromPosition position, uint16_t val) override {
-        write8(position, val & 0xFF);
-        write8(position + 1, val >> 8);
-        changed = true;
+        uint8_t data[2] = { uint8_t(val & 0xFF), uint8_t(val >> 8) };
+        writeValue(position, data, sizeof data);
     }
 
     uint32_t read32(EepromPosition position) override {
-        return read16(position) | (read16(position + 2) << 16);
-
+        uint8_t data[4] = {};
+        readValue(position, data, sizeof data);
+        return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
     }
 
     void write32(EepromPosition position, uint32_t val) override {
-        write16(position, val & 0xFFFF);
-        write16(position + 2, val >> 16);
-        changed = true;
+        uint8_t data[4] = { uint8_t(val & 0xFF), uint8_t(val >> 8), uint8_t(val >> 16), uint8_t(val >> 24) };
+        writeValue(position, data, sizeof data);
     }
 
     void readIntoMemArray(uint8_t *memDest, EepromPosition romSrc, uint8_t len) override {
-        memcpy(memDest, menuStore + romSrc, len);
-
+        if (!store.read(romSrc, memDest, len)) prefsOk = false;
     }
 
     void writeArrayToRom(EepromPosition romDest, const uint8_t *memSrc, uint8_t len) override {
-        memcpy(menuStore + romDest, memSrc, len);
-        changed = true;
+        if (!store.write(romDest, memSrc, len)) prefsOk = false;
+    }
+
+    bool readIntoMemArrayWide(uint8_t *memDest, EepromWidePosition romSrc, size_t len) override {
+        return store.read(romSrc, memDest, len);
+    }
+
+    bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t *memSrc, size_t len) override {
+        return store.write(romDest, memSrc, len);
     }
 
     /**
@@ -129,29 +130,44 @@ public:
     Preferences& getPreferences() { return prefs; }
 
     /**
-     * Commit the contents of the preferences back to ROM.
+     * @return the chunked store that holds the data, it can be used to see how many chunks are dirty or written
      */
-    void commit() {
-        if (changed) {
-            serlogF2(SER_IOA_INFO, "Prefs written to ", IOA_STORE_KEY);
-            prefs.putBytes(IOA_STORE_KEY, menuStore, storeSize);
-        }
-        changed = false;
+    ChunkedPreferenceStore<Preferences>& getChunkedStore() { return store; }
+
+    /**
+     * Commit the contents of the preferences back to ROM, only the chunks that changed are written.
+     * @return true if all the changed chunks were written
+     */
+    bool commit() {
+        if (!store.isDirty()) return true;
+        serlogF2(SER_IOA_INFO, "Prefs written to ", IOA_STORE_KEY);
+        return store.commit();
     }
 
+    /** commits any changes, see commit() */
+    bool flush() override { return commit(); }
+
     /**
      * Reload the contents of the ROM back into memory, overwriting what's in memory and resetting
-     * the OK flag.
+     * the OK flag. Each chunk is loaded when it is next used.
      */
     void reload() {
         serlogF2(SER_IOA_INFO, "Load prefs ", IOA_STORE_KEY);
-        if (prefs.getBytes(IOA_STORE_KEY, menuStore, storeSize) != storeSize) {
-            serlogF3(SER_ERROR, "Prefs load failed ", IOA_STORE_KEY, storeSize);
+        store.reload();
+        prefsOk = true;
+    }
+
+private:
+    void readValue(EepromPosition position, uint8_t* data, size_t len) {
+        if (!prefsOk || !store.read(position, data, len)) {
             prefsOk = false;
-        } else {
-            prefsOk = true;
         }
     }
+
+    void writeValue(EepromPosition position, const uint8_t* data, size_t len) {
+        if (!prefsOk) return;
+        if (!store.write(position, data, len)) prefsOk = false;
+    }
 };
 
 #endif //IOA_ESPPREFERENCESEEPROM_H
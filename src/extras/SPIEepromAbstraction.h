@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOABSTRACTION_SPIEEPROMABSTRACTION_H
+#define IOABSTRACTION_SPIEEPROMABSTRACTION_H
+
+#include "../PlatformDetermination.h"
+#include "../EepromAbstraction.h"
+#include "SPIHelper.h"
+#include <TaskManagerIO.h>
+#include <IoLogging.h>
+#include <string.h>
+
+/**
+ * @file SPIEepromAbstraction.h
+ * @brief An EepromAbstraction for SPI FRAM (such as MB85RS) and SPI EEPROM (such as 25LC) memory chips, using the
+ * same command set for both. FRAM reads and writes any length in one frame, EEPROM writes are split at page
+ * boundaries and wait for the write cycle of the chip to finish before the next access.
+ *
+ * This class is in the extras package, it means it is not part of the core of IoAbstraction.
+ */
+
+/**
+ * The SPI memory chips that are supported, FRAM parts start with SPI_FRAM and EEPROM parts with SPI_EEPROM.
+ */
+enum SpiEepromType {
+    SPI_FRAM_MB85RS64,
+    SPI_FRAM_MB85RS256,
+    SPI_FRAM_MB85RS512,
+    SPI_FRAM_MB85RS1M,
+    SPI_FRAM_MB85RS2M,
+    SPI_EEPROM_25LC080,
+    SPI_EEPROM_25LC160,
+    SPI_EEPROM_25LC320,
+    SPI_EEPROM_25LC640,
+    SPI_EEPROM_25LC128,
+    SPI_EEPROM_25LC256,
+    SPI_EEPROM_25LC512,
+    SPI_EEPROM_25LC1024
+};
+
+/**
+ * Given a SPI memory type this returns the size of the device in bytes
+ * @param type the memory type
+ * @return the size in bytes
+ */
+inline uint32_t spiEepromSizeFromType(SpiEepromType type) {
+    switch(type) {
+        case SPI_FRAM_MB85RS64: case SPI_EEPROM_25LC640: return 8192UL;
+        case SPI_FRAM_MB85RS256: case SPI_EEPROM_25LC256: return 32768UL;
+        case SPI_FRAM_MB85RS512: case SPI_EEPROM_25LC512: return 65536UL;
+        case SPI_FRAM_MB85RS1M: case SPI_EEPROM_25LC1024: return 131072UL;
+        case SPI_FRAM_MB85RS2M: return 262144UL;
+        case SPI_EEPROM_25LC080: return 1024UL;
+        case SPI_EEPROM_25LC160: return 2048UL;
+        case SPI_EEPROM_25LC320: return 4096UL;
+        case SPI_EEPROM_25LC128: return 16384UL;
+        default: return 0;
+    }
+}
+
+/**
+ * Given a SPI memory type this returns the page size that writes must be split at, FRAM has no pages so it is 0.
+ * @param type the memory type
+ * @return the page size, or 0 for FRAM
+ */
+inline uint16_t spiEepromPageFromType(SpiEepromType type) {
+    switch(type) {
+        case SPI_EEPROM_25LC080: case SPI_EEPROM_25LC160: return 16;
+        case SPI_EEPROM_25LC320: case SPI_EEPROM_25LC640: return 32;
+        case SPI_EEPROM_25LC128: case SPI_EEPROM_25LC256: return 64;
+        case SPI_EEPROM_25LC512: return 128;
+        case SPI_EEPROM_25LC1024: return 256;
+        default: return 0;
+    }
+}
+
+/** the opcodes used by both SPI FRAM and SPI EEPROM chips */
+#define SPI_EEPROM_CMD_WRITE 0x02
+#define SPI_EEPROM_CMD_READ 0x03
+#define SPI_EEPROM_CMD_RDSR 0x05
+#define SPI_EEPROM_CMD_WREN 0x06
+/** the write in progress bit of the status register */
+#define SPI_EEPROM_STATUS_WIP 0x01
+
+/** how long to yield between each read of the status register while an EEPROM write is in progress, in microseconds */
+#define SPI_EEPROM_POLL_MICROS 100
+/** how many times the status register is read before giving up on the write finishing, about 20 milliseconds */
+#define SPI_EEPROM_MAX_POLLS 200
+
+/**
+ * An EepromAbstraction for SPI FRAM and SPI EEPROM chips, built on SPIWithSettings. Values are stored big endian the
+ * same as I2cAt24Eeprom, and each value or array is read or written with one SPI frame wherever the device allows.
+ *
+ * FRAM writes at bus speed and has no pages, so any length is written at once and there is never a wait. EEPROM is
+ * split into pages, each write is limited to one page and afterwards the chip is busy for a few milliseconds; the
+ * status register is only polled before the next access to the chip, yielding to task manager while it is busy, so
+ * a single write returns as soon as it is sent. Scalar writes to EEPROM read the current value first and are skipped
+ * if it is unchanged, to save a write cycle and the wear that goes with it. Devices over 64K take three address
+ * bytes and are fully addressable through the wide array functions.
+ */
+class SPIEepromAbstraction : public EepromAbstraction {
+private:
+    SPIWithSettings& spiBus;
+    uint32_t romSize;
+    uint16_t pageSize;
+    uint8_t addressBytes;
+    bool writePending = false;
+    bool errorOccurred = false;
+public:
+    /**
+     * Create an SPI memory abstraction for a given device type
+     * @param spi the SPI bus and chip select of the device, it must outlive this object.
+     * @param type the type of memory chip, see SpiEepromType
+     */
+    SPIEepromAbstraction(SPIWithSettings& spi, SpiEepromType type) : spiBus(spi),
+            romSize(spiEepromSizeFromType(type)), pageSize(spiEepromPageFromType(type)),
+            addressBytes(romSize > 65536UL ? 3 : 2) {}
+
+    /** @return the size of the device in bytes */
+    uint32_t getRomSize() const { return romSize; }
+
+    /** @return the page size of the device, or 0 for FRAM */
+    uint16_t getPageSize() const { return pageSize; }
+
+    /** @return true if the device is FRAM, which has no pages and no write cycle time */
+    bool isFram() const { return pageSize == 0; }
+
+    bool hasErrorOccurred() override {
+        bool err = errorOccurred;
+        errorOccurred = false;
+        return err;
+    }
+
+    uint8_t read8(EepromPosition position) override {
+        uint8_t data = 0;
+        readBytes(position, &data, 1);
+        return data;
+    }
+
+    void write8(EepromPosition position, uint8_t val) override {
+        writeValue(position, &val, 1);
+    }
+
+    uint16_t read16(EepromPosition position) override {
+        uint8_t data[2] = {};
+        readBytes(position, data, sizeof data);
+        return (data[0] << 8U) | data[1];
+    }
+
+    void write16(EepromPosition position, uint16_t val) override {
+        uint8_t data[2] = { uint8_t(val >> 8U), uint8_t(val) };
+        writeValue(position, data, sizeof data);
+    }
+
+    uint32_t read32(EepromPosition position) override {
+        uint8_t data[4] = {};
+        readBytes(position, data, sizeof data);
+        return ((uint32_t)data[0] << 24U) | ((uint32_t)data[1] << 16U) | ((uint32_t)data[2] << 8U) | data[3];
+    }
+
+    void write32(EepromPosition position, uint32_t val) override {
+        uint8_t data[4] = { uint8_t(val >> 24U), uint8_t(val >> 16U), uint8_t(val >> 8U), uint8_t(val) };
+        writeValue(position, data, sizeof data);
+    }
+
+    void readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) override {
+        readBytes(romSrc, memDest, len);
+    }
+
+    void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) override {
+        writeBytes(romDest, memSrc, len);
+    }
+
+    bool readIntoMemArrayWide(uint8_t* memDest, EepromWidePosition romSrc, size_t len) override {
+        return readBytes(romSrc, memDest, len);
+    }
+
+    bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t* memSrc, size_t len) override {
+        return writeBytes(romDest, memSrc, len);
+    }
+
+    /** waits for any EEPROM write cycle in progress to finish, so that everything written is stored */
+    bool flush() override {
+        return waitForReady();
+    }
+
+private:
+    bool inBounds(EepromWidePosition position, size_t len) {
+        if(len > romSize || position > (romSize - len)) {
+            errorOccurred = true;
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t buildCommand(uint8_t* cmd, uint8_t opcode, EepromWidePosition position) const {
+        cmd[0] = opcode;
+        for(uint8_t i = 0; i < addressBytes; i++) {
+            cmd[addressBytes - i] = uint8_t(position >> (i * 8U));
+        }
+        return addressBytes + 1;
+    }
+
+    bool waitForReady() {
+        if(!writePending) return true;
+        uint8_t cmd = SPI_EEPROM_CMD_RDSR;
+        for(int poll = 0; poll < SPI_EEPROM_MAX_POLLS; poll++) {
+            uint8_t status = SPI_EEPROM_STATUS_WIP;
+            spiBus.readWithCommand(&cmd, 1, &status, 1);
+            if((status & SPI_EEPROM_STATUS_WIP) == 0) {
+                writePending = false;
+                return true;
+            }
+            taskManager.yieldForMicros(SPI_EEPROM_POLL_MICROS);
+        }
+        serlogF(SER_ERROR, "SPI EEPROM write did not finish");
+        errorOccurred = true;
+        return false;
+    }
+
+    bool readBytes(EepromWidePosition position, uint8_t* data, size_t len) {
+        if(!inBounds(position, len) || !waitForReady()) return false;
+        uint8_t cmd[4];
+        uint8_t cmdLen = buildCommand(cmd, SPI_EEPROM_CMD_READ, position);
+        if(!spiBus.readWithCommand(cmd, cmdLen, data, len)) {
+            errorOccurred = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool writeBytes(EepromWidePosition position, const uint8_t* data, size_t len) {
+        if(!inBounds(position, len)) return false;
+        while(len > 0) {
+            // an EEPROM write wraps around within the page, so never go past the end of the current one
+            size_t chunk = len;
+            if(pageSize) chunk = internal_min(len, size_t(pageSize - (position % pageSize)));
+            if(!waitForReady()) return false;
+
+            uint8_t cmd[4] = { SPI_EEPROM_CMD_WREN };
+            bool ok = spiBus.writeWithCommand(cmd, 1, nullptr, 0);
+            uint8_t cmdLen = buildCommand(cmd, SPI_EEPROM_CMD_WRITE, position);
+            ok = ok && spiBus.writeWithCommand(cmd, cmdLen, data, chunk);
+            if(!ok) {
+                errorOccurred = true;
+                return false;
+            }
+            writePending = pageSize != 0;
+            position += chunk;
+            data += chunk;
+            len -= chunk;
+        }
+        return true;
+    }
+
+    void writeValue(EepromPosition position, const uint8_t* data, uint8_t len) {
+        if(pageSize) {
+            uint8_t current[4];
+            if(!readBytes(position, current, len)) return;
+            if(memcmp(current, data, len) == 0) return;
+        }
+        writeBytes(position, data, len);
+    }
+};
+
+#endif //IOABSTRACTION_SPIEEPROMABSTRACTION_H
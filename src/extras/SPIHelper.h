@@ -31,6 +31,7 @@ public:
     void init() {
         internalDigitalDevice().pinMode(csPin, OUTPUT);
         internalDigitalDevice().digitalWrite(csPin, HIGH);
+        initializedYet = true;
     }
 
     bool transferSPI(uint8_t* rdwr, size_t len) {
@@ -44,6 +45,33 @@ public:
         internalDigitalDevice().digitalWrite(csPin, HIGH);
         return true;
     }
+
+    bool readWithCommand(const uint8_t* cmd, size_t cmdLen, uint8_t* data, size_t len) {
+        if(!initializedYet) {
+            init();
+        }
+        internalDigitalDevice().digitalWrite(csPin, LOW);
+        spiBus->beginTransaction(settings);
+        for(size_t i = 0; i < cmdLen; i++) spiBus->transfer(cmd[i]);
+        memset(data, 0, len);
+        spiBus->transfer(data, len);
+        spiBus->endTransaction();
+        internalDigitalDevice().digitalWrite(csPin, HIGH);
+        return true;
+    }
+
+    bool writeWithCommand(const uint8_t* cmd, size_t cmdLen, const uint8_t* data, size_t len) {
+        if(!initializedYet) {
+            init();
+        }
+        internalDigitalDevice().digitalWrite(csPin, LOW);
+        spiBus->beginTransaction(settings);
+        for(size_t i = 0; i < cmdLen; i++) spiBus->transfer(cmd[i]);
+        for(size_t i = 0; i < len; i++) spiBus->transfer(data[i]);
+        spiBus->endTransaction();
+        internalDigitalDevice().digitalWrite(csPin, HIGH);
+        return true;
+    }
 };
 #elif BUILD_FOR_PICO_CMAKE
 #include "hardware/spi.h"
@@ -103,6 +131,22 @@ public:
         waitAndDeactivateCS();
         return written == len;
     }
+
+    bool readWithCommand(const uint8_t* cmd, size_t cmdLen, uint8_t* data, size_t len) {
+        waitAndActiveCS();
+        int written = spi_write_blocking(spiBus, cmd, cmdLen);
+        int read = spi_read_blocking(spiBus, 0, data, len);
+        waitAndDeactivateCS();
+        return written == cmdLen && read == len;
+    }
+
+    bool writeWithCommand(const uint8_t* cmd, size_t cmdLen, const uint8_t* data, size_t len) {
+        waitAndActiveCS();
+        int written = spi_write_blocking(spiBus, cmd, cmdLen);
+        written += spi_write_blocking(spiBus, data, len);
+        waitAndDeactivateCS();
+        return written == (cmdLen + len);
+    }
 };
 #elif __MBED__
 #define TC_SPI_WRITE_AVAILABLE
@@ -157,6 +201,88 @@ public:
         waitAndDeactivateCS();
         return written == len;
     }
+
+    bool readWithCommand(const uint8_t* cmd, size_t cmdLen, uint8_t* data, size_t len) {
+        waitAndActiveCS();
+        char sz[1];
+        int written = spiBus->write((const char*)cmd, cmdLen, sz, 0);
+        int read = spiBus->write(nullptr, 0, (char*)data, len);
+        waitAndDeactivateCS();
+        return written == cmdLen && read == len;
+    }
+
+    bool writeWithCommand(const uint8_t* cmd, size_t cmdLen, const uint8_t* data, size_t len) {
+        waitAndActiveCS();
+        char sz[1];
+        int written = spiBus->write((const char*)cmd, cmdLen, sz, 0);
+        written += spiBus->write((const char*)data, len, sz, 0);
+        waitAndDeactivateCS();
+        return written == (cmdLen + len);
+    }
+};
+#elif defined(BUILD_FOR_HOST)
+#include "../host/HostSpiBus.h"
+#define TC_SPI_WRITE_AVAILABLE
+class SPIWithSettings {
+private:
+    HostSpiBus* spiBus;
+    uint32_t speed;
+    pinid_t csPin = 0;
+    bool initializedYet = false;
+public:
+    SPIWithSettings(HostSpiBus* bus, pinid_t cs) : spiBus(bus), speed(10000000), csPin(cs) {}
+    SPIWithSettings(HostSpiBus* bus, pinid_t cs, uint32_t speed) : spiBus(bus), speed(speed), csPin(cs) {}
+    SPIWithSettings(const SPIWithSettings&) = default;
+    SPIWithSettings& operator=(const SPIWithSettings&)=default;
+
+    void init() {
+        internalDigitalDevice().pinMode(csPin, OUTPUT);
+        internalDigitalDevice().digitalWrite(csPin, HIGH);
+        initializedYet=true;
+    }
+
+    void waitAndActiveCS() {
+        if(!initializedYet) {
+            init();
+        }
+        internalDigitalDevice().digitalWrite(csPin, LOW);
+        spiBus->select(csPin);
+    }
+
+    void waitAndDeactivateCS() {
+        spiBus->deselect();
+        internalDigitalDevice().digitalWrite(csPin, HIGH);
+    }
+
+    bool write(const uint8_t* data, size_t size) {
+        return writeWithCommand(data, size, nullptr, 0);
+    }
+
+    bool transferSPI(uint8_t* rdwr, size_t len) {
+        waitAndActiveCS();
+        for(size_t i = 0; i < len; i++) rdwr[i] = spiBus->transfer(rdwr[i]);
+        waitAndDeactivateCS();
+        return true;
+    }
+
+    bool readWithCommand(const uint8_t* cmd, size_t cmdLen, uint8_t* data, size_t len) {
+        waitAndActiveCS();
+        for(size_t i = 0; i < cmdLen; i++) spiBus->transfer(cmd[i]);
+        for(size_t i = 0; i < len; i++) data[i] = spiBus->transfer(0);
+        waitAndDeactivateCS();
+        return true;
+    }
+
+    bool writeWithCommand(const uint8_t* cmd, size_t cmdLen, const uint8_t* data, size_t len) {
+        waitAndActiveCS();
+        for(size_t i = 0; i < cmdLen; i++) spiBus->transfer(cmd[i]);
+        for(size_t i = 0; i < len; i++) spiBus->transfer(data[i]);
+        waitAndDeactivateCS();
+        return true;
+    }
+
+    /** @return the clock speed requested, the simulated bus transfers at any speed */
+    uint32_t getSpeed() const { return speed; }
 };
 #else
 #error "Not implemented yet for chosen platform"
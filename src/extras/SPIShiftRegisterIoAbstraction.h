@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOABSTRACTION_SPISHIFTREGISTERIOABSTRACTION_H
+#define IOABSTRACTION_SPISHIFTREGISTERIOABSTRACTION_H
+
+#include "../PlatformDetermination.h"
+#include "../IoAbstraction.h"
+#include "SPIHelper.h"
+
+/**
+ * @file SPIShiftRegisterIoAbstraction.h
+ * @brief A shift register IoAbstraction that uses hardware SPI instead of bit banging, for 74HC165 inputs and 74HC595
+ * outputs sharing one SPI bus. On each sync the whole chain is clocked out and in with a single SPI transfer.
+ *
+ * This class is in the extras package, it means it is not part of the core of IoAbstraction.
+ */
+
+/**
+ * An IoAbstraction for 74HC165 input and 74HC595 output shift registers that are connected to hardware SPI, it is
+ * a drop in replacement for ShiftRegisterIoAbstraction and keeps the same pin numbering, inputs are pins 0..31 and
+ * outputs start at SHIFT_REGISTER_OUTPUT_CUTOVER (32). As with the bit banged version, there can be up to four input
+ * devices, and any number of output devices that fit in the range of pinid_t.
+ *
+ * Wiring is as follows, SCK goes to the clock pin of all the devices, MOSI goes to the data in (SER) of the first
+ * 74HC595, and MISO comes from the data out (QH) of the last 74HC165. The chip select pin of the SPIWithSettings object
+ * is wired to the latch (RCLK) of the 74HC595 chain, so the outputs latch as chip select goes high at the end of each
+ * transfer. The 74HC165 load pin (SH/LD) is a separate output that is pulsed before each transfer.
+ *
+ * The QH output of the 74HC165 is not tri-state, it always drives MISO, even when chip select is high. So either give
+ * the shift registers an SPI bus of their own, or put a tri-state buffer such as a 74HC125 between QH and MISO with its
+ * enable wired to the chip select, so that MISO is released for the other devices. Wiring the 74HC165 clock inhibit
+ * (CLK INH) to the chip select as well stops the chain shifting during other devices' traffic.
+ *
+ * Unlike the bit banged version, there is no yield for latching, as the SPI transfer is far shorter than the time
+ * the latch pulse takes on any supported board.
+ */
+class SPIShiftRegisterIoAbstraction : public BasicIoAbstraction {
+private:
+    SPIWithSettings& spiBus;
+    uint8_t readBuffer[SHIFT_REGISTER_MAX_INPUT_DEVICES];
+    uint8_t* writeBuffer;
+    uint8_t* transferBuffer;
+    pinid_t readLoadPin;
+    uint8_t numOfDevicesRead;
+    uint8_t numOfDevicesWrite;
+    bool needsWrite = true;
+    bool needsInit = true;
+public:
+    /**
+     * Create an SPI shift register abstraction, for either input, output, or both.
+     * @param spi the SPI bus and chip select (74HC595 latch) to use, it must outlive this object.
+     * @param readLoadPin the 74HC165 load pin, or IO_PIN_NOT_DEFINED if there are no input devices
+     * @param numRead the number of 74HC165 input devices chained together, 0 to SHIFT_REGISTER_MAX_INPUT_DEVICES
+     * @param numWrite the number of 74HC595 output devices chained together
+     */
+    SPIShiftRegisterIoAbstraction(SPIWithSettings& spi, pinid_t readLoadPin, uint8_t numRead, uint8_t numWrite)
+            : spiBus(spi), readBuffer{}, readLoadPin(readLoadPin) {
+        numOfDevicesRead = (readLoadPin == IO_PIN_NOT_DEFINED) ? 0 : internal_min(numRead, (uint8_t)SHIFT_REGISTER_MAX_INPUT_DEVICES);
+        numOfDevicesWrite = numWrite;
+        writeBuffer = numOfDevicesWrite ? new uint8_t[numOfDevicesWrite]() : nullptr;
+
+        // one transfer clocks the longest chain, so the buffer is as long as the larger of the two.
+        uint8_t transferLen = internal_max(numOfDevicesRead, numOfDevicesWrite);
+        transferBuffer = transferLen ? new uint8_t[transferLen]() : nullptr;
+    }
+
+    ~SPIShiftRegisterIoAbstraction() override {
+        delete[] writeBuffer;
+        delete[] transferBuffer;
+    }
+
+    // the buffers are owned by this object, so it cannot be copied.
+    SPIShiftRegisterIoAbstraction(const SPIShiftRegisterIoAbstraction&) = delete;
+    SPIShiftRegisterIoAbstraction& operator=(const SPIShiftRegisterIoAbstraction&) = delete;
+
+    void initDevice() {
+        spiBus.init();
+        if(readLoadPin != IO_PIN_NOT_DEFINED) {
+            internalDigitalDevice().pinMode(readLoadPin, OUTPUT);
+            internalDigitalDevice().digitalWrite(readLoadPin, HIGH);
+        }
+        needsInit = false;
+    }
+
+    /** pin direction is fixed by the pin number, inputs below 32, outputs 32 onwards */
+    void pinDirection(pinid_t /*pin*/, uint8_t /*mode*/) override { }
+
+    void writeValue(pinid_t pin, uint8_t value) override {
+        if(pin < SHIFT_REGISTER_OUTPUT_CUTOVER) return;
+        pinsToShiftBuffer(writeBuffer, numOfDevicesWrite, pin - SHIFT_REGISTER_OUTPUT_CUTOVER, 1, value ? 1 : 0);
+        needsWrite = true;
+    }
+
+    uint8_t readValue(pinid_t pin) override {
+        if(pin >= SHIFT_REGISTER_OUTPUT_CUTOVER) return LOW;
+        return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, pin, 1) ? HIGH : LOW;
+    }
+
+    /** interrupts are not supported on shift registers */
+    void attachInterrupt(pinid_t, RawIntHandler, uint8_t) override { }
+
+    /**
+     * Shifts the outputs out and the inputs in with a single SPI transfer. When there are no inputs and no output
+     * changes since the last sync, nothing is transferred.
+     */
+    bool runLoop() override {
+        if(needsInit) initDevice();
+        if(numOfDevicesRead == 0 && !needsWrite) return true;
+
+        // the transfer is as long as the longest chain. Output bytes go at the end so they are the ones left in the
+        // 74HC595 chain, the first output byte ends up in the furthest device as with the bit banged version.
+        uint8_t transferLen = internal_max(numOfDevicesRead, numOfDevicesWrite);
+        uint8_t padding = transferLen - numOfDevicesWrite;
+        for(uint8_t i = 0; i < padding; i++) transferBuffer[i] = 0;
+        for(uint8_t i = 0; i < numOfDevicesWrite; i++) transferBuffer[padding + i] = writeBuffer[i];
+
+        if(numOfDevicesRead != 0) {
+            // pulse load so the 74HC165 chain captures its inputs, the first bit is then ready before the first clock.
+            internalDigitalDevice().digitalWrite(readLoadPin, LOW);
+            internalDigitalDevice().digitalWrite(readLoadPin, HIGH);
+        }
+
+        if(!spiBus.transferSPI(transferBuffer, transferLen)) return false;
+        needsWrite = false;
+
+        // the inputs arrive first, the first byte is from the furthest device, which holds the highest pins.
+        for(uint8_t i = 0; i < numOfDevicesRead; i++) {
+            readBuffer[numOfDevicesRead - 1 - i] = transferBuffer[i];
+        }
+        return true;
+    }
+
+    void writePort(pinid_t pin, uint8_t portVal) override {
+        if(pin < SHIFT_REGISTER_OUTPUT_CUTOVER) return;
+        pinsToShiftBuffer(writeBuffer, numOfDevicesWrite, (pin - SHIFT_REGISTER_OUTPUT_CUTOVER) & ~0x07U, 0xff, portVal);
+        needsWrite = true;
+    }
+
+    uint8_t readPort(pinid_t pin) override {
+        if(pin >= SHIFT_REGISTER_OUTPUT_CUTOVER) return 0;
+        return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, pin & ~0x07U, 0xff);
+    }
+
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override {
+        if(firstPin >= SHIFT_REGISTER_OUTPUT_CUTOVER) return 0;
+        return pinsFromShiftBuffer(readBuffer, numOfDevicesRead, firstPin, mask);
+    }
+
+    void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override {
+        // line the mask up with the output register, any pins below the cutover are inputs and are dropped.
+        if(firstPin < SHIFT_REGISTER_OUTPUT_CUTOVER) {
+            uint8_t inputPins = SHIFT_REGISTER_OUTPUT_CUTOVER - firstPin;
+            if(inputPins >= IO_PIN_MASK_BITS) return;
+            mask >>= inputPins;
+            values >>= inputPins;
+            firstPin = SHIFT_REGISTER_OUTPUT_CUTOVER;
+        }
+        if(mask == 0) return;
+
+        pinsToShiftBuffer(writeBuffer, numOfDevicesWrite, firstPin - SHIFT_REGISTER_OUTPUT_CUTOVER, mask, values);
+        needsWrite = true;
+    }
+};
+
+#endif //IOABSTRACTION_SPISHIFTREGISTERIOABSTRACTION_H
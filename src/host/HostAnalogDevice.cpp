@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include "HostAnalogDevice.h"
+
+#if defined(BUILD_FOR_HOST)
+
+HostAnalogDevice analogDeviceInstance;
+
+AnalogDevice* internalAnalogIo() {
+    return &analogDeviceInstance;
+}
+
+HostAnalogDevice& internalAnalogDevice() {
+    return analogDeviceInstance;
+}
+
+void HostAnalogDevice::reset() {
+    for(int i = 0; i < HOST_PIN_COUNT; i++) {
+        values[i] = 0;
+        directions[i] = 0;
+    }
+}
+
+void HostAnalogDevice::setInputValue(pinid_t pin, unsigned int newValue) {
+    if(newValue > HOST_ANALOG_MAX_VAL) newValue = HOST_ANALOG_MAX_VAL;
+    values[pin] = newValue;
+}
+
+#endif // BUILD_FOR_HOST
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_HOST_ANALOG_DEVICE_H
+#define IOA_HOST_ANALOG_DEVICE_H
+
+#if defined(BUILD_FOR_HOST)
+
+#include "../AnalogDeviceAbstraction.h"
+
+#define HOST_ANALOG_RANGE (1 << IOA_ANALOGIN_RES)
+#define HOST_ANALOG_MAX_VAL (HOST_ANALOG_RANGE - 1)
+
+/**
+ * The analog device on host is simulated in memory, tests set the value that each input pin will read using
+ * setInputValue, and can check the value written to output or PWM pins with getCurrentValue. The value returned by
+ * getCurrentValue is always the value on the pin, regardless of direction.
+ */
+class HostAnalogDevice : public AnalogDevice {
+private:
+    uint16_t values[HOST_PIN_COUNT];
+    uint8_t directions[HOST_PIN_COUNT];
+public:
+    HostAnalogDevice() { reset(); }
+
+    /**
+     * Put all analog pins back to zero and uninitialised.
+     */
+    void reset();
+
+    /**
+     * Set the value that will be read from an input pin, it is limited to the maximum range.
+     * @param pin the pin to set
+     * @param newValue the raw value between 0 and the maximum range
+     */
+    void setInputValue(pinid_t pin, unsigned int newValue);
+
+    /**
+     * Set the value that will be read from an input pin as a float between 0 and 1.
+     * @param pin the pin to set
+     * @param newValue the value between 0 and 1
+     */
+    void setInputFloat(pinid_t pin, float newValue) { setInputValue(pin, (unsigned int)(newValue * float(HOST_ANALOG_MAX_VAL))); }
+
+    /**
+     * @param pin the pin to check
+     * @return true if the pin has been initialised in the given direction
+     */
+    bool isInitialisedAs(pinid_t pin, AnalogDirection direction) const { return directions[pin] == (uint8_t)(direction + 1); }
+
+    void initPin(pinid_t pin, AnalogDirection direction) override { directions[pin] = direction + 1; }
+
+    int getMaximumRange(AnalogDirection direction, pinid_t pin) override { return HOST_ANALOG_RANGE; }
+
+    int getBitDepth(AnalogDirection direction, pinid_t pin) override { return IOA_ANALOGIN_RES; }
+
+    unsigned int getCurrentValue(pinid_t pin) override { return values[pin]; }
+
+    float getCurrentFloat(pinid_t pin) override { return float(values[pin]) / float(HOST_ANALOG_MAX_VAL); }
+
+    void setCurrentValue(pinid_t pin, unsigned int newValue) override { setInputValue(pin, newValue); }
+
+    void setCurrentFloat(pinid_t pin, float newValue) override { setInputFloat(pin, newValue); }
+};
+
+HostAnalogDevice& internalAnalogDevice();
+
+#endif // BUILD_FOR_HOST
+#endif //IOA_HOST_ANALOG_DEVICE_H
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include "HostDigitalIO.h"
+#include "IoAbstraction.h"
+
+#ifdef BUILD_FOR_HOST
+
+HostPinSimulation pinSimulation;
+
+HostPinSimulation& hostPinSimulation() {
+    return pinSimulation;
+}
+
+void HostPinSimulation::reset() {
+    for(int i = 0; i < HOST_PIN_COUNT; i++) {
+        modes[i] = HOST_PIN_UNCONFIGURED;
+        levels[i] = LOW;
+        interruptModes[i] = 0;
+        interruptHandlers[i] = nullptr;
+    }
+    pinWrites = pinReads = 0;
+    listener = nullptr;
+}
+
+void HostPinSimulation::pinMode(pinid_t pin, uint8_t mode) {
+    modes[pin] = mode;
+    // an unconnected input with a pull up reads high, just like on a real device.
+    if(mode == INPUT_PULLUP) levels[pin] = HIGH;
+}
+
+void HostPinSimulation::setInputLevel(pinid_t pin, bool level) {
+    uint8_t oldLevel = levels[pin];
+    levels[pin] = level;
+    if(interruptHandlers[pin] == nullptr || oldLevel == (uint8_t)level) return;
+
+    uint8_t mode = interruptModes[pin];
+    if(mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) {
+        interruptHandlers[pin]();
+    }
+}
+
+void HostPinSimulation::attachInterrupt(pinid_t pin, RawIntHandler handler, uint8_t mode) {
+    interruptHandlers[pin] = handler;
+    interruptModes[pin] = mode;
+}
+
+void BasicIoAbstraction::pinDirection(pinid_t pin, uint8_t mode) {
+    pinSimulation.pinMode(pin, mode);
+}
+
+void BasicIoAbstraction::writeValue(pinid_t pin, uint8_t value) {
+    pinSimulation.writeLevel(pin, value != 0);
+}
+
+uint8_t BasicIoAbstraction::readValue(pinid_t pin) {
+    return pinSimulation.readLevel(pin);
+}
+
+void BasicIoAbstraction::attachInterrupt(pinid_t pin, RawIntHandler interruptHandler, uint8_t mode) {
+    pinSimulation.attachInterrupt(pin, interruptHandler, mode);
+}
+
+void BasicIoAbstraction::writePort(pinid_t port, uint8_t portVal) {
+    // on host every 8 pins are treated as a port
+    pinid_t firstPin = port & 0xf8;
+    for(int i = 0; i < 8; i++) {
+        pinSimulation.writeLevel(firstPin + i, (portVal >> i) & 0x01);
+    }
+}
+
+uint8_t BasicIoAbstraction::readPort(pinid_t port) {
+    pinid_t firstPin = port & 0xf8;
+    uint8_t portVal = 0;
+    for(int i = 0; i < 8; i++) {
+        if(pinSimulation.readLevel(firstPin + i)) portVal |= (1U << i);
+    }
+    return portVal;
+}
+
+BasicIoAbstraction internalIoAbstraction;
+
+IoAbstractionRef internalDigitalIo() {
+    return &internalIoAbstraction;
+}
+
+#ifndef IOA_HOST_EXTERNAL_CLOCK
+
+unsigned long simulatedMicros = 0;
+unsigned long microsAutoAdvance = 1;
+
+unsigned long micros() {
+    simulatedMicros += microsAutoAdvance;
+    return simulatedMicros;
+}
+
+unsigned long millis() {
+    return micros() / 1000UL;
+}
+
+void hostAdvanceMicros(unsigned long amount) {
+    simulatedMicros += amount;
+}
+
+void hostSetMicros(unsigned long newMicros) {
+    simulatedMicros = newMicros;
+}
+
+void hostSetMicrosAutoAdvance(unsigned long perRead) {
+    microsAutoAdvance = perRead;
+}
+
+#endif // IOA_HOST_EXTERNAL_CLOCK
+
+#endif // BUILD_FOR_HOST
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_HOST_DIGITAL_IO_H
+#define IOA_HOST_DIGITAL_IO_H
+
+/**
+ * @file HostDigitalIO.h
+ * @brief The host platform simulates device pins and the clock in memory, so that code using IoAbstraction can be
+ * tested and benchmarked on a desktop machine. Tests drive the simulation using hostPinSimulation() and the clock
+ * functions below.
+ */
+
+#ifdef BUILD_FOR_HOST
+
+#include <stdint.h>
+#include <TaskManagerIO.h>
+
+#define INPUT 0x01
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0xff
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define PROGMEM
+#define HIGH 1
+#define LOW 0
+
+#define bitRead(value, bit) (((value) & (1 << (bit))) != 0)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) (bitvalue ? bitSet(value, bit) : bitClear(value, bit))
+
+#define HOST_PIN_COUNT 256
+#define HOST_PIN_UNCONFIGURED 0
+
+/**
+ * A simulated part that is wired to pins, such as a shift register chain, can listen to the pins so that it can react
+ * to the board writing them and provide the level of a pin just before the board reads it.
+ */
+class HostPinListener {
+public:
+    virtual ~HostPinListener() = default;
+    /**
+     * Called after a pin is written through BasicIoAbstraction
+     * @param pin the pin that was written
+     * @param level the new level
+     */
+    virtual void pinWritten(pinid_t pin, bool level) = 0;
+    /**
+     * Called before a pin is read through BasicIoAbstraction, the listener may change the level using setInputLevel.
+     * @param pin the pin about to be read
+     */
+    virtual void pinRead(pinid_t pin) = 0;
+};
+
+/**
+ * Holds the simulated state of every pin on the host. The BasicIoAbstraction functions read and write this state,
+ * and tests use it to set input levels and check what was written to outputs. Setting an input level will call
+ * any interrupt handler attached to that pin directly, as it would be called from an ISR on a device.
+ */
+class HostPinSimulation {
+private:
+    uint8_t modes[HOST_PIN_COUNT];
+    uint8_t levels[HOST_PIN_COUNT];
+    uint8_t interruptModes[HOST_PIN_COUNT];
+    RawIntHandler interruptHandlers[HOST_PIN_COUNT];
+    uint32_t pinWrites;
+    uint32_t pinReads;
+    HostPinListener* listener;
+public:
+    HostPinSimulation() { reset(); }
+
+    /**
+     * Put every pin back to its unconfigured, low, state and remove any interrupt handlers.
+     */
+    void reset();
+
+    /**
+     * Set the level that will be read from a pin, if the pin has an interrupt attached and the change matches
+     * the interrupt mode, the handler is called before returning.
+     * @param pin the pin to change
+     * @param level the new level
+     */
+    void setInputLevel(pinid_t pin, bool level);
+
+    /**
+     * @param pin the pin to check
+     * @return the level on the pin, for outputs this is the last value written
+     */
+    bool getLevel(pinid_t pin) const { return levels[pin] != 0; }
+
+    /**
+     * @param pin the pin to check
+     * @return the mode the pin was last set to, or HOST_PIN_UNCONFIGURED
+     */
+    uint8_t getPinMode(pinid_t pin) const { return modes[pin]; }
+
+    /**
+     * @param pin the pin to check
+     * @return true if an interrupt handler is attached to the pin
+     */
+    bool isInterruptAttached(pinid_t pin) const { return interruptHandlers[pin] != nullptr; }
+
+    /**
+     * Set a listener that is told about every pin read and write, there is one listener at a time and reset removes it.
+     * @param pinListener the listener, or nullptr to remove it
+     */
+    void setPinListener(HostPinListener* pinListener) { listener = pinListener; }
+
+    /** @return the number of pin writes made through BasicIoAbstraction since the last reset */
+    uint32_t getPinWriteCount() const { return pinWrites; }
+
+    /** @return the number of pin reads made through BasicIoAbstraction since the last reset */
+    uint32_t getPinReadCount() const { return pinReads; }
+
+    // the functions below are used by BasicIoAbstraction on host, tests should not normally need them.
+    void pinMode(pinid_t pin, uint8_t mode);
+    void writeLevel(pinid_t pin, bool level) {
+        levels[pin] = level;
+        pinWrites++;
+        if(listener) listener->pinWritten(pin, level);
+    }
+    uint8_t readLevel(pinid_t pin) {
+        pinReads++;
+        if(listener) listener->pinRead(pin);
+        return levels[pin];
+    }
+    void attachInterrupt(pinid_t pin, RawIntHandler handler, uint8_t mode);
+};
+
+/**
+ * @return the pin simulation that backs the device pins on host
+ */
+HostPinSimulation& hostPinSimulation();
+
+#ifndef IOA_HOST_EXTERNAL_CLOCK
+
+/**
+ * On host, time is simulated and only moves forward when asked to, or by the auto advance amount every time
+ * micros or millis is read. Auto advance defaults to 1 microsecond so that code waiting for time to pass cannot
+ * loop forever. Define IOA_HOST_EXTERNAL_CLOCK if your build already provides micros() and millis().
+ */
+unsigned long micros();
+
+/**
+ * @return the simulated time in milliseconds, see micros()
+ */
+unsigned long millis();
+
+/**
+ * Move the simulated clock forward
+ * @param amount the number of microseconds to move forward by
+ */
+void hostAdvanceMicros(unsigned long amount);
+
+/**
+ * Set the simulated clock to an absolute value, useful for testing what happens when the clock rolls over.
+ * @param newMicros the new time in microseconds
+ */
+void hostSetMicros(unsigned long newMicros);
+
+/**
+ * Set how many microseconds the clock moves forward every time it is read.
+ * @param perRead the amount to move forward on each read, 0 to stop the clock unless advanced manually
+ */
+void hostSetMicrosAutoAdvance(unsigned long perRead);
+
+#endif // IOA_HOST_EXTERNAL_CLOCK
+
+#endif // BUILD_FOR_HOST
+
+#endif //IOA_HOST_DIGITAL_IO_H
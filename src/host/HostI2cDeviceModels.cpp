@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifdef BUILD_FOR_HOST
+
+#include "../PlatformDetermination.h"
+#include "HostDigitalIO.h"
+#include "HostI2cDeviceModels.h"
+
+//
+// Register based devices
+//
+
+HostRegisterDeviceModel::HostRegisterDeviceModel(uint16_t numRegisters) : registers{}, numRegisters(numRegisters), pointer(0) {
+}
+
+bool HostRegisterDeviceModel::i2cWrite(const uint8_t *data, size_t len, bool /*sendStop*/) {
+    // an address only write is a probe, the chip acknowledges it and nothing changes.
+    if(len == 0) return true;
+    pointer = data[0] % numRegisters;
+    for(size_t i = 1; i < len; i++) {
+        writeRegister(pointer, data[i]);
+        pointer = nextRegister(pointer);
+    }
+    return true;
+}
+
+bool HostRegisterDeviceModel::i2cRead(uint8_t *buffer, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        buffer[i] = readRegister(pointer);
+        pointer = nextRegister(pointer);
+    }
+    return true;
+}
+
+//
+// PCF8574 and PCF8575
+//
+
+bool HostPcf8574Model::i2cWrite(const uint8_t *data, size_t len, bool /*sendStop*/) {
+    // when more bytes are sent than there are ports, the chip keeps updating the ports in turn.
+    for(size_t i = 0; i < len; i++) {
+        if(sixteenBit && (i % 2) == 1) {
+            latch = (latch & 0x00ffU) | (data[i] << 8U);
+        } else {
+            latch = (latch & 0xff00U) | data[i];
+        }
+    }
+    // a write resets the interrupt, and the chip does not raise one for changes to its own outputs.
+    setInterruptActive(false);
+    lastLevels = getLevels();
+    return true;
+}
+
+bool HostPcf8574Model::i2cRead(uint8_t *buffer, size_t len) {
+    uint16_t levels = getLevels();
+    for(size_t i = 0; i < len; i++) {
+        buffer[i] = (sixteenBit && (i % 2) == 1) ? (levels >> 8U) : (levels & 0xffU);
+    }
+    setInterruptActive(false);
+    lastLevels = levels;
+    return true;
+}
+
+void HostPcf8574Model::setInput(uint8_t pin, bool level) {
+    bitWrite(inputs, pin, level);
+    checkForChange();
+}
+
+void HostPcf8574Model::checkForChange() {
+    uint16_t levels = getLevels();
+    if(levels != lastLevels) setInterruptActive(true);
+    lastLevels = levels;
+}
+
+void HostPcf8574Model::setInterruptPin(uint8_t pin) {
+    interruptPin = pin;
+    if(interruptPin != 0xff) hostPinSimulation().setInputLevel(interruptPin, !interruptActive);
+}
+
+void HostPcf8574Model::setInterruptActive(bool active) {
+    if(active == interruptActive) return;
+    interruptActive = active;
+    if(interruptPin != 0xff) hostPinSimulation().setInputLevel(interruptPin, !active);
+}
+
+//
+// MCP23017 in BANK 0 mode
+//
+
+#define MCP_MODEL_IODIR 0x00
+#define MCP_MODEL_IPOL 0x02
+#define MCP_MODEL_GPINTEN 0x04
+#define MCP_MODEL_DEFVAL 0x06
+#define MCP_MODEL_INTCON 0x08
+#define MCP_MODEL_IOCON 0x0A
+#define MCP_MODEL_INTF 0x0E
+#define MCP_MODEL_INTCAP 0x10
+#define MCP_MODEL_GPIO 0x12
+#define MCP_MODEL_OLAT 0x14
+#define MCP_MODEL_REGISTERS 0x16
+#define MCP_MODEL_IOCON_MIRROR 6
+#define MCP_MODEL_IOCON_SEQOP 5
+
+HostMcp23017Model::HostMcp23017Model() : HostRegisterDeviceModel(MCP_MODEL_REGISTERS) {
+    reset();
+}
+
+void HostMcp23017Model::reset() {
+    for(auto& reg : registers) reg = 0;
+    registers[MCP_MODEL_IODIR] = 0xff;
+    registers[MCP_MODEL_IODIR + 1] = 0xff;
+    pointer = 0;
+}
+
+uint16_t HostMcp23017Model::getLevels() {
+    uint16_t direction = getDirection();
+    return (inputs & direction) | (getLatch() & ~direction);
+}
+
+void HostMcp23017Model::setInput(uint8_t pin, bool level) {
+    uint16_t previous = getLevels();
+    bitWrite(inputs, pin, level);
+    checkInterrupts(previous);
+}
+
+bool HostMcp23017Model::isInterruptActive(uint8_t port) {
+    if(bitRead(registers[MCP_MODEL_IOCON], MCP_MODEL_IOCON_MIRROR)) {
+        return registers[MCP_MODEL_INTF] != 0 || registers[MCP_MODEL_INTF + 1] != 0;
+    }
+    return registers[MCP_MODEL_INTF + (port & 1U)] != 0;
+}
+
+uint8_t HostMcp23017Model::portValue(uint8_t port) {
+    // the polarity register only inverts inputs, outputs always read back as they are.
+    uint8_t levels = getLevels() >> (port * 8U);
+    return levels ^ (registers[MCP_MODEL_IPOL + port] & registers[MCP_MODEL_IODIR + port]);
+}
+
+void HostMcp23017Model::checkInterrupts(uint16_t previousLevels) {
+    uint16_t levels = getLevels();
+    for(uint8_t port = 0; port < 2; port++) {
+        // the capture is held until the port interrupt is cleared, so later changes are not recorded.
+        if(registers[MCP_MODEL_INTF + port] != 0) continue;
+
+        uint8_t current = levels >> (port * 8U);
+        uint8_t previous = previousLevels >> (port * 8U);
+        uint8_t intCon = registers[MCP_MODEL_INTCON + port];
+        uint8_t enabled = registers[MCP_MODEL_GPINTEN + port] & registers[MCP_MODEL_IODIR + port];
+        uint8_t fired = ((intCon & (current ^ registers[MCP_MODEL_DEFVAL + port])) | (~intCon & (current ^ previous))) & enabled;
+        if(fired) {
+            registers[MCP_MODEL_INTF + port] = fired;
+            registers[MCP_MODEL_INTCAP + port] = portValue(port);
+        }
+    }
+}
+
+uint8_t HostMcp23017Model::readRegister(uint8_t reg) {
+    if(reg == MCP_MODEL_GPIO || reg == MCP_MODEL_GPIO + 1 || reg == MCP_MODEL_INTCAP || reg == MCP_MODEL_INTCAP + 1) {
+        uint8_t port = reg & 1U;
+        uint8_t value = (reg >= MCP_MODEL_GPIO) ? portValue(port) : registers[reg];
+        registers[MCP_MODEL_INTF + port] = 0;
+        // with compare to DEFVAL, the interrupt fires again straight away if the pin is still in that state.
+        checkInterrupts(getLevels());
+        return value;
+    }
+    return registers[reg];
+}
+
+void HostMcp23017Model::writeRegister(uint8_t reg, uint8_t value) {
+    uint16_t previous = getLevels();
+    if(reg == MCP_MODEL_IOCON || reg == MCP_MODEL_IOCON + 1) {
+        // IOCON is one register at two addresses
+        registers[MCP_MODEL_IOCON] = registers[MCP_MODEL_IOCON + 1] = value;
+    } else if(reg == MCP_MODEL_GPIO || reg == MCP_MODEL_GPIO + 1) {
+        registers[reg + 2] = value;
+    } else if(reg < MCP_MODEL_INTF || reg >= MCP_MODEL_OLAT) {
+        // INTF and INTCAP are read only
+        registers[reg] = value;
+    }
+    checkInterrupts(previous);
+}
+
+uint8_t HostMcp23017Model::nextRegister(uint8_t reg) {
+    if(bitRead(registers[MCP_MODEL_IOCON], MCP_MODEL_IOCON_SEQOP)) return reg ^ 1U;
+    return (reg + 1U) % MCP_MODEL_REGISTERS;
+}
+
+//
+// AW9523
+//
+
+#define AW_MODEL_INPUT 0x00
+#define AW_MODEL_OUTPUT 0x02
+#define AW_MODEL_DIRECTION 0x04
+#define AW_MODEL_INTERRUPT 0x06
+#define AW_MODEL_ID 0x10
+#define AW_MODEL_ID_VALUE 0x23
+#define AW_MODEL_LED_MODE 0x12
+#define AW_MODEL_RESET 0x7F
+#define AW_MODEL_REGISTERS 0x80
+
+HostAw9523Model::HostAw9523Model() : HostRegisterDeviceModel(AW_MODEL_REGISTERS) {
+    reset();
+}
+
+void HostAw9523Model::reset() {
+    for(auto& reg : registers) reg = 0;
+    registers[AW_MODEL_ID] = AW_MODEL_ID_VALUE;
+    registers[AW_MODEL_LED_MODE] = 0xff;
+    registers[AW_MODEL_LED_MODE + 1] = 0xff;
+    lastInputRead = getLevels();
+    interruptActive = false;
+}
+
+uint16_t HostAw9523Model::getLevels() const {
+    uint16_t direction = getDirection();
+    uint16_t outputs = registers[AW_MODEL_OUTPUT] | (registers[AW_MODEL_OUTPUT + 1] << 8U);
+    return (inputs & direction) | (outputs & ~direction);
+}
+
+void HostAw9523Model::setInput(uint8_t pin, bool level) {
+    bitWrite(inputs, pin, level);
+    // an interrupt control bit of 0 enables the interrupt on that pin
+    uint16_t enabled = getDirection() & ~(registers[AW_MODEL_INTERRUPT] | (registers[AW_MODEL_INTERRUPT + 1] << 8U));
+    if((getLevels() ^ lastInputRead) & enabled) interruptActive = true;
+}
+
+uint8_t HostAw9523Model::readRegister(uint8_t reg) {
+    if(reg == AW_MODEL_INPUT || reg == AW_MODEL_INPUT + 1) {
+        uint16_t levels = getLevels();
+        uint16_t portMask = (reg == AW_MODEL_INPUT) ? 0x00ffU : 0xff00U;
+        lastInputRead = (lastInputRead & ~portMask) | (levels & portMask);
+        interruptActive = false;
+        return (reg == AW_MODEL_INPUT) ? levels : (levels >> 8U);
+    }
+    if(reg == AW_MODEL_RESET) return 0;
+    return registers[reg];
+}
+
+void HostAw9523Model::writeRegister(uint8_t reg, uint8_t value) {
+    if(reg == AW_MODEL_RESET) {
+        if(value == 0) reset();
+    } else if(reg != AW_MODEL_INPUT && reg != AW_MODEL_INPUT + 1 && reg != AW_MODEL_ID) {
+        registers[reg] = value;
+    }
+}
+
+//
+// MPR121
+//
+
+#define MPR_MODEL_TOUCH_STATUS 0x00
+#define MPR_MODEL_AFE_CONFIG_1 0x5C
+#define MPR_MODEL_AFE_CONFIG_2 0x5D
+#define MPR_MODEL_GPIO_DATA 0x75
+#define MPR_MODEL_GPIO_DIRECTION 0x76
+#define MPR_MODEL_GPIO_ENABLE 0x77
+#define MPR_MODEL_GPIO_SET 0x78
+#define MPR_MODEL_GPIO_CLEAR 0x79
+#define MPR_MODEL_GPIO_TOGGLE 0x7A
+#define MPR_MODEL_SOFT_RESET 0x80
+#define MPR_MODEL_SOFT_RESET_VALUE 0x63
+#define MPR_MODEL_REGISTERS 0x81
+
+HostMpr121Model::HostMpr121Model() : HostRegisterDeviceModel(MPR_MODEL_REGISTERS) {
+    reset();
+}
+
+void HostMpr121Model::reset() {
+    for(auto& reg : registers) reg = 0;
+    registers[MPR_MODEL_AFE_CONFIG_1] = 0x10;
+    registers[MPR_MODEL_AFE_CONFIG_2] = 0x24;
+}
+
+void HostMpr121Model::setTouched(uint16_t touched) {
+    registers[MPR_MODEL_TOUCH_STATUS] = touched & 0xffU;
+    registers[MPR_MODEL_TOUCH_STATUS + 1] = (touched >> 8U) & 0x1fU;
+}
+
+void HostMpr121Model::setGpioInput(uint8_t gpio, bool level) {
+    bitWrite(gpioInputs, gpio, level);
+}
+
+uint8_t HostMpr121Model::readRegister(uint8_t reg) {
+    if(reg == MPR_MODEL_GPIO_DATA) {
+        // enabled pins with direction 0 are inputs, everything else reads back the data register
+        uint8_t inputPins = registers[MPR_MODEL_GPIO_ENABLE] & ~registers[MPR_MODEL_GPIO_DIRECTION];
+        return (gpioInputs & inputPins) | (registers[MPR_MODEL_GPIO_DATA] & ~inputPins);
+    }
+    if(reg >= MPR_MODEL_GPIO_SET && reg <= MPR_MODEL_GPIO_TOGGLE) return 0;
+    return registers[reg];
+}
+
+void HostMpr121Model::writeRegister(uint8_t reg, uint8_t value) {
+    switch(reg) {
+        case MPR_MODEL_TOUCH_STATUS:
+        case MPR_MODEL_TOUCH_STATUS + 1:
+            break;
+        case MPR_MODEL_GPIO_SET:
+            registers[MPR_MODEL_GPIO_DATA] |= value;
+            break;
+        case MPR_MODEL_GPIO_CLEAR:
+            registers[MPR_MODEL_GPIO_DATA] &= ~value;
+            break;
+        case MPR_MODEL_GPIO_TOGGLE:
+            registers[MPR_MODEL_GPIO_DATA] ^= value;
+            break;
+        case MPR_MODEL_SOFT_RESET:
+            if(value == MPR_MODEL_SOFT_RESET_VALUE) reset();
+            break;
+        default:
+            registers[reg] = value;
+            break;
+    }
+}
+
+//
+// AT24Cxx EEPROM
+//
+
+HostAt24Model::HostAt24Model(uint32_t size, uint16_t pageSize, uint32_t writeCycle)
+        : memorySize(size), writeCycleMicros(writeCycle), pageSize(pageSize) {
+    memory = new uint8_t[memorySize];
+    memset(memory, 0xff, memorySize);
+    for(uint8_t i = 0; i < HOST_AT24_MAX_BLOCKS; i++) {
+        blocks[i].model = this;
+        blocks[i].block = i;
+    }
+}
+
+HostAt24Model::~HostAt24Model() {
+    delete[] memory;
+}
+
+void HostAt24Model::attach(HostI2cBus &bus, uint8_t address) {
+    uint32_t blockSize = addressBytesTwo() ? 0x10000UL : 256U;
+    uint32_t numBlocks = (memorySize + blockSize - 1U) / blockSize;
+    if(numBlocks > HOST_AT24_MAX_BLOCKS) numBlocks = HOST_AT24_MAX_BLOCKS;
+    for(uint8_t i = 0; i < numBlocks; i++) {
+        bus.attachDevice(address + i, &blocks[i]);
+    }
+}
+
+bool HostAt24Model::isBusy() {
+    if(busy && (micros() - writeStarted) >= writeCycleMicros) busy = false;
+    return busy;
+}
+
+bool HostAt24Model::write(uint8_t block, const uint8_t *data, size_t len) {
+    // during the write cycle the chip does not acknowledge its address at all.
+    if(isBusy()) return false;
+
+    size_t addressBytes = addressBytesTwo() ? 2 : 1;
+    if(len < addressBytes) return true;
+
+    if(addressBytesTwo()) {
+        pointer = (uint32_t(block) << 16U) | (uint32_t(data[0]) << 8U) | data[1];
+    } else {
+        pointer = (uint32_t(block) << 8U) | data[0];
+    }
+    pointer %= memorySize;
+
+    // the chip only latches the low address bits within the page, so writing past the page end wraps to its start.
+    size_t dataLen = len - addressBytes;
+    if(dataLen == 0) return true;
+    uint32_t pageStart = pointer - (pointer % pageSize);
+    uint32_t offset = pointer % pageSize;
+    for(size_t i = 0; i < dataLen; i++) {
+        memory[pageStart + offset] = data[addressBytes + i];
+        offset = (offset + 1) % pageSize;
+    }
+    pointer = pageStart + offset;
+
+    busy = true;
+    writeStarted = micros();
+    writeCycles++;
+    return true;
+}
+
+bool HostAt24Model::read(uint8_t *buffer, size_t len) {
+    if(isBusy()) return false;
+    for(size_t i = 0; i < len; i++) {
+        buffer[i] = memory[pointer];
+        pointer = (pointer + 1) % memorySize;
+    }
+    return true;
+}
+
+bool HostAt24Model::Block::i2cWrite(const uint8_t *data, size_t len, bool /*sendStop*/) {
+    return model->write(block, data, len);
+}
+
+bool HostAt24Model::Block::i2cRead(uint8_t *buffer, size_t len) {
+    return model->read(buffer, len);
+}
+
+#endif // BUILD_FOR_HOST
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_HOST_I2C_DEVICE_MODELS_H
+#define IOA_HOST_I2C_DEVICE_MODELS_H
+
+/**
+ * @file HostI2cDeviceModels.h
+ * @brief Software models of the I2C chips that this library drives, for attaching to the host I2C bus. They model
+ * the register map, auto increment and the pin behaviour of each chip closely enough that the real device classes in
+ * IoAbstractionWire and EepromAbstractionWire can be tested against them, and together with the bus counts in
+ * HostI2cBus, the exact bus cost of each operation can be checked.
+ *
+ * Input levels are set by the test using the setInput style functions on each model, they are the level that is
+ * being applied to the pin from outside the chip.
+ */
+
+#include "HostWireBus.h"
+
+#define HOST_MODEL_MAX_REGISTERS 256
+
+/**
+ * The base for chips that have a register pointer, the first byte of a write sets the pointer, and any further bytes
+ * are written to registers from there, incrementing the pointer after each one. Reads carry on from the pointer in
+ * the same way. Extend and override readRegister, writeRegister and nextRegister for chip specific behaviour.
+ */
+class HostRegisterDeviceModel : public HostI2cDevice {
+protected:
+    uint8_t registers[HOST_MODEL_MAX_REGISTERS];
+    uint16_t numRegisters;
+    uint8_t pointer;
+public:
+    /**
+     * @param numRegisters the number of registers, the pointer wraps back to 0 after the last one
+     */
+    explicit HostRegisterDeviceModel(uint16_t numRegisters);
+
+    bool i2cWrite(const uint8_t* data, size_t len, bool sendStop) override;
+    bool i2cRead(uint8_t* buffer, size_t len) override;
+
+    /**
+     * Get a register value directly without any of the side effects that a read over the bus would have
+     * @param reg the register number
+     * @return the stored value of the register
+     */
+    uint8_t getRegister(uint8_t reg) const { return registers[reg]; }
+
+    /**
+     * Set a register value directly without any of the side effects that a write over the bus would have
+     * @param reg the register number
+     * @param value the new value
+     */
+    void setRegister(uint8_t reg, uint8_t value) { registers[reg] = value; }
+
+    /** @return the current register pointer */
+    uint8_t getPointer() const { return pointer; }
+protected:
+    /** called for each register read over the bus, by default returns the stored value */
+    virtual uint8_t readRegister(uint8_t reg) { return registers[reg]; }
+    /** called for each register written over the bus, by default stores the value */
+    virtual void writeRegister(uint8_t reg, uint8_t value) { registers[reg] = value; }
+    /** @return the register after reg, by default the next one, wrapping at the end of the map */
+    virtual uint8_t nextRegister(uint8_t reg) { return (reg + 1U) % numRegisters; }
+};
+
+/**
+ * A model of the PCF8574 and PCF8575, they have no registers, a write sets the output latches and a read returns the
+ * pin levels. The pins are quasi bidirectional, a latch that is high is weakly pulled up and can be pulled low from
+ * outside, so the pin level is the latch and the input level together. The interrupt output is active when any pin
+ * level changes, and is cleared by the next read or write.
+ */
+class HostPcf8574Model : public HostI2cDevice {
+private:
+    uint16_t latch = 0xffff;
+    uint16_t inputs = 0xffff;
+    uint16_t lastLevels = 0xffff;
+    uint8_t interruptPin = 0xff;
+    bool sixteenBit;
+    bool interruptActive = false;
+public:
+    /**
+     * @param pcf8575 true to model the 16 bit PCF8575, otherwise the 8 bit PCF8574
+     */
+    explicit HostPcf8574Model(bool pcf8575 = false) : sixteenBit(pcf8575) {}
+
+    bool i2cWrite(const uint8_t* data, size_t len, bool sendStop) override;
+    bool i2cRead(uint8_t* buffer, size_t len) override;
+
+    /**
+     * Set the level being applied to a pin from outside, high is the same as the pin being left floating.
+     * @param pin the pin number 0..7 or 0..15
+     * @param level the level applied
+     */
+    void setInput(uint8_t pin, bool level);
+
+    /** @return the output latches, as last written over the bus */
+    uint16_t getLatch() const { return latch; }
+
+    /** @return the level on each pin, the latch and input levels together */
+    uint16_t getLevels() const { return latch & inputs; }
+
+    /** @return true if the interrupt output is active (low on the real chip) */
+    bool isInterruptActive() const { return interruptActive; }
+
+    /**
+     * Connect the interrupt output to a simulated host pin, which is then held low while the interrupt is active,
+     * calling any interrupt handler attached to that pin.
+     * @param pin the host pin, or 0xff to disconnect it
+     */
+    void setInterruptPin(uint8_t pin);
+private:
+    void checkForChange();
+    void setInterruptActive(bool active);
+};
+
+/**
+ * A model of the MCP23017 with IOCON.BANK = 0, which is the only mode the library uses. It models direction,
+ * polarity, pull ups, the output latch, and interrupt on change with the INTF and INTCAP registers. Sequential
+ * operation is modelled, when IOCON.SEQOP is set the pointer toggles within each A/B register pair. Reading GPIO or
+ * INTCAP for a port clears the interrupt on that port.
+ */
+class HostMcp23017Model : public HostRegisterDeviceModel {
+private:
+    uint16_t inputs = 0xffff;
+public:
+    HostMcp23017Model();
+
+    /** put all the registers back to their power on values */
+    void reset();
+
+    /**
+     * Set the level being applied to a pin from outside, this only affects pins that are inputs, and may raise an
+     * interrupt depending on the interrupt registers.
+     * @param pin the pin 0..15, where 8 onwards are port B
+     * @param level the level applied
+     */
+    void setInput(uint8_t pin, bool level);
+
+    /** @return the level on each pin, outputs take the latch value, inputs the level applied to them */
+    uint16_t getLevels();
+
+    /** @return the output latches, the OLAT registers */
+    uint16_t getLatch() const { return registers[0x14] | (registers[0x15] << 8U); }
+
+    /** @return the direction registers, where 1 is an input */
+    uint16_t getDirection() const { return registers[0x00] | (registers[0x01] << 8U); }
+
+    /** @return the pull up registers */
+    uint16_t getPullUps() const { return registers[0x0C] | (registers[0x0D] << 8U); }
+
+    /**
+     * @param port 0 for INTA, 1 for INTB, with IOCON.MIRROR set both report either port.
+     * @return true if the interrupt output for that port is active
+     */
+    bool isInterruptActive(uint8_t port);
+protected:
+    uint8_t readRegister(uint8_t reg) override;
+    void writeRegister(uint8_t reg, uint8_t value) override;
+    uint8_t nextRegister(uint8_t reg) override;
+private:
+    uint8_t portValue(uint8_t port);
+    void checkInterrupts(uint16_t previousLevels);
+};
+
+/**
+ * A model of the AW9523, it models direction, the output registers, LED mode, the chip ID, interrupt on change for
+ * inputs and the software reset register. Reading an input port clears the interrupt for that port.
+ */
+class HostAw9523Model : public HostRegisterDeviceModel {
+private:
+    uint16_t inputs = 0xffff;
+    uint16_t lastInputRead = 0xffff;
+    bool interruptActive = false;
+public:
+    HostAw9523Model();
+
+    /** put all the registers back to their power on values */
+    void reset();
+
+    /**
+     * Set the level being applied to a pin from outside, only pins that are inputs are affected.
+     * @param pin the pin 0..15, where 8 onwards are port 1
+     * @param level the level applied
+     */
+    void setInput(uint8_t pin, bool level);
+
+    /** @return the level on each pin, outputs take the output register value */
+    uint16_t getLevels() const;
+
+    /** @return the direction registers, where 1 is an input */
+    uint16_t getDirection() const { return registers[0x04] | (registers[0x05] << 8U); }
+
+    /** @return the LED mode registers, where 0 is LED current mode and 1 is GPIO */
+    uint16_t getLedMode() const { return registers[0x12] | (registers[0x13] << 8U); }
+
+    /** @return true if the interrupt output is active */
+    bool isInterruptActive() const { return interruptActive; }
+protected:
+    uint8_t readRegister(uint8_t reg) override;
+    void writeRegister(uint8_t reg, uint8_t value) override;
+};
+
+/**
+ * A model of the MPR121, it models the touch status registers, set directly by the test, the GPIO registers for the
+ * eight pins that can be used as GPIO, including the set, clear and toggle registers, and the software reset.
+ */
+class HostMpr121Model : public HostRegisterDeviceModel {
+private:
+    uint8_t gpioInputs = 0xff;
+public:
+    HostMpr121Model();
+
+    /** put all the registers back to their power on values */
+    void reset();
+
+    /**
+     * Set the touch status for the electrodes, bit 12 is the proximity electrode
+     * @param touched the touch status bits
+     */
+    void setTouched(uint16_t touched);
+
+    /**
+     * Set the level applied to one of the GPIO pins from outside, GPIO 0 is electrode 4.
+     * @param gpio the GPIO pin 0..7
+     * @param level the level applied
+     */
+    void setGpioInput(uint8_t gpio, bool level);
+
+    /** @return the GPIO data register, the output latch for outputs */
+    uint8_t getGpioData() const { return registers[0x75]; }
+protected:
+    uint8_t readRegister(uint8_t reg) override;
+    void writeRegister(uint8_t reg, uint8_t value) override;
+};
+
+/** the time that the AT24 model takes to program a page, in microseconds */
+#define HOST_AT24_WRITE_CYCLE_MICROS 5000UL
+
+/** an AT24 occupies up to this many I2C addresses, one per 256 byte block, or per 64K block for the largest parts */
+#define HOST_AT24_MAX_BLOCKS 8
+
+/**
+ * A model of the AT24Cxx family of EEPROMs. Parts with a page size over 16 bytes take a two byte memory address,
+ * smaller parts take one byte and use the low bits of the I2C address for the block, so they are attached at more
+ * than one address. Parts over 64K, such as the AT24CM01 and AT24CM02, use the low bits of the I2C address for each
+ * 64K block in the same way. Writes are limited to a page, wrapping around within the page as the real chip does. After a
+ * write with data, the chip is busy for the write cycle time, during which it NACKs everything. Reads carry on
+ * across page boundaries and wrap at the end of the memory. Use attach() rather than attaching to the bus directly.
+ */
+class HostAt24Model {
+private:
+    class Block : public HostI2cDevice {
+    public:
+        HostAt24Model* model = nullptr;
+        uint8_t block = 0;
+        bool i2cWrite(const uint8_t* data, size_t len, bool sendStop) override;
+        bool i2cRead(uint8_t* buffer, size_t len) override;
+        bool i2cReady() override { return !model->isBusy(); }
+    };
+
+    Block blocks[HOST_AT24_MAX_BLOCKS];
+    uint8_t* memory;
+    uint32_t memorySize;
+    uint32_t pointer = 0;
+    uint32_t writeCycleMicros;
+    unsigned long writeStarted = 0;
+    uint32_t writeCycles = 0;
+    uint16_t pageSize;
+    bool busy = false;
+public:
+    /**
+     * @param size the size of the memory in bytes
+     * @param pageSize the size of a page in bytes
+     * @param writeCycle the time it takes to program a page in microseconds
+     */
+    HostAt24Model(uint32_t size, uint16_t pageSize, uint32_t writeCycle = HOST_AT24_WRITE_CYCLE_MICROS);
+    ~HostAt24Model();
+    HostAt24Model(const HostAt24Model&) = delete;
+    HostAt24Model& operator=(const HostAt24Model&) = delete;
+
+    /**
+     * Attach the EEPROM to a bus, for parts with one byte addressing this attaches at each block address.
+     * @param bus the bus to attach to
+     * @param address the base I2C address, normally 0x50
+     */
+    void attach(HostI2cBus& bus, uint8_t address);
+
+    /** @return true while a write cycle is in progress */
+    bool isBusy();
+
+    /** @return the number of write cycles (page writes) that the chip has carried out */
+    uint32_t getWriteCycles() const { return writeCycles; }
+
+    /** @return the memory contents, which can be read or changed directly */
+    uint8_t* getMemory() { return memory; }
+
+    /** @return the size of the memory in bytes */
+    uint32_t getSize() const { return memorySize; }
+private:
+    bool addressBytesTwo() const { return pageSize > 16; }
+    bool write(uint8_t block, const uint8_t* data, size_t len);
+    bool read(uint8_t* buffer, size_t len);
+};
+
+#endif //IOA_HOST_I2C_DEVICE_MODELS_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#include "HostShiftRegisterModel.h"
+#include "IoAbstraction.h"
+
+#ifdef BUILD_FOR_HOST
+
+HostShiftRegisterModel::HostShiftRegisterModel(pinid_t outClock, pinid_t outData, pinid_t outLatch, uint8_t numOut,
+                                               pinid_t /*inClock*/, pinid_t inData, pinid_t inLatch, uint8_t numIn)
+        : outClock(outClock), outData(outData), outLatch(outLatch), numOut(internal_min(numOut, uint8_t(HOST_SHIFTREG_MAX_DEVICES))),
+          inData(inData), inLatch(inLatch), numIn(internal_min(numIn, uint8_t(HOST_SHIFTREG_MAX_DEVICES))) {
+    for(int i = 0; i < HOST_SHIFTREG_MAX_DEVICES; i++) {
+        shifting[i] = outputs[i] = inputs[i] = loaded[i] = 0;
+    }
+}
+
+void HostShiftRegisterModel::pinWritten(pinid_t pin, bool level) {
+    if(numOut != 0 && pin == outClock) {
+        if(level && !outClockLevel) {
+            // the last bit of each device feeds the first bit of the next one along
+            for(int i = numOut - 1; i > 0; i--) {
+                shifting[i] = uint8_t((shifting[i] << 1U) | (shifting[i - 1] >> 7U));
+            }
+            shifting[0] = uint8_t((shifting[0] << 1U) | (hostPinSimulation().getLevel(outData) ? 1U : 0U));
+        }
+        outClockLevel = level;
+    }
+    else if(numOut != 0 && pin == outLatch) {
+        if(level && !outLatchLevel) {
+            for(int i = 0; i < numOut; i++) outputs[i] = shifting[i];
+            outputLatches++;
+        }
+        outLatchLevel = level;
+    }
+    else if(numIn != 0 && pin == inLatch) {
+        if(!level && inLatchLevel) {
+            for(int i = 0; i < numIn; i++) loaded[i] = inputs[i];
+            inputLoads++;
+        }
+        inLatchLevel = level;
+    }
+}
+
+void HostShiftRegisterModel::pinRead(pinid_t pin) {
+    if(numIn == 0 || pin != inData) return;
+
+    hostPinSimulation().setInputLevel(inData, (loaded[0] & 0x80U) != 0);
+    // while the latch is low the chain keeps loading the inputs, otherwise the chain moves along for the next read
+    if(!inLatchLevel) return;
+    for(int i = 0; i < numIn; i++) {
+        uint8_t next = (i + 1 < numIn) ? (loaded[i + 1] >> 7U) : 0;
+        loaded[i] = uint8_t((loaded[i] << 1U) | next);
+    }
+}
+
+#endif // BUILD_FOR_HOST
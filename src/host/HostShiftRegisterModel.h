@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_HOST_SHIFT_REGISTER_MODEL_H
+#define IOA_HOST_SHIFT_REGISTER_MODEL_H
+
+/**
+ * @file HostShiftRegisterModel.h
+ * @brief A simulated chain of 74HC595 output and 74HC165 input shift registers wired to host pins, so that the shift
+ * register abstractions can be tested against the bits they actually clock in and out.
+ */
+
+#ifdef BUILD_FOR_HOST
+
+#include "HostDigitalIO.h"
+
+/** the most devices that the model can chain in each direction */
+#define HOST_SHIFTREG_MAX_DEVICES 16
+
+/**
+ * Models a 74HC595 output chain and a 74HC165 input chain on host pins, either chain can be left out by giving it no
+ * devices. Attach it to the pin simulation with hostPinSimulation().setPinListener(&model).
+ *
+ * In both chains device 0 is the one wired to the data pin on the board. For outputs, a rising clock moves the data
+ * pin into device 0 and every bit along one place, and a rising latch copies the chain to the outputs. For inputs,
+ * the latch going low loads the inputs into the chain, then each read of the data pin presents the next bit starting
+ * with bit 7 of device 0. Presenting bits on read rather than on a clock edge means it works no matter which edge the
+ * code reads on.
+ */
+class HostShiftRegisterModel : public HostPinListener {
+private:
+    pinid_t outClock, outData, outLatch;
+    uint8_t numOut;
+    pinid_t inData, inLatch;
+    uint8_t numIn;
+    uint8_t shifting[HOST_SHIFTREG_MAX_DEVICES];
+    uint8_t outputs[HOST_SHIFTREG_MAX_DEVICES];
+    uint8_t inputs[HOST_SHIFTREG_MAX_DEVICES];
+    uint8_t loaded[HOST_SHIFTREG_MAX_DEVICES];
+    bool outClockLevel = false;
+    bool outLatchLevel = false;
+    bool inLatchLevel = true;
+    uint32_t outputLatches = 0;
+    uint32_t inputLoads = 0;
+public:
+    /**
+     * Create the model with the pins and number of devices in each chain, unused pins are IO_PIN_NOT_DEFINED. The
+     * input clock is only there to match the wiring, as input bits are presented on each read of the data pin.
+     */
+    HostShiftRegisterModel(pinid_t outClock, pinid_t outData, pinid_t outLatch, uint8_t numOut,
+                           pinid_t inClock, pinid_t inData, pinid_t inLatch, uint8_t numIn);
+
+    void pinWritten(pinid_t pin, bool level) override;
+    void pinRead(pinid_t pin) override;
+
+    /**
+     * @param device the output device, 0 being the one wired to the board
+     * @return the outputs of the device as they were at the last latch
+     */
+    uint8_t getOutput(uint8_t device) const { return outputs[device]; }
+
+    /**
+     * Set the levels on the parallel inputs of an input device, they are loaded into the chain on the next latch.
+     * @param device the input device, 0 being the one wired to the board
+     * @param value the level of each input, bit 7 is read first
+     */
+    void setInput(uint8_t device, uint8_t value) { inputs[device] = value; }
+
+    /** @return the number of times the output chain has been latched */
+    uint32_t getOutputLatches() const { return outputLatches; }
+
+    /** @return the number of times the inputs have been loaded into the input chain */
+    uint32_t getInputLoads() const { return inputLoads; }
+};
+
+#endif // BUILD_FOR_HOST
+
+#endif //IOA_HOST_SHIFT_REGISTER_MODEL_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifdef BUILD_FOR_HOST
+
+#include "HostSpiBus.h"
+#include "HostDigitalIO.h"
+#include <string.h>
+
+HostSpiBus::HostSpiBus() : counts{} {
+    for(auto& device : devices) device = nullptr;
+    for(auto& pin : pins) pin = 0;
+}
+
+bool HostSpiBus::attachDevice(pinid_t csPin, HostSpiDevice *device) {
+    int freeSlot = -1;
+    for(int i = 0; i < HOST_SPI_MAX_DEVICES; i++) {
+        if(devices[i] != nullptr && pins[i] == csPin) {
+            devices[i] = device;
+            return true;
+        }
+        if(devices[i] == nullptr && freeSlot < 0) freeSlot = i;
+    }
+    if(device == nullptr) return true;
+    if(freeSlot < 0) return false;
+    pins[freeSlot] = csPin;
+    devices[freeSlot] = device;
+    return true;
+}
+
+void HostSpiBus::select(pinid_t csPin) {
+    counts.frames++;
+    selected = nullptr;
+    for(int i = 0; i < HOST_SPI_MAX_DEVICES; i++) {
+        if(devices[i] != nullptr && pins[i] == csPin) selected = devices[i];
+    }
+    if(selected) selected->spiSelect();
+}
+
+uint8_t HostSpiBus::transfer(uint8_t mosi) {
+    counts.bytes++;
+    return selected ? selected->spiTransfer(mosi) : 0xff;
+}
+
+void HostSpiBus::deselect() {
+    if(selected) selected->spiDeselect();
+    selected = nullptr;
+}
+
+HostSpiMemoryModel::HostSpiMemoryModel(uint32_t size, uint16_t pageSize, uint8_t addressBytes, uint32_t writeCycle)
+        : memorySize(size), writeCycleMicros(writeCycle), pageSize(pageSize), addressBytes(addressBytes) {
+    memory = new uint8_t[size];
+    memset(memory, 0xff, size);
+}
+
+HostSpiMemoryModel::~HostSpiMemoryModel() {
+    delete[] memory;
+}
+
+bool HostSpiMemoryModel::isBusy() {
+    if(busy && (micros() - writeStarted) >= writeCycleMicros) busy = false;
+    return busy;
+}
+
+uint8_t HostSpiMemoryModel::statusRegister() {
+    return (isBusy() ? 0x01 : 0x00) | (writeEnabled ? 0x02 : 0x00);
+}
+
+void HostSpiMemoryModel::spiSelect() {
+    frameIndex = 0;
+    command = 0;
+    dataWritten = false;
+    ignoringFrame = false;
+}
+
+uint8_t HostSpiMemoryModel::spiTransfer(uint8_t mosi) {
+    uint16_t index = frameIndex++;
+    if(index == 0) {
+        // during a write cycle the chip only answers the status register
+        command = mosi;
+        ignoringFrame = command != SPI_MEM_RDSR && isBusy();
+        return 0xff;
+    }
+    if(ignoringFrame) return 0xff;
+
+    if(command == SPI_MEM_RDSR) {
+        if(index == 1) statusReads++;
+        return statusRegister();
+    }
+    if(command != SPI_MEM_READ && command != SPI_MEM_WRITE) return 0xff;
+
+    if(index <= addressBytes) {
+        pointer = (index == 1) ? mosi : ((pointer << 8U) | mosi);
+        if(index == addressBytes) pointer %= memorySize;
+        return 0xff;
+    }
+
+    if(command == SPI_MEM_READ) {
+        uint8_t val = memory[pointer];
+        pointer = (pointer + 1) % memorySize;
+        return val;
+    }
+
+    if(!writeEnabled) return 0xff;
+    memory[pointer] = mosi;
+    dataWritten = true;
+    if(pageSize) {
+        // an EEPROM wraps back to the start of the page rather than moving on to the next one
+        pointer = (pointer & ~uint32_t(pageSize - 1)) | ((pointer + 1) & (pageSize - 1));
+    } else {
+        pointer = (pointer + 1) % memorySize;
+    }
+    return 0xff;
+}
+
+void HostSpiMemoryModel::spiDeselect() {
+    if(ignoringFrame) return;
+    if(frameIndex == 1 && command == SPI_MEM_WREN) writeEnabled = true;
+    if(frameIndex == 1 && command == SPI_MEM_WRDI) writeEnabled = false;
+    if(command == SPI_MEM_WRITE && frameIndex > addressBytes) {
+        // write enable is cleared at the end of any write frame, as on the real chips
+        writeEnabled = false;
+        if(dataWritten) {
+            writeCycles++;
+            if(pageSize) {
+                busy = true;
+                writeStarted = micros();
+            }
+        }
+    }
+}
+
+#endif // BUILD_FOR_HOST
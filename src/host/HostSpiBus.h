@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_HOST_SPI_BUS_H
+#define IOA_HOST_SPI_BUS_H
+
+/**
+ * @file HostSpiBus.h
+ * @brief An in memory SPI bus for the host platform, simulated devices are attached to it by their chip select pin,
+ * and are then called for each byte clocked while that pin is selected. It also contains a model of the SPI FRAM and
+ * EEPROM memory chips.
+ */
+
+#include "../PlatformDetermination.h"
+
+#define HOST_SPI_MAX_DEVICES 8
+
+/**
+ * Implement this to simulate a device on the host SPI bus. A frame starts with spiSelect, when chip select goes low,
+ * then spiTransfer is called for each byte, and spiDeselect ends the frame when chip select goes high again.
+ */
+class HostSpiDevice {
+public:
+    virtual ~HostSpiDevice() = default;
+
+    /** called when chip select goes active, starting a new frame */
+    virtual void spiSelect() { }
+
+    /**
+     * Called for each byte clocked while the device is selected
+     * @param mosi the byte sent to the device
+     * @return the byte the device sends back at the same time
+     */
+    virtual uint8_t spiTransfer(uint8_t mosi) = 0;
+
+    /** called when chip select goes inactive, ending the frame */
+    virtual void spiDeselect() { }
+};
+
+/**
+ * Counts of the traffic that has passed over a host SPI bus since it was created or the counts were last reset.
+ */
+struct HostSpiBusCounts {
+    /** the number of frames, each is a chip select active then inactive */
+    uint32_t frames;
+    /** the number of bytes clocked in each direction */
+    uint32_t bytes;
+};
+
+/**
+ * The simulated SPI bus on host, this is what SPIWithSettings uses on host. Devices are attached by chip select pin,
+ * bytes clocked when no device is selected read back as 0xff, as they would with the data line pulled up.
+ */
+class HostSpiBus {
+private:
+    pinid_t pins[HOST_SPI_MAX_DEVICES];
+    HostSpiDevice* devices[HOST_SPI_MAX_DEVICES];
+    HostSpiDevice* selected = nullptr;
+    HostSpiBusCounts counts;
+public:
+    HostSpiBus();
+
+    /**
+     * Attach a simulated device to the bus on a chip select pin, replacing any device already on that pin. The bus
+     * does not own the device.
+     * @param csPin the chip select pin
+     * @param device the device to attach, or nullptr to remove it
+     * @return false if there is no space for another device
+     */
+    bool attachDevice(pinid_t csPin, HostSpiDevice* device);
+
+    /**
+     * Start a frame to the device on the given chip select pin
+     * @param csPin the chip select pin
+     */
+    void select(pinid_t csPin);
+
+    /**
+     * Clock a byte in each direction
+     * @param mosi the byte to send
+     * @return the byte received
+     */
+    uint8_t transfer(uint8_t mosi);
+
+    /** end the current frame */
+    void deselect();
+
+    /** @return the traffic counts since the bus was created or resetCounts was called */
+    const HostSpiBusCounts& getCounts() const { return counts; }
+
+    /** set all the traffic counts back to 0 */
+    void resetCounts() { counts = {}; }
+};
+
+/**
+ * The commands understood by both the SPI FRAM and SPI EEPROM memory chips, such as the MB85RS and 25LC series.
+ */
+enum HostSpiMemoryCommand : uint8_t {
+    SPI_MEM_WRSR = 0x01, SPI_MEM_WRITE = 0x02, SPI_MEM_READ = 0x03, SPI_MEM_WRDI = 0x04, SPI_MEM_RDSR = 0x05,
+    SPI_MEM_WREN = 0x06
+};
+
+/** the time that the SPI EEPROM model takes to program a page, in microseconds */
+#define HOST_SPI_EEPROM_WRITE_CYCLE_MICROS 5000UL
+
+/**
+ * A model of SPI FRAM (MB85RS) and SPI EEPROM (25LC) memory. Both need a write enable (WREN) frame before each write,
+ * which is cleared again at the end of the write. FRAM writes any length at once and is never busy. EEPROM writes
+ * are limited to a page, wrapping around within the page as the real chip does, and after each write the chip is
+ * busy for the write cycle time, during which it ignores everything except reading the status register, where bit
+ * 0 (WIP) is set.
+ */
+class HostSpiMemoryModel : public HostSpiDevice {
+private:
+    uint8_t* memory;
+    uint32_t memorySize;
+    uint32_t pointer = 0;
+    uint32_t writeCycleMicros;
+    unsigned long writeStarted = 0;
+    uint32_t writeCycles = 0;
+    uint32_t statusReads = 0;
+    uint16_t pageSize;
+    uint16_t frameIndex = 0;
+    uint8_t addressBytes;
+    uint8_t command = 0;
+    bool writeEnabled = false;
+    bool dataWritten = false;
+    bool busy = false;
+    bool ignoringFrame = false;
+public:
+    /**
+     * @param size the size of the memory in bytes
+     * @param pageSize the page size of an EEPROM, or 0 for FRAM, which has no pages
+     * @param addressBytes the number of address bytes after each read or write command, 2 or 3
+     * @param writeCycle the time it takes an EEPROM to program a page in microseconds
+     */
+    HostSpiMemoryModel(uint32_t size, uint16_t pageSize, uint8_t addressBytes, uint32_t writeCycle = HOST_SPI_EEPROM_WRITE_CYCLE_MICROS);
+    ~HostSpiMemoryModel() override;
+    HostSpiMemoryModel(const HostSpiMemoryModel&) = delete;
+    HostSpiMemoryModel& operator=(const HostSpiMemoryModel&) = delete;
+
+    void spiSelect() override;
+    uint8_t spiTransfer(uint8_t mosi) override;
+    void spiDeselect() override;
+
+    /** @return true while an EEPROM write cycle is in progress */
+    bool isBusy();
+
+    /** @return the number of writes the chip has carried out, each page write on an EEPROM */
+    uint32_t getWriteCycles() const { return writeCycles; }
+
+    /** @return the number of times the status register has been read */
+    uint32_t getStatusReads() const { return statusReads; }
+
+    /** @return true if writes are enabled, the WEL bit in the status register */
+    bool isWriteEnabled() const { return writeEnabled; }
+
+    /** @return the memory contents, which can be read or changed directly */
+    uint8_t* getMemory() { return memory; }
+private:
+    uint8_t statusRegister();
+};
+
+#endif //IOA_HOST_SPI_BUS_H
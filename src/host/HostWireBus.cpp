@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifdef BUILD_FOR_HOST
+
+#include <TaskManagerIO.h>
+#include <IoLogging.h>
+#include "PlatformDeterminationWire.h"
+#include <vector>
+
+SimpleSpinLock i2cLock;
+
+HostI2cBus defaultHostBus;
+WireType defaultWireTypePtr = &defaultHostBus;
+
+HostI2cBus::HostI2cBus() : frequency(100000), maxTransfer(IOA_WIRE_NO_TRANSFER_LIMIT), counts{} {
+    detachAll();
+}
+
+void HostI2cBus::attachDevice(uint8_t address, HostI2cDevice *device) {
+    if(address >= HOST_I2C_ADDRESSES) return;
+    devices[address] = device;
+}
+
+void HostI2cBus::detachAll() {
+    for(auto& device : devices) device = nullptr;
+}
+
+bool HostI2cBus::read(int address, uint8_t *buffer, size_t len) {
+    counts.reads++;
+    auto device = getDevice(address);
+    if(device == nullptr || len > maxTransfer || !device->i2cRead(buffer, len)) {
+        counts.nacks++;
+        return false;
+    }
+    counts.bytesRead += len;
+    return true;
+}
+
+bool HostI2cBus::write(int address, const uint8_t *buffer, size_t len, bool sendStop) {
+    counts.writes++;
+    auto device = getDevice(address);
+    if(device == nullptr || len > maxTransfer || !device->i2cWrite(buffer, len, sendStop)) {
+        counts.nacks++;
+        return false;
+    }
+    counts.bytesWritten += len;
+    return true;
+}
+
+bool HostI2cBus::ready(int address) {
+    counts.readyPolls++;
+    auto device = getDevice(address);
+    return device != nullptr && device->i2cReady();
+}
+
+void ioaWireBegin() {
+    // nothing to do, the host bus is always ready
+}
+
+size_t ioaWireMaxTransferSize(WireType wire) {
+    return wire->getMaxTransferSize();
+}
+
+void ioaWireSetSpeed(WireType wire, long frequency) {
+    ioaWireDefaultSpeedChanged(wire, frequency);
+    wire->setFrequency(frequency);
+}
+
+static inline void selectSpeedForDevice(WireType wire, int address) {
+    auto newSpeed = ioaWireSpeedChangeFor(wire, address);
+    if(newSpeed != 0) wire->setFrequency(long(newSpeed));
+}
+
+bool ioaWireReady(WireType wire, int address) {
+    selectSpeedForDevice(wire, address);
+    return wire->ready(address);
+}
+
+bool ioaWireRead(WireType wire, int address, uint8_t* buffer, size_t len) {
+    if(wire != nullptr) selectSpeedForDevice(wire, address);
+    bool readOk = wire != nullptr && wire->read(address, buffer, len);
+    ioaStatsWireRead(len, readOk);
+    return readOk;
+}
+
+bool ioaWireWriteWithRetry(WireType wire, int address, const uint8_t* buffer, size_t len, int retriesAllowed, bool sendStop) {
+    if(wire == nullptr) return false;
+    selectSpeedForDevice(wire, address);
+
+    // as with Arduino wire, when retries are requested we wait for the device to acknowledge its address first
+    bool firstTime = true;
+    bool i2cReady = retriesAllowed == 0;
+    while(retriesAllowed && !i2cReady) {
+        if(!firstTime) {
+            ioaStatsWireRetry();
+            taskManager.yieldForMicros(50);
+        }
+        firstTime = false;
+        i2cReady = wire->ready(address);
+        retriesAllowed--;
+    }
+
+    if(!i2cReady) {
+        serlogF(SER_ERROR, "I2C was not ready after retries, failing");
+        ioaStatsWireWrite(len, false);
+        return false;
+    }
+
+    bool writeOk = wire->write(address, buffer, len, sendStop);
+    ioaStatsWireWrite(len, writeOk);
+    return writeOk;
+}
+
+// simulated devices take a single buffer, so the parts of a scatter gather write are joined here first. It is kept
+// between writes, growing to the largest write seen, rather than being allocated for each one.
+static std::vector<uint8_t> hostGatherBuffer;
+
+bool ioaWireWriteV(WireType wire, int address, const IoaWireBuffer* buffers, size_t count, int retriesAllowed, bool sendStop) {
+    if(wire == nullptr) return false;
+    size_t total = 0;
+    for(size_t i = 0; i < count; i++) total += buffers[i].len;
+
+    // as on a real bus, a write larger than the wire buffer fails before anything is sent, see setMaxTransferSize
+    if(total > wire->getMaxTransferSize()) {
+        serlogF(SER_ERROR, "I2C write too large to gather");
+        ioaStatsWireWrite(total, false);
+        return false;
+    }
+
+    if(hostGatherBuffer.size() < total) hostGatherBuffer.resize(total);
+    size_t len;
+    ioaWireGather(hostGatherBuffer.data(), hostGatherBuffer.size(), buffers, count, len);
+    return ioaWireWriteWithRetry(wire, address, hostGatherBuffer.data(), len, retriesAllowed, sendStop);
+}
+
+#endif // BUILD_FOR_HOST
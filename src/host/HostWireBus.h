@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOA_HOST_WIRE_BUS_H
+#define IOA_HOST_WIRE_BUS_H
+
+/**
+ * @file HostWireBus.h
+ * @brief An in memory I2C bus for the host platform, simulated devices are attached to it at an address and are
+ * then called whenever the library reads or writes that address.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOST_I2C_ADDRESSES 128
+
+/**
+ * Implement this to simulate a device on the host I2C bus. Each call represents one complete transaction to the
+ * device; if a write was not followed by a stop, the next read is the repeated start read of the same transaction.
+ */
+class HostI2cDevice {
+public:
+    virtual ~HostI2cDevice() = default;
+
+    /**
+     * Called when the bus writes to this device
+     * @param data the bytes written
+     * @param len the number of bytes written
+     * @param sendStop true if a stop condition ended the write, false for a repeated start
+     * @return true to acknowledge the write, false to NACK
+     */
+    virtual bool i2cWrite(const uint8_t* data, size_t len, bool sendStop) = 0;
+
+    /**
+     * Called when the bus reads from this device
+     * @param buffer the buffer to be filled
+     * @param len the number of bytes requested
+     * @return true if the read was acknowledged, otherwise false
+     */
+    virtual bool i2cRead(uint8_t* buffer, size_t len) = 0;
+
+    /**
+     * @return true if the device would acknowledge its address right now, for example false during a write cycle.
+     */
+    virtual bool i2cReady() { return true; }
+};
+
+/**
+ * Counts of the traffic that has passed over a host bus since it was created or the counts were last reset. A write
+ * without a stop followed by a read (a register read) counts as one write and one read.
+ */
+struct HostI2cBusCounts {
+    /** the number of writes that were attempted, including address only writes */
+    uint32_t writes;
+    /** the number of reads that were attempted */
+    uint32_t reads;
+    /** the bytes in the writes that were acknowledged */
+    uint32_t bytesWritten;
+    /** the bytes in the reads that were acknowledged */
+    uint32_t bytesRead;
+    /** the number of reads and writes that were NACKed, or went to an address with no device */
+    uint32_t nacks;
+    /** the number of times a device was polled to see if it was ready */
+    uint32_t readyPolls;
+    /** the number of times the clock was changed to a different frequency */
+    uint32_t speedChanges;
+
+    /** @return the number of reads and writes together */
+    uint32_t transactions() const { return writes + reads; }
+};
+
+/**
+ * The simulated I2C bus on host, this is what WireType points to on host. Devices are attached at an address, and
+ * any access to an address without a device fails as if the address was NACKed. The bus counts the traffic that goes
+ * over it, so tests can check exactly how many transactions and bytes an operation costs.
+ */
+class HostI2cBus {
+private:
+    HostI2cDevice* devices[HOST_I2C_ADDRESSES];
+    long frequency;
+    size_t maxTransfer;
+    HostI2cBusCounts counts;
+public:
+    HostI2cBus();
+
+    /**
+     * Attach a simulated device to the bus, replacing any device already at that address. The bus does not own the
+     * device.
+     * @param address the 7 bit address
+     * @param device the device to attach
+     */
+    void attachDevice(uint8_t address, HostI2cDevice* device);
+
+    /**
+     * Remove any device at the given address
+     * @param address the 7 bit address
+     */
+    void detachDevice(uint8_t address) { attachDevice(address, nullptr); }
+
+    /**
+     * Remove all devices from the bus
+     */
+    void detachAll();
+
+    /**
+     * @param address the 7 bit address
+     * @return the device at that address or nullptr
+     */
+    HostI2cDevice* getDevice(uint8_t address) const { return (address < HOST_I2C_ADDRESSES) ? devices[address] : nullptr; }
+
+    /** @return the last frequency the bus was set to */
+    long getFrequency() const { return frequency; }
+    void setFrequency(long freq) {
+        if(freq != frequency) counts.speedChanges++;
+        frequency = freq;
+    }
+
+    /**
+     * Limit the size of each read and write, to simulate the buffer of a Wire library, any larger transfer fails
+     * as if it were NACKed. By default there is no limit.
+     * @param maxSize the largest transfer allowed, or IOA_WIRE_NO_TRANSFER_LIMIT
+     */
+    void setMaxTransferSize(size_t maxSize) { maxTransfer = maxSize; }
+
+    /** @return the largest transfer allowed on this bus */
+    size_t getMaxTransferSize() const { return maxTransfer; }
+
+    /** @return the traffic counts since the bus was created or resetCounts was called */
+    const HostI2cBusCounts& getCounts() const { return counts; }
+
+    /** set all the traffic counts back to 0 */
+    void resetCounts() { counts = {}; }
+
+    bool read(int address, uint8_t* buffer, size_t len);
+    bool write(int address, const uint8_t* buffer, size_t len, bool sendStop);
+    bool ready(int address);
+};
+
+#endif //IOA_HOST_WIRE_BUS_H
@@ -126,6 +126,24 @@ void HalStm32EepromAbstraction::writeArrayToRom(EepromPosition romDest, const ui
     }
 }
 
+bool HalStm32EepromAbstraction::readIntoMemArrayWide(uint8_t *memDest, EepromWidePosition romSrc, size_t len) {
+    if(len > EEPROM_SIZE || romSrc > (EEPROM_SIZE - len)) {
+        errorOccurred = true;
+        return false;
+    }
+    memcpy(memDest, eepromBuffer + romSrc, len);
+    return true;
+}
+
+bool HalStm32EepromAbstraction::writeArrayToRomWide(EepromWidePosition romDest, const uint8_t *memSrc, size_t len) {
+    if(len > EEPROM_SIZE || romDest > (EEPROM_SIZE - len)) {
+        errorOccurred = true;
+        return false;
+    }
+    memcpy(eepromBuffer + romDest, memSrc, len);
+    return true;
+}
+
 bool HalStm32EepromAbstraction::hasErrorOccurred() {
     return errorOccurred;
 }
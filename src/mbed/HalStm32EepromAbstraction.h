@@ -60,6 +60,12 @@ public:
      */
     void commit() { halWriteToCache(); }
 
+    /** commits the cache to backup RAM, see commit() */
+    bool flush() override {
+        halWriteToCache();
+        return true;
+    }
+
     /**
      * Reads an 8-bit value from the cache
      * @param position the position of the variable
@@ -118,6 +124,24 @@ public:
      */
     void writeArrayToRom(EepromPosition romDest, const uint8_t *memSrc, uint8_t len) override;
 
+    /**
+     * Reads from the cache into memory in one go, without the 255 byte limit of readIntoMemArray.
+     * @param memDest the destination memory
+     * @param romSrc the source offset in the ROM cache
+     * @param len the length to read
+     * @return false if the range is outside of the cache
+     */
+    bool readIntoMemArrayWide(uint8_t *memDest, EepromWidePosition romSrc, size_t len) override;
+
+    /**
+     * Writes data into the ROM cache in one go, that must be committed using commit() later.
+     * @param romDest the position in ROM cache
+     * @param memSrc the memory location to read from
+     * @param len the length to be written
+     * @return false if the range is outside of the cache
+     */
+    bool writeArrayToRomWide(EepromWidePosition romDest, const uint8_t *memSrc, size_t len) override;
+
     /**
      * Indicates if an error has occurred. IE if the regulator failed to enable or a write was outside of bounds
      * @return true if there has been an error, otherwise false.
@@ -15,22 +15,79 @@ void ioaWireBegin(I2C* pI2cToUse) {
     defaultWireTypePtr = pI2cToUse;
 }
 
+size_t ioaWireMaxTransferSize(WireType) {
+    // transfers are sent directly from the callers buffer, so there is no limit
+    return IOA_WIRE_NO_TRANSFER_LIMIT;
+}
+
 void ioaWireSetSpeed(WireType i2c, long frequency) {
+    ioaWireDefaultSpeedChanged(i2c, frequency);
     i2c->frequency(frequency);
 }
 
+static inline void selectSpeedForDevice(WireType pI2c, int address) {
+    auto newSpeed = ioaWireSpeedChangeFor(pI2c, address);
+    if(newSpeed != 0) pI2c->frequency(newSpeed);
+}
+
+bool ioaWireReady(WireType pI2c, int address) {
+    selectSpeedForDevice(pI2c, address);
+    return pI2c->write(address, nullptr, 0, false) == 0;
+}
+
 bool ioaWireRead(WireType pI2c, int address, uint8_t* buffer, size_t len) {
-    return pI2c->read(address, (char*)buffer, len, false) == 0;
+    selectSpeedForDevice(pI2c, address);
+    bool readOk = pI2c->read(address, (char*)buffer, len, false) == 0;
+    ioaStatsWireRead(len, readOk);
+    return readOk;
 }
 
 bool ioaWireWriteWithRetry(WireType pI2c, int address, const uint8_t* buffer, size_t len, int retriesAllowed, bool sendStop) {
+    selectSpeedForDevice(pI2c, address);
     int tries = 0;
     while(pI2c->write(address, (const char*)buffer, len, !sendStop) !=0) {
-        if(tries > retriesAllowed) return false;
+        if(tries > retriesAllowed) {
+            ioaStatsWireWrite(len, false);
+            return false;
+        }
+        ioaStatsWireRetry();
         taskManager.yieldForMicros(50);
         tries++;
     }
+    ioaStatsWireWrite(len, true);
     return true;
 }
 
+static bool writePartsOnce(WireType pI2c, int address, const IoaWireBuffer* buffers, size_t count, bool sendStop) {
+    // mbed addresses are already shifted, so clearing bit 0 makes this a write. Each byte is sent from where it is.
+    pI2c->start();
+    bool ok = pI2c->write(address & 0xfe) == 1;
+    for(size_t i = 0; ok && i < count; i++) {
+        for(size_t j = 0; ok && j < buffers[i].len; j++) {
+            ok = pI2c->write(buffers[i].data[j]) == 1;
+        }
+    }
+    // on failure the stop is always sent to release the bus, otherwise only when asked for
+    if(sendStop || !ok) pI2c->stop();
+    return ok;
+}
+
+bool ioaWireWriteV(WireType pI2c, int address, const IoaWireBuffer* buffers, size_t count, int retriesAllowed, bool sendStop) {
+    selectSpeedForDevice(pI2c, address);
+    size_t total = 0;
+    for(size_t i = 0; i < count; i++) total += buffers[i].len;
+
+    pI2c->lock();
+    int tries = 0;
+    bool writeOk;
+    while(!(writeOk = writePartsOnce(pI2c, address, buffers, count, sendStop)) && tries <= retriesAllowed) {
+        ioaStatsWireRetry();
+        taskManager.yieldForMicros(50);
+        tries++;
+    }
+    pI2c->unlock();
+    ioaStatsWireWrite(total, writeOk);
+    return writeOk;
+}
+
 #endif
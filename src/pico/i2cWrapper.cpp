@@ -3,6 +3,7 @@
 
 #include "i2cWrapper.h"
 #include "PlatformDeterminationWire.h"
+#include <IoLogging.h>
 
 // on pico i2c is set up by the user before first use
 PicoI2cWrapper defaultWireType;
@@ -24,18 +25,61 @@ bool PicoI2cWrapper::wireWrite(uint8_t addr, const uint8_t *src, size_t len, int
     return true;
 }
 
+bool PicoI2cWrapper::wireReady(uint8_t addr) {
+    // the SDK cannot send an address only write, so a one byte read is used to see if the device acknowledges.
+    uint8_t data;
+    return i2c_read_blocking(nativeI2c, addr, &data, 1, false) >= 0;
+}
+
 void ioaWireBegin(i2c_inst_t * i2c) {
     defaultWireTypePtr->init(i2c);
 }
 
-bool ioaWireRead(WireType wire, int address, uint8_t* buffer, size_t len) {
+size_t ioaWireMaxTransferSize(WireType) {
+    // the SDK has no limit itself, but scatter gather writes are limited by the gather buffer
+    return IOA_WIRE_GATHER_BUFFER_SIZE;
+}
+
+void ioaWireSetSpeed(WireType wire, long frequency) {
+    ioaWireDefaultSpeedChanged(wire, frequency);
+    wire->setSpeed(frequency);
+}
+
+static inline void selectSpeedForDevice(WireType wire, int address) {
+    auto newSpeed = ioaWireSpeedChangeFor(wire, address);
+    if(newSpeed != 0) wire->setSpeed(newSpeed);
+}
+
+bool ioaWireReady(WireType wire, int address) {
     if(wire == nullptr || !wire->isValid()) return false;
-    return wire->wireRead(address, buffer, len);
+    selectSpeedForDevice(wire, address);
+    return wire->wireReady(address);
+}
+
+bool ioaWireRead(WireType wire, int address, uint8_t* buffer, size_t len) {
+    if(wire != nullptr) selectSpeedForDevice(wire, address);
+    bool readOk = wire != nullptr && wire->isValid() && wire->wireRead(address, buffer, len);
+    ioaStatsWireRead(len, readOk);
+    return readOk;
 }
 
 bool ioaWireWriteWithRetry(WireType wire, int address, const uint8_t* buffer, size_t len, int retriesAllowed, bool sendStop) {
-    if(wire == nullptr || !wire->isValid()) return false;
-    return wire->wireWrite(address, buffer, len, retriesAllowed, sendStop);
+    if(wire != nullptr) selectSpeedForDevice(wire, address);
+    bool writeOk = wire != nullptr && wire->isValid() && wire->wireWrite(address, buffer, len, retriesAllowed, sendStop);
+    ioaStatsWireWrite(len, writeOk);
+    return writeOk;
+}
+
+bool ioaWireWriteV(WireType wire, int address, const IoaWireBuffer* buffers, size_t count, int retriesAllowed, bool sendStop) {
+    // the SDK always sends the address at the start of each write call, so the parts are gathered first.
+    uint8_t gathered[IOA_WIRE_GATHER_BUFFER_SIZE];
+    size_t len;
+    if(!ioaWireGather(gathered, sizeof gathered, buffers, count, len)) {
+        serlogF(SER_ERROR, "I2C write too large to gather");
+        ioaStatsWireWrite(len, false);
+        return false;
+    }
+    return ioaWireWriteWithRetry(wire, address, gathered, len, retriesAllowed, sendStop);
 }
 
 #endif
\ No newline at end of file
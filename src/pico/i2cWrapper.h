@@ -15,6 +15,8 @@ public:
 
     bool wireRead(uint8_t addr, uint8_t *dst, size_t len);
     bool wireWrite(uint8_t addr, const uint8_t *dst, size_t len, int retries, bool sendStop);
+    bool wireReady(uint8_t addr);
+    void setSpeed(uint32_t frequency) { if(nativeI2c != nullptr) i2c_set_baudrate(nativeI2c, frequency); }
 };
 
 #endif //TCCLIBS_I2CWRAPPER_H
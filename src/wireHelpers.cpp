@@ -4,6 +4,7 @@
  */
 
 #include "wireHelpers.h"
+#include <string.h>
 
 
 uint16_t wireReadReg16(WireType wireType, uint8_t addr, uint8_t reg) {
@@ -28,18 +29,29 @@ uint8_t wireReadReg8(WireType wireType, uint8_t addr, uint8_t reg) {
 }
 
 bool wireWriteReg16(WireType wireType, uint8_t addr, uint8_t reg, uint16_t command) {
-    uint8_t data[3];
-    data[0] = reg;
-    data[1] = (uint8_t)command;
-    data[2] = (uint8_t)(command>>8);
-    return ioaWireWriteWithRetry(wireType, addr, data, sizeof data);
+    uint8_t data[2];
+    data[0] = (uint8_t)command;
+    data[1] = (uint8_t)(command>>8);
+    return wireWriteRegBlock(wireType, addr, reg, data, sizeof data);
 }
 
 bool wireWriteReg8(WireType wireType, uint8_t addr, uint8_t reg, uint8_t command) {
-    uint8_t data[2];
-    data[0] = reg;
-    data[1] = (uint8_t)command;
-    return ioaWireWriteWithRetry(wireType, addr, data, sizeof data);
+    return wireWriteRegBlock(wireType, addr, reg, &command, 1);
+}
+
+bool wireWriteRegBlock(WireType wireType, uint8_t addr, uint8_t reg, const uint8_t* data, size_t len) {
+    IoaWireBuffer parts[] = { { &reg, 1 }, { data, len } };
+    return ioaWireWriteV(wireType, addr, parts, 2);
+}
+
+bool ioaWireGather(uint8_t* dest, size_t destSize, const IoaWireBuffer* buffers, size_t count, size_t& total) {
+    total = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(buffers[i].len > (destSize - total)) return false;
+        if(buffers[i].len != 0) memcpy(dest + total, buffers[i].data, buffers[i].len);
+        total += buffers[i].len;
+    }
+    return true;
 }
 
 void toggleBitInRegister8(WireType wireType, uint8_t addr, uint8_t regAddr, uint8_t theBit, bool value) {
@@ -79,4 +91,225 @@ void write4BitToReg8(WireType wireImpl, uint8_t i2cAddress, uint8_t reg, bool lo
 
 }
 
+WireRegisterShadow::WireRegisterShadow(const uint8_t* registerList, uint8_t numberOfRegisters, bool sixteenBit)
+        : registers(registerList), values{}, validFlags(0), dirtyFlags(0), batchDepth(0), sixteenBit(sixteenBit) {
+    numRegisters = internal_min(numberOfRegisters, (uint8_t)WIRE_SHADOW_MAX_REGISTERS);
+}
+
+int WireRegisterShadow::indexOf(uint8_t reg) const {
+    for(int i = 0; i < numRegisters; i++) {
+        if(registers[i] == reg) return i;
+    }
+    return -1;
+}
+
+bool WireRegisterShadow::readFromDevice(WireType wireType, uint8_t addr, uint8_t reg, uint16_t& value) const {
+    uint8_t data[2] = {};
+    if(!ioaWireWriteWithRetry(wireType, addr, &reg, 1, 0, false)) return false;
+    if(!ioaWireRead(wireType, addr, data, sixteenBit ? 2 : 1)) return false;
+    value = data[0] | (data[1] << 8U);
+    return true;
+}
+
+bool WireRegisterShadow::writeToDevice(WireType wireType, uint8_t addr, uint8_t reg, uint16_t value) const {
+    return sixteenBit ? wireWriteReg16(wireType, addr, reg, value) : wireWriteReg8(wireType, addr, reg, value);
+}
+
+uint16_t WireRegisterShadow::readRegister(WireType wireType, uint8_t addr, uint8_t reg) {
+    int idx = indexOf(reg);
+    if(idx >= 0 && bitRead(validFlags, idx)) return values[idx];
 
+    uint16_t value = 0;
+    bool readOk = readFromDevice(wireType, addr, reg, value);
+    // only ever cache what was actually read, otherwise we would keep writing back a bad value.
+    if(idx >= 0 && readOk) {
+        values[idx] = value;
+        bitSet(validFlags, idx);
+    }
+    return value;
+}
+
+bool WireRegisterShadow::writeRegister(WireType wireType, uint8_t addr, uint8_t reg, uint16_t value) {
+    int idx = indexOf(reg);
+    if(idx < 0) return writeToDevice(wireType, addr, reg, value);
+    if(bitRead(validFlags, idx) && values[idx] == value) return true;
+
+    if(batchDepth != 0) {
+        values[idx] = value;
+        bitSet(validFlags, idx);
+        bitSet(dirtyFlags, idx);
+        return true;
+    }
+
+    bool writeOk = writeToDevice(wireType, addr, reg, value);
+    values[idx] = value;
+    bitWrite(validFlags, idx, writeOk);
+    return writeOk;
+}
+
+bool WireRegisterShadow::toggleBit(WireType wireType, uint8_t addr, uint8_t reg, uint8_t theBit, bool value) {
+    int idx = indexOf(reg);
+    uint16_t newVal;
+    if(idx >= 0 && bitRead(validFlags, idx)) {
+        newVal = values[idx];
+    }
+    else if(!readFromDevice(wireType, addr, reg, newVal)) {
+        return false;
+    }
+    else if(idx >= 0) {
+        // cache what was read, so that a toggle that leaves the register as it was does not write it back.
+        values[idx] = newVal;
+        bitSet(validFlags, idx);
+    }
+    bitWrite(newVal, theBit, value);
+    serlogF4(SER_IOA_DEBUG, "shadow toggle(regAddr, bit, toggle): ", reg, theBit, value);
+    return writeRegister(wireType, addr, reg, newVal);
+}
+
+bool WireRegisterShadow::commitBatch(WireType wireType, uint8_t addr) {
+    if(batchDepth == 0 || --batchDepth != 0) return true;
+
+    bool allOk = true;
+    for(int i = 0; i < numRegisters; i++) {
+        if(!bitRead(dirtyFlags, i)) continue;
+        bool writeOk = writeToDevice(wireType, addr, registers[i], values[i]);
+        // a failed write leaves the device value unknown, so read it again on next use.
+        bitWrite(validFlags, i, writeOk);
+        if(!writeOk) allOk = false;
+    }
+    dirtyFlags = 0;
+    return allOk;
+}
+
+bool WireRegisterShadow::resync(WireType wireType, uint8_t addr) {
+    bool allOk = true;
+    for(int i = 0; i < numRegisters; i++) {
+        if(!bitRead(validFlags, i)) continue;
+        if(!writeToDevice(wireType, addr, registers[i], values[i])) allOk = false;
+    }
+    dirtyFlags = 0;
+    return allOk;
+}
+
+//
+// Per device clock profiles, kept as two small tables. The bus table records the default clock given to
+// ioaWireSetSpeed and the clock each bus is running at now, so that a change is only made when the next device
+// needs a different clock. A bus entry that has no profiles and is back at its default clock can be given to
+// another bus when the table is full.
+//
+
+struct WireClockProfile {
+    WireType wire;
+    uint32_t frequency;
+    uint8_t address;
+    uint8_t addressCount;
+};
+
+struct WireBusClock {
+    WireType wire;
+    uint32_t defaultSpeed;
+    uint32_t currentSpeed;
+    uint8_t profileCount;
+};
+
+static WireClockProfile wireClockProfiles[IOA_WIRE_MAX_CLOCK_PROFILES];
+static WireBusClock wireBusClocks[IOA_WIRE_MAX_BUSES];
+static uint8_t wireClockProfileCount = 0;
+static bool wireClockOffDefault = false;
+
+static WireBusClock* busClockFor(WireType wire) {
+    for(auto& bus : wireBusClocks) {
+        if(bus.wire == wire) return &bus;
+    }
+    return nullptr;
+}
+
+static bool anyBusOffDefault() {
+    for(auto& bus : wireBusClocks) {
+        if(bus.wire != nullptr && bus.currentSpeed != bus.defaultSpeed) return true;
+    }
+    return false;
+}
+
+bool ioaWireSetDeviceSpeed(WireType wire, uint8_t address, uint32_t frequency, uint8_t addressCount) {
+    if(wire == nullptr) wire = defaultWireTypePtr;
+    if(addressCount == 0) addressCount = 1;
+    auto bus = busClockFor(wire);
+
+    for(uint8_t i = 0; i < wireClockProfileCount; i++) {
+        if(wireClockProfiles[i].wire == wire && wireClockProfiles[i].address == address) {
+            if(frequency == 0) {
+                // remove it by moving the last entry into its place
+                wireClockProfileCount--;
+                wireClockProfiles[i] = wireClockProfiles[wireClockProfileCount];
+                if(bus != nullptr && bus->profileCount != 0) bus->profileCount--;
+            } else {
+                wireClockProfiles[i].frequency = frequency;
+                wireClockProfiles[i].addressCount = addressCount;
+            }
+            return true;
+        }
+    }
+
+    if(frequency == 0) return true;
+    if(bus == nullptr) {
+        // without the speed the bus was set to, devices without a preference could not be switched back to it.
+        serlogF2(SER_ERROR, "Call ioaWireSetSpeed before clock profile ", address);
+        return false;
+    }
+    if(wireClockProfileCount >= IOA_WIRE_MAX_CLOCK_PROFILES) {
+        serlogF2(SER_ERROR, "No space for clock profile ", address);
+        return false;
+    }
+    wireClockProfiles[wireClockProfileCount] = { wire, frequency, address, addressCount };
+    wireClockProfileCount++;
+    bus->profileCount++;
+    return true;
+}
+
+uint32_t ioaWireSpeedChangeFor(WireType wire, int address) {
+    // the common case of no profiles, with every bus at its default clock, should cost as little as possible.
+    if(wireClockProfileCount == 0 && !wireClockOffDefault) return 0;
+
+    auto bus = busClockFor(wire);
+    if(bus == nullptr) return 0;
+
+    uint32_t wanted = bus->defaultSpeed;
+    for(uint8_t i = 0; i < wireClockProfileCount; i++) {
+        auto& profile = wireClockProfiles[i];
+        if(profile.wire == wire && address >= profile.address && address < (profile.address + profile.addressCount)) {
+            wanted = profile.frequency;
+            break;
+        }
+    }
+
+    if(wanted == bus->currentSpeed) return 0;
+    bus->currentSpeed = wanted;
+    wireClockOffDefault = anyBusOffDefault();
+    return wanted;
+}
+
+void ioaWireDefaultSpeedChanged(WireType wire, uint32_t frequency) {
+    auto bus = busClockFor(wire);
+    if(bus == nullptr) {
+        // take a free entry, or failing that one that no longer has any profiles and so is only keeping the default
+        WireBusClock* reusable = nullptr;
+        for(auto& entry : wireBusClocks) {
+            if(entry.wire == nullptr) {
+                bus = &entry;
+                break;
+            }
+            if(reusable == nullptr && entry.profileCount == 0 && entry.currentSpeed == entry.defaultSpeed) reusable = &entry;
+        }
+        if(bus == nullptr) bus = reusable;
+        if(bus == nullptr) {
+            serlogF(SER_ERROR, "No space to track bus clock");
+            return;
+        }
+        bus->wire = wire;
+        bus->profileCount = 0;
+    }
+    bus->defaultSpeed = frequency;
+    bus->currentSpeed = frequency;
+    wireClockOffDefault = anyBusOffDefault();
+}
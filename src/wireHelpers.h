@@ -67,6 +67,18 @@ bool wireWriteReg8(WireType wireType, uint8_t addr, uint8_t reg, uint8_t command
  */
 bool wireWriteReg16(WireType wireType, uint8_t addr, uint8_t reg, uint16_t command);
 
+/**
+ * Writes a block of data to consecutive registers starting at reg, for devices that auto increment the register
+ * pointer. The register and the data are sent as one write without copying the data.
+ * @param wireType the wire implementation
+ * @param addr the I2C address
+ * @param reg the first register to write
+ * @param data the data to write
+ * @param len the length of the data
+ * @return true if successful, otherwise false
+ */
+bool wireWriteRegBlock(WireType wireType, uint8_t addr, uint8_t reg, const uint8_t* data, size_t len);
+
 /**
  * Reads an 8 bit value from a given register
  * @param wireType the wire implementation
@@ -85,4 +97,110 @@ uint8_t wireReadReg8(WireType wireType, uint8_t addr, uint8_t reg);
  */
 uint16_t wireReadReg16(WireType wireType, uint8_t addr, uint8_t reg);
 
+/** the most registers that a single WireRegisterShadow can hold */
+#define WIRE_SHADOW_MAX_REGISTERS 8
+
+/**
+ * Keeps a copy of a device's configuration registers in RAM, so that changing a single bit does not need a full read,
+ * modify, write on the bus each time. Each register is read from the device the first time it is used, after that it
+ * is updated in RAM, and only written back to the device when its value actually changes. Only use this for registers
+ * that the device never changes by itself, such as direction, pull up and interrupt setup, never for status or data.
+ *
+ * The registers are either all 8 bit, or all 16 bit, where 16 bit means a pair of adjacent registers that are read
+ * and written together, low byte first, as with wireReadReg16. Any register not in the list given at construction is
+ * not cached and goes straight to the device.
+ *
+ * Between beginBatch and commitBatch, writes to cached registers are only made in RAM, then at commit each register
+ * that changed is written once, no matter how many of its bits were changed during the batch.
+ */
+class WireRegisterShadow {
+private:
+    const uint8_t* registers;
+    uint16_t values[WIRE_SHADOW_MAX_REGISTERS];
+    uint8_t numRegisters;
+    uint8_t validFlags;
+    uint8_t dirtyFlags;
+    uint8_t batchDepth;
+    bool sixteenBit;
+public:
+    /**
+     * Create a shadow for the registers provided, nothing is read from the device until each register is first used.
+     * @param registerList the register addresses to cache, must remain valid, normally a static const array
+     * @param numberOfRegisters the number of registers up to WIRE_SHADOW_MAX_REGISTERS
+     * @param sixteenBit true if the registers are 16 bit (pairs of 8 bit registers), otherwise false.
+     */
+    WireRegisterShadow(const uint8_t* registerList, uint8_t numberOfRegisters, bool sixteenBit);
+
+    /**
+     * Changes a single bit in a register, the register is only read from the device if it is not already cached, and
+     * is only written if the bit changed.
+     * @param wireType the wire implementation
+     * @param addr the i2c address
+     * @param reg the register to change
+     * @param theBit the bit to change
+     * @param value the new value of the bit
+     * @return true if successful, otherwise false
+     */
+    bool toggleBit(WireType wireType, uint8_t addr, uint8_t reg, uint8_t theBit, bool value);
+
+    /**
+     * Gets the value of a register, from the cache if possible, otherwise from the device.
+     * @param wireType the wire implementation
+     * @param addr the i2c address
+     * @param reg the register to read
+     * @return the register value, or 0 if it could not be read
+     */
+    uint16_t readRegister(WireType wireType, uint8_t addr, uint8_t reg);
+
+    /**
+     * Writes a register to the device, unless the cached value shows it already holds that value.
+     * @param wireType the wire implementation
+     * @param addr the i2c address
+     * @param reg the register to write
+     * @param value the value to write
+     * @return true if successful, otherwise false
+     */
+    bool writeRegister(WireType wireType, uint8_t addr, uint8_t reg, uint16_t value);
+
+    /**
+     * Writes every cached register back to the device, use this to put the configuration back after the device has
+     * been reset, for example by a brown out or a reset pin.
+     * @param wireType the wire implementation
+     * @param addr the i2c address
+     * @return true if all the writes succeeded, otherwise false
+     */
+    bool resync(WireType wireType, uint8_t addr);
+
+    /**
+     * Start holding back writes to the cached registers until commitBatch, batches can be nested and only the outermost
+     * commit writes to the device.
+     */
+    void beginBatch() { batchDepth++; }
+
+    /**
+     * Ends a batch, when the outermost batch ends every register changed during the batch is written to the device.
+     * @param wireType the wire implementation
+     * @param addr the i2c address
+     * @return true if all the writes succeeded, otherwise false
+     */
+    bool commitBatch(WireType wireType, uint8_t addr);
+
+    /** @return true if a batch is in progress */
+    bool isBatching() const { return batchDepth != 0; }
+
+    /**
+     * Forgets all the cached values, so each register is read from the device again on next use. Call this when the
+     * device has been put back to its defaults on purpose, such as by a software reset. Any changes held back by a
+     * batch are dropped too.
+     */
+    void invalidate() { validFlags = dirtyFlags = 0; }
+
+    /** @return true if any register values are held in the cache */
+    bool hasCachedValues() const { return validFlags != 0; }
+private:
+    int indexOf(uint8_t reg) const;
+    bool readFromDevice(WireType wireType, uint8_t addr, uint8_t reg, uint16_t& value) const;
+    bool writeToDevice(WireType wireType, uint8_t addr, uint8_t reg, uint16_t value) const;
+};
+
 #endif // IOA_WIRE_HELPERS_H
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2018 https://www.thecoderscorner.com (Dave Cherry).
+ * This product is licensed under an Apache license, see the LICENSE file in the top-level directory.
+ */
+
+/**
+ * @file ioaHostBenchmarks.cpp
+ * @brief Benchmarks for the input processing hot paths, built for the host platform (BUILD_FOR_HOST). Each benchmark
+ * reports the wall clock nanoseconds per operation and the number of heap allocations made per operation, so that
+ * changes to switches, encoders, multi IO, the matrix keyboard and EEPROM wear levelling can be compared before and
+ * after. Pin states and the clock are driven through the host simulation, so results reflect the library code rather
+ * than any hardware.
+ *
+ * Usage: ioaHostBenchmarks [filter], where filter optionally restricts the run to benchmarks containing that text.
+ */
+
+#include <IoAbstraction.h>
+#include <SwitchInput.h>
+#include <KeyboardManager.h>
+#include <WearLevelledEeprom.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+//
+// Allocation counting, every allocation made by the process goes through these operators so we can count them
+// during the measured part of each benchmark.
+//
+
+static volatile unsigned long benchAllocations = 0;
+static volatile unsigned long benchAllocatedBytes = 0;
+
+// both forms of new go straight to malloc, rather than new[] calling new, so that the compiler sees every free
+// paired with a malloc and does not warn about mismatched new and delete.
+static void* countedMalloc(size_t size) {
+    benchAllocations++;
+    benchAllocatedBytes += size;
+    void* ptr = malloc(size ? size : 1);
+    if(ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size) { return countedMalloc(size); }
+void* operator new[](size_t size) { return countedMalloc(size); }
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+//
+// A very small benchmark runner, it warms up the operation, then times a fixed number of iterations. It returns the
+// number of times the operation was called including the warm up, or 0 when the benchmark was filtered out.
+//
+
+static const char* benchFilter = nullptr;
+
+template<typename Fn> unsigned long runBenchmark(const char* name, unsigned long iterations, Fn operation) {
+    if(benchFilter != nullptr && strstr(name, benchFilter) == nullptr) return 0;
+
+    unsigned long warmUps = (iterations / 10) + 1;
+    for(unsigned long i = 0; i < warmUps; i++) {
+        operation(i);
+    }
+
+    unsigned long allocsBefore = benchAllocations;
+    unsigned long bytesBefore = benchAllocatedBytes;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i = 0; i < iterations; i++) {
+        operation(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double nanos = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    printf("%-36s %10lu %12.1f %12.3f %12.1f\n", name, iterations, nanos / (double)iterations,
+           (double)(benchAllocations - allocsBefore) / (double)iterations,
+           (double)(benchAllocatedBytes - bytesBefore) / (double)iterations);
+    return warmUps + iterations;
+}
+
+//
+// Switches, we set up a number of keys on consecutive device pins and then toggle one key in every eight on a regular
+// pattern so that runLoop goes through debounce, press, hold and release rather than just idling.
+//
+
+static volatile unsigned long benchKeyEvents = 0;
+
+void benchKeyPressed(pinid_t /*pin*/, bool /*held*/) {
+    benchKeyEvents++;
+}
+
+void prepareSwitches(int numberOfKeys) {
+    hostPinSimulation().reset();
+    switches.resetAllSwitches();
+    switches.init(internalDigitalIo(), SWITCHES_NO_POLLING, true);
+    for(int i = 0; i < numberOfKeys; i++) {
+        switches.addSwitch(pinid_t(i), benchKeyPressed, 20);
+    }
+}
+
+void benchmarkSwitchesRunLoop(const char* name, int numberOfKeys) {
+    prepareSwitches(numberOfKeys);
+    runBenchmark(name, 200000, [numberOfKeys](unsigned long i) {
+        // pull up logic, so low is pressed. Keep each press going for a while so that held and repeat get a look in.
+        if((i % 64) == 0) {
+            bool level = ((i / 64) % 2) != 0;
+            for(int pin = 0; pin < numberOfKeys; pin += 8) {
+                hostPinSimulation().setInputLevel(pinid_t(pin), level);
+            }
+        }
+        switches.runLoop();
+    });
+}
+
+void benchmarkKeyboardItemTransitions() {
+    KeyboardItem item(0, benchKeyPressed, 20);
+    item.onRelease(benchKeyPressed);
+    runBenchmark("KeyboardItem::checkAndTrigger", 2000000, [&item](unsigned long i) {
+        // press for 48 calls (debounce, pressed, held and repeat), release for 16.
+        item.checkAndTrigger((i % 64) < 48 ? HIGH : LOW);
+    });
+}
+
+//
+// Rotary encoders, we feed a continuous quadrature stream on pins A and B, reversing direction every so often.
+//
+
+void benchEncoderChanged(int /*newValue*/) {
+    benchKeyEvents++;
+}
+
+static const uint8_t quadratureSequence[] = { 0b00, 0b10, 0b11, 0b01 };
+
+void setQuadrature(pinid_t pinA, pinid_t pinB, unsigned long step) {
+    bool reverse = ((step / 256) % 2) != 0;
+    uint8_t state = quadratureSequence[reverse ? (3 - (step % 4)) : (step % 4)];
+    hostPinSimulation().setInputLevel(pinA, (state & 0b10) != 0);
+    hostPinSimulation().setInputLevel(pinB, (state & 0b01) != 0);
+    hostAdvanceMicros(2000);
+}
+
+void benchmarkEncoders() {
+    const pinid_t pinA = 2, pinB = 3;
+
+    hostPinSimulation().reset();
+    switches.resetAllSwitches();
+    switches.init(internalDigitalIo(), SWITCHES_POLL_EVERYTHING, true);
+    auto hwEncoder = new HardwareRotaryEncoder(pinA, pinB, benchEncoderChanged, HWACCEL_NONE, QUARTER_CYCLE);
+    hwEncoder->changePrecision(1000, 500, true);
+    runBenchmark("HardwareRotaryEncoder quadrature", 1000000, [hwEncoder](unsigned long i) {
+        setQuadrature(pinA, pinB, i);
+        hwEncoder->encoderChanged();
+    });
+    delete hwEncoder;
+
+    hostPinSimulation().reset();
+    switches.resetAllSwitches();
+    switches.init(internalDigitalIo(), SWITCHES_POLL_EVERYTHING, true);
+    auto stateEncoder = new HwStateRotaryEncoder(pinA, pinB, benchEncoderChanged, HWACCEL_NONE, QUARTER_CYCLE);
+    stateEncoder->changePrecision(1000, 500, true);
+    runBenchmark("HwStateRotaryEncoder quadrature", 1000000, [stateEncoder](unsigned long i) {
+        setQuadrature(pinA, pinB, i);
+        stateEncoder->encoderChanged();
+    });
+    delete stateEncoder;
+}
+
+//
+// Multi IO, the expanders are memory backed so that only the routing and dispatch cost is measured.
+//
+
+class BenchMemoryExpander : public BasicIoAbstraction {
+private:
+    uint32_t pinStates = 0;
+public:
+    void pinDirection(pinid_t /*pin*/, uint8_t /*mode*/) override { }
+    void writeValue(pinid_t pin, uint8_t value) override { bitWrite(pinStates, pin, value); }
+    uint8_t readValue(pinid_t pin) override { return bitRead(pinStates, pin); }
+    void attachInterrupt(pinid_t /*pin*/, RawIntHandler /*intHandler*/, uint8_t /*mode*/) override { }
+    bool runLoop() override { return true; }
+    void writePort(pinid_t /*pin*/, uint8_t portVal) override { pinStates = portVal; }
+    uint8_t readPort(pinid_t /*pin*/) override { return pinStates & 0xff; }
+};
+
+void benchmarkMultiIoDispatch() {
+    const int numberOfExpanders = 8;
+    const int pinsPerExpander = 16;
+
+    // multi IO takes ownership of the expanders and deletes them when it goes out of scope.
+    MultiIoAbstraction multiIo(100);
+    for(int i = 0; i < numberOfExpanders; i++) {
+        multiIo.addIoExpander(new BenchMemoryExpander(), pinsPerExpander);
+    }
+    const unsigned long totalPins = numberOfExpanders * pinsPerExpander;
+
+    runBenchmark("MultiIoAbstraction writeValue", 2000000, [&multiIo, totalPins](unsigned long i) {
+        multiIo.writeValue(pinid_t(100 + (i % totalPins)), (i & 1));
+    });
+
+    volatile uint8_t sink = 0;
+    runBenchmark("MultiIoAbstraction readValue", 2000000, [&multiIo, &sink, totalPins](unsigned long i) {
+        sink = sink + multiIo.readValue(pinid_t(100 + (i % totalPins)));
+    });
+
+    runBenchmark("MultiIoAbstraction readPins", 1000000, [&multiIo, &sink](unsigned long i) {
+        sink = sink + (uint8_t)multiIo.readPins(pinid_t(100 + ((i % 4) * 32)), 0xffffffffUL);
+    });
+
+    runBenchmark("MultiIoAbstraction runLoop", 500000, [&multiIo, totalPins](unsigned long i) {
+        multiIo.writeValue(pinid_t(100 + (i % totalPins)), 1);
+        multiIo.runLoop();
+    });
+}
+
+//
+// Matrix keyboard, a 4x4 layout on the device pins with a key held down on one row from time to time. Note that
+// exec() yields to task manager for 500uS per column, on host this is simulated time so does not affect the result
+// other than the cost of the yield itself.
+//
+
+class BenchKeyboardListener : public KeyboardListener {
+public:
+    void keyPressed(char /*key*/, bool /*held*/) override { benchKeyEvents++; }
+    void keyReleased(char /*key*/) override { benchKeyEvents++; }
+};
+
+void benchmarkMatrixKeyboard() {
+    hostPinSimulation().reset();
+    hostSetMicrosAutoAdvance(50);
+
+    MAKE_KEYBOARD_LAYOUT_4X4(layout)
+    for(int i = 0; i < 4; i++) {
+        layout.setRowPin(i, 10 + i);
+        layout.setColPin(i, 20 + i);
+    }
+    BenchKeyboardListener listener;
+    MatrixKeyboardManager keyboard;
+    keyboard.initialise(internalDigitalIo(), &layout, &listener);
+
+    runBenchmark("MatrixKeyboardManager::exec", 100000, [&keyboard](unsigned long i) {
+        if((i % 32) == 0) {
+            hostPinSimulation().setInputLevel(11, ((i / 32) % 2) != 0);
+        }
+        keyboard.exec();
+    });
+
+    hostSetMicrosAutoAdvance(1);
+}
+
+//
+// EEPROM wear levelling, a memory backed EEPROM counts the writes to each cell, so that the write amplification and
+// the wear on the most written cell can be compared between writing in place and going through WearLevelledEeprom.
+// Mounting is compared against loading the same settings directly with one array read.
+//
+
+#define BENCH_EEPROM_SIZE 1024
+#define BENCH_WEAR_LOGICAL 64
+
+class BenchCountingEeprom : public EepromAbstraction {
+private:
+    uint8_t data[BENCH_EEPROM_SIZE] = {};
+    unsigned long cellWrites[BENCH_EEPROM_SIZE] = {};
+    unsigned long bytesWritten = 0;
+    unsigned long readCalls = 0;
+public:
+    bool hasErrorOccurred() override { return false; }
+    uint8_t read8(EepromPosition position) override { readCalls++; return data[position]; }
+    void write8(EepromPosition position, uint8_t val) override { writeArrayToRom(position, &val, 1); }
+    uint16_t read16(EepromPosition position) override { readCalls++; return data[position] | (data[position + 1] << 8U); }
+    void write16(EepromPosition position, uint16_t val) override {
+        uint8_t bytes[2] = { uint8_t(val), uint8_t(val >> 8U) };
+        writeArrayToRom(position, bytes, sizeof bytes);
+    }
+    uint32_t read32(EepromPosition position) override {
+        readCalls++;
+        return data[position] | (data[position + 1] << 8U) | (data[position + 2] << 16U) | ((uint32_t)data[position + 3] << 24U);
+    }
+    void write32(EepromPosition position, uint32_t val) override {
+        uint8_t bytes[4] = { uint8_t(val), uint8_t(val >> 8U), uint8_t(val >> 16U), uint8_t(val >> 24U) };
+        writeArrayToRom(position, bytes, sizeof bytes);
+    }
+    void readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) override {
+        readCalls++;
+        memcpy(memDest, &data[romSrc], len);
+    }
+    void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) override {
+        for(int i = 0; i < len; i++) {
+            data[romDest + i] = memSrc[i];
+            cellWrites[romDest + i]++;
+        }
+        bytesWritten += len;
+    }
+
+    void resetCounts() {
+        memset(cellWrites, 0, sizeof cellWrites);
+        bytesWritten = 0;
+        readCalls = 0;
+    }
+    unsigned long getBytesWritten() const { return bytesWritten; }
+    unsigned long getReadCalls() const { return readCalls; }
+    unsigned long getMostWrittenCell() const {
+        unsigned long most = 0;
+        for(auto writes : cellWrites) most = internal_max(most, writes);
+        return most;
+    }
+};
+
+void reportEepromWear(const char* name, BenchCountingEeprom& eeprom, unsigned long logicalBytes) {
+    if(logicalBytes == 0) return;
+    printf("%-36s physical bytes per logical byte %.2f, most writes to one cell %lu\n", name,
+           (double)eeprom.getBytesWritten() / (double)logicalBytes, eeprom.getMostWrittenCell());
+}
+
+void benchmarkEepromWearLevelling() {
+    const unsigned long iterations = 100000;
+    auto direct = new BenchCountingEeprom();
+    auto backing = new BenchCountingEeprom();
+
+    // a counter that is saved often, the worst case for writing in place as it hits the same cells every time.
+    auto calls = runBenchmark("EEPROM direct write32", iterations, [direct](unsigned long i) {
+        direct->write32(0, i);
+    });
+    reportEepromWear("EEPROM direct write32", *direct, calls * 4);
+
+    auto wearLevelled = new WearLevelledEeprom(backing, 0, BENCH_EEPROM_SIZE, BENCH_WEAR_LOGICAL);
+    wearLevelled->begin();
+    backing->resetCounts();
+    calls = runBenchmark("WearLevelledEeprom write32", iterations, [wearLevelled](unsigned long i) {
+        wearLevelled->write32(0, i);
+    });
+    reportEepromWear("WearLevelledEeprom write32", *backing, calls * 4);
+
+    // mounting with a half full journal, against reading the same settings in one go from a direct layout.
+    uint8_t settings[BENCH_WEAR_LOGICAL];
+    runBenchmark("EEPROM direct mount", 100000, [direct, &settings](unsigned long) {
+        direct->readIntoMemArray(settings, 0, sizeof settings);
+    });
+
+    wearLevelled->format();
+    for(int i = 0; wearLevelled->getJournalSpace() > (BENCH_EEPROM_SIZE / 4); i++) {
+        wearLevelled->write8(i % BENCH_WEAR_LOGICAL, i + 1);
+    }
+    backing->resetCounts();
+    calls = runBenchmark("WearLevelledEeprom mount", 10000, [backing](unsigned long) {
+        WearLevelledEeprom mounted(backing, 0, BENCH_EEPROM_SIZE, BENCH_WEAR_LOGICAL);
+        mounted.begin();
+    });
+    if(calls != 0) {
+        printf("%-36s backing reads per mount %.1f\n", "WearLevelledEeprom mount",
+               (double)backing->getReadCalls() / (double)calls);
+    }
+
+    delete wearLevelled;
+    delete backing;
+    delete direct;
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1) benchFilter = argv[1];
+
+    printf("%-36s %10s %12s %12s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+
+    benchmarkSwitchesRunLoop("SwitchInput::runLoop 8 keys", 8);
+    benchmarkSwitchesRunLoop("SwitchInput::runLoop 32 keys", 32);
+    benchmarkSwitchesRunLoop("SwitchInput::runLoop 128 keys", 128);
+    benchmarkKeyboardItemTransitions();
+    benchmarkEncoders();
+    benchmarkMultiIoDispatch();
+    benchmarkMatrixKeyboard();
+    benchmarkEepromWearLevelling();
+
+    switches.resetAllSwitches();
+    printf("events seen %lu\n", benchKeyEvents);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <TaskManagerIO.h>
+#include <DeferredCommitPolicy.h>
+#include <MockEepromAbstraction.h>
+#include <host/HostDigitalIO.h>
+#include <unity.h>
+
+/**
+ * A mock EEPROM that counts each flush, and can be made to fail them.
+ */
+class FlushCountingEeprom : public MockEepromAbstraction {
+public:
+    int flushes = 0;
+    bool failFlush = false;
+
+    FlushCountingEeprom() : MockEepromAbstraction(128) {}
+
+    bool flush() override {
+        flushes++;
+        return !failFlush;
+    }
+};
+
+// moves the clock on in 10 millisecond steps, running task manager at each step as the main loop would.
+static void runForMillis(unsigned long millisToRun) {
+    for(unsigned long i = 0; i < millisToRun; i += 10) {
+        hostAdvanceMicros(10000UL);
+        taskManager.runLoop();
+    }
+}
+
+void testDeferredCommitAfterQuietPeriod() {
+    FlushCountingEeprom rom;
+    DeferredCommitPolicy policy(&rom, 100, 1000);
+    TEST_ASSERT_FALSE(policy.isPending());
+
+    rom.write8(0, 1);
+    policy.changed();
+    TEST_ASSERT_TRUE(policy.isPending());
+    runForMillis(50);
+    rom.write8(1, 2);
+    policy.changed();
+
+    // the second change restarts the quiet period
+    runForMillis(90);
+    TEST_ASSERT_EQUAL(0, rom.flushes);
+    runForMillis(30);
+    TEST_ASSERT_EQUAL(1, rom.flushes);
+    TEST_ASSERT_FALSE(policy.isPending());
+    TEST_ASSERT_EQUAL((uint32_t)2, policy.getStats().changesNotified);
+    TEST_ASSERT_EQUAL((uint32_t)1, policy.getStats().quietCommits);
+    TEST_ASSERT_EQUAL((uint32_t)0, policy.getStats().latencyCommits);
+
+    // with nothing changed there is nothing more to commit
+    runForMillis(500);
+    TEST_ASSERT_EQUAL(1, rom.flushes);
+    TEST_ASSERT_TRUE(policy.commitNow());
+    TEST_ASSERT_EQUAL(1, rom.flushes);
+
+    taskManager.reset();
+}
+
+void testDeferredCommitAtMaxLatency() {
+    FlushCountingEeprom rom;
+    DeferredCommitPolicy policy(&rom, 100, 300);
+
+    // changes every 50 milliseconds never leave a quiet period, so the maximum latency forces the commit
+    for(int i = 0; i < 7; i++) {
+        policy.changed();
+        runForMillis(50);
+    }
+    TEST_ASSERT_EQUAL(1, rom.flushes);
+    TEST_ASSERT_EQUAL((uint32_t)1, policy.getStats().latencyCommits);
+    TEST_ASSERT_EQUAL((uint32_t)0, policy.getStats().quietCommits);
+    TEST_ASSERT_TRUE(policy.isPending());
+
+    runForMillis(150);
+    TEST_ASSERT_EQUAL(2, rom.flushes);
+    TEST_ASSERT_EQUAL((uint32_t)1, policy.getStats().quietCommits);
+
+    taskManager.reset();
+}
+
+void testDeferredCommitRateLimitAndFailure() {
+    FlushCountingEeprom rom;
+    DeferredCommitPolicy policy(&rom, 10, 50, 500);
+    policy.changed();
+    runForMillis(20);
+    TEST_ASSERT_EQUAL(1, rom.flushes);
+
+    // the next commit waits for the minimum interval, even beyond the maximum latency
+    policy.changed();
+    TEST_ASSERT_TRUE(policy.millisUntilCommit(millis()) > 400);
+    runForMillis(400);
+    TEST_ASSERT_EQUAL(1, rom.flushes);
+    runForMillis(100);
+    TEST_ASSERT_EQUAL(2, rom.flushes);
+    TEST_ASSERT_EQUAL((uint32_t)1, policy.getStats().rateLimitedCommits);
+    TEST_ASSERT_EQUAL((uint32_t)1, policy.getStats().quietCommits);
+    TEST_ASSERT_EQUAL((uint32_t)0, policy.getStats().latencyCommits);
+
+    // a failed commit is kept pending and tried again
+    rom.failFlush = true;
+    policy.changed();
+    runForMillis(520);
+    TEST_ASSERT_EQUAL(3, rom.flushes);
+    TEST_ASSERT_TRUE(policy.isPending());
+    TEST_ASSERT_EQUAL((uint32_t)1, policy.getStats().failedCommits);
+    TEST_ASSERT_EQUAL((uint32_t)2, policy.getStats().rateLimitedCommits);
+
+    // commitNow does not wait for the timings
+    rom.failFlush = false;
+    TEST_ASSERT_TRUE(policy.commitNow());
+    TEST_ASSERT_FALSE(policy.isPending());
+    TEST_ASSERT_EQUAL(4, rom.flushes);
+
+    auto& stats = policy.getStats();
+    TEST_ASSERT_EQUAL((uint32_t)4, stats.commits);
+    TEST_ASSERT_TRUE(stats.maxCommitMicros >= stats.lastCommitMicros);
+    TEST_ASSERT_TRUE(stats.totalCommitMicros >= stats.maxCommitMicros);
+    policy.resetStats();
+    TEST_ASSERT_EQUAL((uint32_t)0, policy.getStats().commits);
+    TEST_ASSERT_EQUAL((uint32_t)0, policy.getStats().rateLimitedCommits);
+
+    taskManager.reset();
+}
@@ -0,0 +1,496 @@
+#include <TaskManagerIO.h>
+#include <EepromAbstractionWire.h>
+#include <AtomicSettingsEeprom.h>
+#include <host/HostDigitalIO.h>
+#include <host/HostI2cDeviceModels.h>
+#include <unity.h>
+#include <string.h>
+
+void testAt24ByteAccessCost() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+
+    // write8 reads the byte first, which is the address then a one byte read, then writes the address and data.
+    eeprom.write8(100, 0x42);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint32_t)5, bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL((uint32_t)1, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint8_t)0x42, romModel.getMemory()[100]);
+    TEST_ASSERT_TRUE(romModel.isBusy());
+
+    // writing the same value again costs only the read, there is no write cycle.
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    bus.resetCounts();
+    eeprom.write8(100, 0x42);
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().transactions());
+    TEST_ASSERT_EQUAL((uint32_t)1, romModel.getWriteCycles());
+
+    // write32 is a byte at a time, so four write cycles
+    eeprom.write32(200, 0x11223344UL);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)5, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL(0x11223344UL, eeprom.read32(200));
+}
+
+void testAt24WaitsForWriteCycle() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+
+    eeprom.write8(10, 1);
+    TEST_ASSERT_TRUE(romModel.isBusy());
+
+    // the next access has to poll until the write cycle ends, the device NACKs until then.
+    bus.resetCounts();
+    TEST_ASSERT_EQUAL((uint8_t)1, eeprom.read8(10));
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_TRUE(bus.getCounts().readyPolls > 1);
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().nacks);
+}
+
+void testAt24ArraysSplitAtPages() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+    bus.setMaxTransferSize(32);
+
+    uint8_t data[40];
+    for(uint8_t i = 0; i < sizeof data; i++) data[i] = i + 1;
+
+    // 60 to 99 crosses the page boundary at 64, so it is two page writes of 4 and 36 bytes, but the second is
+    // limited by the 32 byte wire buffer to 30 after the address, giving three writes in all.
+    eeprom.writeArrayToRom(60, data, sizeof data);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)3, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)(sizeof data + 6), bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, romModel.getMemory() + 60, sizeof data);
+
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    bus.resetCounts();
+    uint8_t readBack[40] = {};
+    eeprom.readIntoMemArray(readBack, 60, sizeof readBack);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBack, sizeof data);
+
+    // reads are not limited by the page, only by the wire buffer, so 32 then 8
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint32_t)sizeof data, bus.getCounts().bytesRead);
+}
+
+void testAt24UsesFullPageWhenBusAllows() {
+    HostI2cBus bus;
+    HostAt24Model romModel(65536, 128);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C512, &bus);
+
+    uint8_t data[200];
+    for(uint8_t i = 0; i < sizeof data; i++) data[i] = i ^ 0x5a;
+
+    // with no wire buffer limit, a whole 128 byte page goes in one write cycle, so 0..199 is 128 then 72.
+    eeprom.writeArrayToRom(0, data, sizeof data);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)2, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint32_t)(sizeof data + 4), bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, romModel.getMemory(), sizeof data);
+
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    bus.resetCounts();
+    uint8_t readBack[200] = {};
+    eeprom.readIntoMemArray(readBack, 0, sizeof readBack);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBack, sizeof data);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+}
+
+void testAt24SmallPartBlocks() {
+    HostI2cBus bus;
+    HostAt24Model romModel(512, 16);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C04, &bus);
+
+    // one address byte, the upper address bit goes into the I2C address
+    TEST_ASSERT_NOT_NULL(bus.getDevice(0x51));
+    eeprom.write8(300, 0x99);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint8_t)0x99, romModel.getMemory()[300]);
+    TEST_ASSERT_EQUAL((uint8_t)0x99, eeprom.read8(300));
+}
+
+void testAt24RangeEndsOnLastByte() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+
+    // a range that ends on the last byte of the device is in bounds, for writes, reads and the cache
+    uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    eeprom.writeArrayToRom(32760, data, sizeof data);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint8_t)8, romModel.getMemory()[32767]);
+
+    uint8_t readBack[8] = {};
+    eeprom.readIntoMemArray(readBack, 32760, sizeof readBack);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBack, sizeof data);
+
+    eeprom.setPageCache(1, 0);
+    eeprom.write8(32767, 0x77);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_TRUE(eeprom.flush());
+    TEST_ASSERT_EQUAL((uint8_t)0x77, romModel.getMemory()[32767]);
+
+    // one byte further is past the end
+    eeprom.setPageCache(0);
+    eeprom.readIntoMemArray(readBack, 32761, sizeof readBack);
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+    eeprom.writeArrayToRom(32761, data, sizeof data);
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+    eeprom.write8(32768, 0x11);
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+}
+
+void testAt24ModelPageWrap() {
+    HostI2cBus bus;
+    HostAt24Model romModel(4096, 32);
+    romModel.attach(bus, 0x50);
+
+    // a write that goes past the end of the page wraps around to the start of the same page, as on the real chip.
+    uint8_t raw[] = { 0x00, 30, 1, 2, 3, 4 };
+    TEST_ASSERT_TRUE(bus.write(0x50, raw, sizeof raw, true));
+    TEST_ASSERT_EQUAL((uint8_t)1, romModel.getMemory()[30]);
+    TEST_ASSERT_EQUAL((uint8_t)2, romModel.getMemory()[31]);
+    TEST_ASSERT_EQUAL((uint8_t)3, romModel.getMemory()[0]);
+    TEST_ASSERT_EQUAL((uint8_t)4, romModel.getMemory()[1]);
+    TEST_ASSERT_EQUAL((uint8_t)0xff, romModel.getMemory()[32]);
+
+    // while busy the device does not acknowledge
+    TEST_ASSERT_FALSE(bus.ready(0x50));
+    TEST_ASSERT_FALSE(bus.write(0x50, raw, 2, false));
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    TEST_ASSERT_TRUE(bus.ready(0x50));
+}
+
+void testAt24PageCacheCoalescesWrites() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+    eeprom.setPageCache(4, 0);
+
+    // 200 bytes of menu state written a value at a time, 0 to 199 spans four pages.
+    for(int i = 0; i < 50; i++) {
+        eeprom.write32(i * 4, 0x01020304UL * (i + 1));
+    }
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_TRUE(eeprom.isCacheDirty());
+    TEST_ASSERT_EQUAL((uint32_t)0, romModel.getWriteCycles());
+
+    // read hits come from the cache, without touching the bus.
+    bus.resetCounts();
+    TEST_ASSERT_EQUAL(0x01020304UL * 10, eeprom.read32(9 * 4));
+    uint8_t readBack[8];
+    eeprom.readIntoMemArray(readBack, 100, sizeof readBack);
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().transactions());
+
+    // one page write per page on flush, instead of 200 byte writes.
+    TEST_ASSERT_TRUE(eeprom.flush());
+    TEST_ASSERT_FALSE(eeprom.isCacheDirty());
+    TEST_ASSERT_EQUAL((uint32_t)4, romModel.getWriteCycles());
+    for(int i = 0; i < 50; i++) {
+        uint32_t expected = 0x01020304UL * (i + 1);
+        uint8_t* mem = romModel.getMemory() + (i * 4);
+        TEST_ASSERT_EQUAL(expected, ((uint32_t)mem[0] << 24U) | ((uint32_t)mem[1] << 16U) | ((uint32_t)mem[2] << 8U) | mem[3]);
+    }
+
+    // writing the same values again changes nothing, so there is nothing to flush.
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    eeprom.write32(0, 0x01020304UL);
+    TEST_ASSERT_FALSE(eeprom.isCacheDirty());
+    TEST_ASSERT_TRUE(eeprom.flush());
+    TEST_ASSERT_EQUAL((uint32_t)4, romModel.getWriteCycles());
+}
+
+void testAt24PageCacheEvictsAndFlushesOnTimer() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+    eeprom.setPageCache(1, 100);
+
+    // with a single page cached, moving to another page writes out the first one.
+    eeprom.write8(10, 0x11);
+    eeprom.write8(11, 0x22);
+    TEST_ASSERT_EQUAL((uint32_t)0, romModel.getWriteCycles());
+    eeprom.write8(70, 0x33);
+    TEST_ASSERT_EQUAL((uint32_t)1, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint8_t)0x22, romModel.getMemory()[11]);
+
+    // a read that misses the cache goes to the device, and is combined with what is cached.
+    uint8_t readBack[64];
+    eeprom.readIntoMemArray(readBack, 10, sizeof readBack);
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint8_t)0x11, readBack[0]);
+    TEST_ASSERT_EQUAL((uint8_t)0x33, readBack[60]);
+
+    // the timed flush writes the pending page once the time is up.
+    TEST_ASSERT_TRUE(eeprom.isCacheDirty());
+    hostAdvanceMicros(101000UL);
+    taskManager.runLoop();
+    TEST_ASSERT_FALSE(eeprom.isCacheDirty());
+    TEST_ASSERT_EQUAL((uint32_t)2, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint8_t)0x33, romModel.getMemory()[70]);
+}
+
+void testAt24TimedFlushRetriesAfterFailure() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+    eeprom.setPageCache(1, 100);
+    eeprom.write8(10, 0x44);
+
+    // the device does not answer when the timed flush runs, so the page is still changed afterwards.
+    bus.detachDevice(0x50);
+    hostAdvanceMicros(101000UL);
+    taskManager.runLoop();
+    TEST_ASSERT_TRUE(eeprom.isCacheDirty());
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)0, romModel.getWriteCycles());
+
+    // without any further writes, the flush is tried again after the same time and now succeeds.
+    romModel.attach(bus, 0x50);
+    hostAdvanceMicros(101000UL);
+    taskManager.runLoop();
+    TEST_ASSERT_FALSE(eeprom.isCacheDirty());
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)1, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint8_t)0x44, romModel.getMemory()[10]);
+}
+
+static int asyncCompleteCalls = 0;
+static bool asyncCompleteResult = false;
+
+void testAt24AsyncWritesPollOnQueue() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+    asyncCompleteCalls = 0;
+    eeprom.setAsyncWrites(true, [](I2cAt24Eeprom*, bool ok) {
+        asyncCompleteCalls++;
+        asyncCompleteResult = ok;
+    });
+
+    uint8_t data[200];
+    for(uint8_t i = 0; i < sizeof data; i++) data[i] = i + 3;
+
+    // four page writes are queued and the call returns without touching the bus.
+    eeprom.writeArrayToRom(0, data, sizeof data);
+    TEST_ASSERT_TRUE(eeprom.isWritePending());
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().transactions());
+
+    // the caller's buffer can be reused straight away, each write holds a copy.
+    memset(data, 0, sizeof data);
+
+    // each write waits for the previous write cycle by polling between tasks
+    int loops = 0;
+    while(eeprom.isWritePending() && ++loops < 1000) {
+        hostAdvanceMicros(I2C_QUEUE_POLL_MICROS);
+        taskManager.runLoop();
+    }
+    TEST_ASSERT_FALSE(eeprom.isWritePending());
+    TEST_ASSERT_EQUAL(1, asyncCompleteCalls);
+    TEST_ASSERT_TRUE(asyncCompleteResult);
+    TEST_ASSERT_TRUE(eeprom.lastAsyncWriteResult());
+    TEST_ASSERT_EQUAL((uint32_t)4, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().nacks);
+    TEST_ASSERT_EQUAL((uint8_t)3, romModel.getMemory()[0]);
+    TEST_ASSERT_EQUAL((uint8_t)202, romModel.getMemory()[199]);
+
+    // a read waits for queued writes to complete, so it always sees the latest data
+    eeprom.write8(5, 0x77);
+    TEST_ASSERT_TRUE(eeprom.isWritePending());
+    TEST_ASSERT_EQUAL((uint8_t)0x77, eeprom.read8(5));
+    TEST_ASSERT_FALSE(eeprom.isWritePending());
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL(2, asyncCompleteCalls);
+
+    eeprom.setAsyncWrites(false);
+}
+
+void testAt24PageCacheKeepsPageDirtyOnAsyncNack() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+    eeprom.setPageCache(1, 0);
+    eeprom.setAsyncWrites(true);
+
+    eeprom.write8(20, 0x5A);
+    TEST_ASSERT_TRUE(eeprom.isCacheDirty());
+
+    // the queued write is refused by the device, so the page must still be changed after the flush.
+    bus.detachDevice(0x50);
+    TEST_ASSERT_FALSE(eeprom.flush());
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_TRUE(eeprom.isCacheDirty());
+    TEST_ASSERT_FALSE(eeprom.isWritePending());
+    TEST_ASSERT_FALSE(eeprom.lastAsyncWriteResult());
+    TEST_ASSERT_EQUAL((uint32_t)0, romModel.getWriteCycles());
+
+    // once the device answers again the next flush writes the change out.
+    romModel.attach(bus, 0x50);
+    TEST_ASSERT_TRUE(eeprom.flush());
+    TEST_ASSERT_FALSE(eeprom.isCacheDirty());
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint8_t)0x5A, romModel.getMemory()[20]);
+
+    eeprom.setAsyncWrites(false);
+}
+
+void testAtomicSettingsBootIsOneBulkRead() {
+    HostI2cBus bus;
+    HostAt24Model romModel(32768, 64);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C256, &bus);
+
+    AtomicSettingsEeprom settings(&eeprom, 0x100, 100);
+    settings.begin();
+    for(int i = 0; i < 25; i++) {
+        settings.write32(i * 4, 0x01020304UL * (i + 1));
+    }
+    TEST_ASSERT_TRUE(settings.commit());
+    TEST_ASSERT_EQUAL((uint8_t)0, settings.getActiveCopy());
+
+    // booting reads the two headers, then all the settings in one read, instead of a read for each field.
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    bus.resetCounts();
+    AtomicSettingsEeprom booted(&eeprom, 0x100, 100);
+    TEST_ASSERT_TRUE(booted.begin());
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint32_t)(2 * ATOMIC_SETTINGS_HEADER_SIZE + 100), bus.getCounts().bytesRead);
+    for(int i = 0; i < 25; i++) {
+        TEST_ASSERT_EQUAL(0x01020304UL * (i + 1), booted.read32(i * 4));
+    }
+
+    // with a page cache on the EEPROM, the commit still flushes the settings before the header that validates them.
+    eeprom.setPageCache(2);
+    booted.write32(0, 0xdeadbeefUL);
+    TEST_ASSERT_TRUE(booted.commit());
+    TEST_ASSERT_FALSE(eeprom.isCacheDirty());
+    AtomicSettingsEeprom again(&eeprom, 0x100, 100);
+    TEST_ASSERT_TRUE(again.begin());
+    TEST_ASSERT_EQUAL((uint32_t)2, again.getSequence());
+    TEST_ASSERT_EQUAL(0xdeadbeefUL, again.read32(0));
+    eeprom.setPageCache(0);
+}
+
+uint8_t at24WideData[600];
+uint8_t at24WideReadBack[600];
+
+void testAt24WideAccessAcrossBlocks() {
+    HostI2cBus bus;
+    HostAt24Model romModel(262144, 256);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24CM02, &bus);
+    for(size_t i = 0; i < sizeof at24WideData; i++) at24WideData[i] = uint8_t(i * 3);
+
+    // this crosses from the first 64K block into the second, each is a different I2C address on the AT24CM02.
+    TEST_ASSERT_TRUE(eeprom.writeArrayToRomWide(0xff00UL, at24WideData, sizeof at24WideData));
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)3, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL(at24WideData[0], romModel.getMemory()[0xff00]);
+    TEST_ASSERT_EQUAL(at24WideData[256], romModel.getMemory()[0x10000]);
+    TEST_ASSERT_EQUAL(at24WideData[599], romModel.getMemory()[0xff00 + 599]);
+
+    // reads carry on across pages, but not across 64K blocks, so this is two reads.
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(eeprom.readIntoMemArrayWide(at24WideReadBack, 0xff00UL, sizeof at24WideReadBack));
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(at24WideData, at24WideReadBack, sizeof at24WideData);
+
+    // the top block is at the fourth I2C address
+    romModel.getMemory()[0x30010] = 0x5a;
+    uint8_t top = 0;
+    TEST_ASSERT_TRUE(eeprom.readIntoMemArrayWide(&top, 0x30010UL, 1));
+    TEST_ASSERT_EQUAL((uint8_t)0x5a, top);
+
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_FALSE(eeprom.readIntoMemArrayWide(at24WideReadBack, 0x3ff00UL, sizeof at24WideReadBack));
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+
+    // the narrow functions still work on the first 64K
+    eeprom.write16(0x20, 0xcafe);
+    TEST_ASSERT_EQUAL((uint16_t)0xcafe, eeprom.read16(0x20));
+}
+
+void testAt24AsyncFullPageOnLargeParts() {
+    HostI2cBus bus;
+    HostAt24Model romModel(262144, 256);
+    romModel.attach(bus, 0x50);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24CM02, &bus);
+    eeprom.setAsyncWrites(true);
+    for(size_t i = 0; i < 256; i++) at24WideData[i] = uint8_t(i ^ 0xa5);
+
+    // a whole 256 byte page and its two address bytes are over 255, so all 258 must go out in the one transaction.
+    TEST_ASSERT_TRUE(eeprom.writeArrayToRomWide(0x10000UL, at24WideData, 256));
+    int loops = 0;
+    while(eeprom.isWritePending() && ++loops < 1000) {
+        hostAdvanceMicros(I2C_QUEUE_POLL_MICROS);
+        taskManager.runLoop();
+    }
+    TEST_ASSERT_FALSE(eeprom.isWritePending());
+    TEST_ASSERT_TRUE(eeprom.lastAsyncWriteResult());
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)1, romModel.getWriteCycles());
+    TEST_ASSERT_EQUAL((uint32_t)258, bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(at24WideData, &romModel.getMemory()[0x10000], 256);
+
+    // with a 256 byte wire buffer, the page is split so that each transaction still carries all of its data.
+    eeprom.setAsyncWrites(false);
+    bus.setMaxTransferSize(256);
+    eeprom.setAsyncWrites(true);
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    bus.resetCounts();
+    for(size_t i = 0; i < 256; i++) at24WideData[i] = uint8_t(i + 7);
+    TEST_ASSERT_TRUE(eeprom.writeArrayToRomWide(0x20000UL, at24WideData, 256));
+    loops = 0;
+    while(eeprom.isWritePending() && ++loops < 1000) {
+        hostAdvanceMicros(I2C_QUEUE_POLL_MICROS);
+        taskManager.runLoop();
+    }
+    TEST_ASSERT_TRUE(eeprom.lastAsyncWriteResult());
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)260, bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(at24WideData, &romModel.getMemory()[0x20000], 256);
+
+    eeprom.setAsyncWrites(false);
+}
+
+void testAt24SizesOnSixteenBitLengths() {
+    // the device sizes do not depend on size_t, which is only 16 bits on AVR
+    static_assert(sizeof(at24ActualSizeFromRomSize(PAGESIZE_AT24C01)) >= 4, "AT24 sizes must hold the largest parts");
+    TEST_ASSERT_EQUAL_UINT32(65535UL, at24ActualSizeFromRomSize(PAGESIZE_AT24C512));
+    TEST_ASSERT_EQUAL_UINT32(262143UL, at24ActualSizeFromRomSize(PAGESIZE_AT24CM02));
+
+    // a whole 64K block is left at a block boundary, which must not become a limit of 0 with a 16 bit length.
+    TEST_ASSERT_EQUAL_UINT16(300, at24LimitLength<uint16_t>(0x10000UL, 300));
+    TEST_ASSERT_EQUAL_UINT16(256, at24LimitLength<uint16_t>(0x10000UL - 0xff00UL, 300));
+
+    // the AT24C512 holds 65536 bytes, one more than a 16 bit length can count
+    TEST_ASSERT_TRUE(at24RangeFits<uint16_t>(65535UL, 0, 100));
+    TEST_ASSERT_TRUE(at24RangeFits<uint16_t>(65535UL, 65436UL, 100));
+    TEST_ASSERT_FALSE(at24RangeFits<uint16_t>(65535UL, 65437UL, 100));
+    TEST_ASSERT_TRUE(at24RangeFits<uint16_t>(65535UL, 65535UL, 1));
+    TEST_ASSERT_TRUE(at24RangeFits<uint16_t>(262143UL, 0x3ff00UL, 256));
+    TEST_ASSERT_FALSE(at24RangeFits<uint16_t>(262143UL, 0x3ff01UL, 256));
+    TEST_ASSERT_FALSE(at24RangeFits<uint16_t>(255UL, 0, 257));
+}
@@ -0,0 +1,249 @@
+#include <ChunkedPreferenceStore.h>
+#include <unity.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * A fake of the ESP32 Preferences key value store, it keeps each key in memory and counts the calls made on it.
+ */
+class FakePreferences {
+private:
+    std::map<std::string, std::vector<uint8_t>> keys;
+public:
+    int puts = 0;
+    int gets = 0;
+    bool failPuts = false;
+    int putsBeforeFailing = -1;
+
+    bool isKey(const char* key) { return keys.count(key) != 0; }
+
+    size_t getBytesLength(const char* key) { return isKey(key) ? keys[key].size() : 0; }
+
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        gets++;
+        if(!isKey(key) || keys[key].size() > maxLen) return 0;
+        memcpy(buf, keys[key].data(), keys[key].size());
+        return keys[key].size();
+    }
+
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        puts++;
+        if(failPuts || (putsBeforeFailing >= 0 && puts > putsBeforeFailing)) return 0;
+        auto data = (const uint8_t*)value;
+        keys[key] = std::vector<uint8_t>(data, data + len);
+        return len;
+    }
+
+    bool remove(const char* key) { return keys.erase(key) != 0; }
+
+    std::vector<uint8_t>& get(const char* key) { return keys[key]; }
+};
+
+// 300 bytes in chunks of 64 is four full chunks and a last one of 44 bytes
+#define PREFS_TEST_SIZE 300
+#define PREFS_TEST_CHUNK 64
+
+void testChunkedStoreWritesOnlyDirtyChunks() {
+    FakePreferences prefs;
+    ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    store.begin();
+    TEST_ASSERT_EQUAL((uint16_t)5, store.getChunkCount());
+    TEST_ASSERT_FALSE(store.isDirty());
+
+    uint8_t data[4] = { 1, 2, 3, 4 };
+    TEST_ASSERT_TRUE(store.write(70, data, sizeof data));
+    TEST_ASSERT_TRUE(store.isChunkDirty(1));
+    TEST_ASSERT_TRUE(store.write(126, data, sizeof data));
+    TEST_ASSERT_TRUE(store.isChunkDirty(2));
+    TEST_ASSERT_FALSE(store.isChunkDirty(0));
+
+    // only the two chunks that changed are written, each at the full chunk size
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_EQUAL(2, prefs.puts);
+    TEST_ASSERT_EQUAL((uint32_t)2, store.getChunksWritten());
+    TEST_ASSERT_EQUAL((size_t)PREFS_TEST_CHUNK, prefs.getBytesLength("ioa1"));
+    TEST_ASSERT_EQUAL((uint8_t)3, prefs.get("ioa1")[70 - 64 + 2]);
+    TEST_ASSERT_EQUAL((uint8_t)3, prefs.get("ioa2")[0]);
+    TEST_ASSERT_FALSE(prefs.isKey("ioa0"));
+    TEST_ASSERT_FALSE(store.isDirty());
+
+    // writing the same values again does not make anything dirty, so nothing is written
+    store.write(70, data, sizeof data);
+    TEST_ASSERT_FALSE(store.isDirty());
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_EQUAL(2, prefs.puts);
+
+    // the last chunk is shorter, and writes past the end are refused
+    TEST_ASSERT_TRUE(store.write(PREFS_TEST_SIZE - 4, data, sizeof data));
+    TEST_ASSERT_FALSE(store.write(PREFS_TEST_SIZE - 3, data, sizeof data));
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_EQUAL((size_t)44, prefs.getBytesLength("ioa4"));
+
+    char key[IOA_PREFS_MAX_KEY];
+    store.chunkKey(key, 12);
+    TEST_ASSERT_EQUAL_STRING("ioa12", key);
+}
+
+void testChunkedStoreLoadsLazily() {
+    FakePreferences prefs;
+    {
+        ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+        store.begin();
+        uint32_t val = 0xdeadbeefUL;
+        store.write(200, (const uint8_t*)&val, sizeof val);
+        store.write(10, (const uint8_t*)&val, sizeof val);
+        store.commit();
+    }
+
+    // nothing is read at begin, only the chunk that holds the data asked for
+    ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    store.begin();
+    prefs.gets = 0;
+    uint32_t val = 0;
+    TEST_ASSERT_TRUE(store.read(200, (uint8_t*)&val, sizeof val));
+    TEST_ASSERT_EQUAL(0xdeadbeefUL, val);
+    TEST_ASSERT_EQUAL(1, prefs.gets);
+    TEST_ASSERT_TRUE(store.isChunkLoaded(3));
+    TEST_ASSERT_FALSE(store.isChunkLoaded(0));
+
+    // a chunk that was never stored reads as zero without a get
+    uint8_t zero = 0xff;
+    store.read(100, &zero, 1);
+    TEST_ASSERT_EQUAL((uint8_t)0, zero);
+    TEST_ASSERT_EQUAL(1, prefs.gets);
+
+    // writing part of a chunk loads it first, so the rest of the chunk is kept on commit
+    uint8_t one = 1;
+    store.write(11, &one, 1);
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_EQUAL((uint8_t)0xef, prefs.get("ioa0")[10]);
+    TEST_ASSERT_EQUAL((uint8_t)1, prefs.get("ioa0")[11]);
+
+    // reload throws away anything not committed
+    store.write(200, &one, 1);
+    store.reload();
+    TEST_ASSERT_FALSE(store.isDirty());
+    store.read(200, (uint8_t*)&val, sizeof val);
+    TEST_ASSERT_EQUAL(0xdeadbeefUL, val);
+    TEST_ASSERT_TRUE(store.isOk());
+}
+
+void testChunkedStoreMovesSingleBlobToChunks() {
+    FakePreferences prefs;
+    uint8_t blob[PREFS_TEST_SIZE];
+    for(int i = 0; i < PREFS_TEST_SIZE; i++) blob[i] = i;
+    prefs.putBytes("ioa", blob, sizeof blob);
+    prefs.puts = 0;
+
+    // an older version stored everything under the prefix, it is loaded and written back as chunks
+    ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    store.begin();
+    TEST_ASSERT_TRUE(store.isDirty());
+    uint8_t val = 0;
+    store.read(299, &val, 1);
+    TEST_ASSERT_EQUAL((uint8_t)(299 & 0xff), val);
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_EQUAL(5, prefs.puts);
+    TEST_ASSERT_FALSE(prefs.isKey("ioa"));
+
+    ChunkedPreferenceStore<FakePreferences> again(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    again.begin();
+    TEST_ASSERT_FALSE(again.isDirty());
+    uint8_t readBack[PREFS_TEST_SIZE];
+    TEST_ASSERT_TRUE(again.read(0, readBack, sizeof readBack));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(blob, readBack, sizeof blob);
+}
+
+void testChunkedStoreCommitFailureKeepsDirty() {
+    FakePreferences prefs;
+    ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    store.begin();
+    uint8_t val = 42;
+    store.write(0, &val, 1);
+
+    prefs.failPuts = true;
+    TEST_ASSERT_FALSE(store.commit());
+    TEST_ASSERT_FALSE(store.isOk());
+    TEST_ASSERT_TRUE(store.isChunkDirty(0));
+
+    // the chunk is still dirty, so the next commit writes it
+    prefs.failPuts = false;
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_FALSE(store.isDirty());
+    TEST_ASSERT_TRUE(store.isOk());
+    TEST_ASSERT_EQUAL((uint8_t)42, prefs.get("ioa0")[0]);
+}
+
+void testChunkedStoreResumesPartialBlobMove() {
+    FakePreferences prefs;
+    uint8_t blob[PREFS_TEST_SIZE];
+    for(int i = 0; i < PREFS_TEST_SIZE; i++) blob[i] = i;
+    prefs.putBytes("ioa", blob, sizeof blob);
+    prefs.puts = 0;
+
+    // only the first chunk is stored before the commit fails, so the blob has to stay
+    {
+        ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+        store.begin();
+        uint8_t changed = 0xaa;
+        store.write(5, &changed, 1);
+        prefs.putsBeforeFailing = 1;
+        TEST_ASSERT_FALSE(store.commit());
+        TEST_ASSERT_TRUE(prefs.isKey("ioa0"));
+        TEST_ASSERT_FALSE(prefs.isKey("ioa1"));
+        TEST_ASSERT_TRUE(prefs.isKey("ioa"));
+    }
+
+    // at the next boot the stored chunk is used, and the rest still come from the blob
+    prefs.putsBeforeFailing = -1;
+    prefs.puts = 0;
+    ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    store.begin();
+    TEST_ASSERT_TRUE(store.isDirty());
+    TEST_ASSERT_FALSE(store.isChunkDirty(0));
+    TEST_ASSERT_TRUE(store.isChunkDirty(1));
+    uint8_t readBack[PREFS_TEST_SIZE];
+    TEST_ASSERT_TRUE(store.read(0, readBack, sizeof readBack));
+    TEST_ASSERT_EQUAL((uint8_t)0xaa, readBack[5]);
+    blob[5] = 0xaa;
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(blob, readBack, sizeof blob);
+
+    // the commit stores the four chunks that were missing and then removes the blob
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_EQUAL(4, prefs.puts);
+    TEST_ASSERT_FALSE(prefs.isKey("ioa"));
+    TEST_ASSERT_FALSE(store.isDirty());
+
+    ChunkedPreferenceStore<FakePreferences> again(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    again.begin();
+    TEST_ASSERT_TRUE(again.read(0, readBack, sizeof readBack));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(blob, readBack, sizeof blob);
+}
+
+void testChunkedStoreReloadKeepsBlob() {
+    FakePreferences prefs;
+    uint8_t blob[PREFS_TEST_SIZE];
+    for(int i = 0; i < PREFS_TEST_SIZE; i++) blob[i] = 255 - (i & 0xff);
+    prefs.putBytes("ioa", blob, sizeof blob);
+
+    ChunkedPreferenceStore<FakePreferences> store(prefs, "ioa", PREFS_TEST_SIZE, PREFS_TEST_CHUNK);
+    store.begin();
+    uint8_t changed = 1;
+    store.write(100, &changed, 1);
+
+    // a reload before the blob is moved over reads it again, rather than the chunks that do not exist yet
+    store.reload();
+    TEST_ASSERT_TRUE(store.isDirty());
+    uint8_t readBack[PREFS_TEST_SIZE];
+    TEST_ASSERT_TRUE(store.read(0, readBack, sizeof readBack));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(blob, readBack, sizeof blob);
+
+    TEST_ASSERT_TRUE(store.commit());
+    TEST_ASSERT_FALSE(prefs.isKey("ioa"));
+    store.reload();
+    TEST_ASSERT_FALSE(store.isDirty());
+    TEST_ASSERT_TRUE(store.read(0, readBack, sizeof readBack));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(blob, readBack, sizeof blob);
+}
@@ -0,0 +1,245 @@
+#include <TaskManagerIO.h>
+#include <IoAbstraction.h>
+#include <host/HostDigitalIO.h>
+#include <host/HostShiftRegisterModel.h>
+#include <host/HostSpiBus.h>
+#include <extras/SPIShiftRegisterIoAbstraction.h>
+#include <unity.h>
+
+//
+// These tests run the shift register abstractions against a simulated chain wired to the host pins, checking the
+// bits that are actually clocked in and out of each device.
+//
+
+#define OUT_CLOCK_PIN 10
+#define OUT_DATA_PIN 11
+#define OUT_LATCH_PIN 12
+#define IN_CLOCK_PIN 13
+#define IN_DATA_PIN 14
+#define IN_LATCH_PIN 15
+
+void testShiftRegisterBulkPinsOnModel() {
+    hostPinSimulation().reset();
+    HostShiftRegisterModel model(OUT_CLOCK_PIN, OUT_DATA_PIN, OUT_LATCH_PIN, 2, IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 2);
+    hostPinSimulation().setPinListener(&model);
+    ShiftRegisterIoAbstraction shiftReg(ShiftRegConfig(IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 2),
+                                        ShiftRegConfig(OUT_CLOCK_PIN, OUT_DATA_PIN, OUT_LATCH_PIN, 2));
+
+    // the first byte shifted in is from the device wired to the board, it holds the highest input pins
+    model.setInput(0, 0x12);
+    model.setInput(1, 0x34);
+    shiftReg.writePins(32, 0xffff, 0xbeef);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(1, model.getInputLoads());
+    TEST_ASSERT_EQUAL_UINT32(0x1234, shiftReg.readPins(0, 0xffff));
+    TEST_ASSERT_EQUAL_UINT32(0x23, shiftReg.readPins(4, 0xff));
+    TEST_ASSERT_EQUAL_UINT32(0, shiftReg.readPins(32, 0xffff));
+
+    // the first byte shifted out ends up on the device furthest from the board, that is pins 32 to 39
+    TEST_ASSERT_EQUAL_UINT32(1, model.getOutputLatches());
+    TEST_ASSERT_EQUAL_HEX8(0xef, model.getOutput(1));
+    TEST_ASSERT_EQUAL_HEX8(0xbe, model.getOutput(0));
+
+    // a bulk write that starts among the inputs only changes the outputs in the mask
+    shiftReg.writePins(28, 0xff, 0x0f);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_HEX8(0xe0, model.getOutput(1));
+    TEST_ASSERT_EQUAL_HEX8(0xbe, model.getOutput(0));
+
+    hostPinSimulation().reset();
+}
+
+void testShiftRegisterLongChainsOnModel() {
+    hostPinSimulation().reset();
+    HostShiftRegisterModel model(OUT_CLOCK_PIN, OUT_DATA_PIN, OUT_LATCH_PIN, 6, IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 4);
+    hostPinSimulation().setPinListener(&model);
+    // asking for more than four input devices is capped, as the inputs have to fit below the output cutover
+    ShiftRegisterIoAbstraction shiftReg(ShiftRegConfig(IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 5),
+                                        ShiftRegConfig(OUT_CLOCK_PIN, OUT_DATA_PIN, OUT_LATCH_PIN, 6));
+
+    for(uint8_t i = 0; i < 4; i++) model.setInput(i, uint8_t(0x10 + i));
+    for(uint8_t i = 0; i < 6; i++) shiftReg.writePort(32 + (i * 8), uint8_t(0xa0 + i));
+    shiftReg.writeValue(32 + 40, LOW);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+
+    TEST_ASSERT_EQUAL_UINT32(0x10111213, shiftReg.readPins(0, 0xffffffff));
+    TEST_ASSERT_EQUAL_UINT8(0x10, shiftReg.readPort(24));
+    TEST_ASSERT_EQUAL_UINT32(0, shiftReg.readPins(32, 0xff));
+    for(uint8_t i = 0; i < 6; i++) {
+        // device 0 holds the last byte shifted out, pins 72 to 79, where pin 72 was cleared
+        uint8_t expected = (i == 0) ? 0xa4 : uint8_t(0xa5 - i);
+        TEST_ASSERT_EQUAL_HEX8(expected, model.getOutput(i));
+    }
+
+    hostPinSimulation().reset();
+}
+
+void testShiftRegisterSyncOptionsOnModel() {
+    hostPinSimulation().reset();
+    HostShiftRegisterModel model(OUT_CLOCK_PIN, OUT_DATA_PIN, OUT_LATCH_PIN, 3, IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 2);
+    hostPinSimulation().setPinListener(&model);
+    ShiftRegisterIoAbstraction shiftReg(ShiftRegConfig(IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 2),
+                                        ShiftRegConfig(OUT_CLOCK_PIN, OUT_DATA_PIN, OUT_LATCH_PIN, 3));
+
+    // by default every write shifts the outputs out, and the inputs are shifted in on every sync
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    shiftReg.writeValue(33, LOW);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(2, model.getOutputLatches());
+    TEST_ASSERT_EQUAL_UINT32(2, model.getInputLoads());
+
+    shiftReg.setSyncOptions((1U << SHIFTREG_OUTPUT_ONLY_ON_CHANGE) | (1U << SHIFTREG_INPUT_ONLY_WHEN_USED));
+
+    // writes that leave the outputs as they were are not shifted, and no input has been set up yet
+    shiftReg.writeValue(33, LOW);
+    shiftReg.writePins(40, 0xffff, 0);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(2, model.getOutputLatches());
+    TEST_ASSERT_EQUAL_UINT32(2, model.getInputLoads());
+
+    shiftReg.writeValue(33, HIGH);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(3, model.getOutputLatches());
+    TEST_ASSERT_EQUAL_HEX8(0x02, model.getOutput(2));
+    TEST_ASSERT_EQUAL_UINT32(2, model.getInputLoads());
+
+    // once an input is set up, the inputs are shifted in on every sync again
+    model.setInput(0, 0x80);
+    shiftReg.pinMode(15, INPUT);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(3, model.getInputLoads());
+    TEST_ASSERT_EQUAL(HIGH, shiftReg.readValue(15));
+    TEST_ASSERT_EQUAL_UINT32(3, model.getOutputLatches());
+
+    hostPinSimulation().reset();
+}
+
+void testShiftRegister165BulkPinsOnModel() {
+    hostPinSimulation().reset();
+    HostShiftRegisterModel model(IO_PIN_NOT_DEFINED, IO_PIN_NOT_DEFINED, IO_PIN_NOT_DEFINED, 0,
+                                 IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 3);
+    hostPinSimulation().setPinListener(&model);
+    ShiftRegisterIoAbstraction165In shiftReg(IN_CLOCK_PIN, IN_DATA_PIN, IN_LATCH_PIN, 3);
+
+    model.setInput(0, 0xa1);
+    model.setInput(1, 0xb2);
+    model.setInput(2, 0xc3);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(0xa1b2c3, shiftReg.readPins(0, 0xffffff));
+    TEST_ASSERT_EQUAL_UINT32(0x1b2c, shiftReg.readPins(4, 0xffff));
+    TEST_ASSERT_EQUAL(HIGH, shiftReg.readValue(23));
+    TEST_ASSERT_EQUAL(LOW, shiftReg.readValue(22));
+
+    hostPinSimulation().reset();
+}
+
+#define SPI_LATCH_PIN 20
+#define SPI_LOAD_PIN 21
+
+/**
+ * A 74HC595 output chain and 74HC165 input chain on the host SPI bus, the chip select is the 595 latch and the 165 load
+ * pin is a board pin, which the chain listens to. Device 0 of the output chain is the one wired to MOSI, and device 0
+ * of the input chain the one wired to MISO.
+ */
+class SpiShiftChainModel : public HostSpiDevice, public HostPinListener {
+private:
+    uint8_t numOut;
+    uint8_t numIn;
+    uint8_t shifting[HOST_SHIFTREG_MAX_DEVICES] = {};
+    uint8_t inputs[HOST_SHIFTREG_MAX_DEVICES] = {};
+    uint8_t loaded[HOST_SHIFTREG_MAX_DEVICES] = {};
+public:
+    uint8_t outputs[HOST_SHIFTREG_MAX_DEVICES] = {};
+    uint32_t latches = 0;
+    uint32_t loads = 0;
+
+    SpiShiftChainModel(uint8_t numOut, uint8_t numIn) : numOut(numOut), numIn(numIn) {}
+
+    void setInput(uint8_t device, uint8_t value) { inputs[device] = value; }
+
+    uint8_t spiTransfer(uint8_t mosi) override {
+        // a whole byte moves each chain along by one device
+        uint8_t miso = numIn ? loaded[0] : 0xff;
+        for(int i = 0; i < numIn; i++) loaded[i] = (i + 1 < numIn) ? loaded[i + 1] : 0;
+        for(int i = numOut - 1; i > 0; i--) shifting[i] = shifting[i - 1];
+        if(numOut) shifting[0] = mosi;
+        return miso;
+    }
+
+    void spiDeselect() override {
+        for(int i = 0; i < numOut; i++) outputs[i] = shifting[i];
+        latches++;
+    }
+
+    void pinWritten(pinid_t pin, bool level) override {
+        if(pin == SPI_LOAD_PIN && !level) {
+            for(int i = 0; i < numIn; i++) loaded[i] = inputs[i];
+            loads++;
+        }
+    }
+
+    void pinRead(pinid_t) override { }
+};
+
+void testSpiShiftRegisterLongChainOnBus() {
+    hostPinSimulation().reset();
+    HostSpiBus bus;
+    SpiShiftChainModel chain(6, 2);
+    bus.attachDevice(SPI_LATCH_PIN, &chain);
+    hostPinSimulation().setPinListener(&chain);
+    SPIWithSettings spi(&bus, SPI_LATCH_PIN);
+    SPIShiftRegisterIoAbstraction shiftReg(spi, SPI_LOAD_PIN, 2, 6);
+
+    // six output devices, more than fit in a 32 bit register, go out in one frame along with the inputs
+    shiftReg.writePins(32, 0xffffffff, 0x44332211);
+    shiftReg.writePort(64, 0x55);
+    shiftReg.writeValue(72, HIGH);
+    shiftReg.writeValue(79, HIGH);
+    chain.setInput(0, 0x12);
+    chain.setInput(1, 0x34);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(1, bus.getCounts().frames);
+    TEST_ASSERT_EQUAL_UINT32(6, bus.getCounts().bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, chain.loads);
+    TEST_ASSERT_EQUAL_UINT32(1, chain.latches);
+
+    // the first output byte ends in the furthest device, the first input byte is from the device wired to MISO.
+    const uint8_t expectedOutputs[] = { 0x81, 0x55, 0x44, 0x33, 0x22, 0x11 };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedOutputs, chain.outputs, 6);
+    TEST_ASSERT_EQUAL_UINT32(0x1234, shiftReg.readPins(0, 0xffff));
+    TEST_ASSERT_EQUAL_UINT8(0x12, shiftReg.readPort(8));
+    TEST_ASSERT_EQUAL(HIGH, shiftReg.readValue(2));
+    TEST_ASSERT_EQUAL(LOW, shiftReg.readValue(1));
+
+    // a bulk write over the cutover only changes the outputs
+    shiftReg.writePins(28, 0xff, 0x00);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_HEX8(0x10, chain.outputs[5]);
+
+    hostPinSimulation().reset();
+}
+
+void testSpiShiftRegisterOutputOnlySkipsIdleSyncs() {
+    hostPinSimulation().reset();
+    HostSpiBus bus;
+    SpiShiftChainModel chain(2, 0);
+    bus.attachDevice(SPI_LATCH_PIN, &chain);
+    SPIWithSettings spi(&bus, SPI_LATCH_PIN);
+    SPIShiftRegisterIoAbstraction shiftReg(spi, IO_PIN_NOT_DEFINED, 0, 2);
+
+    // the first sync always writes, after that only when something was written
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(1, bus.getCounts().frames);
+
+    shiftReg.writeValue(40, HIGH);
+    TEST_ASSERT_TRUE(shiftReg.sync());
+    TEST_ASSERT_EQUAL_UINT32(2, bus.getCounts().frames);
+    TEST_ASSERT_EQUAL_UINT32(4, bus.getCounts().bytes);
+    TEST_ASSERT_EQUAL_HEX8(0x01, chain.outputs[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, chain.outputs[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, shiftReg.readPins(0, 0xff));
+
+    hostPinSimulation().reset();
+}
@@ -0,0 +1,152 @@
+#include <TaskManagerIO.h>
+#include <extras/SPIEepromAbstraction.h>
+#include <host/HostDigitalIO.h>
+#include <host/HostSpiBus.h>
+#include <unity.h>
+#include <string.h>
+
+#define SPI_TEST_CS 10
+
+void testSpiFramBurstAccess() {
+    HostSpiBus bus;
+    HostSpiMemoryModel fram(32768, 0, 2);
+    bus.attachDevice(SPI_TEST_CS, &fram);
+    SPIWithSettings spi(&bus, SPI_TEST_CS);
+    SPIEepromAbstraction rom(spi, SPI_FRAM_MB85RS256);
+    TEST_ASSERT_TRUE(rom.isFram());
+
+    // a long write is a write enable frame then one frame for all of it, there are no pages to split at
+    uint8_t data[200];
+    for(int i = 0; i < 200; i++) data[i] = i;
+    TEST_ASSERT_TRUE(rom.writeArrayToRomWide(100, data, sizeof data));
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().frames);
+    TEST_ASSERT_EQUAL((uint32_t)(1 + 3 + 200), bus.getCounts().bytes);
+    TEST_ASSERT_EQUAL((uint32_t)1, fram.getWriteCycles());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &fram.getMemory()[100], sizeof data);
+    TEST_ASSERT_FALSE(fram.isWriteEnabled());
+
+    // and it is read back in one frame
+    bus.resetCounts();
+    uint8_t readBack[200];
+    TEST_ASSERT_TRUE(rom.readIntoMemArrayWide(readBack, 100, sizeof readBack));
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().frames);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBack, sizeof data);
+
+    // FRAM values are written straight away without reading first, and stored big endian
+    bus.resetCounts();
+    rom.write32(400, 0x11223344UL);
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().frames);
+    TEST_ASSERT_EQUAL((uint8_t)0x11, fram.getMemory()[400]);
+    TEST_ASSERT_EQUAL((uint8_t)0x44, fram.getMemory()[403]);
+    TEST_ASSERT_EQUAL(0x11223344UL, rom.read32(400));
+    rom.write16(404, 0xbeef);
+    TEST_ASSERT_EQUAL((uint16_t)0xbeef, rom.read16(404));
+    TEST_ASSERT_FALSE(rom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)0, fram.getStatusReads());
+}
+
+void testSpiEepromChunksAtPages() {
+    HostSpiBus bus;
+    HostSpiMemoryModel eeprom(32768, 64, 2);
+    bus.attachDevice(SPI_TEST_CS, &eeprom);
+    SPIWithSettings spi(&bus, SPI_TEST_CS);
+    SPIEepromAbstraction rom(spi, SPI_EEPROM_25LC256);
+    TEST_ASSERT_FALSE(rom.isFram());
+    TEST_ASSERT_EQUAL((uint16_t)64, rom.getPageSize());
+
+    // 100 to 299 covers the end of one page, two whole pages and the start of another.
+    uint8_t data[200];
+    for(int i = 0; i < 200; i++) data[i] = 0xff - i;
+    TEST_ASSERT_TRUE(rom.writeArrayToRomWide(100, data, sizeof data));
+    TEST_ASSERT_EQUAL((uint32_t)4, eeprom.getWriteCycles());
+    TEST_ASSERT_TRUE(eeprom.getStatusReads() >= 3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &eeprom.getMemory()[100], sizeof data);
+
+    // reads are not split at pages, they wait for the last write then read in one frame
+    bus.resetCounts();
+    uint32_t statusBefore = eeprom.getStatusReads();
+    uint8_t readBack[200];
+    TEST_ASSERT_TRUE(rom.readIntoMemArrayWide(readBack, 100, sizeof readBack));
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().frames - (eeprom.getStatusReads() - statusBefore));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBack, sizeof data);
+    TEST_ASSERT_FALSE(rom.hasErrorOccurred());
+}
+
+void testSpiEepromPollsStatusUntilReady() {
+    HostSpiBus bus;
+    HostSpiMemoryModel eeprom(8192, 32, 2);
+    bus.attachDevice(SPI_TEST_CS, &eeprom);
+    SPIWithSettings spi(&bus, SPI_TEST_CS);
+    SPIEepromAbstraction rom(spi, SPI_EEPROM_25LC640);
+
+    // a value write reads first, then a write enable and the write, it returns without waiting for the write cycle
+    rom.write8(10, 1);
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().frames);
+    TEST_ASSERT_TRUE(eeprom.isBusy());
+    TEST_ASSERT_EQUAL((uint32_t)0, eeprom.getStatusReads());
+
+    // the next access polls the status register until the write cycle ends
+    TEST_ASSERT_EQUAL((uint8_t)1, rom.read8(10));
+    TEST_ASSERT_FALSE(rom.hasErrorOccurred());
+    TEST_ASSERT_TRUE(eeprom.getStatusReads() > 1);
+
+    // writing the same value again is only a read, there is no write cycle
+    bus.resetCounts();
+    rom.write8(10, 1);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().frames);
+    TEST_ASSERT_EQUAL((uint32_t)1, eeprom.getWriteCycles());
+
+    // flush waits for the write to finish
+    rom.write16(20, 0x1234);
+    TEST_ASSERT_TRUE(eeprom.isBusy());
+    TEST_ASSERT_TRUE(rom.flush());
+    TEST_ASSERT_FALSE(eeprom.isBusy());
+    TEST_ASSERT_EQUAL((uint8_t)0x12, eeprom.getMemory()[20]);
+
+    // a device that never finishes its write cycle is reported as an error rather than waiting forever
+    HostSpiMemoryModel stuck(8192, 32, 2, 1000000UL);
+    bus.attachDevice(SPI_TEST_CS, &stuck);
+    rom.write8(30, 5);
+    TEST_ASSERT_FALSE(rom.flush());
+    TEST_ASSERT_TRUE(rom.hasErrorOccurred());
+}
+
+void testSpiEepromBoundsAndLargeParts() {
+    HostSpiBus bus;
+    HostSpiMemoryModel eeprom(131072, 256, 3);
+    bus.attachDevice(SPI_TEST_CS, &eeprom);
+    SPIWithSettings spi(&bus, SPI_TEST_CS);
+    SPIEepromAbstraction rom(spi, SPI_EEPROM_25LC1024);
+    TEST_ASSERT_EQUAL(131072UL, rom.getRomSize());
+
+    // parts over 64K take three address bytes, this write goes across the 64K boundary in two pages
+    uint8_t data[40];
+    for(int i = 0; i < 40; i++) data[i] = i + 1;
+    TEST_ASSERT_TRUE(rom.writeArrayToRomWide(0xfff0UL, data, sizeof data));
+    TEST_ASSERT_EQUAL((uint32_t)2, eeprom.getWriteCycles());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &eeprom.getMemory()[0xfff0], sizeof data);
+    uint8_t readBack[40];
+    TEST_ASSERT_TRUE(rom.readIntoMemArrayWide(readBack, 0xfff0UL, sizeof readBack));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBack, sizeof data);
+
+    // writing right up to the end is fine, but not past it
+    TEST_ASSERT_TRUE(rom.writeArrayToRomWide(131072UL - 8, data, 8));
+    TEST_ASSERT_FALSE(rom.hasErrorOccurred());
+    uint32_t cycles = eeprom.getWriteCycles();
+    TEST_ASSERT_FALSE(rom.writeArrayToRomWide(131072UL - 4, data, 8));
+    TEST_ASSERT_FALSE(rom.readIntoMemArrayWide(readBack, 131072UL, 1));
+    TEST_ASSERT_TRUE(rom.hasErrorOccurred());
+    TEST_ASSERT_FALSE(rom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL(cycles, eeprom.getWriteCycles());
+
+    // the narrow functions are bounded by the size of a small part too
+    HostSpiMemoryModel small(8192, 0, 2);
+    bus.attachDevice(SPI_TEST_CS, &small);
+    SPIEepromAbstraction fram(spi, SPI_FRAM_MB85RS64);
+    fram.write8(8191, 0x55);
+    TEST_ASSERT_EQUAL((uint8_t)0x55, fram.read8(8191));
+    TEST_ASSERT_FALSE(fram.hasErrorOccurred());
+    fram.write16(8191, 0x1234);
+    TEST_ASSERT_TRUE(fram.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint8_t)0x55, small.getMemory()[8191]);
+}
@@ -0,0 +1,117 @@
+#include <unity.h>
+
+void testPcf8574OnModel();
+void testPcf8574BulkPinsOnModel();
+void testPcf8574AsyncSyncOnModel();
+void testPcf8574InterruptGatedReads();
+void testPcf8575OnModel();
+void testMcp23017OnModel();
+void testMcp23017BulkPinsOnModel();
+void testMcp23017AsyncSyncOnModel();
+void testMcp23017InterruptCaptureOnModel();
+void testMcp23017ChangesKeptForSwitchesOverOtherSyncs();
+void testAw9523OnModel();
+void testMpr121OnModel();
+void testRegisterBlockWriteOnModel();
+void testGatheredTransferLimit();
+void testShadowToggleOnlyWritesChanges();
+void testShiftRegisterBulkPinsOnModel();
+void testShiftRegisterLongChainsOnModel();
+void testShiftRegisterSyncOptionsOnModel();
+void testShiftRegister165BulkPinsOnModel();
+void testSpiShiftRegisterLongChainOnBus();
+void testSpiShiftRegisterOutputOnlySkipsIdleSyncs();
+void testAt24ByteAccessCost();
+void testAt24WaitsForWriteCycle();
+void testAt24ArraysSplitAtPages();
+void testAt24UsesFullPageWhenBusAllows();
+void testAt24PageCacheCoalescesWrites();
+void testAt24PageCacheEvictsAndFlushesOnTimer();
+void testAt24TimedFlushRetriesAfterFailure();
+void testAt24AsyncWritesPollOnQueue();
+void testAt24PageCacheKeepsPageDirtyOnAsyncNack();
+void testAtomicSettingsBootIsOneBulkRead();
+void testAt24WideAccessAcrossBlocks();
+void testAt24AsyncFullPageOnLargeParts();
+void testAt24SizesOnSixteenBitLengths();
+void testAt24SmallPartBlocks();
+void testAt24RangeEndsOnLastByte();
+void testAt24ModelPageWrap();
+void testClockSwitchesOnlyBetweenProfiles();
+void testClockProfileTableFull();
+void testClockProfileNeedsBusSpeed();
+void testClockBusEntriesAreReused();
+void testSpiFramBurstAccess();
+void testSpiEepromChunksAtPages();
+void testSpiEepromPollsStatusUntilReady();
+void testSpiEepromBoundsAndLargeParts();
+void testChunkedStoreWritesOnlyDirtyChunks();
+void testChunkedStoreLoadsLazily();
+void testChunkedStoreMovesSingleBlobToChunks();
+void testChunkedStoreCommitFailureKeepsDirty();
+void testChunkedStoreResumesPartialBlobMove();
+void testChunkedStoreReloadKeepsBlob();
+void testDeferredCommitAfterQuietPeriod();
+void testDeferredCommitAtMaxLatency();
+void testDeferredCommitRateLimitAndFailure();
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(testPcf8574OnModel);
+    RUN_TEST(testPcf8574BulkPinsOnModel);
+    RUN_TEST(testPcf8574AsyncSyncOnModel);
+    RUN_TEST(testPcf8574InterruptGatedReads);
+    RUN_TEST(testPcf8575OnModel);
+    RUN_TEST(testMcp23017OnModel);
+    RUN_TEST(testMcp23017BulkPinsOnModel);
+    RUN_TEST(testMcp23017AsyncSyncOnModel);
+    RUN_TEST(testMcp23017InterruptCaptureOnModel);
+    RUN_TEST(testMcp23017ChangesKeptForSwitchesOverOtherSyncs);
+    RUN_TEST(testAw9523OnModel);
+    RUN_TEST(testMpr121OnModel);
+    RUN_TEST(testRegisterBlockWriteOnModel);
+    RUN_TEST(testGatheredTransferLimit);
+    RUN_TEST(testShadowToggleOnlyWritesChanges);
+    RUN_TEST(testShiftRegisterBulkPinsOnModel);
+    RUN_TEST(testShiftRegisterLongChainsOnModel);
+    RUN_TEST(testShiftRegisterSyncOptionsOnModel);
+    RUN_TEST(testShiftRegister165BulkPinsOnModel);
+    RUN_TEST(testSpiShiftRegisterLongChainOnBus);
+    RUN_TEST(testSpiShiftRegisterOutputOnlySkipsIdleSyncs);
+    RUN_TEST(testAt24ByteAccessCost);
+    RUN_TEST(testAt24WaitsForWriteCycle);
+    RUN_TEST(testAt24ArraysSplitAtPages);
+    RUN_TEST(testAt24UsesFullPageWhenBusAllows);
+    RUN_TEST(testAt24PageCacheCoalescesWrites);
+    RUN_TEST(testAt24PageCacheEvictsAndFlushesOnTimer);
+    RUN_TEST(testAt24TimedFlushRetriesAfterFailure);
+    RUN_TEST(testAt24AsyncWritesPollOnQueue);
+    RUN_TEST(testAt24PageCacheKeepsPageDirtyOnAsyncNack);
+    RUN_TEST(testAtomicSettingsBootIsOneBulkRead);
+    RUN_TEST(testAt24WideAccessAcrossBlocks);
+    RUN_TEST(testAt24AsyncFullPageOnLargeParts);
+    RUN_TEST(testAt24SizesOnSixteenBitLengths);
+    RUN_TEST(testAt24SmallPartBlocks);
+    RUN_TEST(testAt24RangeEndsOnLastByte);
+    RUN_TEST(testAt24ModelPageWrap);
+    RUN_TEST(testClockSwitchesOnlyBetweenProfiles);
+    RUN_TEST(testClockProfileTableFull);
+    RUN_TEST(testClockProfileNeedsBusSpeed);
+    RUN_TEST(testClockBusEntriesAreReused);
+    RUN_TEST(testSpiFramBurstAccess);
+    RUN_TEST(testSpiEepromChunksAtPages);
+    RUN_TEST(testSpiEepromPollsStatusUntilReady);
+    RUN_TEST(testSpiEepromBoundsAndLargeParts);
+    RUN_TEST(testChunkedStoreWritesOnlyDirtyChunks);
+    RUN_TEST(testChunkedStoreLoadsLazily);
+    RUN_TEST(testChunkedStoreMovesSingleBlobToChunks);
+    RUN_TEST(testChunkedStoreCommitFailureKeepsDirty);
+    RUN_TEST(testChunkedStoreResumesPartialBlobMove);
+    RUN_TEST(testChunkedStoreReloadKeepsBlob);
+    RUN_TEST(testDeferredCommitAfterQuietPeriod);
+    RUN_TEST(testDeferredCommitAtMaxLatency);
+    RUN_TEST(testDeferredCommitRateLimitAndFailure);
+
+    return UNITY_END();
+}
@@ -0,0 +1,134 @@
+#include <TaskManagerIO.h>
+#include <IoAbstractionWire.h>
+#include <EepromAbstractionWire.h>
+#include <host/HostDigitalIO.h>
+#include <host/HostI2cDeviceModels.h>
+#include <unity.h>
+
+void testClockSwitchesOnlyBetweenProfiles() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    HostPcf8574Model pcfModel;
+    HostAt24Model romModel(2048, 16);
+    bus.attachDevice(0x20, &mcpModel);
+    bus.attachDevice(0x21, &pcfModel);
+    romModel.attach(bus, 0x50);
+
+    MCP23017IoAbstraction mcp(0x20, &bus);
+    PCF8574IoAbstraction pcf(0x21, IO_PIN_NOT_DEFINED, &bus);
+    I2cAt24Eeprom eeprom(0x50, PAGESIZE_AT24C16, &bus);
+
+    ioaWireSetSpeed(&bus, 100000);
+    TEST_ASSERT_TRUE(mcp.setPreferredClock(1700000));
+    TEST_ASSERT_TRUE(eeprom.setPreferredClock(400000));
+    bus.resetCounts();
+
+    // the first sync switches up to the fast clock, later syncs to the same device cost nothing extra.
+    mcp.sync();
+    TEST_ASSERT_EQUAL(1700000L, bus.getFrequency());
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().speedChanges);
+    mcp.sync();
+    mcp.sync();
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().speedChanges);
+
+    // the EEPROM block at 0x53 is covered by the same profile as 0x50
+    eeprom.write8(0x310, 0x55);
+    TEST_ASSERT_EQUAL(400000L, bus.getFrequency());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().speedChanges);
+    hostAdvanceMicros(HOST_AT24_WRITE_CYCLE_MICROS);
+    TEST_ASSERT_EQUAL((uint8_t)0x55, eeprom.read8(0x310));
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().speedChanges);
+
+    // a device without a preference goes back to the bus default
+    pcf.sync();
+    TEST_ASSERT_EQUAL(100000L, bus.getFrequency());
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().speedChanges);
+
+    // removing the preference puts the device back on the default clock
+    TEST_ASSERT_TRUE(mcp.setPreferredClock(0));
+    mcp.sync();
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().speedChanges);
+    TEST_ASSERT_TRUE(eeprom.setPreferredClock(0));
+}
+
+void testClockProfileTableFull() {
+    HostI2cBus bus;
+    ioaWireSetSpeed(&bus, 100000);
+    for(uint8_t i = 0; i < IOA_WIRE_MAX_CLOCK_PROFILES; i++) {
+        TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&bus, 0x10 + i, 400000));
+    }
+    TEST_ASSERT_FALSE(ioaWireSetDeviceSpeed(&bus, 0x30, 400000));
+
+    // replacing an existing profile still works when the table is full
+    TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&bus, 0x10, 1000000));
+    TEST_ASSERT_EQUAL(1000000UL, ioaWireSpeedChangeFor(&bus, 0x10));
+    TEST_ASSERT_EQUAL(0UL, ioaWireSpeedChangeFor(&bus, 0x10));
+    TEST_ASSERT_EQUAL(100000UL, ioaWireSpeedChangeFor(&bus, 0x40));
+
+    for(uint8_t i = 0; i < IOA_WIRE_MAX_CLOCK_PROFILES; i++) {
+        TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&bus, 0x10 + i, 0));
+    }
+    TEST_ASSERT_EQUAL(0UL, ioaWireSpeedChangeFor(&bus, 0x10));
+}
+
+void testClockProfileNeedsBusSpeed() {
+    // a bus that has not been used before, so no entry left in the bus table by an earlier test can match it
+    static HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    HostPcf8574Model pcfModel;
+    bus.attachDevice(0x20, &mcpModel);
+    bus.attachDevice(0x21, &pcfModel);
+    MCP23017IoAbstraction mcp(0x20, &bus);
+
+    // the speed to go back to for other devices is not known until it is set, so the preference is refused
+    TEST_ASSERT_FALSE(mcp.setPreferredClock(400000));
+    TEST_ASSERT_EQUAL(0UL, ioaWireSpeedChangeFor(&bus, 0x20));
+
+    ioaWireSetSpeed(&bus, 200000);
+    TEST_ASSERT_TRUE(mcp.setPreferredClock(400000));
+    TEST_ASSERT_TRUE(ioaWireReady(&bus, 0x20));
+    TEST_ASSERT_EQUAL(400000L, bus.getFrequency());
+    TEST_ASSERT_TRUE(ioaWireReady(&bus, 0x21));
+    TEST_ASSERT_EQUAL(200000L, bus.getFrequency());
+
+    // removing the last preference while the bus is running fast still lets it go back to the default
+    TEST_ASSERT_TRUE(ioaWireReady(&bus, 0x20));
+    TEST_ASSERT_EQUAL(400000L, bus.getFrequency());
+    TEST_ASSERT_TRUE(mcp.setPreferredClock(0));
+    TEST_ASSERT_TRUE(ioaWireReady(&bus, 0x20));
+    TEST_ASSERT_EQUAL(200000L, bus.getFrequency());
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(ioaWireReady(&bus, 0x20));
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().speedChanges);
+}
+
+void testClockBusEntriesAreReused() {
+    static HostI2cBus unusedBuses[IOA_WIRE_MAX_BUSES + 2];
+
+    // the buses of earlier tests have no preferences left, so their entries are taken over one at a time
+    for(size_t i = 0; i < sizeof(unusedBuses) / sizeof(unusedBuses[0]); i++) {
+        auto& bus = unusedBuses[i];
+        ioaWireSetSpeed(&bus, 100000);
+        TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&bus, 0x20, 400000));
+        TEST_ASSERT_EQUAL(400000UL, ioaWireSpeedChangeFor(&bus, 0x20));
+        TEST_ASSERT_EQUAL(100000UL, ioaWireSpeedChangeFor(&bus, 0x21));
+        TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&bus, 0x20, 0));
+    }
+
+    // while every entry has a bus with preferences, another bus cannot be tracked and so cannot have preferences
+    for(uint8_t i = 0; i < IOA_WIRE_MAX_BUSES; i++) {
+        ioaWireSetSpeed(&unusedBuses[i], 100000);
+        TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&unusedBuses[i], 0x20, 400000));
+    }
+    auto& otherBus = unusedBuses[IOA_WIRE_MAX_BUSES];
+    ioaWireSetSpeed(&otherBus, 100000);
+    TEST_ASSERT_FALSE(ioaWireSetDeviceSpeed(&otherBus, 0x20, 400000));
+
+    for(uint8_t i = 0; i < IOA_WIRE_MAX_BUSES; i++) {
+        TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&unusedBuses[i], 0x20, 0));
+    }
+    ioaWireSetSpeed(&otherBus, 100000);
+    TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&otherBus, 0x20, 400000));
+    TEST_ASSERT_TRUE(ioaWireSetDeviceSpeed(&otherBus, 0x20, 0));
+}
@@ -0,0 +1,518 @@
+#include <TaskManagerIO.h>
+#include <IoAbstractionWire.h>
+#include <I2cTransactionQueue.h>
+#include <SwitchInput.h>
+#include <wireHelpers.h>
+#include <host/HostDigitalIO.h>
+#include <host/HostI2cDeviceModels.h>
+#include <unity.h>
+
+//
+// These tests run the real device classes against the chip models on a host bus, and check both the chip state and
+// the number of transactions and bytes that each operation costs on the bus.
+//
+
+void testPcf8574OnModel() {
+    HostI2cBus bus;
+    HostPcf8574Model pcfModel;
+    bus.attachDevice(0x20, &pcfModel);
+    PCF8574IoAbstraction pcf(0x20, IO_PIN_NOT_DEFINED, &bus);
+
+    for(int i = 0; i < 4; i++) pcf.pinDirection(i, INPUT);
+    for(int i = 4; i < 8; i++) pcf.pinDirection(i, OUTPUT);
+    pcf.writeValue(5, HIGH);
+
+    // one write for the outputs and one read for the inputs, a byte each
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().bytesRead);
+    TEST_ASSERT_EQUAL((uint16_t)0x2f, (uint16_t)(pcfModel.getLatch() & 0xff));
+
+    // pulling an input low raises the interrupt, and the next read clears it
+    pcfModel.setInput(2, false);
+    TEST_ASSERT_TRUE(pcfModel.isInterruptActive());
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_FALSE(pcfModel.isInterruptActive());
+    TEST_ASSERT_EQUAL(LOW, pcf.readValue(2));
+    TEST_ASSERT_EQUAL(HIGH, pcf.readValue(1));
+    TEST_ASSERT_EQUAL(HIGH, pcf.readValue(5));
+
+    // with nothing to write, a sync is only the read
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+}
+
+void testPcf8574BulkPinsOnModel() {
+    HostI2cBus bus;
+    HostPcf8574Model pcfModel;
+    bus.attachDevice(0x20, &pcfModel);
+    PCF8574IoAbstraction pcf(0x20, IO_PIN_NOT_DEFINED, &bus);
+
+    for(int i = 0; i < 4; i++) pcf.pinDirection(i, INPUT);
+    for(int i = 4; i < 8; i++) pcf.pinDirection(i, OUTPUT);
+
+    // all four outputs go out in the one byte written on sync, the inputs stay high so they can be read
+    pcf.writePins(4, 0x0f, 0x05);
+    pcfModel.setInput(1, false);
+    pcfModel.setInput(3, false);
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint16_t)0x5f, (uint16_t)(pcfModel.getLatch() & 0xff));
+
+    TEST_ASSERT_EQUAL_UINT32(0x05, pcf.readPins(0, 0x0f));
+    TEST_ASSERT_EQUAL_UINT32(0x01, pcf.readPins(2, 0x03));
+    TEST_ASSERT_EQUAL_UINT32(0x02, pcf.readPins(1, 0x06));
+}
+
+// runs the queued transactions one at a time, as task manager would, until the queue is empty
+static void runI2cQueueUntilIdle() {
+    int runs = 0;
+    while(!i2cTransactionQueue.isIdle() && ++runs < 100) i2cTransactionQueue.exec();
+    TEST_ASSERT_TRUE(i2cTransactionQueue.isIdle());
+}
+
+void testPcf8574AsyncSyncOnModel() {
+    HostI2cBus bus;
+    HostPcf8574Model pcfModel;
+    bus.attachDevice(0x20, &pcfModel);
+    PCF8574IoAbstraction pcf(0x20, IO_PIN_NOT_DEFINED, &bus);
+
+    for(int i = 0; i < 4; i++) pcf.pinDirection(i, INPUT);
+    for(int i = 4; i < 8; i++) pcf.pinDirection(i, OUTPUT);
+    TEST_ASSERT_TRUE(pcf.setAsyncSync(true));
+    TEST_ASSERT_TRUE(pcf.isAsyncSync());
+
+    // the sync only queues the write and the read, nothing reaches the chip until the queue runs
+    pcf.writeValue(5, HIGH);
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().transactions());
+    TEST_ASSERT_FALSE(i2cTransactionQueue.isIdle());
+    TEST_ASSERT_FALSE(pcf.setAsyncSync(false));
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint16_t)0x2f, (uint16_t)(pcfModel.getLatch() & 0xff));
+
+    // inputs lag by one sync, the read queued by a sync is only picked up by the one after it
+    pcfModel.setInput(2, false);
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL(HIGH, pcf.readValue(2));
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL(LOW, pcf.readValue(2));
+    TEST_ASSERT_EQUAL(HIGH, pcf.readValue(5));
+    runI2cQueueUntilIdle();
+
+    // a failure on the bus is reported by the sync after the transactions ran, and the inputs are left as they were
+    bus.detachDevice(0x20);
+    pcf.writeValue(6, HIGH);
+    TEST_ASSERT_TRUE(pcf.sync());
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_FALSE(pcf.sync());
+    TEST_ASSERT_EQUAL(LOW, pcf.readValue(2));
+    TEST_ASSERT_TRUE(bus.getCounts().nacks != 0);
+
+    // once the chip answers again the read that was forced by the failure succeeds
+    bus.attachDevice(0x20, &pcfModel);
+    pcfModel.setInput(2, true);
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL(HIGH, pcf.readValue(2));
+    runI2cQueueUntilIdle();
+
+    TEST_ASSERT_TRUE(pcf.setAsyncSync(false));
+    TEST_ASSERT_FALSE(pcf.isAsyncSync());
+}
+
+void testPcf8574InterruptGatedReads() {
+    HostI2cBus bus;
+    HostPcf8574Model pcfModel;
+    bus.attachDevice(0x20, &pcfModel);
+    pcfModel.setInterruptPin(7);
+    PCF8574IoAbstraction pcf(0x20, 7, &bus);
+
+    for(int i = 0; i < 8; i++) pcf.pinDirection(i, INPUT);
+    TEST_ASSERT_FALSE(PCF8574IoAbstraction(0x21, IO_PIN_NOT_DEFINED, &bus).setInterruptGatedReads(true));
+    TEST_ASSERT_TRUE(pcf.setInterruptGatedReads(true, 100));
+    TEST_ASSERT_TRUE(pcf.isInterruptGatedReads());
+
+    // the first sync always reads, after that there is no bus traffic while the interrupt line is idle.
+    TEST_ASSERT_TRUE(pcf.sync());
+    bus.resetCounts();
+    for(int i = 0; i < 10; i++) TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().transactions());
+
+    // an input change holds the interrupt line low, so the next sync reads, which releases it again.
+    pcfModel.setInput(3, false);
+    TEST_ASSERT_FALSE(hostPinSimulation().getLevel(7));
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL(LOW, pcf.readValue(3));
+    TEST_ASSERT_TRUE(hostPinSimulation().getLevel(7));
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+
+    // once the safety interval has passed, the inputs are read even though the line is idle.
+    hostAdvanceMicros(100000UL);
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().reads);
+
+    // a write clears the interrupt on the chip, so a read always follows it.
+    pcf.writePort(0, 0xff);
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().reads);
+
+    // back to reading on every sync
+    TEST_ASSERT_TRUE(pcf.setInterruptGatedReads(false));
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)5, bus.getCounts().reads);
+}
+
+void testPcf8575OnModel() {
+    HostI2cBus bus;
+    HostPcf8574Model pcfModel(true);
+    bus.attachDevice(0x21, &pcfModel);
+    PCF8574IoAbstraction pcf(0x21, IO_PIN_NOT_DEFINED, &bus, true);
+
+    pcf.pinDirection(0, INPUT);
+    pcf.pinDirection(12, OUTPUT);
+    pcf.writeValue(12, HIGH);
+    pcfModel.setInput(0, false);
+
+    TEST_ASSERT_TRUE(pcf.sync());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().bytesRead);
+    TEST_ASSERT_EQUAL(LOW, pcf.readValue(0));
+    TEST_ASSERT_TRUE(bitRead(pcfModel.getLatch(), 12));
+}
+
+void testMcp23017OnModel() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    bus.attachDevice(0x20, &mcpModel);
+    MCP23017IoAbstraction mcp(0x20, &bus);
+
+    // a batch of 16 inputs, IOCON is read and written during init, then IODIR and GPPU are each read once. IODIR
+    // is already all inputs, so only GPPU needs writing back.
+    mcp.beginConfig();
+    for(int i = 0; i < 16; i++) mcp.pinDirection(i, INPUT_PULLUP);
+    TEST_ASSERT_TRUE(mcp.commitConfig());
+    TEST_ASSERT_EQUAL((uint32_t)5, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)3, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint16_t)0xffff, mcpModel.getPullUps());
+    TEST_ASSERT_EQUAL((uint16_t)0xffff, mcpModel.getDirection());
+
+    // a sync of both ports is the register address then a two byte read
+    bus.resetCounts();
+    mcpModel.setInput(3, false);
+    mcpModel.setInput(9, false);
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().transactions());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().bytesRead);
+    TEST_ASSERT_EQUAL(LOW, mcp.readValue(3));
+    TEST_ASSERT_EQUAL(LOW, mcp.readValue(9));
+    TEST_ASSERT_EQUAL(HIGH, mcp.readValue(10));
+
+    // changing direction after the batch costs one write per register, as the shadow already holds the values
+    bus.resetCounts();
+    mcp.pinDirection(15, OUTPUT);
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint16_t)0x7fff, mcpModel.getDirection());
+
+    mcp.writeValue(15, HIGH);
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)0x8000, (uint32_t)mcpModel.getLatch());
+    TEST_ASSERT_TRUE(bitRead(mcpModel.getLevels(), 15));
+}
+
+static int mcpModelInterrupts = 0;
+static void mcpModelInterrupt() { mcpModelInterrupts++; }
+
+void testMcp23017BulkPinsOnModel() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    bus.attachDevice(0x20, &mcpModel);
+    MCP23017IoAbstraction mcp(0x20, &bus);
+
+    mcp.beginConfig();
+    for(int i = 0; i < 8; i++) mcp.pinDirection(i, INPUT_PULLUP);
+    for(int i = 8; i < 16; i++) mcp.pinDirection(i, OUTPUT);
+    TEST_ASSERT_TRUE(mcp.commitConfig());
+
+    // a bulk write of port B only writes that port on sync
+    mcp.writePins(8, 0xff, 0xa5);
+    mcpModel.setInput(0, false);
+    mcpModel.setInput(6, false);
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0xa500, (uint32_t)mcpModel.getLatch());
+
+    TEST_ASSERT_EQUAL_UINT32(0xbe, mcp.readPins(0, 0xff));
+    TEST_ASSERT_EQUAL_UINT32(0x0b, mcp.readPins(4, 0x0f));
+    TEST_ASSERT_EQUAL_UINT32(0xa5, mcp.readPins(8, 0xff));
+    TEST_ASSERT_EQUAL_UINT32(0, mcp.readPins(16, 0xff));
+}
+
+void testMcp23017AsyncSyncOnModel() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    bus.attachDevice(0x20, &mcpModel);
+    MCP23017IoAbstraction mcp(0x20, &bus);
+
+    mcp.beginConfig();
+    for(int i = 0; i < 8; i++) mcp.pinDirection(i, INPUT_PULLUP);
+    for(int i = 8; i < 16; i++) mcp.pinDirection(i, OUTPUT);
+    TEST_ASSERT_TRUE(mcp.commitConfig());
+    TEST_ASSERT_TRUE(mcp.setAsyncSync(true));
+
+    // the latch write and the GPIO read are queued, and only reach the chip when the queue runs
+    bus.resetCounts();
+    mcp.writeValue(9, HIGH);
+    mcpModel.setInput(3, false);
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().transactions());
+    TEST_ASSERT_EQUAL((uint32_t)0, (uint32_t)mcpModel.getLatch());
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_EQUAL((uint32_t)0x0200, (uint32_t)mcpModel.getLatch());
+
+    // the read completed by the queue is applied on the next sync
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL(LOW, mcp.readValue(3));
+    TEST_ASSERT_EQUAL(HIGH, mcp.readValue(4));
+    runI2cQueueUntilIdle();
+
+    // a NACK on the queued write is reported by the following sync, which keeps the inputs it last read
+    bus.detachDevice(0x20);
+    mcp.writeValue(10, HIGH);
+    mcpModel.setInput(3, true);
+    TEST_ASSERT_TRUE(mcp.sync());
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_FALSE(mcp.sync());
+    TEST_ASSERT_EQUAL(LOW, mcp.readValue(3));
+    TEST_ASSERT_EQUAL((uint32_t)0x0200, (uint32_t)mcpModel.getLatch());
+    runI2cQueueUntilIdle();
+
+    bus.attachDevice(0x20, &mcpModel);
+    mcp.writeValue(10, HIGH);
+    TEST_ASSERT_FALSE(mcp.sync());
+    runI2cQueueUntilIdle();
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL(HIGH, mcp.readValue(3));
+    TEST_ASSERT_EQUAL((uint32_t)0x0600, (uint32_t)mcpModel.getLatch());
+    runI2cQueueUntilIdle();
+
+    TEST_ASSERT_TRUE(mcp.setAsyncSync(false));
+}
+
+void testMcp23017InterruptCaptureOnModel() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    bus.attachDevice(0x22, &mcpModel);
+    MCP23017IoAbstraction mcp(0x22, ACTIVE_LOW_OPEN, 5, &bus);
+    mcpModelInterrupts = 0;
+
+    mcp.setInterruptCapture(true);
+    mcp.beginConfig();
+    for(int i = 0; i < 16; i++) mcp.pinDirection(i, INPUT_PULLUP);
+    mcp.commitConfig();
+    mcp.attachInterrupt(3, mcpModelInterrupt, CHANGE);
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((IoPinMask)0xffff, mcp.changedPins(0, 0xffff));
+    mcp.clearChangedPins(0, 0xffff);
+
+    // a capture sync is the register address and one six byte read of INTF, INTCAP and GPIO
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().transactions());
+    TEST_ASSERT_EQUAL((uint32_t)6, bus.getCounts().bytesRead);
+    TEST_ASSERT_EQUAL((IoPinMask)0, mcp.changedPins(0, 0xffff));
+
+    // a short pulse that is over before the sync is still seen through INTCAP
+    mcpModel.setInput(3, false);
+    mcpModel.setInput(3, true);
+    TEST_ASSERT_TRUE(mcpModel.isInterruptActive(0));
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_FALSE(mcpModel.isInterruptActive(0));
+    TEST_ASSERT_EQUAL(LOW, mcp.readValue(3));
+    TEST_ASSERT_EQUAL((IoPinMask)0x08, mcp.changedPins(0, 0xffff));
+    mcp.clearChangedPins(0, 0xffff);
+
+    // then the pin goes back high on the next sync
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL(HIGH, mcp.readValue(3));
+    TEST_ASSERT_EQUAL((IoPinMask)0x08, mcp.changedPins(0, 0xffff));
+
+    // the change is kept over further syncs until it is cleared, and only the pins asked for are cleared
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((IoPinMask)0x08, mcp.changedPins(0, 0xffff));
+    mcp.clearChangedPins(0, 0x07);
+    TEST_ASSERT_EQUAL((IoPinMask)0x08, mcp.changedPins(0, 0xffff));
+    mcp.clearChangedPins(3, 0x01);
+    TEST_ASSERT_EQUAL((IoPinMask)0, mcp.changedPins(0, 0xffff));
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_EQUAL((IoPinMask)0, mcp.changedPins(0, 0xffff));
+}
+
+static int captureKeyPresses = 0;
+static int captureKeyReleases = 0;
+static void captureKeyPressed(pinid_t, bool) { captureKeyPresses++; }
+static void captureKeyReleased(pinid_t, bool) { captureKeyReleases++; }
+static void captureEncoderChanged(int) { }
+
+static void runSwitchesUntil(const int& counter, int expected) {
+    for(int i = 0; i < 20 && counter != expected; i++) {
+        switches.runLoop();
+        hostAdvanceMicros(SWITCH_POLL_INTERVAL * 1000UL);
+    }
+}
+
+void testMcp23017ChangesKeptForSwitchesOverOtherSyncs() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    bus.attachDevice(0x22, &mcpModel);
+    MCP23017IoAbstraction mcp(0x22, ACTIVE_LOW_OPEN, IO_PIN_NOT_DEFINED, &bus);
+    mcp.setInterruptCapture(true);
+    captureKeyPresses = captureKeyReleases = 0;
+
+    switches.initialiseInterrupt(&mcp, true);
+    switches.addSwitch(2, captureKeyPressed, NO_REPEAT);
+    switches.onRelease(2, captureKeyReleased);
+    auto encoder = new HwStateRotaryEncoder(5, 6, captureEncoderChanged, HWACCEL_NONE);
+    switches.setEncoder(0, encoder);
+    switches.runLoop();
+    TEST_ASSERT_EQUAL((IoPinMask)0, mcp.changedPins(2, 1));
+
+    // the key goes down while the encoder syncs for itself, between two runs of switches, which still see it.
+    mcpModel.setInput(2, false);
+    encoder->encoderChanged();
+    runSwitchesUntil(captureKeyPresses, 1);
+    TEST_ASSERT_EQUAL(1, captureKeyPresses);
+
+    // the same when the key is let go and the application syncs the device itself, such as to update outputs.
+    mcpModel.setInput(2, true);
+    TEST_ASSERT_TRUE(mcp.sync());
+    TEST_ASSERT_TRUE(mcp.sync());
+    runSwitchesUntil(captureKeyReleases, 1);
+    TEST_ASSERT_EQUAL(1, captureKeyReleases);
+
+    switches.setEncoder(0, nullptr);
+    delete encoder;
+    switches.resetAllSwitches();
+}
+
+void testAw9523OnModel() {
+    HostI2cBus bus;
+    HostAw9523Model awModel;
+    bus.attachDevice(0x58, &awModel);
+    AW9523IoAbstraction aw(0x58, IO_PIN_NOT_DEFINED, &bus);
+
+    TEST_ASSERT_EQUAL((uint8_t)0x23, aw.deviceId());
+
+    // init resets the chip then writes interrupts, direction and global control. The batch then reads LED mode
+    // once, which is already GPIO for every pin, and writes direction back once.
+    bus.resetCounts();
+    aw.beginConfig();
+    for(int i = 0; i < 8; i++) aw.pinDirection(i, OUTPUT);
+    for(int i = 8; i < 16; i++) aw.pinDirection(i, INPUT);
+    TEST_ASSERT_TRUE(aw.commitConfig());
+    TEST_ASSERT_EQUAL((uint32_t)6, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint16_t)0xff00, awModel.getDirection());
+    TEST_ASSERT_EQUAL((uint16_t)0xffff, awModel.getLedMode());
+
+    aw.writeValue(2, HIGH);
+    awModel.setInput(12, false);
+    TEST_ASSERT_TRUE(aw.sync());
+    TEST_ASSERT_TRUE(bitRead(awModel.getLevels(), 2));
+    TEST_ASSERT_EQUAL(LOW, aw.readValue(12));
+    TEST_ASSERT_EQUAL(HIGH, aw.readValue(13));
+
+    // when the chip resets behind our back, such as a brown out, resync puts the cached configuration back
+    awModel.reset();
+    TEST_ASSERT_EQUAL((uint16_t)0, awModel.getDirection());
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(aw.resyncRegisters());
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint16_t)0xff00, awModel.getDirection());
+}
+
+void testMpr121OnModel() {
+    HostI2cBus bus;
+    HostMpr121Model mprModel;
+    bus.attachDevice(0x5A, &mprModel);
+    MPR121IoAbstraction mpr(0x5A, IO_PIN_NOT_DEFINED, &bus);
+
+    mpr.begin(3, MPR121_AUTO_CONFIG);
+    TEST_ASSERT_EQUAL((uint8_t)0x84, mprModel.getRegister(0x5E));
+
+    mpr.beginConfig();
+    mpr.pinDirection(8, OUTPUT);
+    mpr.pinDirection(9, OUTPUT);
+    TEST_ASSERT_TRUE(mpr.commitConfig());
+    TEST_ASSERT_EQUAL((uint8_t)0x30, mprModel.getRegister(0x76));
+    TEST_ASSERT_EQUAL((uint8_t)0x30, mprModel.getRegister(0x77));
+
+    mpr.writeValue(9, HIGH);
+    mprModel.setTouched(0x0005);
+    bus.resetCounts();
+    TEST_ASSERT_TRUE(mpr.sync());
+    TEST_ASSERT_EQUAL((uint8_t)0x20, mprModel.getGpioData());
+    TEST_ASSERT_EQUAL(HIGH, mpr.readValue(0));
+    TEST_ASSERT_EQUAL(LOW, mpr.readValue(1));
+    TEST_ASSERT_EQUAL(HIGH, mpr.readValue(2));
+
+    // touch status is a two byte register read, then the GPIO data is one write
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().reads);
+    TEST_ASSERT_EQUAL((uint32_t)2, bus.getCounts().bytesRead);
+}
+
+void testRegisterBlockWriteOnModel() {
+    HostI2cBus bus;
+    HostMcp23017Model mcpModel;
+    bus.attachDevice(0x20, &mcpModel);
+
+    // a block write to IODIRA runs on through the registers with auto increment, as one write on the bus
+    uint8_t block[] = { 0x0f, 0xf0, 0x01, 0x02 };
+    TEST_ASSERT_TRUE(wireWriteRegBlock(&bus, 0x20, 0x00, block, sizeof block));
+    TEST_ASSERT_EQUAL((uint32_t)1, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint32_t)5, bus.getCounts().bytesWritten);
+    TEST_ASSERT_EQUAL((uint16_t)0xf00f, mcpModel.getDirection());
+    TEST_ASSERT_EQUAL((uint8_t)0x01, mcpModel.getRegister(0x02));
+    TEST_ASSERT_EQUAL((uint8_t)0x02, mcpModel.getRegister(0x03));
+
+    // empty parts are allowed, and the parts are sent in order
+    uint8_t reg = 0x14;
+    uint8_t latch[] = { 0xaa, 0x55 };
+    IoaWireBuffer parts[] = { { &reg, 1 }, { nullptr, 0 }, { latch, 1 }, { latch + 1, 1 } };
+    TEST_ASSERT_TRUE(ioaWireWriteV(&bus, 0x20, parts, 4));
+    TEST_ASSERT_EQUAL((uint16_t)0x55aa, mcpModel.getLatch());
+    TEST_ASSERT_FALSE(ioaWireWriteV(&bus, 0x21, parts, 4));
+
+    // a write larger than the bus allows fails before anything is sent, so the device never sees part of it
+    bus.setMaxTransferSize(2);
+    bus.resetCounts();
+    TEST_ASSERT_FALSE(ioaWireWriteV(&bus, 0x20, parts, 4));
+    TEST_ASSERT_EQUAL((uint32_t)0, bus.getCounts().writes);
+    TEST_ASSERT_EQUAL((uint16_t)0x55aa, mcpModel.getLatch());
+    IoaWireBuffer fits[] = { { &reg, 1 }, { latch + 1, 1 } };
+    TEST_ASSERT_TRUE(ioaWireWriteV(&bus, 0x20, fits, 2));
+    TEST_ASSERT_EQUAL((uint16_t)0x5555, mcpModel.getLatch());
+}
+
+void testGatheredTransferLimit() {
+    // the AVR TWI buffer is 32 bytes, smaller than the gather buffer, so a transfer is limited to 32
+    TEST_ASSERT_EQUAL((size_t)32, (size_t)ioaWireGatheredTransferLimit(32));
+    TEST_ASSERT_TRUE(ioaWireGatheredTransferLimit(32) <= IOA_WIRE_GATHER_BUFFER_SIZE);
+
+    // a driver buffer larger than the gather buffer is limited by the gather buffer instead
+    TEST_ASSERT_EQUAL((size_t)IOA_WIRE_GATHER_BUFFER_SIZE, (size_t)ioaWireGatheredTransferLimit(IOA_WIRE_GATHER_BUFFER_SIZE + 100));
+}
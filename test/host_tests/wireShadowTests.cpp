@@ -0,0 +1,70 @@
+
+#include <wireHelpers.h>
+#include <host/HostWireBus.h>
+#include <unity.h>
+
+/**
+ * A device with eight 8 bit registers, that counts the reads and writes of each register.
+ */
+class ShadowTestDevice : public HostI2cDevice {
+public:
+    uint8_t registers[8] = {};
+    int writes[8] = {};
+    int reads[8] = {};
+    uint8_t pointer = 0;
+
+    bool i2cWrite(const uint8_t* data, size_t len, bool /*sendStop*/) override {
+        if(len == 0) return true;
+        pointer = data[0] & 0x07;
+        if(len > 1) {
+            writes[pointer]++;
+            registers[pointer] = data[1];
+        }
+        return true;
+    }
+
+    bool i2cRead(uint8_t* buffer, size_t len) override {
+        reads[pointer]++;
+        for(size_t i = 0; i < len; i++) buffer[i] = registers[(pointer + i) & 0x07];
+        return true;
+    }
+};
+
+static const uint8_t shadowTestRegisters[] = { 0x00, 0x01 };
+
+void testShadowToggleOnlyWritesChanges() {
+    HostI2cBus bus;
+    ShadowTestDevice device;
+    bus.attachDevice(0x20, &device);
+    device.registers[0] = 0x01;
+    WireRegisterShadow shadow(shadowTestRegisters, sizeof shadowTestRegisters, false);
+
+    // the register is read once, and setting a bit that is already set writes nothing, even though it was not cached
+    TEST_ASSERT_TRUE(shadow.toggleBit(&bus, 0x20, 0x00, 0, true));
+    TEST_ASSERT_EQUAL(1, device.reads[0]);
+    TEST_ASSERT_EQUAL(0, device.writes[0]);
+
+    // a change is written, and later toggles use the cached value without reading again
+    TEST_ASSERT_TRUE(shadow.toggleBit(&bus, 0x20, 0x00, 3, true));
+    TEST_ASSERT_EQUAL(1, device.writes[0]);
+    TEST_ASSERT_EQUAL((uint8_t)0x09, device.registers[0]);
+    TEST_ASSERT_TRUE(shadow.toggleBit(&bus, 0x20, 0x00, 3, true));
+    TEST_ASSERT_EQUAL(1, device.writes[0]);
+    TEST_ASSERT_EQUAL(1, device.reads[0]);
+    TEST_ASSERT_EQUAL((uint16_t)0x09, shadow.readRegister(&bus, 0x20, 0x00));
+    TEST_ASSERT_EQUAL(1, device.reads[0]);
+
+    // writing the cached value again is skipped, resync writes everything cached back after a device reset
+    TEST_ASSERT_TRUE(shadow.writeRegister(&bus, 0x20, 0x01, 0x55));
+    TEST_ASSERT_TRUE(shadow.writeRegister(&bus, 0x20, 0x01, 0x55));
+    TEST_ASSERT_EQUAL(1, device.writes[1]);
+    device.registers[0] = device.registers[1] = 0;
+    TEST_ASSERT_TRUE(shadow.resync(&bus, 0x20));
+    TEST_ASSERT_EQUAL((uint8_t)0x09, device.registers[0]);
+    TEST_ASSERT_EQUAL((uint8_t)0x55, device.registers[1]);
+
+    // registers that are not in the list are never cached
+    shadow.toggleBit(&bus, 0x20, 0x02, 1, true);
+    shadow.toggleBit(&bus, 0x20, 0x02, 1, true);
+    TEST_ASSERT_EQUAL(2, device.reads[2]);
+}
@@ -20,8 +20,8 @@ const At24EepromType eepromType = PAGESIZE_AT24C16;//PAGESIZE_AT24C128;
 const char smallerTestString[] = "Test string that exceeds page size";
 const char longerTestString[] = "This is a test string that exceeds page size on larger EEPROMs with big pages";
 
-uint8_t pageSize;
-size_t eepromSize;
+uint16_t pageSize;
+EepromWidePosition eepromSize;
 
 void testI2CEeprom() {
     int loopsPerformed = 0;
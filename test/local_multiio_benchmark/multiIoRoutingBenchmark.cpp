@@ -0,0 +1,59 @@
+#include <Arduino.h>
+#include <IoAbstraction.h>
+#include <MockIoAbstraction.h>
+
+/**
+ * NOTES:
+ *  This is a local only benchmark, it times pin lookups through a MultiIoAbstraction as the number of expanders
+ *  grows. The pin being accessed is always on the last expander, which was the worst case when the delegates were
+ *  searched in turn. As each lookup goes through the routing table, the time taken should stay roughly flat.
+ *
+ *  It only reports the timings to serial, as how flat they are depends on the board and on interrupts while it runs.
+ */
+
+const int benchmarkIterations = 5000;
+const pinid_t benchmarkDevicePins = 8;
+const pinid_t benchmarkPinsPerExpander = 16;
+
+unsigned long timeLookupsWithExpanders(int numExpanders) {
+    auto multiIo = new MultiIoAbstraction(benchmarkDevicePins);
+    for(int i = 0; i < numExpanders; i++) {
+        multiIo->addIoExpander(new MockedIoAbstraction(), benchmarkPinsPerExpander);
+    }
+
+    pinid_t pinOnLastExpander = benchmarkDevicePins + ((numExpanders - 1) * benchmarkPinsPerExpander) + 3;
+    multiIo->pinMode(pinOnLastExpander, INPUT);
+
+    volatile uint8_t sink = 0;
+    unsigned long start = micros();
+    for(int i = 0; i < benchmarkIterations; i++) {
+        sink += multiIo->digitalRead(pinOnLastExpander);
+    }
+    unsigned long taken = micros() - start;
+
+    delete multiIo;
+    return taken;
+}
+
+void setup() {
+    Serial.begin(115200);
+    while(!Serial);
+
+    Serial.print("Multi IO lookups on the last expander, iterations = ");
+    Serial.println(benchmarkIterations);
+    Serial.println("expanders, micros, ns per lookup");
+
+    const int expanderCounts[] = { 1, 2, 4, 8, 12 };
+    for(auto count : expanderCounts) {
+        unsigned long taken = timeLookupsWithExpanders(count);
+        Serial.print(count);
+        Serial.print(", ");
+        Serial.print(taken);
+        Serial.print(", ");
+        Serial.println((taken * 1000UL) / benchmarkIterations);
+    }
+}
+
+void loop() {
+
+}
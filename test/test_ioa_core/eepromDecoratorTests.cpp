@@ -0,0 +1,227 @@
+
+#include <IoAbstraction.h>
+#include <MockEepromAbstraction.h>
+#include <WearLevelledEeprom.h>
+#include <AtomicSettingsEeprom.h>
+#include <unity.h>
+
+// two sectors of 100 bytes, each with a 6 byte header, a 32 byte snapshot and 62 bytes of journal.
+#define WEAR_TEST_START 10
+#define WEAR_TEST_PHYSICAL 200
+#define WEAR_TEST_LOGICAL 32
+
+void testWearLevelRoundTripAndRemount() {
+    MockEepromAbstraction backing(256);
+    WearLevelledEeprom eeprom(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_FALSE(eeprom.begin());
+    TEST_ASSERT_EQUAL((uint16_t)1, eeprom.getGeneration());
+    TEST_ASSERT_EQUAL((uint8_t)0, eeprom.read8(5));
+
+    const char text[] = "wear levelled";
+    eeprom.write8(0, 0xfe);
+    eeprom.write16(1, 0xf00d);
+    eeprom.write32(3, 0xbeeff00d);
+    eeprom.writeArrayToRom(10, (const uint8_t*)text, sizeof(text));
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+
+    WearLevelledEeprom remounted(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(remounted.begin());
+    TEST_ASSERT_EQUAL((uint8_t)0xfe, remounted.read8(0));
+    TEST_ASSERT_EQUAL((uint16_t)0xf00d, remounted.read16(1));
+    TEST_ASSERT_EQUAL((uint32_t)0xbeeff00d, remounted.read32(3));
+    char readBack[sizeof(text)];
+    remounted.readIntoMemArray((uint8_t*)readBack, 10, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING(text, readBack);
+    TEST_ASSERT_EQUAL(eeprom.getJournalSpace(), remounted.getJournalSpace());
+
+    // outside of the logical size is an error, even though the backing store is larger
+    remounted.write16(WEAR_TEST_LOGICAL - 1, 0xbad);
+    TEST_ASSERT_TRUE(remounted.hasErrorOccurred());
+    TEST_ASSERT_FALSE(remounted.hasErrorOccurred());
+}
+
+void testWearLevelUnchangedWritesAppendNothing() {
+    MockEepromAbstraction backing(256);
+    WearLevelledEeprom eeprom(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    eeprom.begin();
+
+    eeprom.write32(4, 0x12345678);
+    uint16_t space = eeprom.getJournalSpace();
+    eeprom.write32(4, 0x12345678);
+    eeprom.write8(20, 0);
+    TEST_ASSERT_EQUAL(space, eeprom.getJournalSpace());
+
+    // only the byte that changed is journalled, a five byte record plus one byte of data
+    eeprom.write32(4, 0x12345600);
+    TEST_ASSERT_EQUAL(space - 6, eeprom.getJournalSpace());
+}
+
+void testWearLevelCompactsIntoOtherSector() {
+    MockEepromAbstraction backing(256);
+    WearLevelledEeprom eeprom(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    eeprom.begin();
+    eeprom.write16(30, 0xcafe);
+
+    for(int i = 0; i < 25; i++) {
+        eeprom.write8(0, i + 1);
+    }
+    TEST_ASSERT_EQUAL((uint16_t)2, eeprom.getCompactions());
+    TEST_ASSERT_EQUAL((uint16_t)3, eeprom.getGeneration());
+
+    // sector 1 was written by the first compaction, then sector 0 again by the second.
+    TEST_ASSERT_EQUAL((uint8_t)'W', backing.read8(WEAR_TEST_START));
+    TEST_ASSERT_EQUAL((uint8_t)'W', backing.read8(WEAR_TEST_START + WEAR_TEST_PHYSICAL / 2));
+
+    WearLevelledEeprom remounted(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(remounted.begin());
+    TEST_ASSERT_EQUAL((uint16_t)3, remounted.getGeneration());
+    TEST_ASSERT_EQUAL((uint8_t)25, remounted.read8(0));
+    TEST_ASSERT_EQUAL((uint16_t)0xcafe, remounted.read16(30));
+    TEST_ASSERT_FALSE(backing.hasErrorOccurred());
+}
+
+void testWearLevelIgnoresTornWrites() {
+    MockEepromAbstraction backing(256);
+    WearLevelledEeprom eeprom(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    eeprom.begin();
+    eeprom.write8(0, 0x11);
+    eeprom.write8(1, 0x22);
+
+    // corrupt the data of the last record, as if the power failed part way through writing it
+    EepromPosition journal = WEAR_TEST_START + WEAR_LEVEL_HEADER_SIZE + WEAR_TEST_LOGICAL;
+    backing.write8(journal + 6 + 3, 0x99);
+
+    WearLevelledEeprom remounted(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(remounted.begin());
+    TEST_ASSERT_EQUAL((uint8_t)0x11, remounted.read8(0));
+    TEST_ASSERT_EQUAL((uint8_t)0, remounted.read8(1));
+
+    // the next write goes over the torn record, and is read back after another boot
+    remounted.write8(2, 0x33);
+    WearLevelledEeprom again(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(again.begin());
+    TEST_ASSERT_EQUAL((uint8_t)0x11, again.read8(0));
+    TEST_ASSERT_EQUAL((uint8_t)0x33, again.read8(2));
+
+    // now fill the journal so a new snapshot is written, then tear that snapshot, the older sector is used instead.
+    for(int i = 0; i < 20 && again.getCompactions() == 0; i++) {
+        again.write8(3, i + 1);
+    }
+    TEST_ASSERT_EQUAL((uint16_t)1, again.getCompactions());
+    backing.write8(WEAR_TEST_START + (WEAR_TEST_PHYSICAL / 2) + WEAR_LEVEL_HEADER_SIZE, 0x55);
+
+    WearLevelledEeprom fallback(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(fallback.begin());
+    TEST_ASSERT_EQUAL((uint16_t)1, fallback.getGeneration());
+    TEST_ASSERT_EQUAL((uint8_t)0x11, fallback.read8(0));
+    TEST_ASSERT_EQUAL((uint8_t)0x33, fallback.read8(2));
+}
+
+void testWearLevelFormatAfterCompaction() {
+    MockEepromAbstraction backing(256);
+    WearLevelledEeprom eeprom(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    eeprom.begin();
+    eeprom.write16(30, 0xcafe);
+    for(int i = 0; i < 20 && eeprom.getCompactions() == 0; i++) {
+        eeprom.write8(0, i + 1);
+    }
+    TEST_ASSERT_EQUAL((uint16_t)2, eeprom.getGeneration());
+
+    // the format goes into the other sector with a newer generation, so the old contents are not mounted again.
+    eeprom.format();
+    TEST_ASSERT_EQUAL((uint16_t)3, eeprom.getGeneration());
+    TEST_ASSERT_EQUAL((uint16_t)0, eeprom.read16(30));
+
+    WearLevelledEeprom remounted(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(remounted.begin());
+    TEST_ASSERT_EQUAL((uint16_t)3, remounted.getGeneration());
+    TEST_ASSERT_EQUAL((uint8_t)0, remounted.read8(0));
+    TEST_ASSERT_EQUAL((uint16_t)0, remounted.read16(30));
+
+    // writes after the format are journalled against it as usual
+    remounted.write8(1, 0x42);
+    WearLevelledEeprom again(&backing, WEAR_TEST_START, WEAR_TEST_PHYSICAL, WEAR_TEST_LOGICAL);
+    TEST_ASSERT_TRUE(again.begin());
+    TEST_ASSERT_EQUAL((uint8_t)0x42, again.read8(1));
+    TEST_ASSERT_EQUAL((uint16_t)0, again.read16(30));
+    TEST_ASSERT_FALSE(backing.hasErrorOccurred());
+}
+
+// each copy is an 8 byte header then 24 bytes of settings, so copy B starts 32 bytes after copy A.
+#define SETTINGS_TEST_START 20
+#define SETTINGS_TEST_SIZE 24
+
+void testAtomicSettingsCommitAndBoot() {
+    MockEepromAbstraction backing(256);
+    AtomicSettingsEeprom settings(&backing, SETTINGS_TEST_START, SETTINGS_TEST_SIZE);
+    TEST_ASSERT_FALSE(settings.begin());
+    TEST_ASSERT_EQUAL((uint32_t)0, settings.getSequence());
+
+    // writes stay in RAM until the commit
+    settings.write8(0, 0xfe);
+    settings.write16(1, 0xf00d);
+    settings.write32(3, 0xbeeff00d);
+    TEST_ASSERT_TRUE(settings.isDirty());
+    TEST_ASSERT_EQUAL((uint8_t)0, backing.read8(SETTINGS_TEST_START + ATOMIC_SETTINGS_HEADER_SIZE));
+    TEST_ASSERT_TRUE(settings.commit());
+    TEST_ASSERT_FALSE(settings.isDirty());
+    TEST_ASSERT_EQUAL((uint32_t)1, settings.getSequence());
+    TEST_ASSERT_EQUAL((uint8_t)0, settings.getActiveCopy());
+
+    // the next commit goes into the other copy, and a commit with nothing changed writes nothing
+    settings.write8(0, 0xaa);
+    TEST_ASSERT_TRUE(settings.flush());
+    TEST_ASSERT_EQUAL((uint8_t)1, settings.getActiveCopy());
+    settings.write8(0, 0xaa);
+    TEST_ASSERT_FALSE(settings.isDirty());
+    TEST_ASSERT_TRUE(settings.commit());
+    TEST_ASSERT_EQUAL((uint32_t)2, settings.getSequence());
+
+    AtomicSettingsEeprom booted(&backing, SETTINGS_TEST_START, SETTINGS_TEST_SIZE);
+    TEST_ASSERT_TRUE(booted.begin());
+    TEST_ASSERT_EQUAL((uint32_t)2, booted.getSequence());
+    TEST_ASSERT_EQUAL((uint8_t)1, booted.getActiveCopy());
+    TEST_ASSERT_EQUAL((uint8_t)0xaa, booted.read8(0));
+    TEST_ASSERT_EQUAL((uint16_t)0xf00d, booted.read16(1));
+    TEST_ASSERT_EQUAL((uint32_t)0xbeeff00d, booted.read32(3));
+
+    booted.write8(SETTINGS_TEST_SIZE, 1);
+    TEST_ASSERT_TRUE(booted.hasErrorOccurred());
+    TEST_ASSERT_FALSE(backing.hasErrorOccurred());
+}
+
+void testAtomicSettingsTornCommitKeepsPrevious() {
+    MockEepromAbstraction backing(256);
+    AtomicSettingsEeprom settings(&backing, SETTINGS_TEST_START, SETTINGS_TEST_SIZE);
+    settings.begin();
+    settings.write32(0, 0x11111111UL);
+    settings.commit();
+    settings.write32(0, 0x22222222UL);
+    settings.commit();
+
+    // a commit where the power failed before the settings were all written, copy B is then corrupt.
+    EepromPosition copyB = SETTINGS_TEST_START + ATOMIC_SETTINGS_HEADER_SIZE + SETTINGS_TEST_SIZE;
+    backing.write8(copyB + ATOMIC_SETTINGS_HEADER_SIZE + 2, 0x99);
+    AtomicSettingsEeprom booted(&backing, SETTINGS_TEST_START, SETTINGS_TEST_SIZE);
+    TEST_ASSERT_TRUE(booted.begin());
+    TEST_ASSERT_EQUAL((uint32_t)1, booted.getSequence());
+    TEST_ASSERT_EQUAL((uint32_t)0x11111111UL, booted.read32(0));
+
+    // the next commit overwrites the corrupt copy, and boot goes back to that one
+    booted.write32(0, 0x33333333UL);
+    TEST_ASSERT_TRUE(booted.commit());
+    TEST_ASSERT_EQUAL((uint8_t)1, booted.getActiveCopy());
+    TEST_ASSERT_EQUAL((uint32_t)2, booted.getSequence());
+
+    // a header that is only partly written is also rejected
+    backing.write8(copyB, 0x07);
+    AtomicSettingsEeprom again(&backing, SETTINGS_TEST_START, SETTINGS_TEST_SIZE);
+    TEST_ASSERT_TRUE(again.begin());
+    TEST_ASSERT_EQUAL((uint32_t)0x11111111UL, again.read32(0));
+
+    // and with both copies corrupt, nothing is loaded
+    backing.write8(SETTINGS_TEST_START + ATOMIC_SETTINGS_HEADER_SIZE, 0x55);
+    AtomicSettingsEeprom neither(&backing, SETTINGS_TEST_START, SETTINGS_TEST_SIZE);
+    TEST_ASSERT_FALSE(neither.begin());
+    TEST_ASSERT_EQUAL((uint32_t)0, neither.read32(0));
+}
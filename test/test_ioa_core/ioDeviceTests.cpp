@@ -139,4 +139,269 @@ void testMultiIoPassThrough() {
 
     TEST_ASSERT_EQUAL(ioDevice1.getErrorMode(), NO_ERROR);
     TEST_ASSERT_EQUAL(ioDevice2.getErrorMode(), NO_ERROR);
-}
\ No newline at end of file
+}
+
+void testMultiIoBulkPins() {
+    // the multi IO deletes its expanders, so they must be on the heap.
+    auto bulkDevice1 = new MockedIoAbstraction();
+    auto bulkDevice2 = new MockedIoAbstraction();
+    MultiIoAbstraction bulkMultiIo(100);
+    bulkMultiIo.addIoExpander(bulkDevice1, 16);
+    bulkMultiIo.addIoExpander(bulkDevice2, 16);
+
+    for(int i=0; i<8; i++) {
+        bulkMultiIo.pinMode(100 + i, OUTPUT);
+        bulkMultiIo.pinMode(108 + i, INPUT);
+        bulkMultiIo.pinMode(116 + i, INPUT);
+        bulkMultiIo.pinMode(124 + i, OUTPUT);
+    }
+
+    // a read that spans both devices, pins 108..115 are on the first and 116..123 on the second.
+    bulkDevice1->setValueForReading(0, 0xa500);
+    bulkDevice2->setValueForReading(0, 0x003c);
+    TEST_ASSERT_EQUAL_UINT32(0x3ca5, bulkMultiIo.readPins(108, 0xffff));
+    TEST_ASSERT_EQUAL_UINT32(0x0c05, bulkMultiIo.readPins(108, 0x0f0f));
+
+    // a write that spans both devices, pins 100..107 and 124..131.
+    bulkMultiIo.writePins(100, 0xff0000ff, 0xc3000081);
+    TEST_ASSERT_EQUAL_UINT16(0x0081, bulkDevice1->getWrittenValue(0));
+    TEST_ASSERT_EQUAL_UINT16(0xc300, bulkDevice2->getWrittenValue(0));
+
+    // only the pins in the mask should change
+    bulkMultiIo.writePins(100, 0x00000003, 0x00000002);
+    TEST_ASSERT_EQUAL_UINT16(0x0082, bulkDevice1->getWrittenValue(0));
+
+    TEST_ASSERT_EQUAL(NO_ERROR, bulkDevice1->getErrorMode());
+    TEST_ASSERT_EQUAL(NO_ERROR, bulkDevice2->getErrorMode());
+}
+
+void testMultiIoOnlySyncsWhenNeeded() {
+    // the multi IO deletes its expanders, so they must be on the heap.
+    auto syncOutputDevice = new MockedIoAbstraction();
+    auto syncInputDevice = new MockedIoAbstraction();
+    MultiIoAbstraction syncMultiIo(100);
+    syncMultiIo.addIoExpander(syncOutputDevice, 16);
+    syncMultiIo.addIoExpander(syncInputDevice, 16);
+
+    syncMultiIo.pinMode(100, OUTPUT);
+    syncMultiIo.pinMode(116, INPUT);
+
+    // both are synced the first time around, after that only the one with inputs.
+    syncMultiIo.sync();
+    syncMultiIo.sync();
+    syncMultiIo.sync();
+    TEST_ASSERT_EQUAL(1, syncOutputDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL(3, syncInputDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL((uint32_t)2, syncMultiIo.getSkippedSyncCount());
+
+    // writing to the output device makes it dirty for one sync.
+    syncMultiIo.digitalWrite(100, HIGH);
+    syncMultiIo.sync();
+    syncMultiIo.sync();
+    TEST_ASSERT_EQUAL(2, syncOutputDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL(5, syncInputDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL((uint32_t)3, syncMultiIo.getSkippedSyncCount());
+
+    // and when forced it is synced every time.
+    syncMultiIo.alwaysSyncExpander(105);
+    syncMultiIo.sync();
+    TEST_ASSERT_EQUAL(3, syncOutputDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL((uint32_t)3, syncMultiIo.getSkippedSyncCount());
+}
+
+class FailingSyncIoAbstraction : public MockedIoAbstraction {
+public:
+    bool syncResult = false;
+
+    bool runLoop() override {
+        MockedIoAbstraction::runLoop();
+        return syncResult;
+    }
+};
+
+void testMultiIoSyncsEveryDelegateAfterFailure() {
+    auto failingDevice = new FailingSyncIoAbstraction();
+    auto workingDevice = new MockedIoAbstraction();
+    MultiIoAbstraction failMultiIo(100);
+    failMultiIo.addIoExpander(failingDevice, 16);
+    failMultiIo.addIoExpander(workingDevice, 16);
+    failMultiIo.pinMode(100, OUTPUT);
+    failMultiIo.pinMode(116, OUTPUT);
+    failMultiIo.digitalWrite(100, HIGH);
+    failMultiIo.digitalWrite(116, HIGH);
+
+    // the failure is reported, but the device after the failing one is still synced and its outputs are written.
+    TEST_ASSERT_FALSE(failMultiIo.sync());
+    TEST_ASSERT_EQUAL(1, failingDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL(1, workingDevice->getNumberOfRunLoops());
+
+    // only the failing device still has outputs to write, so it alone is tried again.
+    TEST_ASSERT_FALSE(failMultiIo.sync());
+    TEST_ASSERT_EQUAL(2, failingDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL(1, workingDevice->getNumberOfRunLoops());
+
+    failingDevice->syncResult = true;
+    TEST_ASSERT_TRUE(failMultiIo.sync());
+    TEST_ASSERT_TRUE(failMultiIo.sync());
+    TEST_ASSERT_EQUAL(3, failingDevice->getNumberOfRunLoops());
+}
+
+class ConfigCountingIoAbstraction : public MockedIoAbstraction {
+public:
+    int beginCalls = 0;
+    int commitCalls = 0;
+    bool commitResult = true;
+
+    void beginConfig() override { beginCalls++; }
+    bool commitConfig() override { commitCalls++; return commitResult; }
+};
+
+void testMultiIoConfigBatch() {
+    // the multi IO deletes its expanders, so they must be on the heap.
+    auto firstDevice = new ConfigCountingIoAbstraction();
+    auto secondDevice = new ConfigCountingIoAbstraction();
+    MultiIoAbstraction batchMultiIo(100);
+    batchMultiIo.addIoExpander(firstDevice, 16);
+    batchMultiIo.addIoExpander(secondDevice, 16);
+
+    batchMultiIo.beginConfig();
+    batchMultiIo.pinMode(100, INPUT);
+    batchMultiIo.pinMode(116, OUTPUT);
+    TEST_ASSERT_TRUE(batchMultiIo.commitConfig());
+    TEST_ASSERT_EQUAL(1, firstDevice->beginCalls);
+    TEST_ASSERT_EQUAL(1, firstDevice->commitCalls);
+    TEST_ASSERT_EQUAL(1, secondDevice->beginCalls);
+    TEST_ASSERT_EQUAL(1, secondDevice->commitCalls);
+
+    // every device is committed even when one fails, and the failure is reported.
+    firstDevice->commitResult = false;
+    batchMultiIo.beginConfig();
+    TEST_ASSERT_FALSE(batchMultiIo.commitConfig());
+    TEST_ASSERT_EQUAL(2, secondDevice->commitCalls);
+}
+
+class ChangeTrackingIoAbstraction : public FailingSyncIoAbstraction {
+public:
+    IoPinMask changed = 0;
+
+    ChangeTrackingIoAbstraction() { syncResult = true; }
+
+    IoPinMask changedPins(pinid_t firstPin, IoPinMask mask) override { return (changed >> firstPin) & mask; }
+    void clearChangedPins(pinid_t firstPin, IoPinMask mask) override { changed &= ~(mask << firstPin); }
+};
+
+void testMultiIoChangedPins() {
+    auto trackingDevice = new ChangeTrackingIoAbstraction();
+    MultiIoAbstraction changeMultiIo(100);
+    changeMultiIo.addIoExpander(new MockedIoAbstraction(), 16);
+    changeMultiIo.addIoExpander(trackingDevice, 16);
+    changeMultiIo.pinMode(116, INPUT);
+
+    // by default devices cannot tell, so every pin may have changed
+    MockedIoAbstraction plainDevice;
+    TEST_ASSERT_EQUAL((uint32_t)0xff, (uint32_t)plainDevice.changedPins(0, 0xff));
+    TEST_ASSERT_EQUAL((uint32_t)0xffff, (uint32_t)changeMultiIo.changedPins(100, 0xffff));
+
+    // until the tracking device has been synced, what it reports could be stale, so all its pins are reported.
+    trackingDevice->changed = 0x0005;
+    TEST_ASSERT_EQUAL((uint32_t)0xffff, (uint32_t)changeMultiIo.changedPins(116, 0xffff));
+
+    // tracked pins are moved into place across the expander boundary, untracked ones are all reported.
+    TEST_ASSERT_TRUE(changeMultiIo.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0x0005, (uint32_t)changeMultiIo.changedPins(116, 0xffff));
+    TEST_ASSERT_EQUAL((uint32_t)0x05ff, (uint32_t)changeMultiIo.changedPins(108, 0xffff));
+
+    // clearing is also split between the expanders, here pin 116 is cleared on the tracking device as its pin 0.
+    changeMultiIo.clearChangedPins(108, 0x0100);
+    TEST_ASSERT_EQUAL((uint32_t)0x0004, (uint32_t)trackingDevice->changed);
+    TEST_ASSERT_EQUAL((uint32_t)0x0004, (uint32_t)changeMultiIo.changedPins(116, 0xffff));
+}
+
+void testMultiIoChangedPinsAfterSkippedOrFailedSync() {
+    auto inputDevice = new ChangeTrackingIoAbstraction();
+    auto outputDevice = new ChangeTrackingIoAbstraction();
+    MultiIoAbstraction changeMultiIo(100);
+    changeMultiIo.addIoExpander(inputDevice, 16);
+    changeMultiIo.addIoExpander(outputDevice, 16);
+    changeMultiIo.pinMode(100, INPUT);
+    changeMultiIo.pinMode(116, OUTPUT);
+
+    // both are synced the first time as the direction change needs writing, so both can report their changes.
+    inputDevice->changed = 0x0001;
+    outputDevice->changed = 0x0002;
+    TEST_ASSERT_TRUE(changeMultiIo.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0x00020001, (uint32_t)changeMultiIo.changedPins(100, 0xffffffff));
+
+    // the output device is skipped next time, so what it reports is from the earlier sync and is not used.
+    TEST_ASSERT_TRUE(changeMultiIo.sync());
+    TEST_ASSERT_EQUAL(1, outputDevice->getNumberOfRunLoops());
+    TEST_ASSERT_EQUAL((uint32_t)0xffff0001, (uint32_t)changeMultiIo.changedPins(100, 0xffffffff));
+
+    // a failed sync leaves the inputs unknown, once a sync succeeds the device is trusted again.
+    inputDevice->syncResult = false;
+    TEST_ASSERT_FALSE(changeMultiIo.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0x0000ffff, (uint32_t)changeMultiIo.changedPins(100, 0x0000ffff));
+    inputDevice->syncResult = true;
+    TEST_ASSERT_TRUE(changeMultiIo.sync());
+    TEST_ASSERT_EQUAL((uint32_t)0x00000001, (uint32_t)changeMultiIo.changedPins(100, 0x0000ffff));
+}
+
+/**
+ * A mock device that makes a single byte write on the bus each time it is synced.
+ */
+class WireTrafficIoAbstraction : public MockedIoAbstraction {
+public:
+    bool runLoop() override {
+        ioaStatsWireWrite(1, true);
+        return MockedIoAbstraction::runLoop();
+    }
+};
+
+void testDeviceStatsCounting() {
+    MockedIoAbstraction statsDevice;
+    IoDeviceStats deviceStats;
+    IoDeviceStats otherStats;
+
+    // syncs are counted only once stats are attached
+    statsDevice.sync();
+    statsDevice.setDeviceStats(&deviceStats);
+    TEST_ASSERT_EQUAL_PTR(&deviceStats, statsDevice.getDeviceStats());
+    statsDevice.sync();
+    ioDeviceSync(&statsDevice);
+    TEST_ASSERT_EQUAL((uint32_t)2, deviceStats.runLoopCalls);
+    TEST_ASSERT_EQUAL((uint32_t)0, deviceStats.failedSyncs);
+    TEST_ASSERT_TRUE(deviceStats.maxSyncMicros <= deviceStats.totalSyncMicros);
+
+    // wire traffic is counted against the active scope, and nested scopes restore the outer one when they end.
+    {
+        IoDeviceStatsScope outer(&deviceStats, false);
+        ioaStatsWireWrite(3, true);
+        {
+            IoDeviceStatsScope inner(&otherStats, false);
+            ioaStatsWireRetry();
+            ioaStatsWireRead(4, false);
+        }
+        ioaStatsWireRead(2, true);
+    }
+    ioaStatsWireRead(10, true); // no scope active, not counted anywhere
+
+    // a device without stats synced while a tracked device is waiting in its scope is not charged to that device.
+    WireTrafficIoAbstraction untrackedDevice;
+    {
+        IoDeviceStatsScope waiting(&deviceStats, false);
+        untrackedDevice.sync();
+    }
+
+    TEST_ASSERT_EQUAL((uint32_t)2, deviceStats.transactions);
+    TEST_ASSERT_EQUAL((uint32_t)3, deviceStats.bytesWritten);
+    TEST_ASSERT_EQUAL((uint32_t)2, deviceStats.bytesRead);
+    TEST_ASSERT_EQUAL((uint32_t)0, deviceStats.failures);
+    TEST_ASSERT_EQUAL((uint32_t)1, otherStats.transactions);
+    TEST_ASSERT_EQUAL((uint32_t)1, otherStats.retries);
+    TEST_ASSERT_EQUAL((uint32_t)1, otherStats.failures);
+    TEST_ASSERT_EQUAL((uint32_t)0, otherStats.bytesRead);
+
+    deviceStats.reset();
+    TEST_ASSERT_EQUAL((uint32_t)0, deviceStats.runLoopCalls);
+    TEST_ASSERT_EQUAL((uint32_t)0, deviceStats.transactions);
+}
@@ -4,6 +4,7 @@
 #include <MockEepromAbstraction.h>
 #include <EepromAbstractionWire.h>
 #include <unity.h>
+#include <string.h>
 
 
 char memToWrite[110] = { };
@@ -31,3 +32,58 @@ void testMockEeprom() {
     eeprom.write16(1000, 0xbad);
     TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
 }
+
+/**
+ * Only has the narrow array functions, so that the default wide functions in EepromAbstraction are used.
+ */
+class NarrowOnlyEeprom : public EepromAbstraction {
+public:
+    MockEepromAbstraction mock;
+    int arrayCalls = 0;
+
+    explicit NarrowOnlyEeprom(unsigned int size) : mock(size) {}
+    uint8_t read8(EepromPosition position) override { return mock.read8(position); }
+    void write8(EepromPosition position, uint8_t val) override { mock.write8(position, val); }
+    uint16_t read16(EepromPosition position) override { return mock.read16(position); }
+    void write16(EepromPosition position, uint16_t val) override { mock.write16(position, val); }
+    uint32_t read32(EepromPosition position) override { return mock.read32(position); }
+    void write32(EepromPosition position, uint32_t val) override { mock.write32(position, val); }
+    void readIntoMemArray(uint8_t* memDest, EepromPosition romSrc, uint8_t len) override {
+        arrayCalls++;
+        mock.readIntoMemArray(memDest, romSrc, len);
+    }
+    void writeArrayToRom(EepromPosition romDest, const uint8_t* memSrc, uint8_t len) override {
+        arrayCalls++;
+        mock.writeArrayToRom(romDest, memSrc, len);
+    }
+};
+
+uint8_t wideData[600];
+uint8_t wideReadBack[600];
+
+void testMockEepromWide() {
+    for(size_t i = 0; i < sizeof wideData; i++) wideData[i] = uint8_t(i * 7);
+
+    // the mock takes any length in one go
+    MockEepromAbstraction eeprom(1024);
+    TEST_ASSERT_TRUE(eeprom.writeArrayToRomWide(100, wideData, sizeof wideData));
+    TEST_ASSERT_TRUE(eeprom.readIntoMemArrayWide(wideReadBack, 100, sizeof wideReadBack));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(wideData, wideReadBack, sizeof wideData);
+    TEST_ASSERT_EQUAL(wideData[300], eeprom.read8(400));
+    TEST_ASSERT_FALSE(eeprom.hasErrorOccurred());
+
+    TEST_ASSERT_FALSE(eeprom.readIntoMemArrayWide(wideReadBack, 500, sizeof wideReadBack));
+    TEST_ASSERT_TRUE(eeprom.hasErrorOccurred());
+
+    // the default implementation splits into calls of up to 255 bytes, and cannot go beyond 64K
+    NarrowOnlyEeprom narrow(1024);
+    TEST_ASSERT_TRUE(narrow.writeArrayToRomWide(10, wideData, sizeof wideData));
+    TEST_ASSERT_EQUAL(3, narrow.arrayCalls);
+    memset(wideReadBack, 0, sizeof wideReadBack);
+    TEST_ASSERT_TRUE(narrow.readIntoMemArrayWide(wideReadBack, 10, sizeof wideReadBack));
+    TEST_ASSERT_EQUAL(6, narrow.arrayCalls);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(wideData, wideReadBack, sizeof wideData);
+    TEST_ASSERT_FALSE(narrow.readIntoMemArrayWide(wideReadBack, 0x10000UL, 1));
+    TEST_ASSERT_FALSE(narrow.writeArrayToRomWide(0xff00UL, wideData, sizeof wideData));
+    TEST_ASSERT_EQUAL(6, narrow.arrayCalls);
+}
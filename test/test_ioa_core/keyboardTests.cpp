@@ -0,0 +1,99 @@
+#include <TaskManagerIO.h>
+#include <unity.h>
+#include "KeyboardManager.h"
+
+/**
+ * Simulates a keypad wired to a device, the columns are outputs and the rows are inputs with pull ups. A row reads low
+ * only when the pressed key is in that row and its column is driven low. Bulk and single pin calls are counted.
+ */
+class KeypadMatrixIo : public BasicIoAbstraction {
+private:
+    uint32_t outputs = 0;
+public:
+    int pressedRow = -1;
+    int pressedCol = -1;
+    int bulkReads = 0;
+    int bulkWrites = 0;
+    int singleReads = 0;
+    int singleWrites = 0;
+
+    void resetCounts() { bulkReads = bulkWrites = singleReads = singleWrites = 0; }
+
+    void pinDirection(pinid_t, uint8_t) override {}
+    void attachInterrupt(pinid_t, RawIntHandler, uint8_t) override {}
+    bool runLoop() override { return true; }
+
+    void writeValue(pinid_t pin, uint8_t value) override {
+        singleWrites++;
+        bitWrite(outputs, pin, value);
+    }
+
+    uint8_t readValue(pinid_t pin) override {
+        singleReads++;
+        return rowLevel(pin);
+    }
+
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override {
+        bulkReads++;
+        IoPinMask result = 0;
+        for(uint8_t i = 0; i < IO_PIN_MASK_BITS; i++) {
+            if(bitRead(mask, i) && rowLevel(firstPin + i)) result |= (IoPinMask(1) << i);
+        }
+        return result;
+    }
+
+    void writePins(pinid_t firstPin, IoPinMask mask, IoPinMask values) override {
+        bulkWrites++;
+        for(uint8_t i = 0; i < IO_PIN_MASK_BITS; i++) {
+            if(bitRead(mask, i)) bitWrite(outputs, firstPin + i, bitRead(values, i));
+        }
+    }
+
+private:
+    uint8_t rowLevel(pinid_t pin) const {
+        // rows are on pins 4 onwards, columns on pins 0 onwards
+        bool keyInRow = pressedRow >= 0 && pin == (4 + pressedRow);
+        return (keyInRow && !bitRead(outputs, pressedCol)) ? LOW : HIGH;
+    }
+};
+
+class RecordingKeyListener : public KeyboardListener {
+public:
+    char lastPressed = 0;
+    char lastReleased = 0;
+    void keyPressed(char key, bool) override { lastPressed = key; }
+    void keyReleased(char key) override { lastReleased = key; }
+};
+
+MAKE_KEYBOARD_LAYOUT_3X4(bulkTestLayout)
+
+void testKeyboardScansWithBulkPins() {
+    KeyboardLayout& layout = bulkTestLayout;
+    for(int i = 0; i < 4; i++) layout.setRowPin(i, 4 + i);
+    for(int i = 0; i < 3; i++) layout.setColPin(i, i);
+
+    KeypadMatrixIo keypad;
+    RecordingKeyListener listener;
+    MatrixKeyboardManager keyboard;
+    keyboard.initialise(&keypad, &layout, &listener);
+    // the scans are driven by hand below
+    taskManager.reset();
+
+    // row 1 column 2 is the 6 key, each scan is a bulk write and a bulk read per column
+    keypad.pressedRow = 1;
+    keypad.pressedCol = 2;
+    keypad.resetCounts();
+    for(int i = 0; i < 4 && listener.lastPressed == 0; i++) keyboard.exec();
+    TEST_ASSERT_EQUAL('6', listener.lastPressed);
+
+    keypad.resetCounts();
+    keyboard.exec();
+    TEST_ASSERT_EQUAL(3, keypad.bulkWrites);
+    TEST_ASSERT_EQUAL(3, keypad.bulkReads);
+    TEST_ASSERT_EQUAL(0, keypad.singleWrites);
+    TEST_ASSERT_EQUAL(0, keypad.singleReads);
+
+    keypad.pressedRow = -1;
+    keyboard.exec();
+    TEST_ASSERT_EQUAL('6', listener.lastReleased);
+}
@@ -309,3 +309,190 @@ void testChangingFromListenerToCallback() {
     TEST_ASSERT_FALSE(testSwitchListener.wasActivated());
     fixture.teardown();
 }
+
+/**
+ * A mock device that records each bulk read, so that tests can check switches read their keys together.
+ */
+class BulkCountingMockIo : public MockedIoAbstraction {
+public:
+    int readPinsCalls = 0;
+    pinid_t lastFirstPin = 0;
+    IoPinMask lastMask = 0;
+
+    BulkCountingMockIo() : MockedIoAbstraction(25) {}
+
+    IoPinMask readPins(pinid_t firstPin, IoPinMask mask) override {
+        readPinsCalls++;
+        lastFirstPin = firstPin;
+        lastMask = mask;
+        return MockedIoAbstraction::readPins(firstPin, mask);
+    }
+};
+
+void testSwitchesReadKeysInOneBulkCall() {
+    SwitchesFixture fixture;
+    fixture.setup();
+    BulkCountingMockIo bulkIo;
+    switches.initialise(&bulkIo, true);
+    switches.addSwitch(3, onSwitchPressed, NO_REPEAT);
+    switches.addSwitch(9, onSwitchPressed, NO_REPEAT);
+
+    // pin 3 is pulled up and pin 9 is held down, both keys are in the same 32 pin window so it is one read
+    for(int i = 0; i < 25; i++) bulkIo.setValueForReading(i, 0x0008);
+    switches.runLoop();
+    TEST_ASSERT_EQUAL(1, bulkIo.readPinsCalls);
+    TEST_ASSERT_EQUAL(3, bulkIo.lastFirstPin);
+    TEST_ASSERT_EQUAL_UINT32(0x41, bulkIo.lastMask);
+
+    int loopCount = 0;
+    while(!pressed && ++loopCount < 200) {
+        taskManager.yieldForMicros(2000);
+    }
+    TEST_ASSERT_TRUE(pressed);
+    TEST_ASSERT_EQUAL(9, key);
+    TEST_ASSERT_EQUAL(NO_ERROR, bulkIo.getErrorMode());
+    fixture.teardown();
+}
+
+/**
+ * A device where the test sets the level of each pin directly, along with which pins it reports as changed by the
+ * last sync, as a device that can tell which pins changed would.
+ */
+class ChangeReportingIo : public BasicIoAbstraction {
+public:
+    IoPinMask levels = 0xffffffff;
+    IoPinMask changed = 0;
+    bool syncResult = true;
+    int syncCount = 0;
+
+    void pinDirection(pinid_t, uint8_t) override {}
+    void writeValue(pinid_t, uint8_t) override {}
+    uint8_t readValue(pinid_t pin) override { return (levels >> pin) & 1U; }
+    void attachInterrupt(pinid_t, RawIntHandler, uint8_t) override {}
+    void writePort(pinid_t, uint8_t) override {}
+    uint8_t readPort(pinid_t) override { return 0; }
+    bool runLoop() override {
+        syncCount++;
+        return syncResult;
+    }
+    IoPinMask changedPins(pinid_t firstPin, IoPinMask mask) override { return (changed >> firstPin) & mask; }
+
+    void setLevel(pinid_t pin, bool level) { bitWrite(levels, pin, level); }
+};
+
+void testSwitchesSkipIdleKeysThatDidNotChange() {
+    SwitchesFixture fixture;
+    fixture.setup();
+    ChangeReportingIo changeIo;
+    switches.initialise(&changeIo, true);
+    switches.addSwitch(2, onSwitchPressed, 5);
+    switches.onRelease(2, onSwitchReleased);
+
+    // the key is down, but while the device says its pin has not changed an idle key is not looked at.
+    changeIo.setLevel(2, false);
+    for(int i = 0; i < 5; i++) switches.runLoop();
+    TEST_ASSERT_FALSE(pressed);
+
+    // once the change is reported the key starts debouncing, and from then on it is checked on every sync, even
+    // though the device goes on reporting that nothing has changed.
+    changeIo.changed = 0x04;
+    switches.runLoop();
+    changeIo.changed = 0;
+    switches.runLoop();
+    TEST_ASSERT_TRUE(pressed);
+    TEST_ASSERT_EQUAL(1, callsMade);
+
+    // held across many syncs that report no change, it still goes to held and repeats.
+    for(int i = 0; i < HOLD_THRESHOLD + 30; i++) switches.runLoop();
+    TEST_ASSERT_TRUE(held);
+    TEST_ASSERT_GREATER_THAN(3, callsMade);
+    TEST_ASSERT_FALSE(keyReleased);
+
+    // and letting go is seen without the device reporting a change, as a pressed key is always checked.
+    changeIo.setLevel(2, true);
+    switches.runLoop();
+    TEST_ASSERT_TRUE(keyReleased);
+    TEST_ASSERT_TRUE(held);
+
+    // back to idle, the key is skipped again until its pin changes
+    int callsWhenReleased = callsMade;
+    changeIo.setLevel(2, false);
+    for(int i = 0; i < 5; i++) switches.runLoop();
+    TEST_ASSERT_EQUAL(callsWhenReleased, callsMade);
+    fixture.teardown();
+}
+
+static void turnEncoderOneStep(ChangeReportingIo& io, IoPinMask changedToReport) {
+    // a full cycle on pins 5 (A) and 6 (B), starting and ending with both low, with an interrupt for each edge. The
+    // steps are spaced out so that none are rejected as bounces.
+    taskManager.yieldForMicros(REJECT_DIRECTION_CHANGE_THRESHOLD);
+    const uint8_t cycle[] = { 0b01, 0b11, 0b10, 0b00 };
+    for(auto bits : cycle) {
+        io.setLevel(5, (bits >> 1) & 1U);
+        io.setLevel(6, bits & 1U);
+        io.changed = changedToReport;
+        onSwitchesInterrupt(5);
+    }
+}
+
+void testEncoderUsesSharedSyncChangedPins() {
+    SwitchesFixture fixture;
+    fixture.setup();
+    ChangeReportingIo changeIo;
+    changeIo.setLevel(5, false);
+    changeIo.setLevel(6, false);
+    switches.initialiseInterrupt(&changeIo, true);
+    auto encoder = new HwStateRotaryEncoder(5, 6, encoderCallback, HWACCEL_NONE);
+    switches.setEncoder(0, encoder);
+    switches.changeEncoderPrecision(100, 50);
+    callsMade = 0;
+
+    // the first interrupt finds both pins low and sets up the encoder state
+    changeIo.changed = 0x60;
+    onSwitchesInterrupt(5);
+    TEST_ASSERT_EQUAL(0, callsMade);
+
+    // switches syncs once for each interrupt and the encoder shares it, rather than syncing again
+    int syncsBefore = changeIo.syncCount;
+    turnEncoderOneStep(changeIo, 0x60);
+    TEST_ASSERT_EQUAL(syncsBefore + 4, changeIo.syncCount);
+    TEST_ASSERT_EQUAL(1, callsMade);
+    TEST_ASSERT_EQUAL(51, encoderCurrentVal);
+    TEST_ASSERT_FALSE(switches.isEncoderSyncShared());
+
+    // when the shared sync says the encoder pins did not change, the encoder does not read them at all
+    turnEncoderOneStep(changeIo, 0);
+    TEST_ASSERT_EQUAL(1, callsMade);
+
+    // a change on other pins only is skipped in the same way
+    turnEncoderOneStep(changeIo, 0x01);
+    TEST_ASSERT_EQUAL(1, callsMade);
+    turnEncoderOneStep(changeIo, 0x60);
+    TEST_ASSERT_EQUAL(2, callsMade);
+    TEST_ASSERT_EQUAL(52, encoderCurrentVal);
+
+    // the status of the shared sync is taken by the encoder as if it were its own
+    changeIo.syncResult = false;
+    changeIo.changed = 0;
+    onSwitchesInterrupt(5);
+    TEST_ASSERT_FALSE(encoder->didLastSyncSucceed());
+    changeIo.syncResult = true;
+
+    // called outside of a shared sync, such as when polling, the encoder syncs for itself and ignores changedPins
+    syncsBefore = changeIo.syncCount;
+    changeIo.changed = 0;
+    taskManager.yieldForMicros(REJECT_DIRECTION_CHANGE_THRESHOLD);
+    const uint8_t cycle[] = { 0b01, 0b11, 0b10, 0b00 };
+    for(auto bits : cycle) {
+        changeIo.setLevel(5, (bits >> 1) & 1U);
+        changeIo.setLevel(6, bits & 1U);
+        encoder->encoderChanged();
+    }
+    TEST_ASSERT_EQUAL(syncsBefore + 4, changeIo.syncCount);
+    TEST_ASSERT_EQUAL(3, callsMade);
+    TEST_ASSERT_TRUE(encoder->didLastSyncSucceed());
+
+    switches.setEncoder(0, nullptr);
+    delete encoder;
+    fixture.teardown();
+}
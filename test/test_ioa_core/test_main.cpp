@@ -2,9 +2,24 @@
 #include <unity.h>
 
 void testMockEeprom();
+void testMockEepromWide();
+void testWearLevelRoundTripAndRemount();
+void testWearLevelUnchangedWritesAppendNothing();
+void testWearLevelCompactsIntoOtherSector();
+void testWearLevelIgnoresTornWrites();
+void testWearLevelFormatAfterCompaction();
+void testAtomicSettingsCommitAndBoot();
+void testAtomicSettingsTornCommitKeepsPrevious();
 void testMockIoAbstractionRead();
 void testMockIoAbstractionWrite();
 void testMultiIoPassThrough();
+void testMultiIoBulkPins();
+void testMultiIoOnlySyncsWhenNeeded();
+void testMultiIoSyncsEveryDelegateAfterFailure();
+void testMultiIoConfigBatch();
+void testMultiIoChangedPins();
+void testMultiIoChangedPinsAfterSkippedOrFailedSync();
+void testDeviceStatsCounting();
 void testNegatingIoAbstractionRead();
 void testPressingASingleButton();
 void testInterruptButtonRepeating();
@@ -12,6 +27,10 @@ void testUpDownEncoder();
 void testChangingCallbacks();
 void testChangingFromCallbackToListener();
 void testChangingFromListenerToCallback();
+void testSwitchesReadKeysInOneBulkCall();
+void testSwitchesSkipIdleKeysThatDidNotChange();
+void testEncoderUsesSharedSyncChangedPins();
+void testKeyboardScansWithBulkPins();
 
 void setup() {
     Serial.begin(115200);
@@ -19,9 +38,24 @@ void setup() {
     UNITY_BEGIN();
 
     RUN_TEST(testMockEeprom);
+    RUN_TEST(testMockEepromWide);
+    RUN_TEST(testWearLevelRoundTripAndRemount);
+    RUN_TEST(testWearLevelUnchangedWritesAppendNothing);
+    RUN_TEST(testWearLevelCompactsIntoOtherSector);
+    RUN_TEST(testWearLevelIgnoresTornWrites);
+    RUN_TEST(testWearLevelFormatAfterCompaction);
+    RUN_TEST(testAtomicSettingsCommitAndBoot);
+    RUN_TEST(testAtomicSettingsTornCommitKeepsPrevious);
     RUN_TEST(testMockIoAbstractionRead);
     RUN_TEST(testMockIoAbstractionWrite);
     RUN_TEST(testMultiIoPassThrough);
+    RUN_TEST(testMultiIoBulkPins);
+    RUN_TEST(testMultiIoOnlySyncsWhenNeeded);
+    RUN_TEST(testMultiIoSyncsEveryDelegateAfterFailure);
+    RUN_TEST(testMultiIoConfigBatch);
+    RUN_TEST(testMultiIoChangedPins);
+    RUN_TEST(testMultiIoChangedPinsAfterSkippedOrFailedSync);
+    RUN_TEST(testDeviceStatsCounting);
     RUN_TEST(testNegatingIoAbstractionRead);
     RUN_TEST(testPressingASingleButton);
     RUN_TEST(testInterruptButtonRepeating);
@@ -30,6 +64,10 @@ void setup() {
     RUN_TEST(testChangingCallbacks);
     RUN_TEST(testChangingFromCallbackToListener);
     RUN_TEST(testChangingFromListenerToCallback);
+    RUN_TEST(testSwitchesReadKeysInOneBulkCall);
+    RUN_TEST(testSwitchesSkipIdleKeysThatDidNotChange);
+    RUN_TEST(testEncoderUsesSharedSyncChangedPins);
+    RUN_TEST(testKeyboardScansWithBulkPins);
 
     UNITY_END();
 }